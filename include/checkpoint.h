@@ -0,0 +1,78 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "common.h"
+#include "seating.h"
+
+// Punkt kontrolny: obraz sali, prywatnego stanu obsługi (mapa grup, kolejka oczekujących,
+// rezerwacje), płatności w toku kasjera i wiadomości czekających w kolejkach żądań i odpowiedzi,
+// zapisany, gdy kierownik wstrzymał przybycia, klientów i kasjera. Plik ma stały układ (struktury jak
+// w pamięci) - przywrócenie mapuje go przez mmap() zamiast odtwarzać przebieg od t = 0.
+// Plik pasuje tylko do programów zbudowanych z tym samym układem struktur (state_size, seating_size).
+#define CHECKPOINT_MAGIC 0x5043424du  // "MBCP"
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_ENV "BAR_CHECKPOINT"  // Ścieżka zapisu (bar --checkpoint), domyślnie checkpoint_default_path()
+#define RESTORE_ENV "BAR_RESTORE"        // Ścieżka przywracanego punktu (bar --restore) - czyta ją obsługa
+
+// Etapy, od których wznawia się grupa przywrócona z punktu kontrolnego (klient --resume)
+#define RESUME_SEAT "seat"  // Czeka na stolik (kolejka oczekujących, żądanie lub odpowiedź w kolejce)
+#define RESUME_PAY "pay"    // Czeka na potwierdzenie płatności (płatność w kolejce lub u kasjera, potwierdzenie)
+#define RESUME_EAT "eat"    // Przy stoliku po zapłacie - je i oddaje naczynia
+
+typedef struct {
+    int queue;    // Klasa ruchu (QUEUE_*)
+    Message msg;
+} CheckpointMessage;
+
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int state_size;    // sizeof(SharedState)
+    unsigned int seating_size;  // sizeof(Seating)
+    int transport;              // Backend, w którym zapisano punkt (TRANSPORT_*)
+    int pending_count;          // Liczba elementów pending[]
+    long long sim_ms;           // Czas zegara symulacji w chwili zapisu
+    SharedState hall;           // Stan sali (pola niezwiązane z salą nie są przywracane)
+    Seating seating;            // Wskaźniki (state, on_reservation) ustawia przywracający
+    CheckpointMessage pending[];  // W kolejności klas: QUEUE_SEAT, QUEUE_DISHES, QUEUE_PAYMENT (na początku
+                                  // płatność w toku kasjera), QUEUE_CONTROL, QUEUE_SEAT_REPLY, QUEUE_PAY_REPLY
+} CheckpointFile;
+
+/**
+ * Zwraca domyślną ścieżkę punktu kontrolnego instancji
+ * (logs/checkpoint.bin dla instancji 0, logs/checkpoint-N.bin dla pozostałych).
+ */
+const char *checkpoint_default_path(void);
+
+/**
+ * Zwraca ścieżkę zapisu punktu kontrolnego (CHECKPOINT_ENV lub checkpoint_default_path()).
+ */
+const char *checkpoint_path(void);
+
+/**
+ * Zapisuje punkt kontrolny do pliku tymczasowego, utrwala go (fsync) i podmienia przez rename() -
+ * przerwany zapis nie niszczy poprzedniego punktu.
+ * @param hall - stan sali
+ * @param seating - stan usadzania obsługi
+ * @param pending - wiadomości zdjęte z kolejek (może być NULL przy count = 0)
+ * @return rozmiar pliku w bajtach lub -1 przy błędzie (errno)
+ */
+long checkpoint_write(const char *path, const SharedState *hall, const Seating *seating, long long sim_ms,
+                      const CheckpointMessage *pending, int count);
+
+/**
+ * Mapuje punkt kontrolny tylko do odczytu i sprawdza nagłówek.
+ * @param size - rozmiar mapowania (do checkpoint_unmap())
+ * @return wskaźnik do pliku lub NULL (EINVAL - plik uszkodzony lub z innym układem struktur)
+ */
+const CheckpointFile *checkpoint_map(const char *path, size_t *size);
+
+void checkpoint_unmap(const CheckpointFile *checkpoint, size_t size);
+
+/**
+ * Liczy miejsca zajęte przez grupę przy stolikach sali (rozmiar usadzonej grupy).
+ * @return rozmiar grupy lub 0, gdy grupa nie siedzi przy żadnym stoliku
+ */
+int checkpoint_group_size(const SharedState *hall, int group_id);
+
+#endif // CHECKPOINT_H
@@ -4,6 +4,7 @@
 #define _POSIX_C_SOURCE 200809L
 #define _XOPEN_SOURCE 700
 #define _DEFAULT_SOURCE
+#define _GNU_SOURCE  // semtimedop() i inne rozszerzenia Linuksa
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -35,6 +36,14 @@
 // Czas symulacji (w sekundach)
 #define SIMULATION_TIME 30
 
+// Przebieg długotrwały (bar --soak S): czas trwania w sekundach zamiast SIMULATION_TIME, ciągłe
+// przybycia klientów, bez pożaru; domyślny harmonogram kierownika powtarza rezerwację co okres
+#define SOAK_ENV "BAR_SOAK"
+#define SOAK_RESERVE_PERIOD_S 60
+// Odstęp przybyć w przebiegu długotrwałym: kasjer obsługuje jedną grupę na PAYMENT_TIME, więc przy
+// CLIENT_ARRIVAL_INTERVAL_MS kolejka do kasy (i liczba procesów klientów) rośnie bez ograniczenia
+#define SOAK_ARRIVAL_INTERVAL_MS 1500
+
 // Liczba klientów (grup) do wygenerowania na starcie symulacji
 #define TOTAL_CLIENTS 30
 
@@ -44,6 +53,22 @@
 // Czas jedzenia klienta (w sekundach)
 #define EATING_TIME 3
 
+// Czas obsługi płatności przez kasjera (w sekundach)
+#define PAYMENT_TIME 1
+
+// Czas odbioru dania po zapłacie (w sekundach)
+#define DISH_PICKUP_TIME 1
+
+// Odstęp między przybyciem kolejnych grup klientów (w milisekundach)
+#define CLIENT_ARRIVAL_INTERVAL_MS 500
+
+// Przedziały identyfikatorów grup: węzeł N numeruje grupy w [N * GROUP_ID_STRIDE, (N + 1) * GROUP_ID_STRIDE).
+// Węzeł 0 to bar (kolejne numery od 1, po wyczerpaniu przedziału od nowa), 1..GROUP_NODE_MAX - generatory
+// (generator --node N); numer nadaje uruchamiający, nie PID, więc generatory o różnych numerach nie
+// wysyłają tych samych group_id także z różnych hostów
+#define GROUP_ID_STRIDE (1 << 24)
+#define GROUP_NODE_MAX 126  // (GROUP_NODE_MAX + 1) * GROUP_ID_STRIDE mieści się w int
+
 // Czas wywołania sygnałów przez kierownika (w sekundach od startu symulacji)
 #define SIGNAL1_TIME 10   // Sygnał 1 (SIGUSR1)
 #define SIGNAL2_TIME 3   // Sygnał 2 (SIGUSR2)
@@ -52,12 +77,50 @@
 // Liczba stolików do rezerwacji przez kierownika (sygnał 2)
 #define RESERVED_TABLE_COUNT 2
 
+// Domyślny czas trwania rezerwacji kierownika (w milisekundach) - po nim stoliki wracają do sali
+#define RESERVATION_DEFAULT_MS 10000
+
+// Najdłuższe wstrzymanie przybyć, klientów i kasjera na czas zapisu punktu kontrolnego (w milisekundach)
+#define CHECKPOINT_WAIT_MS 2000
+
 // Klucz bazowy dla zasobów IPC
+// Każda instancja baru ma własną przestrzeń kluczy: IPC_KEY_BASE + instancja * IPC_INSTANCE_STRIDE + obiekt
+// (instancja 0 używa kluczy 0x00001011..0x0000101e)
 #define IPC_KEY_BASE 0x00001010
-#define SHM_KEY (IPC_KEY_BASE + 1) 
-#define MSG_KEY (IPC_KEY_BASE + 2)
-#define SEM_KEY (IPC_KEY_BASE + 3)  
-#define LOG_SEM_KEY (IPC_KEY_BASE + 4) 
+#define IPC_INSTANCE_STRIDE 0x10
+#define MAX_INSTANCES 4096
+#define INSTANCE_ENV "BAR_INSTANCE"  // Zmienna środowiskowa przekazująca numer instancji do ról
+
+// Obiekty IPC instancji (przesunięcia względem bazy instancji, patrz ipc_key())
+#define IPC_SHM 1
+#define IPC_RING 2      // Pierścienie transportu (tylko backend TRANSPORT_RING, patrz transport.h)
+#define IPC_SEM 3
+#define IPC_LOG_SEM 4
+#define IPC_LOCKPROF 5  // Wspólny profil blokad (tylko bar --lockprof, patrz lockprof.h)
+#define IPC_MSG_BASE 8  // Kolejki komunikatów: IPC_MSG_BASE + klasa ruchu (QUEUE_*)
+
+// Kolejki POSIX backendu TRANSPORT_MQ (nazwy zamiast kluczy): klasa ruchu instancji
+// oraz kolejki odpowiedzi zakładane przez grupę na czas jej cyklu życia
+#define MQ_NAME_FORMAT "/milkbar-%d-%d"           // instancja, klasa ruchu
+#define MQ_REPLY_NAME_FORMAT "/milkbar-%d-%d-%d"  // instancja, klasa odpowiedzi, group_id
+#define MQ_FS_DIR "/dev/mqueue"  // System plików mqueue (Linux) - wyliczanie kolejek odpowiedzi po awarii
+
+// Domyślne gniazda usług backendu TRANSPORT_SOCKET (instancja, "obsluga" lub "kasjer")
+#define SOCKET_PATH_FORMAT "unix:/tmp/milkbar-%d-%s.sock"
+
+// Klasy ruchu - każda ma własną kolejkę komunikatów, więc zator w jednej (np. płatności)
+// nie blokuje pozostałych (np. usadzania)
+#define QUEUE_SEAT 0        // Klient → Obsługa: MSG_TYPE_SEAT_REQUEST, MSG_TYPE_SEAT_AND_PAY
+#define QUEUE_DISHES 1      // Klient → Obsługa: MSG_TYPE_DISHES
+#define QUEUE_PAYMENT 2     // Klient (lub Obsługa - protokół potokowy) → Kasjer: MSG_TYPE_PAYMENT
+                            // (Kierownik → Kasjer: MSG_TYPE_FIRE)
+#define QUEUE_CONTROL 3     // Kierownik → Obsługa: MSG_TYPE_RESERVE_SEATS, MSG_TYPE_RELEASE_SEATS, MSG_TYPE_FIRE,
+                            // MSG_TYPE_CHECKPOINT
+#define QUEUE_POOL 4        // Bar → Klient z puli: MSG_TYPE_POOL_ASSIGN
+#define QUEUE_SEAT_REPLY 5  // Obsługa → Klient: stolik lub odmowa (mtype = group_id)
+#define QUEUE_PAY_REPLY 6   // Kasjer → Klient: potwierdzenie płatności ze stolikiem (mtype = group_id);
+                            // w protokole potokowym także odmowa stolika od Obsługi
+#define QUEUE_COUNT 7
 
 // structura przechowująca stan sali w pamięci dzielonej
 typedef struct {
@@ -83,20 +146,54 @@ typedef struct {
     int fire_alarm;       // Flaga pożaru (1 = pożar)
     time_t simulation_start_time;  // Czas startu symulacji (dla synchronizacji sygnałów)
     
+    // Pomiar startu (CLOCK_MONOTONIC w ns, patrz monotonic_ns())
+    long long startup_begin_ns;    // Bar zaczyna uruchamiać role
+    long long roles_ready_ns;      // Wszystkie role zgłosiły gotowość - start zegara symulacji
+    long long first_seat_ns;       // Obsługa usadziła pierwszą grupę
+    long long simulation_start_ns; // Start zegara symulacji - wspólna podstawa czasu dla skryptu kierownika
+    long long restored_ms;         // Czas zegara symulacji przywróconego punktu kontrolnego (0 = start od zera)
+    
     // Kolejka oczekujących klientów (dla wizualizacji)
     #define MAX_WAITING_GROUPS 50
     int waiting_group_ids[MAX_WAITING_GROUPS];    // ID grup czekających
     int waiting_group_sizes[MAX_WAITING_GROUPS];  // Rozmiary grup czekających
     int waiting_count;                            // Liczba grup w kolejce
+    
+    // Pula procesów klientów (tryb --pool), aktualizowana atomowo
+    int pool_size;        // Liczba procesów w puli
+    int pool_idle;        // Procesy czekające na przydział grupy
+    
+    // Przeciążenie kolejek: wysyłki, które zastały pełną kolejkę (per klasa QUEUE_*), aktualizowane atomowo
+    unsigned long queue_full[QUEUE_COUNT];
+
+    // Punkt kontrolny: kierownik zatrzymuje przybycia, klientów i kasjera, obsługa zapisuje spójny obraz
+    int checkpoint_active;         // Bar wstrzymuje przybycia nowych grup (ustawia kierownik)
+    unsigned int checkpoint_seq;   // Liczba punktów zapisanych przez obsługę (aktualizowana atomowo)
+    int cashier_updating;          // Kasjer odbiera płatność lub wysyła potwierdzenie - pola cashier_* niepewne
+    int cashier_group_id;          // Płatność w toku kasjera (0 = kasa wolna)
+    int cashier_group_size;
+    int cashier_table_type;
+    int cashier_table_index;
 } SharedState;
 
 //  kolejka komunikatów 
 #define MSG_TYPE_PAYMENT 1        // Klient → Kasjer: "chcę zapłacić"
 #define MSG_TYPE_DISHES 3         // Klient → Obsługa: "oddajemy naczynia"
 #define MSG_TYPE_SEAT_REQUEST 4   // Klient → Obsługa: "rezerwuj stolik dla grupy"
-#define MSG_TYPE_SEAT_CONFIRM 5   // Obsługa → Klient: "stolik zarezerwowany"
-#define MSG_TYPE_SEAT_REJECT 6    // Obsługa → Klient: "brak miejsca"
-#define MSG_TYPE_RESERVE_SEATS 7  // Kierownik → Obsługa: "zarezerwuj N miejsc"
+#define MSG_TYPE_SEAT_CONFIRM 5   // Obsługa → Klient: "stolik zarezerwowany" (w kolejce odpowiedzi mtype = group_id)
+#define MSG_TYPE_SEAT_REJECT 6    // Obsługa → Klient: "brak miejsca" (table_index = -1)
+#define MSG_TYPE_RESERVE_SEATS 7  // Kierownik → Obsługa: "zarezerwuj N stolików" (group_size = N,
+                                  // table_type = start za ms, table_index = czas trwania w ms, 0 = domyślny)
+#define MSG_TYPE_POOL_ASSIGN 8    // Bar → Klient z puli: "obsłuż grupę (group_id, group_size)"
+#define MSG_TYPE_RELEASE_SEATS 9  // Kierownik → Obsługa: "zwolnij zarezerwowane stoliki"
+#define MSG_TYPE_FIRE 10          // Kierownik → Obsługa, Kasjer (gniazda): "pożar" - usługi rozgłaszają go klientom
+#define MSG_TYPE_CHECKPOINT 11    // Kierownik → Obsługa: "zapisz punkt kontrolny" (patrz checkpoint.h)
+#define MSG_TYPE_SEAT_AND_PAY 12  // Klient → Obsługa (bar --pipeline): "rezerwuj stolik i przekaż płatność" - usadzona
+                                  // grupa trafia od razu do kasjera, odpowiedź (również odmowa) przychodzi
+                                  // w QUEUE_PAY_REPLY
+
+// Protokół potokowy (bar --pipeline): klienci wysyłają MSG_TYPE_SEAT_AND_PAY zamiast osobnych żądań
+#define PIPELINE_ENV "BAR_PIPELINE"
 
 // Struktura wiadomości
 typedef struct {
@@ -108,6 +205,13 @@ typedef struct {
 } Message;
 
 #define SEM_SHARED_STATE 0    // Mutex na pamięć dzieloną
+#define SEM_READY 1           // Licznik ról, które dołączyły do IPC (bariera gotowości)
+#define SEM_START 2           // Bramka startu: bar podnosi ją po starcie zegara symulacji
+#define SEM_COUNT 3
+
+// Role zgłaszające gotowość przed startem zegara: kasjer, obsługa, kierownik
+#define READY_ROLES 3
+#define READY_TIMEOUT_MS 5000
 
 #endif // COMMON_H
 
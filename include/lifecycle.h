@@ -0,0 +1,129 @@
+#ifndef LIFECYCLE_H
+#define LIFECYCLE_H
+
+#include "common.h"
+#include <stdint.h>
+
+// Rekordy cyklu życia grup: proces, który kończy pobyt grupy (klient, generator), zapisuje jeden
+// rekord o stałej szerokości do wspólnego pliku zmapowanego MAP_SHARED. Plik jest kolumnowy:
+// każde pole ma własny ciągły obszar (offset i szerokość w nagłówku), więc narzędzia analizy
+// (bin/lifequery, numpy.memmap) czytają kolumnę bez parsowania. Indeks rekordu to atomowe
+// fetch_add na liczniku w nagłówku - bez blokad między procesami; bajt "committed" jest
+// ustawiany na końcu (release), więc plik można czytać w trakcie przebiegu.
+#define LIFECYCLE_ENV "BAR_LIFECYCLE"   // Ścieżka pliku (bar --lifecycle PLIK)
+#define LIFECYCLE_MAGIC 0x434c4d42u     // "BMLC"
+#define LIFECYCLE_VERSION 2
+#define LIFECYCLE_MIN_CAPACITY (1 << 20)  // Rekordy w pliku (rzadkim - zajmuje tylko zapisane strony)
+#define LIFECYCLE_NAME_MAX 16
+#define LIFECYCLE_ALIGN 4096            // Początek każdej kolumny
+
+// Wynik pobytu grupy
+#define LIFECYCLE_SERVED 1       // Zjadła i oddała naczynia
+#define LIFECYCLE_REJECTED 2     // Brak miejsca
+#define LIFECYCLE_EVACUATED 3    // Pożar
+#define LIFECYCLE_NO_ORDER 4     // Nie zamówiła (NO_ORDER_PROBABILITY)
+#define LIFECYCLE_INTERRUPTED 5  // Koniec symulacji lub błąd przed końcem pobytu
+#define LIFECYCLE_OUTCOMES 6
+
+// Kolumny (kolejność w nagłówku); czasy: CLOCK_MONOTONIC w ns (0 = etap nieosiągnięty),
+// start zegara symulacji w nagłówku
+#define LC_COMMITTED 0     // uint8: 1 = rekord kompletny
+#define LC_GROUP_ID 1      // int32
+#define LC_GROUP_SIZE 2    // int8
+#define LC_OUTCOME 3       // int8: LIFECYCLE_*
+#define LC_TABLE_TYPE 4    // int8: 0 = bez stolika
+#define LC_TABLE_INDEX 5   // int16
+#define LC_ARRIVAL 6       // int64: wejście (po wznowieniu z punktu kontrolnego - wznowienie)
+#define LC_SEATED 7        // int64: odpowiedź obsługi ze stolikiem
+#define LC_PAY_WAIT 8      // int64: od wysłania płatności do potwierdzenia (ns)
+#define LC_EAT 9           // int64: czas jedzenia (ns)
+#define LC_DEPARTURE 10    // int64: wyjście
+#define LC_WRITER 11       // int32: PID procesu, który zapisał rekord
+#define LC_COLUMNS 12
+
+// Numery stolików każdego typu mieszczą się w kolumnie LC_TABLE_INDEX
+_Static_assert(X1 <= INT16_MAX && X2 <= INT16_MAX && X3_MAX <= INT16_MAX && X4 <= INT16_MAX,
+               "LC_TABLE_INDEX (int16) nie mieści numeru stolika - poszerz kolumnę");
+
+typedef struct {
+    char name[LIFECYCLE_NAME_MAX];
+    uint32_t width;    // Bajty na rekord
+    uint32_t reserved;
+    uint64_t offset;   // Od początku pliku
+} LifecycleColumn;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;
+    uint64_t next;         // Zarezerwowane indeksy (może przekroczyć capacity - nadmiar jest odrzucany)
+    uint64_t dropped;      // Rekordy bez miejsca w pliku
+    int64_t start_ns;      // Start zegara symulacji (CLOCK_MONOTONIC), 0 = nieznany
+    uint32_t column_count;
+    uint32_t reserved;
+    LifecycleColumn columns[LC_COLUMNS];
+} LifecycleHeader;
+
+// Rekord w pamięci procesu (przed zapisem do kolumn)
+typedef struct {
+    int32_t group_id;
+    int8_t group_size;
+    int8_t outcome;
+    int8_t table_type;
+    int16_t table_index;
+    int64_t arrival_ns;
+    int64_t seated_ns;
+    int64_t pay_wait_ns;
+    int64_t eat_ns;
+    int64_t departure_ns;
+} GroupLifecycle;
+
+extern int lifecycle_enabled;
+
+/**
+ * Tworzy plik rekordów (lub zostawia istniejący) i mapuje go do zapisu. Nowy plik powstaje
+ * pod nazwą tymczasową i jest dowiązywany po zapisaniu nagłówka - procesy otwierające go
+ * równolegle nigdy nie widzą niezainicjowanego nagłówka.
+ * @param path - ścieżka pliku
+ * @param capacity - liczba rekordów nowego pliku
+ * @param truncate - 1 = usuń istniejący plik (nowy przebieg baru), 0 = dopisuj do istniejącego
+ * @return 0 przy sukcesie, -1 przy błędzie (errno)
+ */
+int lifecycle_create(const char *path, uint64_t capacity, int truncate);
+
+/**
+ * Mapuje do zapisu plik wskazany przez LIFECYCLE_ENV (klient). Bez LIFECYCLE_ENV nic nie robi.
+ */
+void lifecycle_init(void);
+
+/**
+ * Zapisuje start zegara symulacji w nagłówku (bar po otwarciu bramki startu).
+ */
+void lifecycle_set_start(long long start_ns);
+
+/**
+ * Dopisuje rekord grupy (rezerwacja indeksu fetch_add, zapis kolumn, committed na końcu).
+ * @return indeks rekordu lub -1, gdy zapis jest wyłączony albo plik pełny
+ */
+long long lifecycle_append(const GroupLifecycle *record);
+
+/**
+ * Mapuje plik rekordów tylko do odczytu (narzędzia analizy).
+ * @param size - rozmiar mapowania (do munmap())
+ * @return nagłówek lub NULL (errno; EINVAL dla pliku innego formatu)
+ */
+const LifecycleHeader *lifecycle_map_read(const char *path, size_t *size);
+
+/**
+ * Zwraca początek kolumny w zmapowanym pliku.
+ */
+static inline const void *lifecycle_column(const LifecycleHeader *header, int column) {
+    return (const char *)header + header->columns[column].offset;
+}
+
+/**
+ * Zwraca nazwę wyniku pobytu ("obsłużona", ...).
+ */
+const char *lifecycle_outcome_name(int outcome);
+
+#endif // LIFECYCLE_H
@@ -0,0 +1,96 @@
+#ifndef LOCKPROF_H
+#define LOCKPROF_H
+
+#include "common.h"
+#include "utils.h"
+
+// Profil rywalizacji o semafory: czas czekania na wejście i czas trzymania, osobno dla każdego
+// miejsca wywołania (para: semafor, miejsce). Histogramy mają przedziały potęg dwójki w ns.
+// Procesy instancji baru (role, klienci, publikator) dopisują liczniki do wspólnego profilu
+// (segment IPC_LOCKPROF, miejsca rozpoznawane po nazwach), a jeden scalony raport najgorszych
+// miejsc wypisuje bar przy zamknięciu. Proces bez wspólnego profilu (wizualizacja, generator na
+// innym węźle) wypisuje własny raport przy wyjściu (do logu lub na stderr).
+// Wyłączony (brak LOCKPROF_ENV) kosztuje jedno sprawdzenie flagi przy wejściu i wyjściu.
+#define LOCKPROF_ENV "BAR_LOCKPROF"  // Liczba miejsc w raporcie (bar --lockprof N)
+#define LOCKPROF_MAX_SITES 16        // Miejsca jednego procesu
+#define LOCKPROF_SHARED_SITES 64     // Miejsca wspólnego profilu (wszystkie programy instancji)
+#define LOCKPROF_BUCKETS 32          // Przedział i: [2^i, 2^(i+1)) ns, ostatni otwarty
+
+// Liczniki miejsca (aktualizowane atomowo - także w pamięci współdzielonej)
+typedef struct {
+    unsigned long long count;
+    unsigned long long wait_total_ns;
+    unsigned long long wait_max_ns;
+    unsigned long long hold_total_ns;
+    unsigned long long hold_max_ns;
+    unsigned long long wait_hist[LOCKPROF_BUCKETS];
+    unsigned long long hold_hist[LOCKPROF_BUCKETS];
+} LockStats;
+
+// Wejście do sekcji krytycznej (wynik lockprof_acquired(), argument lockprof_released())
+typedef struct {
+    LockStats *stats;   // NULL - profil wyłączony
+    long long acquired_ns;
+} LockHold;
+
+extern int lockprof_enabled;
+
+/**
+ * Zakłada wspólny profil instancji (segment IPC_LOCKPROF, usuwa go cleanup_ipc()) - woła go bar
+ * przed lockprof_init() i uruchomieniem ról. Bez LOCKPROF_ENV nic nie robi.
+ * @return 0 przy sukcesie lub -1 przy błędzie (errno) - procesy raportują wtedy osobno
+ */
+int lockprof_create_shared(void);
+
+/**
+ * Włącza profil w procesie, jeśli ustawiono LOCKPROF_ENV. Proces raportujący do logu dołącza
+ * do wspólnego profilu instancji, jeśli ten istnieje; pozostałe rejestrują własny raport przy
+ * wyjściu (atexit).
+ * @param role - nazwa procesu w raporcie
+ * @param report - strumień raportu lub NULL (log_message())
+ */
+void lockprof_init(const char *role, FILE *report);
+
+/**
+ * Zapisuje czas czekania od wait_start_ns (wynik lockprof_begin() sprzed semop()).
+ * Nazwy muszą być stałymi napisami - miejsca są rozpoznawane po wskaźnikach.
+ * @return uchwyt sekcji do lockprof_released()
+ */
+LockHold lockprof_acquired_at(const char *lock, const char *site, long long wait_start_ns);
+
+/**
+ * Zapisuje czas trzymania semafora od lockprof_acquired_at().
+ */
+void lockprof_released_at(const LockHold *hold);
+
+/**
+ * Sprawdza, czy wątek trzyma semafor objęty profilem (wejście zagnieżdżone, np. log pod SEM_SHARED_STATE).
+ */
+int lockprof_holding(void);
+
+/**
+ * Wypisuje raport najdroższych miejsc (łączny czas czekania i trzymania) - raz na proces.
+ * Wspólny profil raportuje tylko jego założyciel (bar, po zakończeniu pozostałych procesów,
+ * przed usunięciem semafora logu); pozostali uczestnicy nie wypisują nic.
+ */
+void lockprof_report(void);
+
+static inline long long lockprof_begin(void) {
+    return __builtin_expect(lockprof_enabled, 0) ? monotonic_ns() : 0;
+}
+
+static inline LockHold lockprof_acquired(const char *lock, const char *site, long long wait_start_ns) {
+    if (__builtin_expect(lockprof_enabled, 0)) {
+        return lockprof_acquired_at(lock, site, wait_start_ns);
+    }
+    LockHold none = {NULL, 0};
+    return none;
+}
+
+static inline void lockprof_released(const LockHold *hold) {
+    if (__builtin_expect(hold->stats != NULL, 0)) {
+        lockprof_released_at(hold);
+    }
+}
+
+#endif // LOCKPROF_H
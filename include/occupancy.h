@@ -0,0 +1,81 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include "common.h"
+
+// Statystyki jednego typu stolików (1-, 2-, 3- lub 4-osobowych)
+typedef struct {
+    int tables;              // Liczba aktywnych stolików danego typu
+    int tables_free;         // Stoliki całkowicie wolne
+    int tables_partial;      // Stoliki częściowo zajęte
+    int tables_full;         // Stoliki pełne
+    int tables_reserved;     // Stoliki zarezerwowane przez kierownika (-1)
+    int tables_joinable[2];  // Stoliki, do których może dosiąść się grupa 1-os. [0] / 2-os. [1]
+    int seats_occupied;      // Zajęte miejsca
+    int seats_free;          // Wolne miejsca (bez zarezerwowanych)
+    int seats_reserved;      // Miejsca w zarezerwowanych stolikach
+    int seats_fragmented;    // Wolne miejsca bezużyteczne przez zasadę równoliczności grup
+} TableTypeStats;
+
+// Statystyki obłożenia całej sali
+typedef struct {
+    TableTypeStats type[4];  // type[0] = stoliki 1-os., ..., type[3] = stoliki 4-os.
+    TableTypeStats total;    // Suma po wszystkich typach
+} OccupancyStats;
+
+/**
+ * Liczy statystyki dla jednej tablicy stolików (np. table_3[]).
+ * Wersja wybierana w czasie działania: AVX2, SSE2 lub skalarna.
+ * @param occ - tablica obłożenia (0 = wolny, 1..capacity = zajęte, -1 = zarezerwowany)
+ * @param count - liczba stolików w tablicy
+ * @param capacity - liczba miejsc przy stoliku
+ * @param out - wynik (nadpisywany)
+ */
+void occupancy_scan_tables(const int *occ, int count, int capacity, TableTypeStats *out);
+
+/**
+ * Skalarna wersja occupancy_scan_tables() - wzorzec do sprawdzania wersji SIMD.
+ */
+void occupancy_scan_tables_scalar(const int *occ, int count, int capacity, TableTypeStats *out);
+
+/**
+ * Liczy statystyki obłożenia całej sali (uwzględnia effective_x3).
+ * Wywołujący odpowiada za spójność odczytu (semafor lub kopia stanu).
+ * @param state - stan sali
+ * @param out - wynik (nadpisywany)
+ */
+void occupancy_stats(const SharedState *state, OccupancyStats *out);
+
+/**
+ * Skalarna wersja occupancy_stats().
+ */
+void occupancy_stats_scalar(const SharedState *state, OccupancyStats *out);
+
+/**
+ * Porównuje wynik wersji SIMD z wersją skalarną dla podanego stanu sali.
+ * Tablice sali X1..X4 są krótsze niż wektor, więc obie drogi liczą pętlą skalarną - jądra SIMD
+ * sprawdza occupancy_scan_verify() (barbench --verify).
+ * @return 1 jeśli wyniki są identyczne, 0 w przeciwnym razie
+ */
+int occupancy_stats_verify(const SharedState *state);
+
+/**
+ * Test różnicowy jąder: każda wersja SIMD dostępna na tym procesorze (SSE2, AVX2) liczy całą
+ * tablicę, także krótszą niż wektor, i jest porównywana z pętlą skalarną.
+ * @return liczba jąder z wynikiem różnym od skalarnego (0 = zgodne)
+ */
+int occupancy_scan_verify(const int *occ, int count, int capacity);
+
+/**
+ * Sprawdza na podstawie statystyk, czy grupa danej wielkości zmieści się
+ * gdziekolwiek (zgodnie z regułami seating_find_free_table()).
+ * @return 1 jeśli istnieje pasujący stolik, 0 w przeciwnym razie
+ */
+int occupancy_can_seat(const OccupancyStats *stats, int group_size);
+
+/**
+ * Zwraca nazwę aktywnej implementacji ("avx2", "sse2" lub "scalar").
+ */
+const char *occupancy_backend(void);
+
+#endif // OCCUPANCY_H
@@ -0,0 +1,106 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include "common.h"
+#include "snapshot.h"
+#include <stdint.h>
+
+// Nagranie stanu sali: publikator (publisher --record PLIK) dopisuje każdą zmienioną próbkę SharedState
+// do pierścienia w pliku zmapowanym MAP_SHARED, w formacie strumienia stanu (SnapshotHeader + ładunek):
+// delta względem poprzedniej klatki, co jakiś czas klatka kluczowa. Po zapełnieniu pierścienia
+// najstarsze klatki są nadpisywane - początek nagrania jest zawsze klatką kluczową. Odtwarzanie:
+// viz --replay PLIK.
+#define RECORDING_MAGIC 0x43524d42u        // "BMRC"
+#define RECORDING_VERSION 1
+#define RECORDING_DEFAULT_MB 16
+#define RECORDING_DEFAULT_HZ 100           // bar --record bez --publish
+#define RECORDING_ALIGN 8                  // Początek każdej klatki w pierścieniu
+#define RECORDING_WRAP 3                   // Rodzaj klatki: znacznik końca danych przed zawinięciem pierścienia
+// Klatka kluczowa, gdy delty od poprzedniej przekroczą 4 jej rozmiary - skok w nagraniu nakłada
+// najwyżej tyle bajtów delt, a klatki kluczowe zajmują co najwyżej 1/5 pierścienia
+#define RECORDING_KEY_BYTES (sizeof(SnapshotHeader) + sizeof(SharedState))
+#define RECORDING_KEY_INTERVAL (4 * RECORDING_KEY_BYTES)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t state_size;   // sizeof(SharedState) nagrywającego - odtwarzanie odrzuca niezgodne nagranie
+    uint32_t hz;           // Częstotliwość próbkowania
+    uint64_t capacity;     // Bajty pierścienia (za nagłówkiem)
+    // Pozycje logiczne (rosną bez końca, w pierścieniu modulo capacity); aktualizowane po zapisie klatki
+    uint64_t tail;         // Najstarsza klatka (kluczowa)
+    uint64_t head;         // Koniec ostatniej klatki
+    uint64_t frames;       // Klatki zapisane od początku nagrania
+    uint64_t keyframes;
+    uint64_t evicted;      // Klatki nadpisane po zapełnieniu pierścienia
+} RecordingHeader;
+
+// Nagranie otwarte do zapisu
+typedef struct {
+    RecordingHeader *header;
+    unsigned char *data;       // Pierścień
+    size_t map_size;
+    uint64_t last_key;         // Pozycja ostatniej klatki kluczowej
+    uint64_t since_key;        // Bajty delt od ostatniej klatki kluczowej
+} Recording;
+
+// Klatka w indeksie odtwarzania
+typedef struct {
+    uint64_t offset;       // W pierścieniu
+    int64_t sampled_ns;
+    uint32_t kind;         // SNAPSHOT_KEYFRAME / SNAPSHOT_DELTA
+    uint32_t key;          // Indeks klatki kluczowej, od której trzeba odtwarzać
+} RecordingFrame;
+
+// Nagranie otwarte do odtwarzania
+typedef struct {
+    const RecordingHeader *header;
+    const unsigned char *data;
+    size_t map_size;
+    RecordingFrame *frames;
+    size_t count;
+    size_t current;            // Klatka odtworzona w state (count = żadna)
+    SharedState state;
+} RecordingReplay;
+
+/**
+ * Tworzy plik nagrania z pustym pierścieniem (istniejący plik jest zastępowany).
+ * @param capacity - bajty pierścienia (co najmniej 4 klatki kluczowe)
+ * @param hz - częstotliwość próbkowania (informacyjnie, w nagłówku)
+ * @return 0 przy sukcesie, -1 przy błędzie (errno)
+ */
+int recording_create(Recording *rec, const char *path, uint64_t capacity, int hz);
+
+/**
+ * Dopisuje klatkę: deltę, gdy jest dostępna i ostatnia klatka kluczowa zostaje w pierścieniu,
+ * w przeciwnym razie klatkę kluczową. Zapis bez blokad i wywołań systemowych (memcpy do mapowania).
+ * @param state - pełny stan próbki
+ * @param delta - delta względem poprzedniej zapisanej klatki (snapshot_encode_delta())
+ * @param delta_len - długość delty lub -1, gdy jej nie ma (pierwsza klatka, zmiana zbyt duża)
+ */
+void recording_append(Recording *rec, uint64_t seq, int64_t sampled_ns, const SharedState *state,
+                      const unsigned char *delta, long delta_len);
+
+void recording_close(Recording *rec);
+
+/**
+ * Mapuje nagranie do odczytu i buduje indeks klatek od najstarszej klatki kluczowej.
+ * @return 0 przy sukcesie, -1 przy błędzie (errno; EINVAL dla pliku innego formatu)
+ */
+int recording_open(RecordingReplay *replay, const char *path);
+
+/**
+ * Ustawia replay->state na stan klatki index: kolejna klatka to jedna delta, skok - odtworzenie
+ * od najbliższej wcześniejszej klatki kluczowej.
+ * @return 0 przy sukcesie, -1 przy uszkodzonej klatce
+ */
+int recording_seek(RecordingReplay *replay, size_t index);
+
+/**
+ * Indeks ostatniej klatki spróbkowanej nie później niż sampled_ns (0, gdy wszystkie są późniejsze).
+ */
+size_t recording_find(const RecordingReplay *replay, int64_t sampled_ns);
+
+void recording_replay_close(RecordingReplay *replay);
+
+#endif // RECORDING_H
@@ -0,0 +1,49 @@
+#ifndef SCHEDPROF_H
+#define SCHEDPROF_H
+
+#include "common.h"
+#include <sched.h>
+
+// Profil uruchomienia ról usługowych (obsługa, kasjer, kierownik): przypięcie do osobnych rdzeni,
+// opcjonalnie SCHED_FIFO z mlockall(), i raport opóźnień planisty przy wyjściu. Bar ustawia zmienne
+// środowiskowe, rola stosuje profil sama w schedprof_init() - przed zgłoszeniem gotowości, więc
+// pomiar obejmuje tylko pracę w ustalonym profilu. Klienci i procesy pomocnicze dziedziczą po barze
+// pozostałe rdzenie (schedprof_confine_clients()).
+#define SCHEDPROF_CPUS_ENV "BAR_SERVICE_CPUS"    // Lista rdzeni ról (bar --service-cpus 1,2 / 1-3)
+#define SCHEDPROF_RT_ENV "BAR_SERVICE_RT"        // Priorytet SCHED_FIFO (bar --service-rt P)
+#define SCHEDPROF_REPORT_ENV "BAR_SCHED_REPORT"  // Raport bez zmiany profilu (bar --sched-report)
+
+// Kolejność ról przy przydziale rdzeni z listy (rola i dostaje i-ty rdzeń, modulo długość listy)
+#define SCHEDPROF_SLOT_OBSLUGA 0
+#define SCHEDPROF_SLOT_KASJER 1
+#define SCHEDPROF_SLOT_KIEROWNIK 2
+
+/**
+ * Parsuje listę rdzeni w formacie "1,3,5-7".
+ * @param list - lista rdzeni
+ * @param set - wynik (nadpisywany)
+ * @return liczba rdzeni w zbiorze lub -1 dla nieprawidłowej listy
+ */
+int schedprof_parse_cpus(const char *list, cpu_set_t *set);
+
+/**
+ * Stosuje profil roli usługowej ze zmiennych SCHEDPROF_*_ENV i rejestruje raport przy wyjściu (atexit).
+ * Bez zmiennych nic nie robi. Błędy (np. brak uprawnień do SCHED_FIFO) trafiają do logu, rola działa dalej.
+ * @param role - nazwa roli w logu
+ * @param slot - SCHEDPROF_SLOT_* (wybór rdzenia z listy)
+ */
+void schedprof_init(const char *role, int slot);
+
+/**
+ * Ogranicza proces wywołujący (bar) i jego przyszłe dzieci do rdzeni spoza listy ról usługowych.
+ * @return liczba rdzeni klientów, 0 gdy profil wyłączony lub nie zostaje żaden rdzeń (bez zmian), -1 przy błędzie
+ */
+int schedprof_confine_clients(void);
+
+/**
+ * Zapisuje do logu czas czekania roli w kolejce planisty, liczbę przydziałów CPU i wywłaszczeń
+ * od schedprof_init() - raz na proces. Wywoływany przy wyjściu.
+ */
+void schedprof_report(void);
+
+#endif // SCHEDPROF_H
@@ -0,0 +1,97 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include "common.h"
+
+// Koło czasowe: 1 slot = 1 ms, jeden obrót = SCHEDULE_WHEEL_SLOTS ms (potęga dwójki)
+#define SCHEDULE_WHEEL_SLOTS 1024
+
+// Akcje kierownika
+#define ACTION_DOUBLE 1   // Podwojenie stolików 3-osobowych (SIGUSR1 do obsługi)
+#define ACTION_RESERVE 2  // Rezerwacja N stolików (MSG_TYPE_RESERVE_SEATS)
+#define ACTION_RELEASE 3  // Zwolnienie wszystkich rezerwacji (MSG_TYPE_RELEASE_SEATS)
+#define ACTION_FIRE 4     // Pożar - ewakuacja i koniec symulacji
+#define ACTION_PAUSE 5    // Wstrzymanie obsługi i kasjera na N ms (SIGSTOP / SIGCONT)
+#define ACTION_RESUME 6   // Wewnętrzna: koniec pauzy
+#define ACTION_END 7      // Wewnętrzna: koniec symulacji (SIMULATION_TIME)
+#define ACTION_CHECKPOINT 8  // Zapis punktu kontrolnego przez obsługę (MSG_TYPE_CHECKPOINT)
+
+typedef struct ScheduledEvent {
+    long long due_ms;             // Czas od startu zegara symulacji
+    int action;
+    int arg;                      // Liczba stolików (reserve) lub czas pauzy w ms (pause)
+    int duration_ms;              // Czas trwania rezerwacji (reserve, 0 = RESERVATION_DEFAULT_MS)
+    int lead_ms;                  // Start rezerwacji za tyle ms od wysłania polecenia (reserve)
+    int line;                     // Linia skryptu (0 = zdarzenie domyślne lub wewnętrzne)
+    struct ScheduledEvent *next;
+} ScheduledEvent;
+
+typedef struct {
+    ScheduledEvent *slots[SCHEDULE_WHEEL_SLOTS];
+    long long cursor_ms;          // Najbliższy nieprzetworzony tick
+    int pending;                  // Liczba zaplanowanych zdarzeń
+} TimerWheel;
+
+/**
+ * Inicjalizuje puste koło czasowe (cursor_ms = 0).
+ */
+void wheel_init(TimerWheel *wheel);
+
+/**
+ * Planuje zdarzenie. Zdarzenia z tym samym czasem są wykonywane w kolejności dodania,
+ * zdarzenie z przeszłości wykonuje się przy najbliższym ticku.
+ * @return 0 przy sukcesie, -1 przy braku pamięci
+ */
+int wheel_add(TimerWheel *wheel, long long due_ms, int action, int arg, int line);
+
+/**
+ * Planuje rezerwację count stolików na duration_ms, zaczynającą się lead_ms po due_ms.
+ * @return 0 przy sukcesie, -1 przy braku pamięci
+ */
+int wheel_add_reservation(TimerWheel *wheel, long long due_ms, int count, int duration_ms, int lead_ms, int line);
+
+/**
+ * Przesuwa koło do now_ms i zwraca kolejne zdarzenie, którego czas minął.
+ * Zwrócone zdarzenie zwalnia wywołujący (free()).
+ * @return zdarzenie lub NULL, gdy do now_ms nie ma więcej zdarzeń
+ */
+ScheduledEvent *wheel_pop_due(TimerWheel *wheel, long long now_ms);
+
+/**
+ * @return czas najbliższego zdarzenia w ms lub -1, gdy koło jest puste
+ */
+long long wheel_next_due(const TimerWheel *wheel);
+
+/**
+ * Zwalnia wszystkie zaplanowane zdarzenia.
+ */
+void wheel_free(TimerWheel *wheel);
+
+/**
+ * Wczytuje skrypt kierownika: linie "<czas_ms> <akcja> [argumenty]", komentarze od '#'.
+ * Akcje: double, reserve [N [czas_ms [za_ms]]], release, fire, pause <ms>, checkpoint.
+ * @param error - opis pierwszego błędu z numerem linii (może być NULL)
+ * @return liczba wczytanych zdarzeń lub -1 przy błędzie
+ */
+int schedule_load(TimerWheel *wheel, const char *path, char *error, size_t error_size);
+
+/**
+ * Planuje zdarzenia odpowiadające stałym SIGNAL1_TIME, SIGNAL2_TIME i SIGNAL3_TIME
+ * (z ponowną próbą podwojenia po 3 s).
+ * @return liczba zaplanowanych zdarzeń
+ */
+int schedule_load_default(TimerWheel *wheel);
+
+/**
+ * Planuje zdarzenia przebiegu długotrwałego (SOAK_ENV): podwojenie X3 i pierwszą rezerwację,
+ * bez pożaru. Kierownik powtarza domyślną rezerwację co SOAK_RESERVE_PERIOD_S.
+ * @return liczba zaplanowanych zdarzeń
+ */
+int schedule_load_soak(TimerWheel *wheel);
+
+/**
+ * Zwraca nazwę akcji używaną w skrypcie ("double", "reserve", ...).
+ */
+const char *schedule_action_name(int action);
+
+#endif // SCHEDULE_H
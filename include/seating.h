@@ -0,0 +1,240 @@
+#ifndef SEATING_H
+#define SEATING_H
+
+#include "common.h"
+
+// Mapa grupa -> stolik: adresowanie otwarte po pełnym group_id (numer nadany przez bar lub
+// z przedziału generatora - identyfikatory nie muszą być małe ani kolejne)
+#define MAX_GROUPS 128  // Potęga dwójki, z zapasem ponad liczbę grup mieszczących się w sali
+#define GROUP_SLOT_FREE 0
+// Każda osoba może być osobną grupą; mapa zapełniona najwyżej w połowie zostaje z krótkimi łańcuchami,
+// a pełna odrzucałaby grupy przy wolnych stolikach - większa sala wymaga większego MAX_GROUPS
+_Static_assert(MAX_GROUPS >= 2 * MAX_PERSONS_DOUBLED && (MAX_GROUPS & (MAX_GROUPS - 1)) == 0,
+               "MAX_GROUPS musi być potęgą dwójki co najmniej 2 * MAX_PERSONS_DOUBLED");
+
+// Maksymalna długość kolejki oczekujących grup
+#define MAX_WAITING 50
+
+typedef struct {
+    int group_id;
+    int group_size;
+    int pipelined;    // Grupa wysłała MSG_TYPE_SEAT_AND_PAY - po usadzeniu jej płatność idzie do kasjera
+} WaitingClient;
+
+typedef struct {
+    int group_id;     // GROUP_SLOT_FREE lub group_id usadzonej grupy
+    int table_type;
+    int table_index;
+} SeatedGroup;
+
+// Stolik wskazany przez typ (1-4) i indeks w tablicy table_X[]
+typedef struct {
+    int type;
+    int index;
+    int seats;
+} TableRef;
+
+// Rezerwacje czasowe: czasy w ms od startu zegara symulacji, przedziały [start_ms, end_ms)
+#define TABLE_SLOTS (X1 + X2 + X3_MAX + X4)  // Wszystkie stoliki sali, także dostawiane 3-os.
+#define RESERVATIONS_PER_TABLE 8             // Pojemność indeksu przedziałów jednego stolika
+#define MAX_RESERVATIONS (TABLE_SLOTS * RESERVATIONS_PER_TABLE)
+
+// Przewidywany pobyt grupy od usadzenia do oddania naczyń - stolik, którego rezerwacja
+// zaczyna się wcześniej, nie dostaje nowych grup
+#define EXPECTED_STAY_MS ((PAYMENT_TIME + DISH_PICKUP_TIME + EATING_TIME) * 1000LL)
+
+// Stan rezerwacji
+#define RESERVATION_FREE 0     // Wolny element puli
+#define RESERVATION_PENDING 1  // Czeka na start
+#define RESERVATION_WAITING 2  // Start minął, ale przy stoliku siedzi jeszcze grupa
+#define RESERVATION_ACTIVE 3   // Stolik oznaczony -1 w sali
+
+// Zdarzenia zgłaszane przez ReservationCallback
+#define RESERVATION_STARTED 1
+#define RESERVATION_EXPIRED 2
+
+typedef struct {
+    long long start_ms;
+    long long end_ms;
+    int table;       // Numer stolika w indeksie (0..TABLE_SLOTS-1)
+    int generation;  // Unieważnia zdarzenia w kopcu po zwolnieniu elementu puli
+    int state;       // RESERVATION_*
+} Reservation;
+
+// Zdarzenie kopca rezerwacji (start lub koniec przedziału)
+typedef struct {
+    long long due_ms;
+    int id;          // Indeks w puli reservations[]
+    int generation;
+    int is_start;
+} ReservationEvent;
+
+/**
+ * Funkcja wywoływana, gdy rezerwacja zajmuje stolik lub wygasa.
+ * @param ctx - kontekst ustawiony w seating_set_reservation_callback()
+ * @param table - stolik rezerwacji
+ * @param event - RESERVATION_STARTED lub RESERVATION_EXPIRED
+ */
+typedef void (*ReservationCallback)(void *ctx, const TableRef *table, int event);
+
+// Stan algorytmu usadzania: sala (SharedState) + prywatne dane obsługi
+typedef struct {
+    SharedState *state;
+    SeatedGroup seated[MAX_GROUPS];
+    WaitingClient waiting_queue[MAX_WAITING];
+    int waiting_count;
+
+    // Rezerwacje: pula, indeks przedziałów per stolik (posortowany po start_ms, rozłączne
+    // przedziały) i kopiec min zdarzeń start/koniec z leniwym usuwaniem po generation
+    long long now_ms;
+    Reservation reservations[MAX_RESERVATIONS];
+    int free_reservations[MAX_RESERVATIONS];  // Stos wolnych elementów puli
+    int free_reservation_count;
+    int table_reservations[TABLE_SLOTS][RESERVATIONS_PER_TABLE];
+    int table_reservation_count[TABLE_SLOTS];
+    ReservationEvent reservation_events[2 * MAX_RESERVATIONS];
+    int reservation_event_count;
+    int waiting_reservations;  // Rezerwacje w stanie RESERVATION_WAITING
+    ReservationCallback on_reservation;
+    void *reservation_ctx;
+
+    // Stoliki spakowane po 4 bity w kolejności indeksu rezerwacji (alokator wygenerowany przez
+    // bin/seatgen): liczba zajętych miejsc albo 0xF dla stolika zarezerwowanego lub niedostawionego
+    unsigned long long packed_tables;
+} Seating;
+
+/**
+ * Funkcja wywoływana dla każdej grupy usadzonej z kolejki oczekujących.
+ * @param ctx - kontekst przekazany do seating_serve_waiting()
+ * @param client - usadzona grupa (kopia wpisu zdjętego z kolejki)
+ * @param table_type, table_index - przydzielony stolik
+ */
+typedef void (*SeatedCallback)(void *ctx, const WaitingClient *client, int table_type, int table_index);
+
+/**
+ * Inicjalizuje stan usadzania dla podanej sali (nie modyfikuje SharedState).
+ * Nie synchronizuje dostępu - wywołujący trzyma SEM_SHARED_STATE, jeśli sala jest współdzielona.
+ */
+void seating_init(Seating *seating, SharedState *state);
+
+/**
+ * Inicjalizuje prywatną salę (bez IPC) wartościami początkowymi jak create_shared_memory().
+ */
+void seating_init_hall(SharedState *state);
+
+/**
+ * Szuka stolika dla grupy zgodnie z zasadą równoliczności grup (pomija zarezerwowane).
+ * @return 1 jeśli znaleziono stolik, 0 w przeciwnym razie
+ */
+int seating_find_free_table(Seating *seating, int group_size, int *table_type, int *table_index);
+
+/**
+ * Ogólna wersja seating_find_free_table() - pętle po stolikach każdego typu, bez spakowanego stanu.
+ * Używana dla układów sali nieobsłużonych przez wygenerowany alokator i do weryfikacji.
+ */
+int seating_find_free_table_generic(Seating *seating, int group_size, int *table_type, int *table_index);
+
+/**
+ * Porównuje spakowany stan stolików z salą oraz wybór stolika wygenerowanego alokatora
+ * z seating_find_free_table_generic() dla grup 1-4 osobowych.
+ * @return 1 jeśli wyniki są identyczne, 0 w przeciwnym razie
+ */
+int seating_verify_fixed(Seating *seating);
+
+/**
+ * Zwraca opis aktywnego alokatora stolików (układ sali wygenerowanego alokatora albo "ogólny").
+ */
+const char *seating_allocator(void);
+
+/**
+ * Zajmuje miejsca przy stoliku.
+ * @return 0 przy sukcesie, -1 dla nieprawidłowego typu stolika
+ */
+int seating_allocate_table(Seating *seating, int table_type, int table_index, int group_size, int group_id);
+
+/**
+ * Zwalnia miejsca grupy przy stoliku (stolik zarezerwowany pozostaje zarezerwowany).
+ * @return 0 przy sukcesie, -1 dla nieprawidłowego typu stolika
+ */
+int seating_free_table(Seating *seating, int table_type, int table_index, int group_size, int group_id);
+
+/**
+ * Usadza grupę: szybka decyzja na podstawie occupancy_stats(), wyszukanie i zajęcie stolika,
+ * zapamiętanie stolika grupy.
+ * @return 1 jeśli grupa została usadzona, 0 jeśli brak miejsca
+ */
+int seating_seat_group(Seating *seating, int group_id, int group_size, int *table_type, int *table_index);
+
+/**
+ * Zwalnia stolik grupy (oddanie naczyń) i zwiększa licznik brudnych naczyń.
+ * @return 1 jeśli grupa miała stolik, 0 w przeciwnym razie
+ */
+int seating_release_group(Seating *seating, int group_id, int group_size);
+
+/**
+ * Kopiuje stan sali (stoliki, kolejkę oczekujących, liczniki miejsc) do innej struktury SharedState,
+ * np. z prywatnej sali obsługi do pamięci dzielonej czytanej przez wizualizację.
+ * Pola niezwiązane z salą (pożar, czasy startu, pula, liczniki kolejek) pozostają bez zmian.
+ */
+void seating_mirror(const SharedState *hall, SharedState *dst);
+
+/**
+ * Dodaje grupę do kolejki oczekujących (synchronizuje kolejkę z SharedState).
+ * @param pipelined - 1 dla grupy protokołu potokowego (MSG_TYPE_SEAT_AND_PAY), wraca w SeatedCallback
+ * @return 1 przy sukcesie, 0 gdy kolejka jest pełna
+ */
+int seating_enqueue(Seating *seating, int group_id, int group_size, int pipelined);
+
+/**
+ * Usadza grupy z początku kolejki oczekujących, dopóki są dla nich miejsca.
+ * @param on_seated - wywoływana dla każdej usadzonej grupy (może być NULL)
+ * @return liczba usadzonych grup
+ */
+int seating_serve_waiting(Seating *seating, SeatedCallback on_seated, void *ctx);
+
+/**
+ * Podwaja liczbę stolików 3-osobowych (sygnał 1).
+ * @return liczba dodanych miejsc lub 0, jeśli stoliki były już podwojone
+ */
+int seating_double_x3(Seating *seating);
+
+/**
+ * Ustawia funkcję zgłaszającą start i wygaśnięcie rezerwacji (może być NULL).
+ */
+void seating_set_reservation_callback(Seating *seating, ReservationCallback callback, void *ctx);
+
+/**
+ * Rezerwuje losowe stoliki na przedział [start_ms, end_ms) (sygnał 2). Kandydatem jest stolik
+ * bez kolidującej rezerwacji; przy rezerwacji od teraz stolik musi być też wolny.
+ * Dopisanie rezerwacji kosztuje O(log n) (indeks stolika i kopiec zdarzeń).
+ * Rezerwacje, których start już minął, zajmują stolik od razu.
+ * @param count - liczba stolików do zarezerwowania
+ * @param start_ms, end_ms - przedział rezerwacji (czas zegara symulacji)
+ * @param seed - stan generatora rand_r() (osobny strumień dla każdej symulacji)
+ * @param reserved - zarezerwowane stoliki (może być NULL)
+ * @param max_reserved - rozmiar tablicy reserved
+ * @return liczba zarezerwowanych stolików
+ */
+int seating_reserve_tables(Seating *seating, int count, long long start_ms, long long end_ms,
+                           unsigned int *seed, TableRef *reserved, int max_reserved);
+
+/**
+ * Przesuwa zegar rezerwacji do now_ms: zajmuje stoliki rezerwacji, których start minął
+ * (także te, na których grupa siedziała w chwili startu, jeśli już odeszła), i zwalnia
+ * stoliki rezerwacji, które wygasły.
+ * @return liczba stolików zwolnionych przez wygaśnięcie
+ */
+int seating_advance(Seating *seating, long long now_ms);
+
+/**
+ * @return czas najbliższego startu lub końca rezerwacji w ms albo -1, gdy brak rezerwacji
+ */
+long long seating_next_reservation_ms(Seating *seating);
+
+/**
+ * Zwalnia wszystkie rezerwacje, także przyszłe (przywraca zajęte stoliki jako wolne).
+ * @return liczba zwolnionych stolików
+ */
+int seating_release_reservations(Seating *seating);
+
+#endif // SEATING_H
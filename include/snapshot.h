@@ -0,0 +1,89 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "common.h"
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Strumień stanu sali: publikator (bin/publisher) próbkuje SharedState i rozsyła go
+// subskrybentom przez gniazdo Unix (przestrzeń abstrakcyjna, osobne dla każdej instancji).
+// Każda wiadomość to nagłówek SnapshotHeader i ładunek:
+//   SNAPSHOT_KEYFRAME - pełna kopia SharedState,
+//   SNAPSHOT_DELTA    - zmienione fragmenty względem poprzedniej klatki (seq - 1):
+//                       ciąg odcinków {uint32 przesunięcie w słowach, uint32 liczba słów, słowa...}.
+#define SNAPSHOT_MAGIC 0x50414e53  // "SNAP"
+#define SNAPSHOT_KEYFRAME 1
+#define SNAPSHOT_DELTA 2
+
+#define SNAPSHOT_DEFAULT_HZ 20
+#define SNAPSHOT_MAX_HZ 1000
+
+#define SNAPSHOT_WORDS (sizeof(SharedState) / sizeof(uint32_t))
+#define SNAPSHOT_MAX_PAYLOAD sizeof(SharedState)  // Delta większa od klatki kluczowej nie jest wysyłana
+
+_Static_assert(sizeof(SharedState) % sizeof(uint32_t) == 0, "SharedState musi składać się z pełnych słów");
+
+typedef struct {
+    uint32_t magic;
+    uint32_t kind;         // SNAPSHOT_KEYFRAME / SNAPSHOT_DELTA
+    uint32_t state_size;   // sizeof(SharedState) publikatora - klient odrzuca niezgodny strumień
+    uint32_t payload_len;  // Bajty ładunku za nagłówkiem
+    uint64_t seq;          // Numer klatki (kolejne próbki publikatora)
+    int64_t sampled_ns;    // monotonic_ns() w chwili próbkowania
+} SnapshotHeader;
+
+// Subskrybent strumienia: bieżący stan odtworzony z klatek i bufor odbioru
+typedef struct {
+    int fd;
+    SharedState state;       // Ostatnia odtworzona klatka
+    int have_state;          // Odebrano już klatkę kluczową
+    uint64_t seq;
+    int64_t sampled_ns;
+    unsigned char *in;       // Bufor odbioru (niepełna wiadomość)
+    size_t in_len;
+    size_t in_capacity;
+    unsigned long frames;    // Statystyki: klatki, w tym kluczowe, i odebrane bajty
+    unsigned long keyframes;
+    unsigned long long bytes;
+} SnapshotClient;
+
+/**
+ * Wypełnia adres gniazda publikatora bieżącej instancji (patrz ipc_instance()).
+ * @param addr - bufor na struct sockaddr_un
+ * @return długość adresu dla bind()/connect()
+ */
+socklen_t snapshot_socket_address(struct sockaddr_un *addr);
+
+/**
+ * Koduje różnicę między dwiema klatkami.
+ * Sąsiednie zmiany oddzielone mniej niż trzema niezmienionymi słowami są łączone w jeden odcinek.
+ * @param prev - poprzednia klatka
+ * @param cur - bieżąca klatka
+ * @param out - bufor o rozmiarze co najmniej SNAPSHOT_MAX_PAYLOAD
+ * @return długość ładunku w bajtach (0 = brak zmian) lub -1, gdy delta nie jest mniejsza od klatki kluczowej
+ */
+long snapshot_encode_delta(const SharedState *prev, const SharedState *cur, unsigned char *out);
+
+/**
+ * Nakłada deltę na stan.
+ * @return 0 przy sukcesie, -1 przy niepoprawnym ładunku (stan może być wtedy częściowo zmieniony)
+ */
+int snapshot_apply_delta(SharedState *state, const unsigned char *payload, size_t len);
+
+/**
+ * Łączy się z publikatorem bieżącej instancji.
+ * @return 0 przy sukcesie, -1 przy błędzie (errno z connect(), np. ECONNREFUSED gdy publikator nie działa)
+ */
+int snapshot_connect(SnapshotClient *client);
+
+/**
+ * Odbiera dostępne wiadomości i nakłada je na client->state.
+ * @param timeout_ms - maksymalny czas oczekiwania na pierwszą wiadomość (0 = bez czekania, -1 = bez limitu)
+ * @return liczba odtworzonych klatek (0 = brak nowych), -1 po rozłączeniu lub błędzie protokołu
+ */
+int snapshot_receive(SnapshotClient *client, int timeout_ms);
+
+void snapshot_close(SnapshotClient *client);
+
+#endif // SNAPSHOT_H
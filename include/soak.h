@@ -0,0 +1,61 @@
+#ifndef SOAK_H
+#define SOAK_H
+
+#include "common.h"
+
+// Próbkowanie zasobów w przebiegu długotrwałym (bar --soak S). Co SOAK_SAMPLE_MS bar zapisuje dla
+// każdej roli RSS i liczbę deskryptorów, dla klientów liczbę procesów i największy RSS / liczbę
+// deskryptorów, dla instancji liczbę obiektów IPC, bajty w kolejkach i rozmiar logu z rotacjami.
+// Historia metryki ma stałą pamięć: SOAK_BUCKETS przedziałów (min, max), przy zapełnieniu sąsiednie
+// przedziały są łączone parami. Metryka "rośnie bez ograniczenia", gdy po rozgrzewce (pierwsza
+// ćwiartka przebiegu) minimum każdej z trzech kolejnych części jest większe od poprzedniego, a wzrost
+// przekracza tolerancję metryki - jednorazowy skok (np. pierwsze użycie rzadkiej ścieżki) nie wystarcza.
+#define SOAK_SAMPLE_MS 5000       // Domyślny odstęp próbek (bar --soak-sample-ms)
+#define SOAK_BUCKETS 1024
+#define SOAK_MAX_METRICS 32
+#define SOAK_MIN_SAMPLES 12       // Mniej próbek - brak werdyktu (przebieg za krótki)
+#define SOAK_RSS_TOLERANCE_KB 256
+#define SOAK_LOG_MAX_MB 8         // Limit pliku logu w przebiegu długotrwałym bez --log-max-mb
+#define SOAK_CSV_FORMAT "logs/soak-%d.csv"  // Instancja; instancja 0: logs/soak.csv
+
+/**
+ * Przygotowuje próbkowanie i otwiera plik CSV próbek.
+ * @param log_bound - limit łącznego rozmiaru logu z rotacjami w bajtach (0 = bez rotacji wg rozmiaru)
+ * @return 0 przy sukcesie, -1 gdy nie można utworzyć pliku CSV
+ */
+int soak_init(long long log_bound);
+
+/**
+ * Zaczyna próbkę (zeruje wartości zbierane z procesów).
+ */
+void soak_begin_sample(void);
+
+/**
+ * Zbiera RSS i liczbę deskryptorów roli (pid <= 0 - rola nie działa, wartości pominięte).
+ * Nazwa musi być stałym napisem.
+ */
+void soak_process(const char *role, pid_t pid);
+
+/**
+ * Dolicza proces klienta do metryk "klienci.*".
+ */
+void soak_client(pid_t pid);
+
+/**
+ * Kończy próbkę: obiekty IPC i bajty kolejek instancji, rozmiar logu, zapis wiersza CSV.
+ * @param elapsed_ms - czas od startu zegara symulacji
+ */
+void soak_end_sample(long long elapsed_ms);
+
+/**
+ * Ocenia historię każdej metryki i zapisuje raport do logu oraz na stdout.
+ * @return liczba metryk rosnących bez ograniczenia (0 = przebieg bez wycieków)
+ */
+int soak_report(void);
+
+/**
+ * @return ścieżka pliku CSV próbek bieżącej instancji
+ */
+const char *soak_csv_path(void);
+
+#endif // SOAK_H
@@ -0,0 +1,98 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "common.h"
+#include <stdint.h>
+
+// Śledzenie etapów cyklu życia: każdy proces zapisuje odcinki (początek CLOCK_MONOTONIC + czas
+// trwania) do własnego bufora - pliku TRACE_FILE_FORMAT zmapowanego MAP_SHARED, więc dane
+// przetrwają także zabicie procesu. bin/tracemerge scala bufory w JSON formatu Chrome / Perfetto.
+// Wyłączone (brak TRACE_ENV) kosztuje jedno sprawdzenie flagi w punkcie śledzenia.
+#define TRACE_ENV "BAR_TRACE"                // Katalog buforów (bar --trace KATALOG)
+#define TRACE_FILE_FORMAT "%s/trace-%d.bin"  // katalog, PID
+#define TRACE_MAGIC 0x52544d42u              // "BMTR"
+#define TRACE_VERSION 1
+#define TRACE_CAPACITY 65536                 // Odcinki na proces (plik rzadki - zajmuje tylko zapisane strony)
+#define TRACE_ROLE_MAX 16
+
+// Punkty śledzenia (indeksy trace_event_name())
+#define TRACE_LOG 0              // log_message(): formatowanie, semafor logu, zapis (każdy proces)
+#define TRACE_KLIENT_REQUEST 1   // Wysłanie żądania stolika
+#define TRACE_KLIENT_SEAT 2      // Oczekiwanie na stolik (od wysłania żądania do odpowiedzi)
+#define TRACE_KLIENT_PAY 3       // Płatność: wysłanie i oczekiwanie na potwierdzenie
+#define TRACE_KLIENT_PICKUP 4    // Odbiór dania
+#define TRACE_KLIENT_EAT 5       // Jedzenie
+#define TRACE_KLIENT_DISHES 6    // Oddanie naczyń
+#define TRACE_OBSLUGA_DEQUEUE 7  // Odbiór żądania z kolejki (arg = typ wiadomości)
+#define TRACE_OBSLUGA_LOCK 8     // Oczekiwanie na SEM_SHARED_STATE (z przesunięciem rezerwacji)
+#define TRACE_OBSLUGA_ALLOCATE 9 // Szukanie i zajęcie stolika (arg = 1 usadzona, 0 brak miejsca)
+#define TRACE_OBSLUGA_RELEASE 10 // Zwolnienie stolika i obsługa kolejki oczekujących (arg = usadzone z kolejki)
+#define TRACE_OBSLUGA_REPLY 11   // Wysłanie odpowiedzi do grupy
+#define TRACE_KASJER_RECEIVE 12  // Odbiór płatności z kolejki
+#define TRACE_KASJER_PAYMENT 13  // Obsługa płatności (PAYMENT_TIME)
+#define TRACE_KASJER_REPLY 14    // Wysłanie potwierdzenia płatności
+#define TRACE_EVENT_COUNT 15
+
+typedef struct {
+    int64_t begin_ns;
+    int64_t duration_ns;
+    int32_t event;     // TRACE_*
+    int32_t group_id;  // 0 = poza grupą
+    int32_t arg;
+    int32_t reserved;
+} TraceEvent;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t pid;
+    uint32_t capacity;
+    uint32_t count;      // Zapisane odcinki (może przekroczyć capacity - nadmiar jest pomijany)
+    uint32_t reserved;
+    char role[TRACE_ROLE_MAX];
+    TraceEvent events[];
+} TraceBuffer;
+
+extern int trace_enabled;
+
+/**
+ * Włącza śledzenie w procesie, jeśli ustawiono TRACE_ENV: zakłada bufor procesu w katalogu
+ * śledzenia i podpina odcinki log_message(). Bez TRACE_ENV nic nie robi.
+ * @param role - nazwa roli w scalonym śladzie ("klient", "obsluga", ...)
+ */
+void trace_init(const char *role);
+
+/**
+ * Usuwa bufory poprzedniego przebiegu z katalogu śledzenia (bar przed uruchomieniem ról).
+ * @return liczba usuniętych plików lub -1, gdy katalogu nie można utworzyć
+ */
+int trace_reset_dir(const char *dir);
+
+/**
+ * Zapisuje odcinek od begin_ns do teraz (wywoływane przez TRACE_END()).
+ */
+void trace_record(int event, long long begin_ns, int group_id, int arg);
+
+/**
+ * Zwraca nazwę punktu śledzenia ("klient.seat", ...).
+ */
+const char *trace_event_name(int event);
+
+// Początek odcinka: 0 bez wywołania zegara, gdy śledzenie jest wyłączone
+static inline long long trace_begin(void) {
+    if (__builtin_expect(trace_enabled, 0)) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+    return 0;
+}
+
+#define TRACE_END(event, begin_ns, group_id, arg)                    \
+    do {                                                              \
+        if (__builtin_expect(trace_enabled, 0)) {                     \
+            trace_record((event), (begin_ns), (group_id), (arg));     \
+        }                                                             \
+    } while (0)
+
+#endif // TRACE_H
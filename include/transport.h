@@ -0,0 +1,199 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "common.h"
+
+// Transport wiadomości między rolami - wspólne API dla wszystkich klas ruchu (QUEUE_*).
+// Backend wybiera bar (--transport) i przekazuje go rolom przez zmienną środowiskową TRANSPORT_ENV.
+//   TRANSPORT_SYSV - kolejki komunikatów System V (msgsnd/msgrcv, po jednej na klasę ruchu)
+//   TRANSPORT_RING - pierścienie w pamięci współdzielonej (bez wywołań systemowych na ścieżce
+//                    wysyłki i odbioru; futex tylko wtedy, gdy odbiorca śpi na pustym pierścieniu)
+//   TRANSPORT_MQ   - kolejki POSIX (mq_open, nazwy MQ_NAME_FORMAT); deskryptor kolejki można dodać
+//                    do epoll razem z signalfd i timerfd (patrz transport_poll_fd())
+//   TRANSPORT_SOCKET - gniazda TCP lub unix (protokół wire.h): obsługa i kasjer są usługami,
+//                    z którymi łączą się klienci, także z innych węzłów; odpowiedzi wracają tym
+//                    samym połączeniem, wiadomości są łączone w ramki do transport_flush()
+#define TRANSPORT_SYSV 0
+#define TRANSPORT_RING 1
+#define TRANSPORT_MQ 2
+#define TRANSPORT_SOCKET 3
+#define TRANSPORT_ENV "BAR_TRANSPORT"  // "sysv", "ring", "mq" lub "socket"
+#define TRANSPORT_WAIT_SLICE_MS 100  // Maksymalny pojedynczy sen odbiorcy - potem ponowne sprawdzenie przerwania
+
+// Pierścienie żądań: kolejka ograniczona wielu producentów / wielu konsumentów (numery sekwencyjne
+// w komórkach), w praktyce MPSC - jedynie pula klientów ma wielu odbiorców
+#define RING_CAPACITY 256  // Potęga dwójki
+
+// Kolejki POSIX: odpowiedzi trafiają do kolejek grupy (MQ_REPLY_NAME_FORMAT) zakładanych przez
+// transport_mailbox_open(); grupa czeka najwyżej na jedną odpowiedź danej klasy naraz
+#define MQ_REPLY_CAPACITY 2
+#define MQ_MSG_MAX_PATH "/proc/sys/fs/mqueue/msg_max"  // Limit pojemności bez CAP_SYS_RESOURCE
+
+// Gniazda: usługa obsługi (QUEUE_SEAT, QUEUE_DISHES, QUEUE_CONTROL, odpowiedzi QUEUE_SEAT_REPLY)
+// i usługa kasjera (QUEUE_PAYMENT, odpowiedzi QUEUE_PAY_REPLY). QUEUE_POOL zostaje lokalną kolejką
+// System V węzła baru. Adres usługi: zmienna środowiskowa, domyślnie gniazdo unix SOCKET_PATH_FORMAT.
+#define SOCKET_SEATING 0
+#define SOCKET_CASHIER 1
+#define SOCKET_SERVICES 2
+#define SOCKET_SEATING_ENV "BAR_SEATING_ADDR"  // "unix:ŚCIEŻKA" lub "tcp:HOST:PORT"
+#define SOCKET_CASHIER_ENV "BAR_CASHIER_ADDR"
+#define SOCKET_MAX_PEERS 1024        // Połączenia klientów jednej usługi
+#define SOCKET_INBOX_CAPACITY 1024   // Odebrane, nieprzetworzone wiadomości jednej klasy ruchu
+#define SOCKET_ROUTE_SLOTS 4096      // group_id -> połączenie, którym ma wrócić odpowiedź (potęga dwójki)
+#define SOCKET_CONNECT_TIMEOUT_MS 3000  // Ponawianie połączenia z usługą, która jeszcze nie nasłuchuje
+
+// Odpowiedzi (QUEUE_SEAT_REPLY, QUEUE_PAY_REPLY): skrzynki grup w tablicy haszowanej po group_id
+#define MAILBOX_SLOTS 1024  // Potęga dwójki
+#define MAILBOX_FREE 0
+#define MAILBOX_DELETED -1
+
+typedef struct {
+    unsigned int seq;  // Numer sekwencyjny komórki (zapis: seq == pozycja, odczyt: seq == pozycja + 1)
+    Message msg;
+} RingCell;
+
+typedef struct {
+    _Alignas(64) unsigned int head;  // Następna pozycja do zapisu (producenci)
+    _Alignas(64) unsigned int tail;  // Następna pozycja do odczytu (konsumenci)
+    _Alignas(64) unsigned int wake;  // Słowo futeksu - zwiększane przy budzeniu
+    unsigned int waiters;            // Konsumenci śpiący (lub zasypiający) na pustym pierścieniu
+    RingCell cells[RING_CAPACITY];
+} Ring;
+
+typedef struct {
+    unsigned int full;  // Słowo futeksu: 0 = pusta, 1 = odpowiedź czeka na odbiór, 2 = nadawca ją zapisuje
+    Message msg;
+} Mailbox;
+
+typedef struct {
+    int owner;           // group_id, MAILBOX_FREE lub MAILBOX_DELETED
+    Mailbox box[2];      // [0] = odpowiedź obsługi, [1] = potwierdzenie płatności
+} MailboxSlot;
+
+// Segment pamięci współdzielonej backendu pierścieni (obiekt IPC_RING instancji)
+typedef struct {
+    Ring rings[QUEUE_COUNT];  // Używane tylko dla klas żądań (bez QUEUE_SEAT_REPLY, QUEUE_PAY_REPLY)
+    MailboxSlot mailboxes[MAILBOX_SLOTS];
+} RingTransport;
+
+/**
+ * Wybiera backend dla bieżącego procesu i eksportuje go do TRANSPORT_ENV (dziedziczą go role).
+ * @param backend - TRANSPORT_SYSV, TRANSPORT_RING, TRANSPORT_MQ lub TRANSPORT_SOCKET
+ */
+void transport_select(int backend);
+
+/**
+ * Parsuje nazwę backendu ("sysv", "ring", "mq", "socket").
+ * @return TRANSPORT_* lub -1 dla nieznanej nazwy
+ */
+int transport_parse(const char *name);
+
+/**
+ * Zwraca backend bieżącego procesu (z TRANSPORT_ENV, domyślnie TRANSPORT_SYSV).
+ */
+int transport_backend(void);
+
+const char *transport_name(int backend);
+
+/**
+ * Tworzy zasoby backendu w procesie baru (dla TRANSPORT_SYSV - nic, kolejki tworzy create_message_queues()).
+ */
+void transport_create(void);
+
+/**
+ * Usuwa zasoby backendu utworzone przez transport_create().
+ */
+void transport_destroy(void);
+
+/**
+ * Zwraca adres usługi backendu gniazd (zmienna SOCKET_*_ENV lub domyślne gniazdo unix instancji).
+ * @param service - SOCKET_SEATING lub SOCKET_CASHIER
+ */
+const char *transport_address(int service);
+
+/**
+ * Otwiera usługę backendu gniazd w bieżącym procesie: żądania jej klas ruchu są odbierane od
+ * połączonych klientów, a odpowiedzi wracają połączeniem, którym przyszło żądanie grupy.
+ * Dla pozostałych backendów nic nie robi.
+ * @param service - SOCKET_SEATING lub SOCKET_CASHIER
+ * @return 0 przy sukcesie, -1 gdy nie można nasłuchiwać pod adresem usługi
+ */
+int transport_listen(int service);
+
+/**
+ * Zamyka odziedziczone po fork() gniazda i połączenia backendu gniazd - proces potomny zaczyna
+ * bez usługi i bez połączeń (adres usługi nie jest usuwany).
+ */
+void transport_reset(void);
+
+/**
+ * Wysyła wiadomości czekające w ramkach backendu gniazd (dla pozostałych backendów nic nie robi).
+ * Odbiór z czekaniem wysyła je sam; usługa wywołuje to przed uśpieniem w epoll, a klient po
+ * ostatniej wysyłce.
+ */
+void transport_flush(void);
+
+/**
+ * Rozgłasza wiadomość do wszystkich klientów połączonych z usługą procesu (backend gniazd).
+ * Klient, który ją odbierze, ustawia transport_fire_alarm(), a jego odbiór kończy się EINTR.
+ * @return liczba klientów, do których wysłano wiadomość (0 dla pozostałych backendów)
+ */
+int transport_broadcast(const Message *msg);
+
+/**
+ * @return 1 jeśli proces odebrał rozgłoszony alarm pożarowy (backend gniazd), 0 w przeciwnym razie
+ */
+int transport_fire_alarm(void);
+
+/**
+ * Wysyła wiadomość danej klasy ruchu. Pełna kolejka zwiększa licznik queue_full[queue];
+ * bez IPC_NOWAIT nadawca czeka na miejsce.
+ * Odpowiedzi (QUEUE_SEAT_REPLY, QUEUE_PAY_REPLY) trafiają do grupy msg->mtype.
+ * @return 0 przy sukcesie, -1 przy błędzie (EAGAIN - kolejka pełna przy IPC_NOWAIT, ENOENT - brak skrzynki grupy)
+ */
+int transport_send(int queue, const Message *msg, int flags);
+
+/**
+ * Odbiera wiadomość danej klasy ruchu (semantyka jak msgrcv()).
+ * @param mtype - 0 = dowolna wiadomość; dla odpowiedzi group_id odbiorcy
+ * @param flags - 0 lub IPC_NOWAIT
+ * @return rozmiar treści wiadomości lub -1 (ENOMSG - brak wiadomości przy IPC_NOWAIT, EINTR - przerwanie)
+ */
+ssize_t transport_receive(int queue, Message *msg, long mtype, int flags);
+
+/**
+ * Kopiuje wiadomość o numerze index (0 = najstarsza) bez zdejmowania jej z kolejki - kolejność
+ * i zawartość kolejki zostają nietknięte (obraz kolejek w punkcie kontrolnym).
+ * TRANSPORT_SYSV: msgrcv() z MSG_COPY. TRANSPORT_RING: komórki pierścienia, dla klas odpowiedzi
+ * kolejne pełne skrzynki grup.
+ * @return 0 przy sukcesie, -1 przy błędzie (ENOMSG - brak wiadomości o tym numerze,
+ *         ENOSYS - backend lub jądro nie pozwala podejrzeć kolejki)
+ */
+int transport_peek(int queue, int index, Message *msg);
+
+/**
+ * Przerywa oczekujące i przyszłe transport_receive() w tym procesie (bezpieczne w procedurze obsługi sygnału).
+ */
+void transport_interrupt(void);
+
+/**
+ * Zwraca deskryptor, który epoll zgłasza jako gotowy do odczytu, gdy w kolejce czeka wiadomość.
+ * TRANSPORT_MQ: kolejka klasy żądań. TRANSPORT_SOCKET: epoll usługi procesu (ten sam dla wszystkich
+ * jej klas) lub połączenie z usługą dla klas odpowiedzi. Pozostałe backendy zwracają -1 i wymagają
+ * cyklicznego odpytywania (IPC_NOWAIT).
+ * @param queue - klasa ruchu
+ */
+int transport_poll_fd(int queue);
+
+/**
+ * Zakłada skrzynkę odpowiedzi grupy (pierścienie, kolejki POSIX) - przed wysłaniem pierwszego żądania.
+ * @return 0 przy sukcesie, -1 gdy tablica skrzynek jest pełna
+ */
+int transport_mailbox_open(int group_id);
+
+/**
+ * Zwalnia skrzynkę odpowiedzi grupy po zakończeniu jej cyklu życia.
+ */
+void transport_mailbox_close(int group_id);
+
+#endif // TRANSPORT_H
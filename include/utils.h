@@ -3,9 +3,72 @@
 
 #include "common.h"
 
+// Rotacja logu (bar --log-max-mb, --log-rotate-s): proces, który pod semaforem logu zastaje plik
+// większy od limitu albo z poprzedniego okresu, przenosi go do .1 (starsze do .2 .. .LOG_ROTATE_KEEP);
+// pozostałe procesy otwierają nowy plik przy najbliższym zapisie
+#define LOG_MAX_BYTES_ENV "BAR_LOG_MAX_BYTES"  // Limit rozmiaru pliku w bajtach (0 = bez limitu)
+#define LOG_ROTATE_S_ENV "BAR_LOG_ROTATE_S"    // Okres rotacji w s, wyrównany do zegara (0 = bez)
+#define LOG_ROTATE_KEEP 4                      // Liczba zachowywanych plików po rotacji
+
+/**
+ * Zwraca numer instancji baru (zmienna środowiskowa BAR_INSTANCE, domyślnie 0).
+ * @return numer instancji z zakresu 0..MAX_INSTANCES-1
+ */
+int ipc_instance(void);
+
+/**
+ * Ustawia numer instancji dla bieżącego procesu i eksportuje go do BAR_INSTANCE,
+ * dzięki czemu dziedziczą go wszystkie uruchamiane role.
+ * @param id - numer instancji
+ */
+void ipc_set_instance(int id);
+
+/**
+ * Wylicza klucz obiektu IPC dla bieżącej instancji.
+ * @param object - obiekt instancji (IPC_SHM, IPC_RING, IPC_SEM, IPC_LOG_SEM, IPC_MSG_BASE + QUEUE_*)
+ * @return klucz System V
+ */
+key_t ipc_key(int object);
+
+/**
+ * Zwraca ścieżkę pliku logu bieżącej instancji
+ * (logs/symulacja.log dla instancji 0, logs/symulacja-N.log dla pozostałych).
+ */
+const char *log_file_path(void);
+
+/**
+ * Sprawdza, czy instancja jest używana - istnieje jej pamięć współdzielona,
+ * a proces, który ją utworzył, nadal działa.
+ * @param id - numer instancji
+ * @return 1 jeśli instancja jest używana, 0 w przeciwnym razie
+ */
+int ipc_instance_in_use(int id);
+
+/**
+ * Usuwa wszystkie obiekty IPC instancji (pamięć, kolejki, semafory).
+ * @param id - numer instancji
+ * @return liczba usuniętych obiektów
+ */
+int ipc_remove_instance(int id);
+
+/**
+ * Usuwa obiekty IPC wszystkich nieużywanych instancji (pozostałości po awariach).
+ * @return liczba wyczyszczonych instancji
+ */
+int ipc_cleanup_stale(void);
+
+/**
+ * Rezerwuje instancję dla nowego baru: usuwa jej nieaktualne obiekty
+ * i tworzy pamięć współdzieloną z IPC_EXCL.
+ * @param requested - żądany numer instancji lub -1 (pierwsza wolna)
+ * @param stale_removed - liczba usuniętych nieaktualnych obiektów (może być NULL)
+ * @return numer zarezerwowanej instancji lub -1 w przypadku błędu
+ */
+int ipc_claim_instance(int requested, int *stale_removed);
+
 /**
  * Inicjalizuje logger - tworzy plik logu i semafor synchronizujący zapis.
- * Plik logu: logs/symulacja.log 
+ * Plik logu: logs/symulacja.log (patrz log_file_path()); pliki rotacji poprzedniego przebiegu są usuwane.
  */
 void init_logger(void);
 
@@ -14,6 +77,11 @@ void init_logger(void);
  */
 void close_logger(void);
 
+/**
+ * Zwraca łączny rozmiar pliku logu i plików jego rotacji w bajtach.
+ */
+long long log_total_bytes(void);
+
 /**
  * Zapisuje sformatowany komunikat do pliku logu z timestampem i PID.
  * Format: [HH:MM:SS] [PID:xxxxx] wiadomość
@@ -22,6 +90,12 @@ void close_logger(void);
  */
 void log_message(const char *format, ...);
 
+/**
+ * Wywoływana po każdym log_message() z chwilą jego rozpoczęcia (monotonic_ns()), gdy ustawiona.
+ * Ustawia ją trace_init() - utils.o nie zależy od modułu śledzenia.
+ */
+extern void (*log_trace_hook)(long long begin_ns);
+
 /**
  * Tworzy segment pamięci współdzielonej dla stanu sali (SharedState).
  * Inicjalizuje strukturę wartościami początkowymi.
@@ -30,14 +104,14 @@ void log_message(const char *format, ...);
 int create_shared_memory(void);
 
 /**
- * Tworzy kolejkę komunikatów IPC dla wymiany wiadomości między procesami.
- * @return ID kolejki komunikatów
+ * Tworzy kolejki komunikatów wszystkich klas ruchu (QUEUE_*) i ustawia ich pojemność przez msgctl(IPC_SET).
+ * Gdy limitu nie można podnieść (brak uprawnień), kolejka zostaje z limitem domyślnym.
  */
-int create_message_queue(void);
+void create_message_queues(void);
 
 /**
  * Tworzy zbiór semaforów do synchronizacji dostępu do zasobów.
- * Inicjalizuje semafor SEM_SHARED_STATE wartością 1 (mutex).
+ * Inicjalizuje semafor SEM_SHARED_STATE wartością 1 (mutex) oraz SEM_READY i SEM_START wartością 0.
  * @return ID zbioru semaforów
  */
 int create_semaphores(void);
@@ -49,10 +123,37 @@ int create_semaphores(void);
 SharedState* get_shared_memory(void);
 
 /**
- * Pobiera ID istniejącej kolejki komunikatów.
- * @return ID kolejki komunikatów lub -1 w przypadku błędu
+ * Pobiera ID istniejącej kolejki komunikatów klasy ruchu (zapamiętywane w procesie).
+ * @param queue - klasa ruchu (QUEUE_*)
+ * @return ID kolejki komunikatów
+ */
+int get_message_queue(int queue);
+
+/**
+ * Wysyła wiadomość do kolejki klasy ruchu. Najpierw próbuje bez czekania; pełna kolejka
+ * zwiększa licznik SharedState.queue_full[queue]. Bez IPC_NOWAIT w flags czeka potem na miejsce.
+ * @param queue - klasa ruchu (QUEUE_*)
+ * @param msg - wiadomość
+ * @param flags - 0 lub IPC_NOWAIT
+ * @return 0 przy sukcesie, -1 przy błędzie (EAGAIN - kolejka pełna przy IPC_NOWAIT)
+ */
+int queue_send(int queue, const Message *msg, int flags);
+
+/**
+ * Zwiększa licznik przepełnień SharedState.queue_full[queue] (wspólny dla wszystkich backendów transportu).
+ * @param queue - klasa ruchu (QUEUE_*)
+ */
+void queue_note_full(int queue);
+
+/**
+ * Zwraca docelową pojemność kolejki klasy ruchu (w wiadomościach).
+ */
+int queue_capacity(int queue);
+
+/**
+ * Zwraca nazwę klasy ruchu (do logów).
  */
-int get_message_queue(void);
+const char *queue_name(int queue);
 
 /**
  * Pobiera ID istniejącego zbioru semaforów.
@@ -61,7 +162,36 @@ int get_message_queue(void);
 int get_semaphores(void);
 
 /**
- * Zwalnia wszystkie zasoby IPC (pamięć współdzielona, kolejka, semafory).
+ * Zwraca bieżący czas CLOCK_MONOTONIC w nanosekundach.
+ */
+long long monotonic_ns(void);
+
+/**
+ * Zgłasza gotowość roli (po dołączeniu do IPC) - zwiększa semafor SEM_READY.
+ */
+void role_signal_ready(void);
+
+/**
+ * Czeka na bramce SEM_START, aż bar wystartuje zegar symulacji.
+ * @return 0 po otwarciu bramki, -1 jeśli oczekiwanie przerwano (np. sygnał zakończenia)
+ */
+int role_wait_start(void);
+
+/**
+ * Czeka (w procesie baru), aż podana liczba ról zgłosi gotowość.
+ * @param count - liczba ról
+ * @param timeout_ms - maksymalny czas oczekiwania
+ * @return 0 gdy wszystkie role są gotowe, -1 po upływie czasu lub przerwaniu sygnałem
+ */
+int wait_roles_ready(int count, int timeout_ms);
+
+/**
+ * Otwiera bramkę SEM_START dla podanej liczby ról czekających w role_wait_start().
+ */
+void release_start_gate(int count);
+
+/**
+ * Zwalnia wszystkie zasoby IPC (pamięć współdzielona, kolejki, semafory).
  * Wywołuje także close_logger().
  */
 void cleanup_ipc(void);
@@ -0,0 +1,94 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include "common.h"
+
+// Protokół wiadomości przez gniazda (backend TRANSPORT_SOCKET): ramka = 4-bajtowa długość treści
+// (big-endian) + do WIRE_BATCH_MAX wiadomości po WIRE_MESSAGE_SIZE bajtów. Wiadomość na łączu to
+// klasa ruchu (QUEUE_* lub WIRE_BROADCAST) i pola Message jako int32 w kolejności sieciowej.
+#define WIRE_BATCH_MAX 64
+#define WIRE_MESSAGE_SIZE 24
+#define WIRE_HEADER_SIZE 4
+#define WIRE_FRAME_MAX (WIRE_HEADER_SIZE + WIRE_BATCH_MAX * WIRE_MESSAGE_SIZE)
+#define WIRE_OUT_FRAMES 16                           // Ramki czekające na wysłanie, zanim nadawca poczeka
+#define WIRE_IN_SIZE (4 * WIRE_FRAME_MAX)            // Bufor odczytu połączenia
+#define WIRE_BROADCAST QUEUE_COUNT                   // Klasa komunikatów rozgłaszanych (pożar)
+
+// Adres usługi: "unix:ŚCIEŻKA" lub "tcp:HOST:PORT"
+#define WIRE_ADDR_MAX 108
+
+typedef struct {
+    int fd;
+    unsigned char out[WIRE_OUT_FRAMES * WIRE_FRAME_MAX];
+    size_t out_len;       // Bajty do wysłania (ramki zamknięte i bieżąca)
+    size_t frame_start;   // Początek otwartej ramki w out (gdy frame_count > 0)
+    int frame_count;      // Wiadomości w otwartej ramce
+    unsigned char in[WIRE_IN_SIZE];
+    size_t in_len;
+    size_t in_pos;
+    int in_frame_left;    // Wiadomości pozostałe w bieżącej ramce odczytu
+} WireConn;
+
+/**
+ * Otwiera gniazdo nasłuchujące usługi (dla unix: usuwa starą ścieżkę).
+ * @param addr - adres w formacie "unix:ŚCIEŻKA" lub "tcp:HOST:PORT"
+ * @return deskryptor (nieblokujący) lub -1 przy błędzie
+ */
+int wire_listen(const char *addr);
+
+/**
+ * Łączy się z usługą (blokująco), po czym przełącza gniazdo w tryb nieblokujący.
+ * @return deskryptor lub -1 przy błędzie
+ */
+int wire_connect(const char *addr);
+
+/**
+ * Usuwa ścieżkę gniazda unix (adresy tcp są pomijane).
+ */
+void wire_unlink(const char *addr);
+
+/**
+ * Tworzy połączenie dla deskryptora (malloc).
+ * @return połączenie lub NULL przy braku pamięci
+ */
+WireConn *wire_conn_new(int fd);
+
+/**
+ * Zamyka deskryptor i zwalnia połączenie.
+ */
+void wire_conn_free(WireConn *conn);
+
+/**
+ * Dopisuje wiadomość do otwartej ramki; pełna ramka jest zamykana, a przy braku miejsca na kolejną
+ * bufor jest wysyłany (z czekaniem).
+ * @param queue - klasa ruchu zapisywana w wiadomości
+ * @return 0 przy sukcesie, -1 przy błędzie połączenia
+ */
+int wire_queue(WireConn *conn, int queue, const Message *msg);
+
+/**
+ * Zamyka otwartą ramkę i wysyła bufor.
+ * @param wait - 1: czeka, aż cały bufor zostanie wysłany; 0: wysyła tyle, ile przyjmie gniazdo
+ * @return 0 przy sukcesie, -1 przy błędzie połączenia
+ */
+int wire_flush(WireConn *conn, int wait);
+
+/**
+ * Czy w buforze wysyłki są dane.
+ */
+int wire_pending(const WireConn *conn);
+
+/**
+ * Czyta z gniazda dostępne dane (bez czekania).
+ * @return liczba odczytanych bajtów, 0 gdy brak danych, -1 gdy połączenie zamknięte lub błąd
+ */
+ssize_t wire_fill(WireConn *conn);
+
+/**
+ * Dekoduje następną wiadomość z bufora odczytu.
+ * @param queue - klasa ruchu wiadomości
+ * @return 1 - wiadomość, 0 - niepełne dane, -1 - błąd protokołu
+ */
+int wire_next(WireConn *conn, int *queue, Message *msg);
+
+#endif // WIRE_H
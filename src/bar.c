@@ -1,19 +1,73 @@
 #include "common.h"
 #include "utils.h"
+#include "snapshot.h"
+#include "transport.h"
+#include "checkpoint.h"
+#include "trace.h"
+#include "lockprof.h"
+#include "schedprof.h"
+#include "soak.h"
+#include "lifecycle.h"
+#include "recording.h"
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+// Czas na zakończenie procesów potomnych po końcu symulacji, potem SIGKILL
+#define SHUTDOWN_TIMEOUT_MS 10000
+
+// Rodzaj procesu potomnego w tablicy dzieci
+#define CHILD_ROLE 1
+#define CHILD_CLIENT 2
+#define CHILD_SIDECAR 3  // Publikator stanu (--publish) - nie jest rolą symulacji
+
+// Powód zakończenia symulacji
+#define STOP_END 1        // Koniec czasu symulacji
+#define STOP_FIRE 2       // Pożar (kierownik)
+#define STOP_INTERRUPT 3  // SIGINT / SIGTERM
+
+typedef struct {
+    pid_t pid;  // 0 = pusty slot
+    int kind;
+} ChildSlot;
 
 static pid_t pid_kasjer = -1;
 static pid_t pid_obsluga = -1;
 static pid_t pid_kierownik = -1;
+static pid_t pid_publisher = -1;
+static int publish_hz = 0;  // 0 = bez publikatora stanu
+static const char *record_path = NULL;  // Nagranie stanu sali przez publikator (--record)
+static const char *record_mb = NULL;
+static int total_clients = TOTAL_CLIENTS;  // 0 = klientów dostarczają wyłącznie generatory (gniazda)
 static int running = 1;
+static int stop_reason = 0;
 static pid_t clients_pgid = -1;  // PGID grupa klientów - do masowej ewakuacji przez killpg()
+static int run_seconds = SIMULATION_TIME;  // Czas trwania przebiegu (--soak zamiast SIMULATION_TIME)
+static int arrival_interval_ms = CLIENT_ARRIVAL_INTERVAL_MS;
 
-static pid_t client_pids[TOTAL_CLIENTS];
-static int num_clients = 0;
+// Przebieg długotrwały (--soak): próbkowanie zasobów ról co soak_sample_ms
+static int soak = 0;
+static int soak_sample_ms = SOAK_SAMPLE_MS;
 
-static void signal_handler(int sig) {
-    (void)sig;
-    running = 0;
-}
+// Tablica procesów potomnych: haszowanie otwarte po PID, rozmiar podwajany przy zapełnieniu w połowie
+static ChildSlot *children = NULL;
+static size_t children_capacity = 0;
+static size_t children_count = 0;
+
+// Pula procesów klientów (0 = każda grupa to nowy proces)
+static int pool_initial = 0;
+static int pool_max = 0;
+static int next_group_id = 1;
+
+// Przywracany punkt kontrolny (--restore), zmapowany na czas startu
+static const CheckpointFile *restore_point = NULL;
+static size_t restore_size = 0;
+static int resumed_groups = 0;  // Wznowieni klienci - dołączają do bariery gotowości ról
+
+// Sygnały odbierane przez signalfd - zablokowane w barze, odblokowane w dzieciach
+static sigset_t supervised_signals;
+static int signal_fd = -1;
 
 // Funkcja obsługująca sygnał TSTP
 static void sigtstp_handler(int sig) {
@@ -23,7 +77,7 @@ static void sigtstp_handler(int sig) {
     if (pid_obsluga > 0) kill(pid_obsluga, SIGSTOP);
     if (pid_kierownik > 0) kill(pid_kierownik, SIGSTOP);
     if (clients_pgid > 0) killpg(clients_pgid, SIGSTOP);
-    
+
     // Zatrzymaj siebie (domyślne zachowanie)
     signal(SIGTSTP, SIG_DFL);
     raise(SIGTSTP);
@@ -36,198 +90,1032 @@ static void sigcont_handler(int sig) {
     if (pid_obsluga > 0) kill(pid_obsluga, SIGCONT);
     if (pid_kierownik > 0) kill(pid_kierownik, SIGCONT);
     if (clients_pgid > 0) killpg(clients_pgid, SIGCONT);
-    
+
     // Przywróć obsługę SIGTSTP
     signal(SIGTSTP, sigtstp_handler);
 }
 
-// Funkcja obsługująca sygnały potomnych
-static void sigchld_handler(int sig) {
-    (void)sig;
-    int status;
-    while (waitpid(-1, &status, WNOHANG) > 0) {
+static size_t child_home(pid_t pid, size_t capacity) {
+    return ((size_t)pid * 2654435761u) & (capacity - 1);
+}
+
+static int children_grow(void) {
+    size_t new_capacity = children_capacity > 0 ? children_capacity * 2 : 64;
+    ChildSlot *table = calloc(new_capacity, sizeof(ChildSlot));
+    if (table == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < children_capacity; i++) {
+        if (children[i].pid > 0) {
+            size_t j = child_home(children[i].pid, new_capacity);
+            while (table[j].pid != 0) {
+                j = (j + 1) & (new_capacity - 1);
+            }
+            table[j] = children[i];
+        }
     }
+    free(children);
+    children = table;
+    children_capacity = new_capacity;
+    return 0;
 }
 
-static pid_t spawn_process(const char *program_path, const char *program_name) {
-    pid_t pid = fork();
-    
-    if (pid == -1) {
-        perror("spawn_process: fork failed");
+static int children_add(pid_t pid, int kind) {
+    if ((children_count + 1) * 2 > children_capacity && children_grow() == -1) {
+        perror("BAR: children_add failed");
         return -1;
-    } else if (pid == 0) {
-        if (execl(program_path, program_name, (char *)NULL) == -1) {
-            perror("spawn_process: execl failed");
-            exit(EXIT_FAILURE);
+    }
+    size_t i = child_home(pid, children_capacity);
+    while (children[i].pid != 0) {
+        i = (i + 1) & (children_capacity - 1);
+    }
+    children[i].pid = pid;
+    children[i].kind = kind;
+    children_count++;
+    return 0;
+}
+
+// Usuwa PID z tablicy (przesunięcie wsteczne zamiast znaczników usunięcia)
+// Zwraca rodzaj procesu lub 0, jeśli PID nie był śledzony
+static int children_remove(pid_t pid) {
+    if (children_capacity == 0) {
+        return 0;
+    }
+    size_t mask = children_capacity - 1;
+    size_t i = child_home(pid, children_capacity);
+    while (children[i].pid != pid) {
+        if (children[i].pid == 0) {
+            return 0;
+        }
+        i = (i + 1) & mask;
+    }
+    int kind = children[i].kind;
+
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (children[j].pid == 0) {
+            break;
+        }
+        size_t home = child_home(children[j].pid, children_capacity);
+        // Slot j może zająć dziurę i, jeśli jego pozycja domowa nie leży w (i, j]
+        if ((j > i && (home <= i || home > j)) || (j < i && home <= i && home > j)) {
+            children[i] = children[j];
+            i = j;
         }
     }
+    children[i].pid = 0;
+    children[i].kind = 0;
+    children_count--;
+    return kind;
+}
+
+static void children_kill_all(int sig) {
+    for (size_t i = 0; i < children_capacity; i++) {
+        if (children[i].pid > 0) {
+            kill(children[i].pid, sig);
+        }
+    }
+}
+
+// Zbiera wszystkie zakończone procesy jednym przebiegiem waitpid(WNOHANG)
+static void reap_children(void) {
+    pid_t pid;
+    int status;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        int kind = children_remove(pid);
+        if (kind == CHILD_SIDECAR) {
+            pid_publisher = -1;
+            if (running) {
+                log_message("BAR: Publikator stanu (PID %d) zakończył się przed końcem symulacji", pid);
+            }
+            continue;
+        }
+        if (kind != CHILD_ROLE) {
+            continue;
+        }
+        const char *role = pid == pid_kasjer ? "kasjer" : pid == pid_obsluga ? "obsługa" : "kierownik";
+        if (pid == pid_kasjer) pid_kasjer = -1;
+        if (pid == pid_obsluga) pid_obsluga = -1;
+        if (pid == pid_kierownik) pid_kierownik = -1;
+        if (running) {
+            log_message("BAR: Proces %s (PID %d) zakończył się przed końcem symulacji", role, pid);
+        }
+    }
+}
+
+static void request_stop(int reason) {
+    if (running) {
+        running = 0;
+        stop_reason = reason;
+    }
+}
+
+// Odczytuje wszystkie oczekujące sygnały z signalfd
+static void handle_signals(SharedState *shared_state) {
+    struct signalfd_siginfo info;
+    int child_exited = 0;
+
+    while (read(signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+        switch (info.ssi_signo) {
+            case SIGCHLD:
+                child_exited = 1;
+                break;
+            case SIGUSR1:  // Kierownik: pożar lub koniec symulacji
+                request_stop(shared_state != NULL && shared_state->fire_alarm ? STOP_FIRE : STOP_END);
+                break;
+            default:
+                request_stop(STOP_INTERRUPT);
+                break;
+        }
+    }
+    if (child_exited) {
+        reap_children();
+    }
+}
+
+static int setup_signal_fd(void) {
+    sigemptyset(&supervised_signals);
+    sigaddset(&supervised_signals, SIGCHLD);
+    sigaddset(&supervised_signals, SIGINT);
+    sigaddset(&supervised_signals, SIGTERM);
+    sigaddset(&supervised_signals, SIGUSR1);
+
+    if (sigprocmask(SIG_BLOCK, &supervised_signals, NULL) == -1) {
+        perror("BAR: sigprocmask failed");
+        return -1;
+    }
+    signal_fd = signalfd(-1, &supervised_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd == -1) {
+        perror("BAR: signalfd failed");
+        return -1;
+    }
+    return 0;
+}
+
+// Ustawia timerfd na czas bezwzględny CLOCK_MONOTONIC (expire_ns = 0 wyłącza timer)
+static int arm_timer(int fd, long long expire_ns, long long interval_ns) {
+    struct itimerspec its;
+    its.it_value.tv_sec = expire_ns / 1000000000LL;
+    its.it_value.tv_nsec = expire_ns % 1000000000LL;
+    its.it_interval.tv_sec = interval_ns / 1000000000LL;
+    its.it_interval.tv_nsec = interval_ns % 1000000000LL;
+    return timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+// Uruchamia program przez posix_spawn() (vfork + exec, bez kopiowania tablic stron rodzica).
+// pgid >= 0 ustawia grupę procesów dziecka przed exec (0 = nowa grupa z PID dziecka).
+static pid_t spawn_process(const char *program_path, char *const argv[], pid_t pgid) {
+    posix_spawnattr_t attr;
+    pid_t pid = -1;
+
+    if (posix_spawnattr_init(&attr) != 0) {
+        perror("spawn_process: posix_spawnattr_init failed");
+        return -1;
+    }
+    // Dziecko nie dziedziczy maski sygnałów obsługiwanych przez signalfd
+    short flags = POSIX_SPAWN_SETSIGMASK;
+    sigset_t child_mask;
+    sigemptyset(&child_mask);
+    posix_spawnattr_setsigmask(&attr, &child_mask);
+    if (pgid >= 0) {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attr, pgid);
+    }
+    posix_spawnattr_setflags(&attr, flags);
+
+    int rc = posix_spawn(&pid, program_path, NULL, &attr, argv, environ);
+    posix_spawnattr_destroy(&attr);
+
+    if (rc != 0) {
+        errno = rc;
+        return -1;
+    }
+    return pid;
+}
+
+static pid_t spawn_role(const char *program_path, char *const argv[]) {
+    pid_t pid = spawn_process(program_path, argv, -1);
+    if (pid > 0) {
+        children_add(pid, CHILD_ROLE);
+    }
     return pid;
 }
 
-static pid_t spawn_client(const char *program_path, const char *program_name, const char *group_size_str) {
-    pid_t pid = fork();
-    
+// Publikator stanu dla widzów (viz) - jedyny proces czytający salę niezależnie od liczby widzów
+static pid_t spawn_publisher(void) {
+    char hz_str[16];
+    snprintf(hz_str, sizeof(hz_str), "%d", publish_hz);
+    char *argv[] = {"publisher", "--hz", hz_str, NULL, NULL, NULL, NULL, NULL};
+    int argc = 3;
+    if (record_path != NULL) {
+        argv[argc++] = "--record";
+        argv[argc++] = (char *)record_path;
+    }
+    if (record_mb != NULL) {
+        argv[argc++] = "--record-mb";
+        argv[argc++] = (char *)record_mb;
+    }
+    pid_publisher = spawn_process("./bin/publisher", argv, -1);
+    if (pid_publisher > 0) {
+        children_add(pid_publisher, CHILD_SIDECAR);
+    }
+    return pid_publisher;
+}
+
+static pid_t spawn_client(const char *program_path, char *const argv[]) {
+
+    // Pierwszy klient tworzy nową grupę, kolejni dołączają do grupy klientów
+    pid_t pid = spawn_process(program_path, argv, clients_pgid > 0 ? clients_pgid : 0);
+    if (pid == -1 && errno == EPERM && clients_pgid > 0) {
+        // Wszyscy członkowie grupy już wyszli - grupa przestała istnieć, klient zakłada nową
+        pid = spawn_process(program_path, argv, 0);
+        if (pid > 0) {
+            clients_pgid = pid;
+        }
+    }
     if (pid == -1) {
-        perror("spawn_client: fork failed");
+        perror("spawn_client: posix_spawn failed");
         return -1;
-    } else if (pid == 0) {
-        if (clients_pgid > 0) {
-            setpgid(0, clients_pgid);  // Dołącza do istniejącej grupy klientów
+    }
+    if (clients_pgid == -1) {
+        clients_pgid = pid;
+    }
+    children_add(pid, CHILD_CLIENT);
+    return pid;
+}
+
+// Wznawia grupę z punktu kontrolnego od podanego etapu (klient --resume)
+static int spawn_resumed(SharedState *shared_state, const char *stage, int group_id, int group_size) {
+    char group_id_str[16];
+    char group_size_str[8];
+    snprintf(group_id_str, sizeof(group_id_str), "%d", group_id);
+    snprintf(group_size_str, sizeof(group_size_str), "%d", group_size);
+
+    char *const argv[] = {"klient", "--resume", (char *)stage, group_id_str, group_size_str, NULL};
+    if (spawn_client("./bin/klient", argv) == -1) {
+        return 0;
+    }
+    shared_state->clients_pgid = clients_pgid;
+    return 1;
+}
+
+static int restored_pending(int queue, int group_id) {
+    for (int i = 0; i < restore_point->pending_count; i++) {
+        if (restore_point->pending[i].queue == queue && restore_point->pending[i].msg.group_id == group_id) {
+            return 1;
         }
-        if (execl(program_path, program_name, group_size_str, (char *)NULL) == -1) {
-            perror("spawn_client: execl failed");
-            exit(EXIT_FAILURE);
+    }
+    return 0;
+}
+
+// Klienci grup z punktu kontrolnego: usadzone (czekają na potwierdzenie stolika lub płatności albo
+// jedzą), czekające na stolik i te, których żądanie stolika czekało w kolejce. Grupa, której naczynia
+// są w kolejce, już wyszła - jej stolik zwolni przywrócona wiadomość. Grupa bez stolika z odpowiedzią
+// w kolejce dostała odmowę - wznowiona odbierze ją i wyjdzie.
+static int resume_groups(SharedState *shared_state) {
+    const Seating *seating = &restore_point->seating;
+    int spawned = 0;
+
+    for (int i = 0; i < MAX_GROUPS; i++) {
+        int group_id = seating->seated[i].group_id;
+        if (group_id == GROUP_SLOT_FREE || restored_pending(QUEUE_DISHES, group_id)) {
+            continue;
         }
-    } else {
-        if (clients_pgid == -1) {
-            clients_pgid = pid;
-            setpgid(pid, pid);  // Pierwszy klient tworzy nową grupę
-        } else {
-            setpgid(pid, clients_pgid);  // Kolejni klienci dołączają do grupy
+        const char *stage = restored_pending(QUEUE_SEAT_REPLY, group_id) ? RESUME_SEAT
+                            : restored_pending(QUEUE_PAYMENT, group_id) || restored_pending(QUEUE_PAY_REPLY, group_id)
+                                ? RESUME_PAY
+                                : RESUME_EAT;
+        spawned += spawn_resumed(shared_state, stage, group_id, checkpoint_group_size(&restore_point->hall, group_id));
+    }
+    for (int i = 0; i < seating->waiting_count; i++) {
+        spawned += spawn_resumed(shared_state, RESUME_SEAT, seating->waiting_queue[i].group_id,
+                                 seating->waiting_queue[i].group_size);
+    }
+    for (int i = 0; i < restore_point->pending_count; i++) {
+        int queue = restore_point->pending[i].queue;
+        const Message *msg = &restore_point->pending[i].msg;
+        if (queue == QUEUE_SEAT && (msg->mtype == MSG_TYPE_SEAT_REQUEST || msg->mtype == MSG_TYPE_SEAT_AND_PAY)) {
+            spawned += spawn_resumed(shared_state, RESUME_SEAT, msg->group_id, msg->group_size);
+        } else if ((queue == QUEUE_SEAT_REPLY || queue == QUEUE_PAY_REPLY) &&
+                   checkpoint_group_size(&restore_point->hall, msg->group_id) == 0) {
+            spawned += spawn_resumed(shared_state, queue == QUEUE_SEAT_REPLY ? RESUME_SEAT : RESUME_PAY,
+                                     msg->group_id, msg->group_size);
         }
     }
+    return spawned;
+}
+
+// Wiadomości z kolejek punktu kontrolnego wracają do kolejek po starcie zegara (polecenie
+// zapisu punktu pominięte - kierownik nie powtarza zdarzeń sprzed punktu). Żądanie protokołu
+// potokowego wraca jako zwykłe żądanie stolika - wznowiony klient czeka na osobne potwierdzenie.
+static void restore_queues(void) {
+    int restored = 0;
+    for (int i = 0; i < restore_point->pending_count; i++) {
+        const CheckpointMessage *pending = &restore_point->pending[i];
+        if (pending->msg.mtype == MSG_TYPE_CHECKPOINT) {
+            continue;
+        }
+        Message msg = pending->msg;
+        if (msg.mtype == MSG_TYPE_SEAT_AND_PAY) {
+            msg.mtype = MSG_TYPE_SEAT_REQUEST;
+        }
+        if (pending->queue == QUEUE_SEAT) {
+            log_message("BAR: Przywrócone żądanie stolika grupy #%d (%d os.)", pending->msg.group_id,
+                       pending->msg.group_size);
+        }
+        if (transport_send(pending->queue, &msg, IPC_NOWAIT) == -1) {
+            log_message("BAR: Nie przywrócono wiadomości do kolejki \"%s\": %s", queue_name(pending->queue),
+                       strerror(errno));
+            continue;
+        }
+        restored++;
+    }
+    log_message("BAR: Przywrócono %d wiadomości do kolejek, wznowiono %d grup", restored, resumed_groups);
+}
+
+static pid_t spawn_pool_worker(SharedState *shared_state) {
+    char *const argv[] = {"klient", "--pool", NULL};
+    pid_t pid = spawn_client("./bin/klient", argv);
+    if (pid > 0) {
+        __atomic_add_fetch(&shared_state->pool_size, 1, __ATOMIC_SEQ_CST);
+        shared_state->clients_pgid = clients_pgid;
+    }
     return pid;
 }
 
-int main(void) {
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
-    signal(SIGUSR1, signal_handler);
+// Przygotowuje pulę przed startem zegara - czeka, aż wszystkie procesy będą gotowe na przydział
+static int prefork_pool(SharedState *shared_state) {
+    for (int i = 0; i < pool_initial; i++) {
+        if (spawn_pool_worker(shared_state) == -1) {
+            return -1;
+        }
+    }
+
+    long long deadline = monotonic_ns() + (long long)READY_TIMEOUT_MS * 1000000LL;
+    while (__atomic_load_n(&shared_state->pool_idle, __ATOMIC_SEQ_CST) < pool_initial) {
+        handle_signals(shared_state);
+        if (!running) {
+            return -1;
+        }
+        if (monotonic_ns() >= deadline) {
+            log_message("BAR: Pula klientów nie była gotowa w ciągu %d ms", READY_TIMEOUT_MS);
+            return -1;
+        }
+        usleep(1000);
+    }
+    return 0;
+}
+
+// Kolejny identyfikator grupy baru - w przedziale węzła 0, więc bez kolizji z generatorami także
+// w długim przebiegu (--soak); po wyczerpaniu przedziału numeracja wraca do 1 (tamte grupy dawno wyszły)
+static int take_group_id(void) {
+    int group_id = next_group_id++;
+    if (next_group_id >= GROUP_ID_STRIDE) {
+        next_group_id = 1;
+    }
+    return group_id;
+}
 
-    signal(SIGCHLD, sigchld_handler);
+// Przekazuje grupę wolnemu procesowi z puli; pula rośnie, gdy żaden proces nie jest wolny
+static int assign_group(SharedState *shared_state, int group_size) {
+    int idle = __atomic_load_n(&shared_state->pool_idle, __ATOMIC_SEQ_CST);
+    int size = __atomic_load_n(&shared_state->pool_size, __ATOMIC_SEQ_CST);
+    if (idle == 0 && size < pool_max) {
+        if (spawn_pool_worker(shared_state) > 0) {
+            log_message("BAR: Pula klientów powiększona do %d procesów", size + 1);
+        }
+    }
+
+    Message assignment;
+    assignment.mtype = MSG_TYPE_POOL_ASSIGN;
+    assignment.group_id = take_group_id();
+    assignment.group_size = group_size;
+    assignment.table_type = 0;
+    assignment.table_index = 0;
+
+    // Bar nie czeka na pulę - przy pełnej kolejce przydziałów grupa przepada (licznik queue_full)
+    if (transport_send(QUEUE_POOL, &assignment, IPC_NOWAIT) == -1) {
+        log_message("BAR: Błąd przydziału grupy #%d do puli: %s", assignment.group_id, strerror(errno));
+        return -1;
+    }
+    return assignment.group_id;
+}
+
+// Tworzy jedną grupę klientów (nowy proces lub przydział do puli)
+static int generate_group(SharedState *shared_state) {
+    int group_size = (rand() % 3) + 1;
+
+    if (pool_max > 0) {
+        return assign_group(shared_state, group_size) > 0;
+    }
+
+    char group_size_str[8];
+    char group_id_str[16];
+    snprintf(group_size_str, sizeof(group_size_str), "%d", group_size);
+    snprintf(group_id_str, sizeof(group_id_str), "%d", take_group_id());
+
+    char *const client_argv[] = {"klient", group_size_str, group_id_str, NULL};
+    if (spawn_client("./bin/klient", client_argv) == -1) {
+        return 0;
+    }
+    shared_state->clients_pgid = clients_pgid;
+    return 1;
+}
+
+static int role_alive(pid_t pid) {
+    return pid > 0;  // PID roli jest zerowany przez reap_children()
+}
+
+// Bariera gotowości: czeka, aż kasjer, obsługa i kierownik dołączą do IPC
+static int wait_for_roles(SharedState *shared_state) {
+    long long deadline = monotonic_ns() + (long long)READY_TIMEOUT_MS * 1000000LL;
+
+    while (running) {
+        if (wait_roles_ready(READY_ROLES + resumed_groups, 100) == 0) {
+            return 0;
+        }
+        if (errno != EAGAIN && errno != EINTR) {
+            perror("BAR: wait_roles_ready failed");
+            return -1;
+        }
+        handle_signals(shared_state);
+        if (!role_alive(pid_kasjer) || !role_alive(pid_obsluga) || !role_alive(pid_kierownik)) {
+            log_message("BAR: Jedna z ról zakończyła się przed zgłoszeniem gotowości");
+            return -1;
+        }
+        if (monotonic_ns() >= deadline) {
+            log_message("BAR: Role nie zgłosiły gotowości w ciągu %d ms", READY_TIMEOUT_MS);
+            return -1;
+        }
+    }
+    return -1;
+}
+
+static void abort_startup(SharedState *shared_state) {
+    if (pid_kasjer > 0) kill(pid_kasjer, SIGTERM);
+    if (pid_obsluga > 0) kill(pid_obsluga, SIGTERM);
+    if (pid_kierownik > 0) kill(pid_kierownik, SIGTERM);
+    if (pid_publisher > 0) kill(pid_publisher, SIGTERM);
+    while (waitpid(-1, NULL, 0) > 0 || errno == EINTR) { }
+    if (shared_state != NULL) {
+        shmdt(shared_state);
+    }
+    transport_destroy();
+    cleanup_ipc();
+}
+
+// Początek zamykania: klienci dostają SIGTERM, role kończy kierownik (lub bar przy przerwaniu)
+static void begin_shutdown(SharedState *shared_state, long long deadline_ns) {
+    switch (stop_reason) {
+        case STOP_END:
+            log_message("BAR: Koniec czasu symulacji (reakcja po %.3f ms)",
+                       monotonic_ns() > deadline_ns ? (monotonic_ns() - deadline_ns) / 1e6 : 0.0);
+            break;
+        case STOP_FIRE:
+            log_message("BAR: Pożar! Kończę symulację.");
+            break;
+        default:
+            log_message("BAR: Przerwanie - kończę symulację");
+            if (pid_kasjer > 0) kill(pid_kasjer, SIGTERM);
+            if (pid_obsluga > 0) kill(pid_obsluga, SIGTERM);
+            if (pid_kierownik > 0) kill(pid_kierownik, SIGTERM);
+            break;
+    }
+
+    if (shared_state->first_seat_ns > 0) {
+        log_message("BAR: Czas startu: role gotowe po %.3f ms, pierwsza grupa usadzona po %.3f ms",
+                   (shared_state->roles_ready_ns - shared_state->startup_begin_ns) / 1e6,
+                   (shared_state->first_seat_ns - shared_state->startup_begin_ns) / 1e6);
+    }
+
+    if (pid_publisher > 0) {
+        kill(pid_publisher, SIGTERM);
+    }
+
+    // Zakończ wszystkie procesy klientów
+    if (shared_state->clients_pgid > 0) {
+        clients_pgid = shared_state->clients_pgid;
+    }
+    if (clients_pgid > 0) {
+        killpg(clients_pgid, SIGTERM);
+    }
+}
+
+// Podsumowanie przeciążeń kolejek (wysyłki, które zastały pełną kolejkę danej klasy ruchu)
+static void report_queue_pressure(const SharedState *shared_state) {
+    for (int queue = 0; queue < QUEUE_COUNT; queue++) {
+        unsigned long full = __atomic_load_n(&shared_state->queue_full[queue], __ATOMIC_RELAXED);
+        if (full > 0) {
+            log_message("BAR: Kolejka \"%s\" była pełna %lu razy", queue_name(queue), full);
+        }
+    }
+}
+
+// Próbka zasobów przebiegu długotrwałego: role, klienci (tablica dzieci), obiekty IPC instancji, log
+static void soak_tick(const SharedState *shared_state) {
+    soak_begin_sample();
+    soak_process("bar", getpid());
+    soak_process("kasjer", pid_kasjer);
+    soak_process("obsluga", pid_obsluga);
+    soak_process("kierownik", pid_kierownik);
+    if (publish_hz > 0) {
+        soak_process("publisher", pid_publisher);
+    }
+    for (size_t i = 0; i < children_capacity; i++) {
+        if (children[i].pid > 0 && children[i].kind == CHILD_CLIENT) {
+            soak_client(children[i].pid);
+        }
+    }
+    soak_end_sample((monotonic_ns() - shared_state->simulation_start_ns) / 1000000LL);
+}
+
+static int epoll_watch(int epoll_fd, int fd) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+// Pętla nadzorcy: signalfd (dzieci, przerwanie, pożar), timerfd końca symulacji i timerfd przybyć klientów.
+// Kończy się, gdy po zamknięciu nie ma już żadnych procesów potomnych.
+// arrivals_done - grupy wygenerowane przed punktem kontrolnym (przy przywróceniu)
+static void supervise(SharedState *shared_state, int arrivals_done) {
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    int deadline_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int arrival_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int sample_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epoll_fd == -1 || deadline_fd == -1 || arrival_fd == -1 || sample_fd == -1) {
+        handle_error("BAR: epoll/timerfd failed");
+    }
+    if (epoll_watch(epoll_fd, signal_fd) == -1 || epoll_watch(epoll_fd, deadline_fd) == -1 ||
+        epoll_watch(epoll_fd, arrival_fd) == -1 || epoll_watch(epoll_fd, sample_fd) == -1) {
+        handle_error("BAR: epoll_ctl failed");
+    }
+    if (soak) {
+        long long sample_ns = (long long)soak_sample_ms * 1000000LL;
+        arm_timer(sample_fd, shared_state->simulation_start_ns + sample_ns, sample_ns);
+    }
+
+    long long deadline_ns = shared_state->simulation_start_ns + (long long)run_seconds * 1000000000LL;
+    arm_timer(deadline_fd, deadline_ns, 0);
+    long long arrival_interval_ns = (long long)arrival_interval_ms * 1000000LL;
+    if (arrivals_done < total_clients) {
+        arm_timer(arrival_fd, shared_state->simulation_start_ns + arrivals_done * arrival_interval_ns,
+                  arrival_interval_ns);
+    }
+
+    log_message("BAR: Generuję %d grup klientów...", total_clients - arrivals_done);
+
+    int arrivals = arrivals_done;
+    int groups_generated = 0;
+    int shutting_down = 0;
+    uint64_t deferred_arrivals = 0;
+
+    while (!shutting_down || children_count > 0) {
+        struct epoll_event events[5];
+        int n = epoll_wait(epoll_fd, events, 5, -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;  // SIGTSTP / SIGCONT
+            perror("BAR: epoll_wait failed");
+            break;
+        }
+
+        for (int e = 0; e < n; e++) {
+            int fd = events[e].data.fd;
+            uint64_t expirations = 0;
+
+            if (fd == signal_fd) {
+                handle_signals(shared_state);
+            } else if (fd == sample_fd) {
+                if (read(sample_fd, &expirations, sizeof(expirations)) == sizeof(expirations) && running) {
+                    soak_tick(shared_state);
+                }
+            } else if (fd == arrival_fd) {
+                if (read(arrival_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+                    continue;
+                }
+                if (__atomic_load_n(&shared_state->checkpoint_active, __ATOMIC_SEQ_CST)) {
+                    deferred_arrivals += expirations;  // Punkt kontrolny - grupy przychodzą po wznowieniu ról
+                    continue;
+                }
+                expirations += deferred_arrivals;
+                deferred_arrivals = 0;
+                for (uint64_t k = 0; k < expirations && arrivals < total_clients && running; k++) {
+                    groups_generated += generate_group(shared_state);
+                    arrivals++;
+                }
+                if (arrivals == total_clients) {
+                    arm_timer(arrival_fd, 0, 0);
+                    log_message("BAR: Wygenerowano %d grup klientów", groups_generated);
+                    arrivals++;  // Komunikat tylko raz
+                }
+            } else if (fd == deadline_fd) {
+                if (read(deadline_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+                    continue;
+                }
+                if (!shutting_down) {
+                    request_stop(STOP_END);
+                } else {
+                    log_message("BAR: %zu procesów nie zakończyło się w ciągu %d ms - SIGKILL",
+                               children_count, SHUTDOWN_TIMEOUT_MS);
+                    children_kill_all(SIGKILL);
+                }
+            }
+        }
+
+        if (!running && !shutting_down) {
+            shutting_down = 1;
+            arm_timer(arrival_fd, 0, 0);
+            arm_timer(sample_fd, 0, 0);  // Zamykanie nie należy do stanu ustalonego
+            if (arrivals < total_clients) {
+                log_message("BAR: Wygenerowano %d grup klientów", groups_generated);
+            }
+            begin_shutdown(shared_state, deadline_ns);
+            arm_timer(deadline_fd, monotonic_ns() + (long long)SHUTDOWN_TIMEOUT_MS * 1000000LL, 0);
+        }
+    }
+
+    close(sample_fd);
+    close(arrival_fd);
+    close(deadline_fd);
+    close(epoll_fd);
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Użycie: %s [-i INSTANCJA] [--cleanup-stale]\n", program);
+    fprintf(stderr, "  -i, --instance N   numer instancji (domyślnie pierwsza wolna)\n");
+    fprintf(stderr, "  --cleanup-stale    usuń obiekty IPC instancji po awariach i zakończ\n");
+    fprintf(stderr, "  --pool N           pula N procesów klientów uruchomionych przed startem\n");
+    fprintf(stderr, "  --pool-max M       maksymalny rozmiar puli (domyślnie %d)\n", TOTAL_CLIENTS);
+    fprintf(stderr, "  --script PLIK      skrypt zdarzeń kierownika (domyślnie SIGNAL1..3_TIME)\n");
+    fprintf(stderr, "  --publish HZ       publikator stanu dla wizualizacji (gniazdo Unix, 1..%d Hz)\n", SNAPSHOT_MAX_HZ);
+    fprintf(stderr, "  --record PLIK      nagranie stanu sali przez publikator z częstotliwością --publish (domyślnie %d Hz),\n",
+            RECORDING_DEFAULT_HZ);
+    fprintf(stderr, "                     pierścień delt w PLIK (odtwarzanie: ./visualization/viz --replay PLIK)\n");
+    fprintf(stderr, "  --record-mb N      rozmiar pierścienia nagrania (domyślnie %d MB)\n", RECORDING_DEFAULT_MB);
+    fprintf(stderr, "  --transport T      transport wiadomości: sysv (domyślnie), ring (pamięć współdzielona), mq (kolejki POSIX)\n");
+    fprintf(stderr, "                     lub socket (gniazda - klienci także z generatorów na innych węzłach)\n");
+    fprintf(stderr, "  --seating-addr A   adres usługi obsługi dla socket: unix:ŚCIEŻKA lub tcp:HOST:PORT\n");
+    fprintf(stderr, "  --cashier-addr A   adres usługi kasjera dla socket\n");
+    fprintf(stderr, "  --pipeline         protokół potokowy: żądanie stolika niesie płatność, obsługa przekazuje usadzoną\n");
+    fprintf(stderr, "                     grupę kasjerowi, klient dostaje jedno potwierdzenie (poza socket)\n");
+    fprintf(stderr, "  --clients N        liczba grup generowanych przez bar (domyślnie %d; 0 = tylko generatory)\n", TOTAL_CLIENTS);
+    fprintf(stderr, "  --checkpoint PLIK  plik punktu kontrolnego zapisywanego akcją skryptu \"checkpoint\"\n");
+    fprintf(stderr, "                     (domyślnie logs/checkpoint.bin)\n");
+    fprintf(stderr, "  --restore PLIK     wznów symulację z punktu kontrolnego (transport sysv, ring lub mq)\n");
+    fprintf(stderr, "  --trace KATALOG    śledzenie etapów klientów, obsługi i kasjera (scalanie: bin/tracemerge KATALOG)\n");
+    fprintf(stderr, "  --lifecycle PLIK   rekordy cyklu życia grup w kolumnowym pliku PLIK (zapytania: bin/lifequery PLIK)\n");
+    fprintf(stderr, "  --lockprof N       profil czekania i trzymania semaforów sali i logu, raport N miejsc na proces\n");
+    fprintf(stderr, "  --service-cpus L   przypięcie obsługi, kasjera i kierownika do rdzeni z listy (np. 2,3 lub 2-4),\n");
+    fprintf(stderr, "                     klienci na pozostałych rdzeniach\n");
+    fprintf(stderr, "  --service-rt P     SCHED_FIFO z priorytetem P i mlockall() dla ról usługowych\n");
+    fprintf(stderr, "  --sched-report     raport czekania ról usługowych w kolejce planisty (włączony przez opcje wyżej)\n");
+    fprintf(stderr, "  --soak S           przebieg długotrwały: S sekund ciągłych przybyć bez pożaru, próbki zasobów ról\n");
+    fprintf(stderr, "                     w logs/soak.csv, błąd, gdy któryś zasób rośnie bez ograniczenia\n");
+    fprintf(stderr, "  --soak-sample-ms M odstęp próbek zasobów (domyślnie %d ms)\n", SOAK_SAMPLE_MS);
+    fprintf(stderr, "  --log-max-mb N     rotacja logu po N MB (przy --soak domyślnie %d MB)\n", SOAK_LOG_MAX_MB);
+    fprintf(stderr, "  --log-rotate-s S   rotacja logu co S sekund (wyrównana do zegara)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int requested_instance = -1;
+    const char *script = "";
+    const char *restore_path = NULL;
+    const char *trace_dir = NULL;
+    const char *lifecycle_path = NULL;
+    long long log_max_mb = -1;
+    int clients_given = 0;
+    int pipeline = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--instance") == 0) && i + 1 < argc) {
+            requested_instance = atoi(argv[++i]);
+            if (requested_instance < 0 || requested_instance >= MAX_INSTANCES) {
+                fprintf(stderr, "BAR: Nieprawidłowy numer instancji (0..%d)\n", MAX_INSTANCES - 1);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--pool") == 0 && i + 1 < argc) {
+            pool_initial = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pool-max") == 0 && i + 1 < argc) {
+            pool_max = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+            script = argv[++i];
+        } else if (strcmp(argv[i], "--publish") == 0 && i + 1 < argc) {
+            publish_hz = atoi(argv[++i]);
+            if (publish_hz < 1 || publish_hz > SNAPSHOT_MAX_HZ) {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--record-mb") == 0 && i + 1 < argc) {
+            record_mb = argv[++i];
+        } else if (strcmp(argv[i], "--transport") == 0 && i + 1 < argc) {
+            int backend = transport_parse(argv[++i]);
+            if (backend == -1) {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            transport_select(backend);  // Role dziedziczą wybór przez TRANSPORT_ENV
+        } else if (strcmp(argv[i], "--seating-addr") == 0 && i + 1 < argc) {
+            setenv(SOCKET_SEATING_ENV, argv[++i], 1);
+        } else if (strcmp(argv[i], "--cashier-addr") == 0 && i + 1 < argc) {
+            setenv(SOCKET_CASHIER_ENV, argv[++i], 1);
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            pipeline = 1;
+            setenv(PIPELINE_ENV, "1", 1);  // Klienci wysyłają MSG_TYPE_SEAT_AND_PAY
+        } else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc) {
+            total_clients = atoi(argv[++i]);
+            clients_given = 1;
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            setenv(CHECKPOINT_ENV, argv[++i], 1);  // Ścieżkę zapisu czyta obsługa
+        } else if (strcmp(argv[i], "--restore") == 0 && i + 1 < argc) {
+            restore_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_dir = argv[++i];
+        } else if (strcmp(argv[i], "--lifecycle") == 0 && i + 1 < argc) {
+            lifecycle_path = argv[++i];
+        } else if (strcmp(argv[i], "--lockprof") == 0 && i + 1 < argc) {
+            setenv(LOCKPROF_ENV, argv[++i], 1);  // Role włączają profil w lockprof_init()
+        } else if (strcmp(argv[i], "--soak") == 0 && i + 1 < argc) {
+            run_seconds = atoi(argv[++i]);
+            soak = 1;
+            if (run_seconds < 1) {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            setenv(SOAK_ENV, argv[i], 1);  // Kierownik kończy przebieg po tym czasie i nie ogłasza pożaru
+        } else if (strcmp(argv[i], "--soak-sample-ms") == 0 && i + 1 < argc) {
+            soak_sample_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--log-max-mb") == 0 && i + 1 < argc) {
+            log_max_mb = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--log-rotate-s") == 0 && i + 1 < argc) {
+            setenv(LOG_ROTATE_S_ENV, argv[++i], 1);  // Rotację wykonuje logger każdego procesu
+        } else if (strcmp(argv[i], "--service-cpus") == 0 && i + 1 < argc) {
+            cpu_set_t cpus;
+            if (schedprof_parse_cpus(argv[++i], &cpus) == -1) {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            setenv(SCHEDPROF_CPUS_ENV, argv[i], 1);  // Role przypinają się same w schedprof_init()
+        } else if (strcmp(argv[i], "--service-rt") == 0 && i + 1 < argc) {
+            int priority = atoi(argv[++i]);
+            if (priority < sched_get_priority_min(SCHED_FIFO) || priority > sched_get_priority_max(SCHED_FIFO)) {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            setenv(SCHEDPROF_RT_ENV, argv[i], 1);
+        } else if (strcmp(argv[i], "--sched-report") == 0) {
+            setenv(SCHEDPROF_REPORT_ENV, "1", 1);
+        } else if (strcmp(argv[i], "--cleanup-stale") == 0) {
+            printf("BAR: Wyczyszczono %d nieaktualnych instancji\n", ipc_cleanup_stale());
+            return EXIT_SUCCESS;
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (pool_initial < 0 || pool_max < 0 || total_clients < 0 || soak_sample_ms < 1) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (record_path != NULL && publish_hz == 0) {
+        publish_hz = RECORDING_DEFAULT_HZ;  // Nagranie prowadzi publikator - bez --publish z domyślną częstotliwością
+    }
+
+    // Przebieg długotrwały: przybycia w tempie obsługi kasjera przez cały czas trwania, log ograniczony rotacją
+    if (soak) {
+        arrival_interval_ms = SOAK_ARRIVAL_INTERVAL_MS;
+    }
+    if (soak && !clients_given) {
+        total_clients = (int)((long long)run_seconds * 1000 / arrival_interval_ms);
+    }
+    if (soak && log_max_mb == -1) {
+        log_max_mb = SOAK_LOG_MAX_MB;
+    }
+    if (log_max_mb > 0) {
+        char bytes[32];
+        snprintf(bytes, sizeof(bytes), "%lld", log_max_mb * 1024 * 1024);
+        setenv(LOG_MAX_BYTES_ENV, bytes, 1);
+    }
+    if (pool_initial > 0 && pool_max == 0) {
+        pool_max = TOTAL_CLIENTS;
+    }
+    if (pool_max < pool_initial) {
+        pool_max = pool_initial;
+    }
+
+    // Obsługa przekazuje płatność do kolejki kasjera, a odmowę do kolejki potwierdzeń klienta - przy
+    // gniazdach odpowiedź kasjera wróciłaby do połączenia obsługi, nie klienta
+    if (pipeline && transport_backend() == TRANSPORT_SOCKET) {
+        fprintf(stderr, "BAR: Protokół potokowy (--pipeline) nie obsługuje transportu socket\n");
+        return EXIT_FAILURE;
+    }
+
+    // Punkt kontrolny jest mapowany, a nie odtwarzany - czas startu nie zależy od długości przebiegu
+    if (restore_path != NULL) {
+        restore_point = checkpoint_map(restore_path, &restore_size);
+        if (restore_point == NULL) {
+            fprintf(stderr, "BAR: Nie można wczytać punktu kontrolnego %s: %s\n", restore_path,
+                    errno == EINVAL ? "plik uszkodzony lub z innej wersji programu" : strerror(errno));
+            return EXIT_FAILURE;
+        }
+        if (transport_backend() == TRANSPORT_SOCKET) {
+            fprintf(stderr, "BAR: Przywracanie punktu kontrolnego nie obsługuje transportu socket\n");
+            checkpoint_unmap(restore_point, restore_size);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Bufory poprzedniego przebiegu są usuwane - tracemerge scala wszystkie pliki katalogu
+    if (trace_dir != NULL) {
+        if (trace_reset_dir(trace_dir) == -1) {
+            fprintf(stderr, "BAR: Nie można przygotować katalogu śledzenia %s: %s\n", trace_dir, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        setenv(TRACE_ENV, trace_dir, 1);  // Role włączają śledzenie w trace_init()
+    }
+
+    // Nowy plik rekordów na przebieg; generatory na tym samym węźle mogą dopisywać do niego (--lifecycle)
+    if (lifecycle_path != NULL) {
+        uint64_t capacity = total_clients > LIFECYCLE_MIN_CAPACITY ? (uint64_t)total_clients : LIFECYCLE_MIN_CAPACITY;
+        if (lifecycle_create(lifecycle_path, capacity, 1) == -1) {
+            fprintf(stderr, "BAR: Nie można utworzyć pliku rekordów %s: %s\n", lifecycle_path, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        setenv(LIFECYCLE_ENV, lifecycle_path, 1);  // Klienci mapują plik w lifecycle_init()
+    }
+
+    int stale_removed = 0;
+    int instance = ipc_claim_instance(requested_instance, &stale_removed);
+    if (instance == -1) {
+        return EXIT_FAILURE;
+    }
+    printf("BAR: Instancja %d (wizualizacja: ./viz -i %d)\n", instance, instance);
+    fflush(stdout);
+
+    if (setup_signal_fd() == -1) {
+        ipc_remove_instance(instance);
+        return EXIT_FAILURE;
+    }
 
     signal(SIGTSTP, sigtstp_handler);
     signal(SIGCONT, sigcont_handler);
-    
+
     srand(time(NULL));
-    
+
     init_logger();
+    if (lockprof_create_shared() == -1) {
+        perror("BAR: lockprof_create_shared failed");  // Każdy proces wypisze własny raport
+    }
+    lockprof_init("bar", NULL);
+    // Granica logu z rotacjami: każdy plik może przekroczyć limit o jeden wpis
+    if (soak && soak_init(log_max_mb > 0 ? (LOG_ROTATE_KEEP + 1) * (log_max_mb * 1024 * 1024 + 2048) : 0) == -1) {
+        perror("BAR: soak_init failed");  // Przebieg trwa, werdykt tylko w logu
+    }
     create_shared_memory();
-    create_message_queue();
+    create_message_queues();
+    transport_create();
     create_semaphores();
-    
-    // Ustawienie czasu startu symulacji w pamięci dzielonej
+
     SharedState *shared_state = get_shared_memory();
-    if (shared_state != NULL) {
-        shared_state->simulation_start_time = time(NULL);
+    shared_state->startup_begin_ns = monotonic_ns();
+
+    if (stale_removed > 0) {
+        log_message("BAR: Usunięto %d nieaktualnych obiektów IPC instancji %d", stale_removed, instance);
+    }
+    log_message("BAR: Inicjalizacja zakończona (instancja %d, transport %s), uruchamiam pracowników...",
+               instance, transport_name(transport_backend()));
+    if (transport_backend() == TRANSPORT_SOCKET) {
+        log_message("BAR: Usługi: obsługa %s, kasjer %s", transport_address(SOCKET_SEATING),
+                   transport_address(SOCKET_CASHIER));
+    }
+    if (pipeline) {
+        log_message("BAR: Protokół potokowy: stolik i płatność w jednym żądaniu grupy");
+    }
+
+    // Sala z punktu kontrolnego w pamięci współdzielonej; stan usadzania przywraca obsługa (RESTORE_ENV)
+    int arrivals_done = 0;
+    if (restore_point != NULL) {
+        seating_mirror(&restore_point->hall, shared_state);
+        shared_state->restored_ms = restore_point->sim_ms;
+        setenv(RESTORE_ENV, restore_path, 1);
+        arrivals_done = (int)(restore_point->sim_ms / arrival_interval_ms) + 1;
+        if (arrivals_done > total_clients) {
+            arrivals_done = total_clients;
+        }
+        next_group_id = arrivals_done + 1;  // Identyfikatory grup puli nie powtarzają się po wznowieniu
+        log_message("BAR: Przywracanie punktu kontrolnego %s (@%lld ms, zapisany w transporcie %s, "
+                   "%d wiadomości w kolejkach)", restore_path, restore_point->sim_ms,
+                   transport_name(restore_point->transport), restore_point->pending_count);
     }
-    
-    log_message("BAR: Inicjalizacja zakończona, uruchamiam pracowników...");
-    
-    pid_kasjer = spawn_process("./bin/kasjer", "kasjer");
+
+    char *const kasjer_argv[] = {"kasjer", NULL};
+    pid_kasjer = spawn_role("./bin/kasjer", kasjer_argv);
     if (pid_kasjer == -1) {
-        cleanup_ipc();
+        perror("BAR: posix_spawn kasjer failed");
+        abort_startup(shared_state);
         return EXIT_FAILURE;
     }
-    
-    pid_obsluga = spawn_process("./bin/obsluga", "obsluga");
+
+    char *const obsluga_argv[] = {"obsluga", NULL};
+    pid_obsluga = spawn_role("./bin/obsluga", obsluga_argv);
     if (pid_obsluga == -1) {
-        cleanup_ipc();
+        perror("BAR: posix_spawn obsluga failed");
+        abort_startup(shared_state);
         return EXIT_FAILURE;
     }
 
-    usleep(50000);
-    
     char pid_obsluga_str[32];
     char pid_kasjer_str[32];
     char clients_pgid_str[32];
     snprintf(pid_obsluga_str, sizeof(pid_obsluga_str), "%d", pid_obsluga);
     snprintf(pid_kasjer_str, sizeof(pid_kasjer_str), "%d", pid_kasjer);
     snprintf(clients_pgid_str, sizeof(clients_pgid_str), "%d", -1);
-    
-    pid_kierownik = fork();
+
+    char *const kierownik_argv[] = {"kierownik", pid_obsluga_str, pid_kasjer_str, clients_pgid_str, (char *)script, NULL};
+    pid_kierownik = spawn_role("./bin/kierownik", kierownik_argv);
     if (pid_kierownik == -1) {
-        handle_error("BAR: fork kierownik failed");
-    } else if (pid_kierownik == 0) {
-        execl("./bin/kierownik", "kierownik", pid_obsluga_str, pid_kasjer_str, clients_pgid_str, (char *)NULL);
-        perror("BAR: execl kierownik failed");
-        exit(EXIT_FAILURE);
-    }
-    
-    log_message("BAR: Procesy uruchomione (kasjer, obsługa, kierownik)");
-    
-    log_message("BAR: Generuję %d grup klientów...", TOTAL_CLIENTS);
-    
-    for (int i = 0; i < TOTAL_CLIENTS && running; i++) {
-        int group_size = (rand() % 3) + 1;
-        char group_size_str[8];
-        snprintf(group_size_str, sizeof(group_size_str), "%d", group_size);
-        
-        pid_t client_pid = spawn_client("./bin/klient", "klient", group_size_str);
-        if (client_pid > 0) {
-            client_pids[num_clients++] = client_pid;
-        }
-        
-        usleep(500000);
-        // sleep(1);  
-    }
-    
-    log_message("BAR: Wygenerowano %d grup klientów", num_clients);
-    
-    if (shared_state != NULL && clients_pgid > 0) {
-        shared_state->clients_pgid = clients_pgid;
+        perror("BAR: posix_spawn kierownik failed");
+        abort_startup(shared_state);
+        return EXIT_FAILURE;
+    }
+
+    // Role usługowe już działają na swoich rdzeniach - bar i wszystkie dalsze dzieci (klienci,
+    // publikator) dziedziczą pozostałe
+    int client_cpus = schedprof_confine_clients();
+    if (client_cpus > 0) {
+        log_message("BAR: Klienci ograniczeni do %d rdzeni poza rolami usługowymi (%s)", client_cpus,
+                    getenv(SCHEDPROF_CPUS_ENV));
+    } else if (client_cpus == 0 && getenv(SCHEDPROF_CPUS_ENV) != NULL) {
+        log_message("BAR: Brak rdzeni poza rolami usługowymi (%s) - klienci dzielą rdzenie z rolami",
+                    getenv(SCHEDPROF_CPUS_ENV));
+    } else if (client_cpus == -1) {
+        perror("BAR: sched_setaffinity failed");  // Klienci bez ograniczenia
+    }
+
+    if (restore_point != NULL) {
+        resumed_groups = resume_groups(shared_state);
     }
-    
-    if (shared_state == NULL) {
-        shared_state = get_shared_memory();
-        if (shared_state == NULL) {
-            cleanup_ipc();
+
+    if (wait_for_roles(shared_state) == -1) {
+        if (clients_pgid > 0) killpg(clients_pgid, SIGTERM);
+        abort_startup(shared_state);
+        return EXIT_FAILURE;
+    }
+
+    if (publish_hz > 0 && spawn_publisher() == -1) {
+        perror("BAR: posix_spawn publisher failed");  // Symulacja działa dalej, widzowie mogą użyć --shm
+    }
+
+    if (pool_initial > 0) {
+        if (prefork_pool(shared_state) == -1) {
+            if (clients_pgid > 0) killpg(clients_pgid, SIGTERM);
+            abort_startup(shared_state);
             return EXIT_FAILURE;
         }
+        log_message("BAR: Pula klientów gotowa: %d procesów (maks. %d)", pool_initial, pool_max);
     }
-    
-    time_t start_time = shared_state->simulation_start_time;
-    
-    while (running) {  // Główna pętla symulacji
-        time_t current_time = time(NULL);
-        
-        if (current_time - start_time >= SIMULATION_TIME) {
-            log_message("BAR: Koniec czasu symulacji");
-            break;
-        }
-        
-        if (shared_state->fire_alarm) {
-            log_message("BAR: Pożar! Kończę symulację.");
-            break;
-        }
-        
-        int status;
-        while (waitpid(-1, &status, WNOHANG) > 0) {
-        }
-        
-        sleep(2);
+
+    // Zegar symulacji startuje dopiero, gdy wszystkie role są gotowe; po przywróceniu wskazuje
+    // od razu czas punktu kontrolnego
+    long long restored_ms = restore_point != NULL ? restore_point->sim_ms : 0;
+    shared_state->simulation_start_time = time(NULL) - (time_t)(restored_ms / 1000);
+    shared_state->roles_ready_ns = monotonic_ns();
+    shared_state->simulation_start_ns = shared_state->roles_ready_ns - restored_ms * 1000000LL;
+    lifecycle_set_start(shared_state->simulation_start_ns);
+    release_start_gate(1 + resumed_groups);  // Kierownik i wznowieni klienci czekają na start zegara
+
+    if (restore_point != NULL) {
+        restore_queues();
+        checkpoint_unmap(restore_point, restore_size);
+        restore_point = NULL;
     }
-    
-    if (shared_state != NULL) {
-        shmdt(shared_state);
+
+    log_message("BAR: Procesy uruchomione (kasjer, obsługa, kierownik) - gotowe po %.3f ms",
+               (shared_state->roles_ready_ns - shared_state->startup_begin_ns) / 1e6);
+
+    supervise(shared_state, arrivals_done);  // Główna pętla symulacji
+
+    report_queue_pressure(shared_state);
+    shmdt(shared_state);
+    close(signal_fd);
+    free(children);
+
+    int soak_failures = soak ? soak_report() : 0;
+    log_message("BAR: Symulacja zakończona");
+    lockprof_report();  // Przed usunięciem semafora logu
+    if (trace_dir != NULL) {
+        printf("BAR: Bufory śledzenia w %s (scalanie: ./bin/tracemerge %s)\n", trace_dir, trace_dir);
     }
-    
-    int status;
-    
-    // Zakończ wszystkie procesy klientów przed zakończeniem
-    if (clients_pgid > 0) {
-        killpg(clients_pgid, SIGTERM);
+    if (lifecycle_path != NULL) {
+        printf("BAR: Rekordy cyklu życia grup w %s (./bin/lifequery %s)\n", lifecycle_path, lifecycle_path);
     }
-    
-    // Czekaj na zakończenie wszystkich procesów klientów
-    for (int i = 0; i < num_clients; i++) {
-        if (client_pids[i] > 0) {
-            waitpid(client_pids[i], &status, 0);
-        }
-    }
-    
-    // Czekaj na pozostałe procesy potomne
-    while (waitpid(-1, &status, WNOHANG) > 0) { }
-    
-    if (pid_kasjer > 0) waitpid(pid_kasjer, &status, 0);
-    if (pid_obsluga > 0) waitpid(pid_obsluga, &status, 0);
-    if (pid_kierownik > 0) waitpid(pid_kierownik, &status, 0);
-    
-    while (waitpid(-1, &status, 0) > 0) { }
-    
-    log_message("BAR: Symulacja zakończona");
-    
+
+    transport_destroy();
     cleanup_ipc();  // Czyszczenie zasobów IPC
 
-    return EXIT_SUCCESS;
+    return soak_failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
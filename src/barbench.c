@@ -0,0 +1,489 @@
+#include "common.h"
+#include "seating.h"
+#include "occupancy.h"
+
+// Mikrobenchmark algorytmu usadzania na prywatnej sali (bez IPC, procesów i czekania): każda operacja
+// seating.c / occupancy.c jest powtarzana na kopii sali przygotowanej dla danego rozmiaru (X3 lub
+// podwojone X3) i zapełnienia. Wynik to ns/op - najlepszy z kilku powtórzeń, żeby przerwania
+// planisty nie zawyżały pomiaru. Wersje alternatywne (alokator ogólny, skalarne occupancy_stats)
+// są mierzone na tych samych danych.
+#define DEFAULT_OPS 1000000
+#define DEFAULT_REPEATS 5
+#define DEFAULT_SEED 1
+#define MAX_GROUP_SIZE 3      // Rozmiary grup jak w generate_group() baru
+#define CHURN_MAX_SEATED 64   // Więcej grup niż miejsc w sali po podwojeniu
+#define RESERVE_START_MS 10000
+#define RESERVE_END_MS 20000
+#define BENCH_GROUP_ID 900000  // Grupa mierzonych operacji - poza identyfikatorami grup sali wzorcowej
+#define SERVE_FIRST_ID 1000000
+#define LABEL_WIDTH 28
+// Test różnicowy jąder occupancy: tablice syntetyczne dłuższe niż wektor (sala X1..X4 ma krótsze)
+#define VERIFY_MAX_LEN 300
+#define VERIFY_LONG_LEN 10000
+#define VERIFY_ROUNDS 8       // Losowe wypełnienia na długość
+
+typedef int (*FindFn)(Seating *seating, int group_size, int *table_type, int *table_index);
+typedef void (*StatsFn)(const SharedState *state, OccupancyStats *out);
+
+// Układ sali: podwojenie X3 i zapełnienie miejsc (procent pojemności)
+typedef struct {
+    const char *name;
+    int doubled;
+    int fill_percent;
+} HallConfig;
+
+static const HallConfig halls[] = {
+    {"X3 0%", 0, 0},    {"X3 50%", 0, 50},    {"X3 90%", 0, 90},
+    {"2xX3 0%", 1, 0},  {"2xX3 50%", 1, 50},  {"2xX3 90%", 1, 90},
+};
+#define HALL_COUNT ((int)(sizeof(halls) / sizeof(halls[0])))
+
+// Sala wzorcowa - każdy pomiar zaczyna od jej kopii
+typedef struct {
+    Seating seating;
+    SharedState state;
+    int capacity;
+} Hall;
+
+typedef struct {
+    int group_id;
+    int group_size;
+    int table_type;
+    int table_index;
+} SeatedEntry;
+
+static Hall templates[HALL_COUNT];
+static Hall work;
+static int ops = DEFAULT_OPS;
+static int repeats = DEFAULT_REPEATS;
+static unsigned int base_seed = DEFAULT_SEED;
+static long long clock_overhead_ns = 0;  // Koszt pary odczytów zegara, odejmowany przy pomiarze pojedynczych wywołań
+static volatile int sink;               // Wyniki operacji - kompilator nie może usunąć pętli
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void calibrate_clock(void) {
+    long long best = -1;
+    for (int i = 0; i < 10000; i++) {
+        long long start = now_ns();
+        long long elapsed = now_ns() - start;
+        if (best == -1 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    clock_overhead_ns = best;
+}
+
+static int occupied_seats(const Hall *hall) {
+    return hall->capacity - hall->state.total_free_seats;
+}
+
+static void hall_copy(Hall *dst, const Hall *src) {
+    memcpy(dst, src, sizeof(*dst));
+    dst->seating.state = &dst->state;  // Seating wskazuje na salę, z której powstał
+}
+
+// Zapełnia salę losowymi grupami do zadanego procentu miejsc (albo do pierwszej nieudanej próby
+// po kilku kolejnych odmowach - przy zasadzie równoliczności nie każda sala da się dopełnić)
+static void hall_build(Hall *hall, const HallConfig *config, unsigned int seed) {
+    seating_init_hall(&hall->state);
+    seating_init(&hall->seating, &hall->state);
+    if (config->doubled) {
+        seating_double_x3(&hall->seating);
+    }
+    hall->capacity = config->doubled ? MAX_PERSONS_DOUBLED : MAX_PERSONS;
+
+    int target = hall->capacity * config->fill_percent / 100;
+    int group_id = 1;
+    int refusals = 0;
+    while (occupied_seats(hall) < target && refusals < 16) {
+        int size = (rand_r(&seed) % MAX_GROUP_SIZE) + 1;
+        if (occupied_seats(hall) + size > target) {
+            size = target - occupied_seats(hall);
+        }
+        int type, index;
+        if (seating_seat_group(&hall->seating, group_id, size, &type, &index)) {
+            group_id++;
+            refusals = 0;
+        } else {
+            refusals++;
+        }
+    }
+}
+
+// Najlepszy wynik z powtórzeń (ns/op); -1 = operacja niewykonalna dla tej sali
+typedef double (*BenchFn)(const Hall *hall, const void *arg);
+
+static double best_of(BenchFn bench, const Hall *hall, const void *arg) {
+    double best = -1;
+    for (int r = 0; r < repeats; r++) {
+        double result = bench(hall, arg);
+        if (result < 0) {
+            return -1;
+        }
+        if (best < 0 || result < best) {
+            best = result;
+        }
+    }
+    return best;
+}
+
+static const FindFn find_fixed = seating_find_free_table;
+static const FindFn find_generic = seating_find_free_table_generic;
+static const StatsFn stats_simd = occupancy_stats;
+static const StatsFn stats_scalar = occupancy_stats_scalar;
+
+static double bench_find(const Hall *hall, const void *arg) {
+    FindFn find = *(const FindFn *)arg;
+    hall_copy(&work, hall);
+    int acc = 0;
+    long long start = now_ns();
+    for (int i = 0; i < ops; i++) {
+        int type = 0, index = 0;
+        if (find(&work.seating, (i % MAX_GROUP_SIZE) + 1, &type, &index)) {
+            acc += type + index;
+        }
+    }
+    long long elapsed = now_ns() - start;
+    sink = acc;
+    return (double)elapsed / ops;
+}
+
+static double bench_stats(const Hall *hall, const void *arg) {
+    StatsFn stats = *(const StatsFn *)arg;
+    hall_copy(&work, hall);
+    OccupancyStats out;
+    int acc = 0;
+    long long start = now_ns();
+    for (int i = 0; i < ops; i++) {
+        stats(&work.state, &out);
+        acc += out.total.seats_free;
+    }
+    long long elapsed = now_ns() - start;
+    sink = acc;
+    return (double)elapsed / ops;
+}
+
+// Para allocate + free na stolikach wybranych przez alokator dla grup 1..MAX_GROUP_SIZE
+static double bench_allocate_free(const Hall *hall, const void *arg) {
+    (void)arg;
+    hall_copy(&work, hall);
+    int types[MAX_GROUP_SIZE], indices[MAX_GROUP_SIZE], sizes[MAX_GROUP_SIZE];
+    int count = 0;
+    for (int size = 1; size <= MAX_GROUP_SIZE; size++) {
+        if (seating_find_free_table(&work.seating, size, &types[count], &indices[count])) {
+            sizes[count++] = size;
+        }
+    }
+    if (count == 0) {
+        return -1;
+    }
+
+    long long start = now_ns();
+    for (int i = 0; i < ops; i++) {
+        int k = i % count;
+        seating_allocate_table(&work.seating, types[k], indices[k], sizes[k], BENCH_GROUP_ID);
+        seating_free_table(&work.seating, types[k], indices[k], sizes[k], BENCH_GROUP_ID);
+    }
+    long long elapsed = now_ns() - start;
+    sink = work.state.total_free_seats;
+    return (double)elapsed / ops;
+}
+
+// Pełna ścieżka obsługi: szybka decyzja occupancy_stats(), wyszukanie, mapa grup, zwolnienie
+static double bench_seat_release(const Hall *hall, const void *arg) {
+    (void)arg;
+    hall_copy(&work, hall);
+    int seated = 0;
+    long long start = now_ns();
+    for (int i = 0; i < ops; i++) {
+        int size = (i % MAX_GROUP_SIZE) + 1;
+        int type, index;
+        if (seating_seat_group(&work.seating, BENCH_GROUP_ID, size, &type, &index)) {
+            seating_release_group(&work.seating, BENCH_GROUP_ID, size);
+            seated++;
+        }
+    }
+    long long elapsed = now_ns() - start;
+    sink = seated;
+    return (double)elapsed / ops;
+}
+
+static void collect_seated(void *ctx, const WaitingClient *client, int table_type, int table_index) {
+    (void)table_type;
+    (void)table_index;
+    SeatedEntry *entry = (SeatedEntry *)ctx;
+    while (entry->group_id != 0) {
+        entry++;
+    }
+    entry->group_id = client->group_id;
+    entry->group_size = client->group_size;
+}
+
+// Wywołanie seating_serve_waiting() przy kolejce dopełnianej do MAX_GROUP_SIZE grup; usadzone grupy
+// są zwalniane poza pomiarem, więc każde wywołanie widzi salę w stanie wzorcowym
+static double bench_serve_waiting(const Hall *hall, const void *arg) {
+    (void)arg;
+    hall_copy(&work, hall);
+    int calls = ops / 10 > 0 ? ops / 10 : 1;
+    int next_id = SERVE_FIRST_ID;
+    long long total = 0;
+    for (int i = 0; i < calls; i++) {
+        while (work.seating.waiting_count < MAX_GROUP_SIZE) {
+            seating_enqueue(&work.seating, next_id, (next_id % MAX_GROUP_SIZE) + 1, 0);
+            next_id++;
+        }
+        SeatedEntry served[MAX_GROUP_SIZE + 1] = {0};
+        long long start = now_ns();
+        seating_serve_waiting(&work.seating, collect_seated, served);
+        total += now_ns() - start - clock_overhead_ns;
+        for (int k = 0; served[k].group_id != 0; k++) {
+            seating_release_group(&work.seating, served[k].group_id, served[k].group_size);
+        }
+    }
+    return (double)total / calls;
+}
+
+// Cykl seating_reserve_tables() na przyszły przedział i seating_release_reservations(), mierzona
+// jedna z dwóch części
+static double reserve_cycle(const Hall *hall, int measure_release) {
+    hall_copy(&work, hall);
+    unsigned int seed = base_seed;
+    int calls = ops / 10 > 0 ? ops / 10 : 1;
+    long long total = 0;
+    for (int i = 0; i < calls; i++) {
+        long long start = now_ns();
+        int reserved = seating_reserve_tables(&work.seating, RESERVED_TABLE_COUNT, RESERVE_START_MS,
+                                              RESERVE_END_MS, &seed, NULL, 0);
+        long long middle = now_ns();
+        seating_release_reservations(&work.seating);
+        long long end = now_ns();
+        if (reserved == 0) {
+            return -1;
+        }
+        total += (measure_release ? end - middle : middle - start) - clock_overhead_ns;
+    }
+    return (double)total / calls;
+}
+
+static double bench_reserve(const Hall *hall, const void *arg) {
+    (void)arg;
+    return reserve_cycle(hall, 0);
+}
+
+static double bench_release_reservations(const Hall *hall, const void *arg) {
+    (void)arg;
+    return reserve_cycle(hall, 1);
+}
+
+// Odtwarzanie ciągu żądań i zwolnień: grupa losowej wielkości szuka stolika podanym alokatorem,
+// najdłużej siedzące grupy wychodzą, gdy sala przekroczyłaby zapełnienie układu lub brak miejsca.
+// Operacją jest każde żądanie i każde zwolnienie.
+typedef struct {
+    FindFn find;
+    int *seated_total;  // Liczba udanych usadzeń - obie wersje alokatora muszą dać ten sam wynik
+} ChurnArg;
+
+static double bench_churn(const Hall *hall, const void *arg) {
+    const ChurnArg *churn = (const ChurnArg *)arg;
+    // Pusta sala wzorca - zapełnienie wynika z limitu, nie ze stanu wzorca
+    seating_init_hall(&work.state);
+    seating_init(&work.seating, &work.state);
+    if (hall->state.x3_doubled) {
+        seating_double_x3(&work.seating);
+    }
+    work.capacity = hall->capacity;
+
+    int limit = occupied_seats(hall) > MAX_GROUP_SIZE ? occupied_seats(hall) : MAX_GROUP_SIZE;
+    SeatedEntry seated[CHURN_MAX_SEATED];
+    int head = 0, count = 0, done = 0, seated_ok = 0;
+    unsigned int seed = base_seed;
+
+    long long start = now_ns();
+    while (done < ops) {
+        int size = (rand_r(&seed) % MAX_GROUP_SIZE) + 1;
+        while (count > 0 && occupied_seats(&work) + size > limit) {
+            SeatedEntry *oldest = &seated[head];
+            seating_free_table(&work.seating, oldest->table_type, oldest->table_index, oldest->group_size,
+                               oldest->group_id);
+            head = (head + 1) % CHURN_MAX_SEATED;
+            count--;
+            done++;
+        }
+
+        int type, index;
+        int group_id = done + 1;
+        done++;
+        if (count < CHURN_MAX_SEATED && churn->find(&work.seating, size, &type, &index)) {
+            seating_allocate_table(&work.seating, type, index, size, group_id);
+            SeatedEntry *entry = &seated[(head + count) % CHURN_MAX_SEATED];
+            entry->group_id = group_id;
+            entry->group_size = size;
+            entry->table_type = type;
+            entry->table_index = index;
+            count++;
+            seated_ok++;
+        } else if (count > 0) {
+            SeatedEntry *oldest = &seated[head];
+            seating_free_table(&work.seating, oldest->table_type, oldest->table_index, oldest->group_size,
+                               oldest->group_id);
+            head = (head + 1) % CHURN_MAX_SEATED;
+            count--;
+            done++;
+        }
+    }
+    long long elapsed = now_ns() - start;
+    *churn->seated_total = seated_ok;
+    return (double)elapsed / done;
+}
+
+// Etykieta wiersza wyrównana do kolumny - szerokość w znakach, nie w bajtach UTF-8
+static void print_label(const char *label) {
+    int width = 0;
+    for (const char *c = label; *c != '\0'; c++) {
+        if (((unsigned char)*c & 0xC0) != 0x80) {
+            width++;
+        }
+    }
+    printf("%s%*s", label, width < LABEL_WIDTH ? LABEL_WIDTH - width : 0, "");
+}
+
+static void print_row(const char *name, BenchFn bench, const void *arg) {
+    print_label(name);
+    for (int h = 0; h < HALL_COUNT; h++) {
+        double result = best_of(bench, &templates[h], arg);
+        if (result < 0) {
+            printf(" %9s", "-");
+        } else {
+            printf(" %9.1f", result);
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+// Jądra SIMD occupancy kontra pętla skalarna: długości 0..VERIFY_MAX_LEN (pełne wektory i każdy ogon)
+// i VERIFY_LONG_LEN, pojemności 1..4, obłożenie losowe z -1..pojemność; zwraca liczbę niezgodności
+static int verify_occupancy(void) {
+    static int occ[VERIFY_LONG_LEN];
+    unsigned int seed = base_seed;
+    int arrays = 0;
+    int mismatches = 0;
+    for (int capacity = 1; capacity <= 4; capacity++) {
+        for (int len = 0; len <= VERIFY_MAX_LEN + 1; len++) {
+            int count = len <= VERIFY_MAX_LEN ? len : VERIFY_LONG_LEN;
+            for (int round = 0; round < VERIFY_ROUNDS; round++) {
+                for (int i = 0; i < count; i++) {
+                    occ[i] = (int)(rand_r(&seed) % (unsigned int)(capacity + 2)) - 1;
+                }
+                int bad = occupancy_scan_verify(occ, count, capacity);
+                if (bad > 0 && mismatches == 0) {
+                    printf("BARBENCH: BŁĄD - jądro occupancy różne od skalarnego (pojemność %d, %d stolików)\n",
+                           capacity, count);
+                }
+                mismatches += bad;
+                arrays++;
+            }
+        }
+    }
+    printf("BARBENCH: occupancy %s - test różnicowy jąder SIMD: %d tablic, %d niezgodności\n",
+           occupancy_backend(), arrays, mismatches);
+    return mismatches;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Użycie: %s [-n OPERACJE] [-r POWTÓRZENIA] [--seed S] [--verify]\n", program);
+    fprintf(stderr, "  -n N      operacje na pomiar (domyślnie %d)\n", DEFAULT_OPS);
+    fprintf(stderr, "  -r R      powtórzenia, wynik = najlepsze (domyślnie %d)\n", DEFAULT_REPEATS);
+    fprintf(stderr, "  --seed S  ziarno zapełnienia sal i ciągu żądań (domyślnie %d)\n", DEFAULT_SEED);
+    fprintf(stderr, "  --verify  tylko test różnicowy jąder SIMD occupancy (wykonywany też przed pomiarami)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int verify_only = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            ops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            repeats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            base_seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            verify_only = 1;
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (ops < 1 || repeats < 1) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Pomiar niezgodnego jądra nie ma sensu
+    if (verify_occupancy() > 0) {
+        return EXIT_FAILURE;
+    }
+    if (verify_only) {
+        return EXIT_SUCCESS;
+    }
+
+    calibrate_clock();
+    for (int h = 0; h < HALL_COUNT; h++) {
+        hall_build(&templates[h], &halls[h], base_seed + (unsigned int)h);
+    }
+
+    printf("BARBENCH: alokator %s, occupancy %s, %d op. na pomiar, najlepszy z %d, zegar %lld ns\n",
+           seating_allocator(), occupancy_backend(), ops, repeats, clock_overhead_ns);
+    print_label("ns/op");
+    for (int h = 0; h < HALL_COUNT; h++) {
+        printf(" %9s", halls[h].name);
+    }
+    printf("\n");
+    print_label("zajęte miejsca");
+    for (int h = 0; h < HALL_COUNT; h++) {
+        printf(" %6d/%-2d", occupied_seats(&templates[h]), templates[h].capacity);
+    }
+    printf("\n");
+
+    print_row("find_free_table", bench_find, &find_fixed);
+    print_row("find_free_table (ogólny)", bench_find, &find_generic);
+    print_row("occupancy_stats", bench_stats, &stats_simd);
+    print_row("occupancy_stats (skalarny)", bench_stats, &stats_scalar);
+    print_row("allocate+free", bench_allocate_free, NULL);
+    print_row("seat_group+release_group", bench_seat_release, NULL);
+    print_row("serve_waiting (wywołanie)", bench_serve_waiting, NULL);
+    print_row("reserve_tables", bench_reserve, NULL);
+    print_row("release_reservations", bench_release_reservations, NULL);
+
+    // Ciąg żądań i zwolnień - obie wersje alokatora muszą usadzić te same grupy
+    int mismatches = 0;
+    int seated_fixed[HALL_COUNT], seated_generic[HALL_COUNT];
+    print_label("ciąg żądań");
+    for (int h = 0; h < HALL_COUNT; h++) {
+        ChurnArg arg = {find_fixed, &seated_fixed[h]};
+        printf(" %9.1f", best_of(bench_churn, &templates[h], &arg));
+        fflush(stdout);
+    }
+    printf("\n");
+    print_label("ciąg żądań (ogólny)");
+    for (int h = 0; h < HALL_COUNT; h++) {
+        ChurnArg arg = {find_generic, &seated_generic[h]};
+        printf(" %9.1f", best_of(bench_churn, &templates[h], &arg));
+        fflush(stdout);
+        if (seated_generic[h] != seated_fixed[h]) {
+            mismatches++;
+        }
+    }
+    printf("\n");
+
+    if (mismatches > 0) {
+        printf("BARBENCH: BŁĄD - alokatory usadziły różne grupy w %d układach\n", mismatches);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
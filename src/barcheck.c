@@ -0,0 +1,715 @@
+#include "common.h"
+#include "utils.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Rodzaje rekordów wyciąganych z logu (pozostałe linie są pomijane)
+#define REC_RUN_START 1     // BAR: Inicjalizacja zakończona - nowy przebieg w logu
+#define REC_ENTER 2         // KLIENT #g: Grupa s-osobowa wchodzi do baru
+#define REC_QUEUE 3         // OBSLUGA: Grupa #g (s os.) czeka w kolejce
+#define REC_SEAT 4          // OBSLUGA: Stolik t-os.[i] -> grupa #g (s os.) / Klient #g z kolejki -> stolik t-os.[i]
+#define REC_FREE 5          // OBSLUGA: Grupa #g zwolniła stolik
+#define REC_RETURNED 6      // KLIENT #g: Oddał naczynia
+#define REC_RESERVE 7       // OBSLUGA: Zarezerwowano stolik t-os.[i]
+#define REC_UNRESERVE 8     // OBSLUGA: Zwolniono rezerwację
+#define REC_DOUBLE 9        // OBSLUGA: X3 podwojone
+#define REC_FIRE 10         // KIEROWNIK: >>> SYGNAŁ 3 (POŻAR)
+#define REC_CLOSING 11      // Koniec czasu symulacji / przerwanie
+#define REC_EVACUATED 12    // KLIENT #g: POŻAR! Ewakuacja
+#define REC_WORKERS_DONE 13 // OBSLUGA: Pracownicy kończą pracę
+#define REC_CASHIER_DONE 14 // KASJER: Kasa zamknięta
+#define REC_BAR_DONE 15     // BAR: Symulacja zakończona
+#define REC_EXPIRE 16       // OBSLUGA: Rezerwacja stolika t-os.[i] wygasła
+#define REC_RESTORED 17     // OBSLUGA: Przywrócona grupa #g (s os.) przy stoliku t-os.[i] (punkt kontrolny)
+
+#define MAX_TABLES_PER_TYPE 64
+_Static_assert(X1 <= MAX_TABLES_PER_TYPE && X2 <= MAX_TABLES_PER_TYPE && X3_MAX <= MAX_TABLES_PER_TYPE &&
+               X4 <= MAX_TABLES_PER_TYPE, "MAX_TABLES_PER_TYPE za małe dla układu sali");
+#define DEFAULT_MAX_REPORTED 50
+
+typedef struct {
+    long line;      // Numer linii w fragmencie, po scaleniu - w całym pliku
+    int type;
+    int gid;
+    int a;          // Rozmiar grupy lub typ stolika
+    int b;          // Indeks stolika
+} Record;
+
+// Fragment pliku parsowany przez jeden wątek
+typedef struct {
+    const char *begin;
+    const char *end;
+    Record *records;
+    size_t count;
+    size_t capacity;
+    long lines;
+    int failed;
+} Chunk;
+
+// Grupa w odtwarzanym stanie sali
+typedef struct {
+    int gid;            // 0 = pusty slot
+    int size;           // 0 = nieznany
+    int table_type;     // 0 = nieusadzona
+    int table_index;
+    long seat_line;
+    int returned;       // Klient zgłosił oddanie naczyń
+    int freed;          // Grupa zwolniła stolik
+} GroupState;
+
+typedef struct {
+    int reserved;
+    int count;
+    int gids[4];
+    int sizes[4];
+} TableState;
+
+// Odtwarzany stan sali i liczniki jednego przebiegu
+typedef struct {
+    TableState tables[4][MAX_TABLES_PER_TYPE];
+    int table_count[4];
+    GroupState *groups;
+    size_t groups_capacity;
+    size_t groups_used;
+    int fire;
+    long fire_line;
+    int closing;
+    int workers_done;
+    int cashier_done;
+    int bar_done;
+    int seats_occupied;
+    int max_seats_occupied;
+} Hall;
+
+typedef struct {
+    long violations;
+    long reported;
+    long max_reported;
+    long runs;
+    long entered;
+    long seated;
+    long freed;
+    long evacuated;
+    long left_at_closing;
+    int max_seats_occupied;
+} Report;
+
+// ---- Parsowanie (równoległe) ----
+
+static int match(const char **p, const char *end, const char *literal) {
+    size_t len = strlen(literal);
+    if ((size_t)(end - *p) < len || memcmp(*p, literal, len) != 0) {
+        return 0;
+    }
+    *p += len;
+    return 1;
+}
+
+static int parse_int(const char **p, const char *end, int *out) {
+    const char *s = *p;
+    int value = 0;
+    if (s >= end || *s < '0' || *s > '9') {
+        return 0;
+    }
+    while (s < end && *s >= '0' && *s <= '9') {
+        value = value * 10 + (*s - '0');
+        s++;
+    }
+    *out = value;
+    *p = s;
+    return 1;
+}
+
+static int push_record(Chunk *chunk, long line, int type, int gid, int a, int b) {
+    if (chunk->count == chunk->capacity) {
+        size_t capacity = chunk->capacity > 0 ? chunk->capacity * 2 : 4096;
+        Record *records = realloc(chunk->records, capacity * sizeof(Record));
+        if (records == NULL) {
+            chunk->failed = 1;
+            return -1;
+        }
+        chunk->records = records;
+        chunk->capacity = capacity;
+    }
+    Record *rec = &chunk->records[chunk->count++];
+    rec->line = line;
+    rec->type = type;
+    rec->gid = gid;
+    rec->a = a;
+    rec->b = b;
+    return 0;
+}
+
+// Rozpoznaje komunikat (tekst po "[HH:MM:SS] [PID:n] ") i dodaje rekord
+static void parse_message(Chunk *chunk, long line, const char *p, const char *end) {
+    int gid, a, b;
+    const char *s = p;
+
+    if (match(&s, end, "OBSLUGA: ")) {
+        const char *m = s;
+        if (match(&m, end, "Stolik ") && parse_int(&m, end, &a) && match(&m, end, "-os.[") &&
+            parse_int(&m, end, &b) && match(&m, end, "] -> grupa #") && parse_int(&m, end, &gid)) {
+            // Grupy generatorów (poza przedziałem baru) nie mają w logu linii wejścia - rozmiar z usadzenia
+            int size;
+            if (gid >= GROUP_ID_STRIDE && match(&m, end, " (") && parse_int(&m, end, &size)) {
+                push_record(chunk, line, REC_QUEUE, gid, size, 0);
+            }
+            push_record(chunk, line, REC_SEAT, gid, a, b);
+            return;
+        }
+        m = s;
+        if (match(&m, end, "Klient #") && parse_int(&m, end, &gid) && match(&m, end, " z kolejki -> stolik ") &&
+            parse_int(&m, end, &a) && match(&m, end, "-os.[") && parse_int(&m, end, &b)) {
+            push_record(chunk, line, REC_SEAT, gid, a, b);
+            return;
+        }
+        m = s;
+        if (match(&m, end, "Grupa #") && parse_int(&m, end, &gid)) {
+            if (match(&m, end, " zwolniła stolik")) {
+                push_record(chunk, line, REC_FREE, gid, 0, 0);
+            } else if (match(&m, end, " (") && parse_int(&m, end, &a) && match(&m, end, " os.) czeka")) {
+                push_record(chunk, line, REC_QUEUE, gid, a, 0);
+            }
+            return;
+        }
+        m = s;
+        if (match(&m, end, "Zarezerwowano stolik ") && parse_int(&m, end, &a) && match(&m, end, "-os.[") &&
+            parse_int(&m, end, &b)) {
+            push_record(chunk, line, REC_RESERVE, 0, a, b);
+            return;
+        }
+        m = s;
+        if (match(&m, end, "Rezerwacja stolika ") && parse_int(&m, end, &a) && match(&m, end, "-os.[") &&
+            parse_int(&m, end, &b) && match(&m, end, "] wygasła")) {
+            push_record(chunk, line, REC_EXPIRE, 0, a, b);
+            return;
+        }
+        // Stan początkowy przebiegu wznowionego z punktu kontrolnego: rozmiar grupy jak z kolejki,
+        // stolik jak przy usadzeniu
+        m = s;
+        if (match(&m, end, "Przywrócona grupa #") && parse_int(&m, end, &gid) && match(&m, end, " (") &&
+            parse_int(&m, end, &a) && match(&m, end, " os.) ")) {
+            push_record(chunk, line, REC_QUEUE, gid, a, 0);
+            if (match(&m, end, "przy stoliku ") && parse_int(&m, end, &a) && match(&m, end, "-os.[") &&
+                parse_int(&m, end, &b)) {
+                push_record(chunk, line, REC_RESTORED, gid, a, b);
+            }
+            return;
+        }
+        m = s;
+        if (match(&m, end, "Przywrócona rezerwacja stolika ") && parse_int(&m, end, &a) &&
+            match(&m, end, "-os.[") && parse_int(&m, end, &b)) {
+            push_record(chunk, line, REC_RESERVE, 0, a, b);
+            return;
+        }
+        m = s;
+        if (match(&m, end, "Zwolniono rezerwację")) {
+            push_record(chunk, line, REC_UNRESERVE, 0, 0, 0);
+        } else if (match(&m, end, "X3 podwojone") || match(&m, end, "Przywrócone podwojenie X3")) {
+            push_record(chunk, line, REC_DOUBLE, 0, 0, 0);
+        } else if (match(&m, end, "Pracownicy kończą pracę")) {
+            push_record(chunk, line, REC_WORKERS_DONE, 0, 0, 0);
+        }
+        return;
+    }
+
+    if (match(&s, end, "KLIENT #")) {
+        if (!parse_int(&s, end, &gid) || !match(&s, end, ": ")) {
+            return;
+        }
+        const char *m = s;
+        if (match(&m, end, "Grupa ") && parse_int(&m, end, &a) && match(&m, end, "-osobowa wchodzi")) {
+            push_record(chunk, line, REC_ENTER, gid, a, 0);
+            return;
+        }
+        m = s;
+        if (match(&m, end, "Oddał naczynia")) {
+            push_record(chunk, line, REC_RETURNED, gid, 0, 0);
+            return;
+        }
+        m = s;
+        if (match(&m, end, "POŻAR! Ewakuacja")) {
+            push_record(chunk, line, REC_EVACUATED, gid, 0, 0);
+        }
+        return;
+    }
+
+    if (match(&s, end, "KIEROWNIK: ")) {
+        const char *m = s;
+        if (match(&m, end, ">>> SYGNAŁ 3")) {
+            push_record(chunk, line, REC_FIRE, 0, 0, 0);
+        } else if (match(&m, end, "Koniec symulacji")) {
+            push_record(chunk, line, REC_CLOSING, 0, 0, 0);
+        }
+        return;
+    }
+
+    if (match(&s, end, "KASJER: Kasa zamknięta")) {
+        push_record(chunk, line, REC_CASHIER_DONE, 0, 0, 0);
+        return;
+    }
+
+    if (match(&s, end, "BAR: ")) {
+        const char *m = s;
+        if (match(&m, end, "Inicjalizacja zakończona")) {
+            push_record(chunk, line, REC_RUN_START, 0, 0, 0);
+        } else if (match(&m, end, "Przywrócone żądanie stolika grupy #") && parse_int(&m, end, &gid) &&
+                   match(&m, end, " (") && parse_int(&m, end, &a)) {
+            push_record(chunk, line, REC_QUEUE, gid, a, 0);
+        } else if (match(&m, end, "Symulacja zakończona")) {
+            push_record(chunk, line, REC_BAR_DONE, 0, 0, 0);
+        } else if (match(&m, end, "Koniec czasu symulacji") || match(&m, end, "Przerwanie")) {
+            push_record(chunk, line, REC_CLOSING, 0, 0, 0);
+        }
+    }
+}
+
+static void *parse_chunk(void *arg) {
+    Chunk *chunk = (Chunk *)arg;
+    const char *p = chunk->begin;
+    long line = 0;
+
+    while (p < chunk->end && !chunk->failed) {
+        const char *eol = memchr(p, '\n', chunk->end - p);
+        if (eol == NULL) {
+            eol = chunk->end;
+        }
+        line++;
+
+        // Prefiks "[HH:MM:SS] [PID:n] " - treść zaczyna się po drugim "] "
+        const char *msg = memchr(p, ']', eol - p);
+        if (msg != NULL) {
+            msg = memchr(msg + 1, ']', eol - msg - 1);
+        }
+        if (msg != NULL && msg + 2 <= eol) {
+            parse_message(chunk, line, msg + 2, eol);
+        }
+        p = eol + 1;
+    }
+    chunk->lines = line;
+    return NULL;
+}
+
+// ---- Odtwarzanie stanu (sekwencyjne) ----
+
+static void violation(Report *report, long line, const char *format, ...) {
+    report->violations++;
+    if (report->reported >= report->max_reported) {
+        return;
+    }
+    report->reported++;
+
+    char message[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    printf("barcheck: linia %ld: %s\n", line, message);
+}
+
+static size_t group_home(int gid, size_t capacity) {
+    return ((size_t)(unsigned int)gid * 2654435761u) & (capacity - 1);
+}
+
+// Zwraca stan grupy (tworzy nowy wpis, jeśli brak); NULL przy braku pamięci
+static GroupState *group_get(Hall *hall, int gid) {
+    if ((hall->groups_used + 1) * 2 > hall->groups_capacity) {
+        size_t capacity = hall->groups_capacity > 0 ? hall->groups_capacity * 2 : 1024;
+        GroupState *groups = calloc(capacity, sizeof(GroupState));
+        if (groups == NULL) {
+            return NULL;
+        }
+        for (size_t i = 0; i < hall->groups_capacity; i++) {
+            if (hall->groups[i].gid != 0) {
+                size_t j = group_home(hall->groups[i].gid, capacity);
+                while (groups[j].gid != 0) {
+                    j = (j + 1) & (capacity - 1);
+                }
+                groups[j] = hall->groups[i];
+            }
+        }
+        free(hall->groups);
+        hall->groups = groups;
+        hall->groups_capacity = capacity;
+    }
+
+    size_t i = group_home(gid, hall->groups_capacity);
+    while (hall->groups[i].gid != 0 && hall->groups[i].gid != gid) {
+        i = (i + 1) & (hall->groups_capacity - 1);
+    }
+    if (hall->groups[i].gid == 0) {
+        hall->groups[i].gid = gid;
+        hall->groups_used++;
+    }
+    return &hall->groups[i];
+}
+
+static void hall_reset(Hall *hall) {
+    free(hall->groups);
+    memset(hall, 0, sizeof(Hall));
+    hall->table_count[0] = X1;
+    hall->table_count[1] = X2;
+    hall->table_count[2] = X3;
+    hall->table_count[3] = X4;
+}
+
+// Sprawdzenie końca przebiegu: niezwolnione stoliki i kompletność ewakuacji
+static void hall_finish(Hall *hall, Report *report) {
+    if (hall->max_seats_occupied > report->max_seats_occupied) {
+        report->max_seats_occupied = hall->max_seats_occupied;
+    }
+    for (size_t i = 0; i < hall->groups_capacity; i++) {
+        GroupState *g = &hall->groups[i];
+        if (g->gid == 0 || g->table_type == 0) {
+            continue;
+        }
+        if (g->returned) {
+            violation(report, g->seat_line, "grupa #%d oddała naczynia, ale stolik %d-os.[%d] nie został zwolniony",
+                      g->gid, g->table_type, g->table_index);
+        } else if (hall->fire || hall->closing) {
+            report->left_at_closing++;  // Przy stoliku w chwili pożaru / zamknięcia
+        } else {
+            violation(report, g->seat_line, "grupa #%d nie zwolniła stolika %d-os.[%d] (brak końca symulacji w logu)",
+                      g->gid, g->table_type, g->table_index);
+        }
+    }
+
+    if (hall->fire) {
+        if (!hall->workers_done) {
+            violation(report, hall->fire_line, "ewakuacja niezakończona: brak \"OBSLUGA: Pracownicy kończą pracę\"");
+        }
+        if (!hall->cashier_done) {
+            violation(report, hall->fire_line, "ewakuacja niezakończona: brak \"KASJER: Kasa zamknięta\"");
+        }
+        if (!hall->bar_done) {
+            violation(report, hall->fire_line, "ewakuacja niezakończona: brak \"BAR: Symulacja zakończona\"");
+        }
+    }
+}
+
+static void replay(Hall *hall, Report *report, const Record *rec) {
+    GroupState *g;
+    TableState *table;
+
+    switch (rec->type) {
+        case REC_RUN_START:
+            if (report->runs > 0) {
+                hall_finish(hall, report);
+            }
+            hall_reset(hall);
+            report->runs++;
+            break;
+
+        case REC_ENTER:
+        case REC_QUEUE:
+            if ((g = group_get(hall, rec->gid)) == NULL) break;
+            g->size = rec->a;
+            if (rec->type == REC_ENTER) {
+                g->returned = 0;
+                g->freed = 0;
+                report->entered++;
+            }
+            break;
+
+        case REC_SEAT:
+        case REC_RESTORED:
+            if ((g = group_get(hall, rec->gid)) == NULL) break;
+            if (rec->type == REC_SEAT) {
+                report->seated++;
+            }
+            if (hall->fire) {
+                violation(report, rec->line, "grupa #%d usadzona po ogłoszeniu pożaru (linia %ld)",
+                          rec->gid, hall->fire_line);
+            }
+            if (rec->a < 1 || rec->a > 4 || rec->b < 0 || rec->b >= hall->table_count[rec->a - 1]) {
+                violation(report, rec->line, "stolik %d-os.[%d] nie istnieje", rec->a, rec->b);
+                break;
+            }
+            if (g->table_type != 0) {
+                violation(report, rec->line, "grupa #%d usadzona ponownie (już przy stoliku %d-os.[%d], linia %ld)",
+                          rec->gid, g->table_type, g->table_index, g->seat_line);
+            }
+            if (g->size == 0) {
+                violation(report, rec->line, "nieznany rozmiar grupy #%d (brak wejścia do baru)", rec->gid);
+            }
+
+            table = &hall->tables[rec->a - 1][rec->b];
+            if (table->reserved) {
+                violation(report, rec->line, "grupa #%d usadzona przy zarezerwowanym stoliku %d-os.[%d]",
+                          rec->gid, rec->a, rec->b);
+            }
+            int occupied = 0;
+            for (int i = 0; i < table->count; i++) {
+                occupied += table->sizes[i];
+                if (g->size != 0 && table->sizes[i] != g->size) {
+                    violation(report, rec->line, "przy stoliku %d-os.[%d] grupy różnej wielkości: #%d (%d os.) i #%d (%d os.)",
+                              rec->a, rec->b, table->gids[i], table->sizes[i], rec->gid, g->size);
+                }
+            }
+            if (occupied + g->size > rec->a) {
+                violation(report, rec->line, "przekroczona liczba miejsc przy stoliku %d-os.[%d]: %d > %d",
+                          rec->a, rec->b, occupied + g->size, rec->a);
+            }
+            if (table->count < 4) {
+                table->gids[table->count] = rec->gid;
+                table->sizes[table->count] = g->size;
+                table->count++;
+            }
+            g->table_type = rec->a;
+            g->table_index = rec->b;
+            g->seat_line = rec->line;
+            hall->seats_occupied += g->size;
+            if (hall->seats_occupied > hall->max_seats_occupied) {
+                hall->max_seats_occupied = hall->seats_occupied;
+            }
+            break;
+
+        case REC_FREE:
+            if ((g = group_get(hall, rec->gid)) == NULL) break;
+            if (g->table_type == 0) {
+                violation(report, rec->line, "grupa #%d zwalnia stolik, przy którym nie siedzi", rec->gid);
+                break;
+            }
+            table = &hall->tables[g->table_type - 1][g->table_index];
+            for (int i = 0; i < table->count; i++) {
+                if (table->gids[i] == rec->gid) {
+                    table->count--;
+                    table->gids[i] = table->gids[table->count];
+                    table->sizes[i] = table->sizes[table->count];
+                    break;
+                }
+            }
+            hall->seats_occupied -= g->size;
+            g->table_type = 0;
+            g->table_index = 0;
+            g->freed = 1;
+            report->freed++;
+            break;
+
+        case REC_RETURNED:
+            if ((g = group_get(hall, rec->gid)) == NULL) break;
+            g->returned = 1;
+            break;
+
+        case REC_RESERVE:
+            if (rec->a < 1 || rec->a > 4 || rec->b < 0 || rec->b >= hall->table_count[rec->a - 1]) {
+                violation(report, rec->line, "rezerwacja nieistniejącego stolika %d-os.[%d]", rec->a, rec->b);
+                break;
+            }
+            table = &hall->tables[rec->a - 1][rec->b];
+            if (table->count > 0) {
+                violation(report, rec->line, "rezerwacja zajętego stolika %d-os.[%d]", rec->a, rec->b);
+            }
+            table->reserved = 1;
+            break;
+
+        case REC_EXPIRE:
+            if (rec->a >= 1 && rec->a <= 4 && rec->b >= 0 && rec->b < MAX_TABLES_PER_TYPE) {
+                hall->tables[rec->a - 1][rec->b].reserved = 0;
+            }
+            break;
+
+        case REC_UNRESERVE:
+            for (int t = 0; t < 4; t++) {
+                for (int i = 0; i < MAX_TABLES_PER_TYPE; i++) {
+                    hall->tables[t][i].reserved = 0;
+                }
+            }
+            break;
+
+        case REC_DOUBLE:
+            hall->table_count[2] = X3_MAX;
+            break;
+
+        case REC_FIRE:
+            if (!hall->fire) {
+                hall->fire = 1;
+                hall->fire_line = rec->line;
+                // Grupy generatorów nie logują ewakuacji - liczone są te, które czekały lub siedziały przy stoliku
+                for (size_t i = 0; i < hall->groups_capacity; i++) {
+                    g = &hall->groups[i];
+                    if (g->gid >= GROUP_ID_STRIDE && !g->freed) {
+                        report->evacuated++;
+                    }
+                }
+            }
+            break;
+
+        case REC_CLOSING:
+            hall->closing = 1;
+            break;
+
+        case REC_EVACUATED:
+            report->evacuated++;
+            break;
+
+        case REC_WORKERS_DONE:
+            hall->workers_done = 1;
+            break;
+
+        case REC_CASHIER_DONE:
+            hall->cashier_done = 1;
+            break;
+
+        case REC_BAR_DONE:
+            hall->bar_done = 1;
+            break;
+    }
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Użycie: %s [PLIK_LOGU] [-i INSTANCJA] [-j WĄTKI] [--max N]\n", program);
+    fprintf(stderr, "  PLIK_LOGU      log symulacji (domyślnie logs/symulacja.log instancji)\n");
+    fprintf(stderr, "  -i N           instancja, której log sprawdzić\n");
+    fprintf(stderr, "  -j N           liczba wątków parsujących (domyślnie liczba rdzeni)\n");
+    fprintf(stderr, "  --max N        maksymalna liczba wypisanych naruszeń (domyślnie %d)\n", DEFAULT_MAX_REPORTED);
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long max_reported = DEFAULT_MAX_REPORTED;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            int instance = atoi(argv[++i]);
+            if (instance < 0 || instance >= MAX_INSTANCES) {
+                fprintf(stderr, "barcheck: Nieprawidłowy numer instancji (0..%d)\n", MAX_INSTANCES - 1);
+                return 2;
+            }
+            ipc_set_instance(instance);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max") == 0 && i + 1 < argc) {
+            max_reported = atol(argv[++i]);
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (path == NULL) path = log_file_path();
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "barcheck: %s: %s\n", path, strerror(errno));
+        return 2;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("barcheck: fstat failed");
+        close(fd);
+        return 2;
+    }
+    size_t size = (size_t)st.st_size;
+    const char *data = NULL;
+    if (size > 0) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror("barcheck: mmap failed");
+            close(fd);
+            return 2;
+        }
+        madvise((void *)data, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    long long t0 = monotonic_ns();
+
+    // Podział na fragmenty kończące się na granicy linii
+    if ((size_t)threads > size / 65536 + 1) {
+        threads = (int)(size / 65536 + 1);
+    }
+    Chunk *chunks = calloc(threads, sizeof(Chunk));
+    pthread_t *tids = calloc(threads, sizeof(pthread_t));
+    if (chunks == NULL || tids == NULL) {
+        perror("barcheck: calloc failed");
+        return 2;
+    }
+    const char *cursor = data;
+    const char *data_end = data + size;
+    for (int t = 0; t < threads; t++) {
+        const char *end = t == threads - 1 ? data_end : data + size / threads * (t + 1);
+        if (end < cursor) end = cursor;
+        if (end < data_end) {
+            const char *eol = memchr(end, '\n', data_end - end);
+            end = eol != NULL ? eol + 1 : data_end;
+        }
+        chunks[t].begin = cursor;
+        chunks[t].end = end;
+        cursor = end;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&tids[t], NULL, parse_chunk, &chunks[t]) != 0) {
+            perror("barcheck: pthread_create failed");
+            return 2;
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+
+    long long t1 = monotonic_ns();
+
+    // Odtwarzanie w kolejności pliku - numery linii przesunięte o linie poprzednich fragmentów
+    Report report;
+    memset(&report, 0, sizeof(report));
+    report.max_reported = max_reported;
+    Hall hall;
+    memset(&hall, 0, sizeof(hall));
+    hall_reset(&hall);
+
+    long line_offset = 0;
+    size_t records = 0;
+    int failed = 0;
+    for (int t = 0; t < threads; t++) {
+        failed |= chunks[t].failed;
+        for (size_t r = 0; r < chunks[t].count; r++) {
+            Record rec = chunks[t].records[r];
+            rec.line += line_offset;
+            if (rec.type != REC_RUN_START && report.runs == 0) {
+                report.runs = 1;  // Log bez nagłówka (np. po rotacji)
+            }
+            replay(&hall, &report, &rec);
+        }
+        records += chunks[t].count;
+        line_offset += chunks[t].lines;
+        free(chunks[t].records);
+    }
+    hall_finish(&hall, &report);
+    free(hall.groups);
+
+    long long t2 = monotonic_ns();
+
+    if (report.violations > report.reported) {
+        printf("barcheck: ... pominięto %ld kolejnych naruszeń\n", report.violations - report.reported);
+    }
+    printf("barcheck: %s: %ld linii, %zu rekordów, %ld przebiegów\n", path, line_offset, records, report.runs);
+    printf("barcheck: grupy: %ld weszło, %ld usadzono, %ld zwolniło stolik, %ld przy stolikach w chwili zamknięcia, %ld ewakuacji\n",
+           report.entered, report.seated, report.freed, report.left_at_closing, report.evacuated);
+    printf("barcheck: maks. zajętych miejsc: %d (sala: %d, po podwojeniu X3: %d)\n",
+           report.max_seats_occupied, MAX_PERSONS, MAX_PERSONS_DOUBLED);
+    printf("barcheck: parsowanie %.1f ms (%d wątków, %.0f MB/s), odtwarzanie %.1f ms\n",
+           (t1 - t0) / 1e6, threads, t1 > t0 ? size / 1e6 / ((t1 - t0) / 1e9) : 0.0, (t2 - t1) / 1e6);
+
+    if (data != NULL) {
+        munmap((void *)data, size);
+    }
+    free(chunks);
+    free(tids);
+
+    if (failed) {
+        fprintf(stderr, "barcheck: brak pamięci podczas parsowania\n");
+        return 2;
+    }
+    if (report.violations > 0) {
+        printf("barcheck: NARUSZENIA: %ld\n", report.violations);
+        return 1;
+    }
+    printf("barcheck: OK - wszystkie niezmienniki spełnione\n");
+    return 0;
+}
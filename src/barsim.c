@@ -0,0 +1,606 @@
+#include "common.h"
+#include "seating.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <math.h>
+
+// Wsadowy silnik Monte-Carlo: wiele niezależnych symulacji baru w jednym procesie.
+// Każda replika ma prywatną salę (SharedState) i używa logiki usadzania z seating.c,
+// a kasjer jest modelowany jako kolejka FIFO z czasem obsługi PAYMENT_TIME - bez IPC.
+// Czas jest wirtualny (zdarzenia dyskretne), więc replika trwa mikrosekundy zamiast SIMULATION_TIME sekund.
+
+#define WAIT_HIST_BINS 6000      // Histogram czasu oczekiwania na stolik: kubełki po 10 ms, do 60 s
+#define WAIT_HIST_RESOLUTION 0.01
+
+typedef enum {
+    EV_ARRIVAL,
+    EV_PAYMENT_DONE,
+    EV_DISHES,
+    EV_RESERVE,
+    EV_RESERVATION,  // Start lub koniec rezerwacji w indeksie seating.c
+    EV_DOUBLE_X3,
+    EV_FIRE,
+    EV_END
+} EventType;
+
+typedef struct {
+    double time;
+    long seq;        // Kolejność wstawienia - rozstrzyga remisy czasowe deterministycznie
+    EventType type;
+    int group;
+} Event;
+
+typedef struct {
+    Event *items;
+    int count;
+    int capacity;
+    long next_seq;
+} EventHeap;
+
+typedef enum {
+    GROUP_NEW,
+    GROUP_WAITING,
+    GROUP_SEATED,
+    GROUP_DONE
+} GroupState;
+
+typedef struct {
+    int size;
+    GroupState state;
+    double arrival_time;
+    double payment_queued_time;
+} GroupInfo;
+
+// Parametry symulacji (wspólne dla wszystkich replik)
+typedef struct {
+    int replicas;
+    int threads;
+    int clients;
+    double arrival_interval;
+    double sim_time;
+    double reserve_time;
+    double reserve_duration;
+    double double_time;
+    double fire_time;
+    int reserve_count;
+    uint64_t seed;
+    int verify;         // Porównanie wygenerowanego alokatora z ogólnym po każdym zdarzeniu
+} SimConfig;
+
+// Wynik jednej repliki
+typedef struct {
+    int arrived;
+    int served;
+    int rejected;
+    int no_order;
+    int evacuated;
+    int seated;
+    double seat_wait_sum;
+    double payment_wait_sum;
+    int payments;
+    double seat_utilization;
+    double cashier_utilization;
+    long verify_checks;
+    long verify_mismatches;
+} ReplicaResult;
+
+typedef struct {
+    const SimConfig *config;
+    ReplicaResult *results;
+    long *wait_hist;      // Histogram wątku (łączony po zakończeniu)
+} WorkerArgs;
+
+static long next_replica = 0;  // Indeks następnej repliki do wykonania (atomowy licznik puli)
+
+// --- Generator liczb losowych: splitmix64 (zasiew) + xorshift64* (strumień repliki) ---
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t rng_next(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static int rng_int(uint64_t *state, int n) {
+    return (int)((rng_next(state) >> 33) % (uint64_t)n);
+}
+
+// --- Kopiec zdarzeń (min-heap po czasie) ---
+
+static int event_before(const Event *a, const Event *b) {
+    if (a->time != b->time) return a->time < b->time;
+    return a->seq < b->seq;
+}
+
+static void heap_push(EventHeap *heap, double time, EventType type, int group) {
+    if (heap->count == heap->capacity) {
+        heap->capacity = heap->capacity ? heap->capacity * 2 : 64;
+        heap->items = realloc(heap->items, heap->capacity * sizeof(Event));
+        if (heap->items == NULL) {
+            perror("barsim: realloc failed");
+            exit(EXIT_FAILURE);
+        }
+    }
+    int i = heap->count++;
+    Event ev = {time, heap->next_seq++, type, group};
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!event_before(&ev, &heap->items[parent])) break;
+        heap->items[i] = heap->items[parent];
+        i = parent;
+    }
+    heap->items[i] = ev;
+}
+
+static Event heap_pop(EventHeap *heap) {
+    Event top = heap->items[0];
+    Event last = heap->items[--heap->count];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count && event_before(&heap->items[child + 1], &heap->items[child])) {
+            child++;
+        }
+        if (!event_before(&heap->items[child], &last)) break;
+        heap->items[i] = heap->items[child];
+        i = child;
+    }
+    if (heap->count > 0) {
+        heap->items[i] = last;
+    }
+    return top;
+}
+
+// --- Replika ---
+
+typedef struct {
+    const SimConfig *config;
+    SharedState hall;
+    Seating seating;
+    uint64_t rng;
+    unsigned int reserve_seed;
+    EventHeap events;
+    GroupInfo *groups;
+    double now;
+
+    int *cashier_queue;       // Kolejka FIFO grup czekających na płatność
+    int cashier_head;
+    int cashier_tail;
+    int cashier_busy;
+    double cashier_busy_time;
+
+    int occupied_seats;
+    double utilization_area;  // Całka (zajęte miejsca / pojemność sali) po czasie
+    double last_change;
+
+    ReplicaResult *result;
+    long *wait_hist;
+} Replica;
+
+static int hall_capacity(const Replica *r) {
+    return MAX_PERSONS + (r->hall.x3_doubled ? X3 * 3 : 0);
+}
+
+static void advance_clock(Replica *r, double time) {
+    r->utilization_area += (time - r->last_change) * r->occupied_seats / hall_capacity(r);
+    r->last_change = time;
+    r->now = time;
+}
+
+static void cashier_start_next(Replica *r) {
+    if (r->cashier_busy || r->cashier_head == r->cashier_tail) {
+        return;
+    }
+    int group = r->cashier_queue[r->cashier_head++];
+    r->cashier_busy = 1;
+    r->result->payment_wait_sum += r->now - r->groups[group].payment_queued_time;
+    r->result->payments++;
+    r->cashier_busy_time += PAYMENT_TIME;
+    heap_push(&r->events, r->now + PAYMENT_TIME, EV_PAYMENT_DONE, group);
+}
+
+static void on_group_seated(Replica *r, int group) {
+    GroupInfo *g = &r->groups[group];
+    double wait = r->now - g->arrival_time;
+    int bin = (int)(wait / WAIT_HIST_RESOLUTION);
+    if (bin >= WAIT_HIST_BINS) bin = WAIT_HIST_BINS - 1;
+
+    g->state = GROUP_SEATED;
+    g->payment_queued_time = r->now;
+    r->occupied_seats += g->size;
+    r->result->seated++;
+    r->result->seat_wait_sum += wait;
+    r->wait_hist[bin]++;
+
+    r->cashier_queue[r->cashier_tail++] = group;
+    cashier_start_next(r);
+}
+
+static void seated_from_queue(void *ctx, const WaitingClient *client, int table_type, int table_index) {
+    (void)table_type;
+    (void)table_index;
+    on_group_seated((Replica *)ctx, client->group_id - 1);
+}
+
+static void handle_arrival(Replica *r, int group) {
+    GroupInfo *g = &r->groups[group];
+    r->result->arrived++;
+
+    if (rng_int(&r->rng, 100) < NO_ORDER_PROBABILITY) {
+        g->state = GROUP_DONE;
+        r->result->no_order++;
+        return;
+    }
+
+    int table_type, table_index;
+    if (seating_seat_group(&r->seating, group + 1, g->size, &table_type, &table_index)) {
+        on_group_seated(r, group);
+    } else if (seating_enqueue(&r->seating, group + 1, g->size, 0)) {
+        g->state = GROUP_WAITING;
+    } else {
+        g->state = GROUP_DONE;
+        r->result->rejected++;
+    }
+}
+
+// Zegar rezerwacji idzie za zegarem repliki; wygasłe rezerwacje zwalniają stoliki dla kolejki
+static void advance_reservations(Replica *r) {
+    if (seating_advance(&r->seating, llround(r->now * 1000.0)) > 0) {
+        seating_serve_waiting(&r->seating, seated_from_queue, r);
+    }
+}
+
+static void schedule_next_reservation(Replica *r) {
+    long long next_ms = seating_next_reservation_ms(&r->seating);
+    if (next_ms >= 0) {
+        heap_push(&r->events, next_ms / 1000.0, EV_RESERVATION, -1);
+    }
+}
+
+static void handle_dishes(Replica *r, int group) {
+    GroupInfo *g = &r->groups[group];
+    seating_release_group(&r->seating, group + 1, g->size);
+    g->state = GROUP_DONE;
+    r->occupied_seats -= g->size;
+    r->result->served++;
+    seating_advance(&r->seating, r->seating.now_ms);
+    seating_serve_waiting(&r->seating, seated_from_queue, r);
+}
+
+static void run_replica(const SimConfig *config, int index, ReplicaResult *result, long *wait_hist) {
+    Replica r;
+    memset(&r, 0, sizeof(r));
+    memset(result, 0, sizeof(*result));
+
+    r.config = config;
+    r.result = result;
+    r.wait_hist = wait_hist;
+
+    // Niezależny strumień dla każdej repliki wyprowadzony z ziarna bazowego
+    uint64_t sm = config->seed + (uint64_t)index * 0xD1B54A32D192ED03ULL;
+    r.rng = splitmix64(&sm) | 1;
+    r.reserve_seed = (unsigned int)splitmix64(&sm);
+
+    seating_init_hall(&r.hall);
+    seating_init(&r.seating, &r.hall);
+
+    r.groups = calloc(config->clients > 0 ? config->clients : 1, sizeof(GroupInfo));
+    r.cashier_queue = calloc(config->clients > 0 ? config->clients : 1, sizeof(int));
+    if (r.groups == NULL || r.cashier_queue == NULL) {
+        perror("barsim: calloc failed");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < config->clients; i++) {
+        r.groups[i].size = rng_int(&r.rng, 3) + 1;
+        r.groups[i].state = GROUP_NEW;
+        r.groups[i].arrival_time = i * config->arrival_interval;
+        heap_push(&r.events, r.groups[i].arrival_time, EV_ARRIVAL, i);
+    }
+    if (config->reserve_time > 0) heap_push(&r.events, config->reserve_time, EV_RESERVE, -1);
+    if (config->double_time > 0) heap_push(&r.events, config->double_time, EV_DOUBLE_X3, -1);
+    if (config->fire_time > 0) heap_push(&r.events, config->fire_time, EV_FIRE, -1);
+    heap_push(&r.events, config->sim_time, EV_END, -1);
+
+    int finished = 0;
+    while (!finished && r.events.count > 0) {
+        Event ev = heap_pop(&r.events);
+        advance_clock(&r, ev.time);
+        advance_reservations(&r);
+
+        switch (ev.type) {
+            case EV_ARRIVAL:
+                handle_arrival(&r, ev.group);
+                break;
+            case EV_PAYMENT_DONE:
+                r.cashier_busy = 0;
+                heap_push(&r.events, r.now + DISH_PICKUP_TIME + EATING_TIME, EV_DISHES, ev.group);
+                cashier_start_next(&r);
+                break;
+            case EV_DISHES:
+                handle_dishes(&r, ev.group);
+                break;
+            case EV_RESERVE: {
+                long long start_ms = r.seating.now_ms;
+                long long end_ms = start_ms + llround(config->reserve_duration * 1000.0);
+                seating_reserve_tables(&r.seating, config->reserve_count, start_ms, end_ms, &r.reserve_seed, NULL, 0);
+                schedule_next_reservation(&r);
+                break;
+            }
+            case EV_RESERVATION:
+                schedule_next_reservation(&r);
+                break;
+            case EV_DOUBLE_X3:
+                seating_double_x3(&r.seating);
+                seating_serve_waiting(&r.seating, seated_from_queue, &r);
+                break;
+            case EV_FIRE:
+            case EV_END:
+                finished = 1;
+                break;
+        }
+
+        if (config->verify) {
+            result->verify_checks++;
+            if (!seating_verify_fixed(&r.seating)) {
+                result->verify_mismatches++;
+            }
+        }
+    }
+
+    // Grupy obecne w sali lub w kolejce w chwili zakończenia są ewakuowane
+    for (int i = 0; i < config->clients; i++) {
+        if (r.groups[i].state == GROUP_WAITING || r.groups[i].state == GROUP_SEATED) {
+            result->evacuated++;
+        }
+    }
+
+    double elapsed = r.now > 0 ? r.now : 1.0;
+    result->seat_utilization = r.utilization_area / elapsed;
+    // Płatność rozpoczęta przed końcem liczy się tylko do chwili zakończenia
+    double busy = r.cashier_busy_time;
+    if (r.cashier_busy) {
+        for (int i = 0; i < r.events.count; i++) {
+            if (r.events.items[i].type == EV_PAYMENT_DONE) {
+                busy -= r.events.items[i].time - r.now;
+            }
+        }
+    }
+    result->cashier_utilization = busy / elapsed;
+
+    free(r.events.items);
+    free(r.groups);
+    free(r.cashier_queue);
+}
+
+static void *worker_thread(void *arg) {
+    WorkerArgs *args = (WorkerArgs *)arg;
+
+    for (;;) {
+        long index = __atomic_fetch_add(&next_replica, 1, __ATOMIC_RELAXED);
+        if (index >= args->config->replicas) {
+            break;
+        }
+        run_replica(args->config, (int)index, &args->results[index], args->wait_hist);
+    }
+    return NULL;
+}
+
+// --- Statystyki zbiorcze ---
+
+// Kwantyl rozkładu t-Studenta dla 95% przedziału ufności (df = 1..30, dalej przybliżenie normalne)
+static double t_quantile_95(int df) {
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (df < 1) return 0.0;
+    if (df <= 30) return table[df - 1];
+    return 1.960;
+}
+
+typedef double (*MetricFunc)(const ReplicaResult *r);
+
+static double m_arrived(const ReplicaResult *r) { return r->arrived; }
+static double m_served(const ReplicaResult *r) { return r->served; }
+static double m_rejected(const ReplicaResult *r) { return r->rejected; }
+static double m_no_order(const ReplicaResult *r) { return r->no_order; }
+static double m_evacuated(const ReplicaResult *r) { return r->evacuated; }
+static double m_seat_wait(const ReplicaResult *r) { return r->seated ? r->seat_wait_sum / r->seated : 0.0; }
+static double m_pay_wait(const ReplicaResult *r) { return r->payments ? r->payment_wait_sum / r->payments : 0.0; }
+static double m_seat_util(const ReplicaResult *r) { return 100.0 * r->seat_utilization; }
+static double m_cashier_util(const ReplicaResult *r) { return 100.0 * r->cashier_utilization; }
+
+static void print_metric(const char *name, MetricFunc metric, const ReplicaResult *results, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += metric(&results[i]);
+    double mean = sum / n;
+
+    double var = 0.0;
+    for (int i = 0; i < n; i++) {
+        double d = metric(&results[i]) - mean;
+        var += d * d;
+    }
+    double sd = (n > 1) ? sqrt(var / (n - 1)) : 0.0;
+    double ci = (n > 1) ? t_quantile_95(n - 1) * sd / sqrt((double)n) : 0.0;
+
+    printf("  %-34s %12.3f  ± %9.3f  (sd %.3f)\n", name, mean, ci, sd);
+}
+
+static double hist_percentile(const long *hist, long total, double p) {
+    long target = (long)ceil(p * total);
+    long acc = 0;
+    for (int i = 0; i < WAIT_HIST_BINS; i++) {
+        acc += hist[i];
+        if (acc >= target && acc > 0) {
+            return (i + 1) * WAIT_HIST_RESOLUTION;
+        }
+    }
+    return WAIT_HIST_BINS * WAIT_HIST_RESOLUTION;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Użycie: %s [opcje]\n"
+            "  -n, --replicas N     liczba replik (domyślnie 1000)\n"
+            "  -j, --threads N      liczba wątków (domyślnie liczba rdzeni)\n"
+            "  --clients N          grupy klientów na replikę (domyślnie TOTAL_CLIENTS)\n"
+            "  --interval-ms N      odstęp między grupami (domyślnie CLIENT_ARRIVAL_INTERVAL_MS)\n"
+            "  --time S             czas symulacji (domyślnie SIMULATION_TIME)\n"
+            "  --reserve-at S       chwila rezerwacji stolików, 0 = brak (domyślnie SIGNAL2_TIME)\n"
+            "  --reserve-count N    liczba rezerwowanych stolików (domyślnie RESERVED_TABLE_COUNT)\n"
+            "  --reserve-for S      czas trwania rezerwacji (domyślnie RESERVATION_DEFAULT_MS)\n"
+            "  --double-at S        chwila podwojenia X3, 0 = brak (domyślnie SIGNAL1_TIME)\n"
+            "  --fire-at S          chwila pożaru, 0 = brak (domyślnie SIGNAL3_TIME)\n"
+            "  --seed N             ziarno bazowe generatora\n"
+            "  --verify             porównuje wygenerowany alokator stolików z ogólnym po każdym zdarzeniu\n"
+            "Układ sali (X1..X4) jest ustalany w include/common.h.\n",
+            program);
+}
+
+int main(int argc, char *argv[]) {
+    SimConfig config;
+    config.replicas = 1000;
+    config.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    config.clients = TOTAL_CLIENTS;
+    config.arrival_interval = CLIENT_ARRIVAL_INTERVAL_MS / 1000.0;
+    config.sim_time = SIMULATION_TIME;
+    config.reserve_time = SIGNAL2_TIME;
+    config.reserve_count = RESERVED_TABLE_COUNT;
+    config.reserve_duration = RESERVATION_DEFAULT_MS / 1000.0;
+    config.double_time = SIGNAL1_TIME;
+    config.fire_time = SIGNAL3_TIME;
+    config.seed = (uint64_t)time(NULL);
+    config.verify = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--verify") == 0) {
+            config.verify = 1;
+            continue;
+        }
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (value == NULL) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        if (strcmp(arg, "-n") == 0 || strcmp(arg, "--replicas") == 0) config.replicas = atoi(value);
+        else if (strcmp(arg, "-j") == 0 || strcmp(arg, "--threads") == 0) config.threads = atoi(value);
+        else if (strcmp(arg, "--clients") == 0) config.clients = atoi(value);
+        else if (strcmp(arg, "--interval-ms") == 0) config.arrival_interval = atof(value) / 1000.0;
+        else if (strcmp(arg, "--time") == 0) config.sim_time = atof(value);
+        else if (strcmp(arg, "--reserve-at") == 0) config.reserve_time = atof(value);
+        else if (strcmp(arg, "--reserve-count") == 0) config.reserve_count = atoi(value);
+        else if (strcmp(arg, "--reserve-for") == 0) config.reserve_duration = atof(value);
+        else if (strcmp(arg, "--double-at") == 0) config.double_time = atof(value);
+        else if (strcmp(arg, "--fire-at") == 0) config.fire_time = atof(value);
+        else if (strcmp(arg, "--seed") == 0) config.seed = strtoull(value, NULL, 10);
+        else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        i++;
+    }
+
+    if (config.replicas < 1 || config.clients < 0 || config.sim_time <= 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (config.threads < 1) config.threads = 1;
+    if (config.threads > config.replicas) config.threads = config.replicas;
+
+    ReplicaResult *results = calloc(config.replicas, sizeof(ReplicaResult));
+    pthread_t *threads = calloc(config.threads, sizeof(pthread_t));
+    WorkerArgs *args = calloc(config.threads, sizeof(WorkerArgs));
+    if (results == NULL || threads == NULL || args == NULL) {
+        perror("barsim: calloc failed");
+        return EXIT_FAILURE;
+    }
+
+    struct timespec t_start, t_end;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+
+    for (int t = 0; t < config.threads; t++) {
+        args[t].config = &config;
+        args[t].results = results;
+        args[t].wait_hist = calloc(WAIT_HIST_BINS, sizeof(long));
+        if (args[t].wait_hist == NULL) {
+            perror("barsim: calloc failed");
+            return EXIT_FAILURE;
+        }
+        if (pthread_create(&threads[t], NULL, worker_thread, &args[t]) != 0) {
+            perror("barsim: pthread_create failed");
+            return EXIT_FAILURE;
+        }
+    }
+
+    long wait_hist[WAIT_HIST_BINS] = {0};
+    long wait_total = 0;
+    for (int t = 0; t < config.threads; t++) {
+        pthread_join(threads[t], NULL);
+        for (int b = 0; b < WAIT_HIST_BINS; b++) {
+            wait_hist[b] += args[t].wait_hist[b];
+            wait_total += args[t].wait_hist[b];
+        }
+        free(args[t].wait_hist);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    double wall = (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+
+    printf("BARSIM: %d replik, %d wątków, %.3f s (%.1f replik/s), ziarno %llu\n",
+           config.replicas, config.threads, wall, config.replicas / wall,
+           (unsigned long long)config.seed);
+    printf("Sala: X1=%d X2=%d X3=%d X4=%d (%d miejsc), %d grup co %.0f ms, czas %.1f s\n",
+           X1, X2, X3, X4, MAX_PERSONS, config.clients, config.arrival_interval * 1000.0, config.sim_time);
+    printf("Alokator stolików: %s\n\n", seating_allocator());
+    printf("  %-34s %12s  ± %9s\n", "Metryka (na replikę)", "średnia", "CI 95%");
+    print_metric("Grupy przybyłe", m_arrived, results, config.replicas);
+    print_metric("Grupy obsłużone", m_served, results, config.replicas);
+    print_metric("Grupy odrzucone (kolejka pełna)", m_rejected, results, config.replicas);
+    print_metric("Grupy bez zamówienia", m_no_order, results, config.replicas);
+    print_metric("Grupy ewakuowane", m_evacuated, results, config.replicas);
+    print_metric("Średnie czekanie na stolik [s]", m_seat_wait, results, config.replicas);
+    print_metric("Średnie czekanie na kasę [s]", m_pay_wait, results, config.replicas);
+    print_metric("Wykorzystanie miejsc [%]", m_seat_util, results, config.replicas);
+    print_metric("Wykorzystanie kasjera [%]", m_cashier_util, results, config.replicas);
+
+    if (wait_total > 0) {
+        printf("\n  Rozkład czekania na stolik (%ld usadzeń): p50 %.2f s, p90 %.2f s, p99 %.2f s, max %.2f s\n",
+               wait_total,
+               hist_percentile(wait_hist, wait_total, 0.50),
+               hist_percentile(wait_hist, wait_total, 0.90),
+               hist_percentile(wait_hist, wait_total, 0.99),
+               hist_percentile(wait_hist, wait_total, 1.00));
+    }
+
+    int status = EXIT_SUCCESS;
+    if (config.verify) {
+        long checks = 0, mismatches = 0;
+        for (int i = 0; i < config.replicas; i++) {
+            checks += results[i].verify_checks;
+            mismatches += results[i].verify_mismatches;
+        }
+        printf("\n  Weryfikacja alokatora: %ld porównań z wersją ogólną, %ld niezgodności - %s\n",
+               checks, mismatches, mismatches == 0 ? "OK" : "BŁĄD");
+        if (mismatches > 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    free(results);
+    free(threads);
+    free(args);
+    return status;
+}
@@ -0,0 +1,144 @@
+#include "checkpoint.h"
+#include "transport.h"
+#include "utils.h"
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const char *checkpoint_default_path(void) {
+    static char path[64];
+    if (ipc_instance() == 0) {
+        snprintf(path, sizeof(path), "logs/checkpoint.bin");
+    } else {
+        snprintf(path, sizeof(path), "logs/checkpoint-%d.bin", ipc_instance());
+    }
+    return path;
+}
+
+const char *checkpoint_path(void) {
+    const char *path = getenv(CHECKPOINT_ENV);
+    return path != NULL && path[0] != '\0' ? path : checkpoint_default_path();
+}
+
+static int write_all(int fd, const void *data, size_t size) {
+    const char *p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+long checkpoint_write(const char *path, const SharedState *hall, const Seating *seating, long long sim_ms,
+                      const CheckpointMessage *pending, int count) {
+    CheckpointFile *header = calloc(1, sizeof(CheckpointFile));
+    if (header == NULL) {
+        return -1;
+    }
+    header->magic = CHECKPOINT_MAGIC;
+    header->version = CHECKPOINT_VERSION;
+    header->state_size = sizeof(SharedState);
+    header->seating_size = sizeof(Seating);
+    header->transport = transport_backend();
+    header->pending_count = count;
+    header->sim_ms = sim_ms;
+    header->hall = *hall;
+    header->seating = *seating;
+
+    char tmp_path[PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        free(header);
+        return -1;
+    }
+
+    size_t pending_size = (size_t)count * sizeof(CheckpointMessage);
+    int rc = write_all(fd, header, sizeof(CheckpointFile));
+    if (rc == 0 && count > 0) {
+        rc = write_all(fd, pending, pending_size);
+    }
+    free(header);
+    if (rc == 0 && fsync(fd) == -1) {  // Bez tego po awarii systemu rename() może wskazać pusty plik
+        rc = -1;
+    }
+    if (close(fd) == -1) {
+        rc = -1;
+    }
+    if (rc == -1 || rename(tmp_path, path) == -1) {
+        int saved = errno;
+        unlink(tmp_path);
+        errno = saved;
+        return -1;
+    }
+    return (long)(sizeof(CheckpointFile) + pending_size);
+}
+
+const CheckpointFile *checkpoint_map(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(CheckpointFile)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    const CheckpointFile *checkpoint = data;
+    if (checkpoint->magic != CHECKPOINT_MAGIC || checkpoint->version != CHECKPOINT_VERSION ||
+        checkpoint->state_size != sizeof(SharedState) || checkpoint->seating_size != sizeof(Seating) ||
+        checkpoint->pending_count < 0 ||
+        (size_t)st.st_size != sizeof(CheckpointFile) + (size_t)checkpoint->pending_count * sizeof(CheckpointMessage)) {
+        munmap(data, (size_t)st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return checkpoint;
+}
+
+void checkpoint_unmap(const CheckpointFile *checkpoint, size_t size) {
+    if (checkpoint != NULL) {
+        munmap((void *)checkpoint, size);
+    }
+}
+
+int checkpoint_group_size(const SharedState *hall, int group_id) {
+    int seats = 0;
+    for (int i = 0; i < X1; i++) {
+        seats += hall->table_1_groups[i][0] == group_id;
+    }
+    for (int i = 0; i < X2; i++) {
+        for (int s = 0; s < 2; s++) {
+            seats += hall->table_2_groups[i][s] == group_id;
+        }
+    }
+    for (int i = 0; i < X3_MAX; i++) {
+        for (int s = 0; s < 3; s++) {
+            seats += hall->table_3_groups[i][s] == group_id;
+        }
+    }
+    for (int i = 0; i < X4; i++) {
+        for (int s = 0; s < 4; s++) {
+            seats += hall->table_4_groups[i][s] == group_id;
+        }
+    }
+    return seats;
+}
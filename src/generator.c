@@ -0,0 +1,394 @@
+#include "common.h"
+#include "utils.h"
+#include "transport.h"
+#include "lifecycle.h"
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+// Generator klientów dla backendu gniazd: jeden proces prowadzi wiele grup naraz (pętla zdarzeń
+// zamiast procesu na grupę) i łączy się z usługami obsługi i kasjera po adresie - może działać
+// na innym węźle niż bar. Nie korzysta z IPC węzła baru, wynik wypisuje na stdout.
+#define DEFAULT_GROUPS 100
+#define DEFAULT_WINDOW 64       // Grupy w toku przy --interval-ms 0 (pętla zamknięta)
+#define MAX_EVENTS 16
+
+#define GROUP_IDLE 0     // Jeszcze nie weszła
+#define GROUP_SEATING 1  // Czeka na stolik
+#define GROUP_PAYING 2   // Czeka na potwierdzenie płatności
+#define GROUP_EATING 3
+#define GROUP_DONE 4
+
+typedef struct {
+    int state;
+    int size;
+    long long sent_ns;  // Wysłanie żądania stolika
+    GroupLifecycle life;  // Rekord cyklu życia (--lifecycle)
+} Group;
+
+static Group *groups = NULL;
+static int group_count = DEFAULT_GROUPS;
+static int node = 1;                // Numer węzła (--node) - wyznacza przedział identyfikatorów grup
+static int group_base = 0;          // group_id = group_base + indeks (unikalne między węzłami)
+static int interval_ms = CLIENT_ARRIVAL_INTERVAL_MS;
+static int window = DEFAULT_WINDOW;
+static int eat_ms = EATING_TIME * 1000;
+static int seat_only = 0;           // Naczynia zaraz po usadzeniu - bez płatności i jedzenia
+static unsigned int seed = 0;
+static const char *lifecycle_path = NULL;
+
+static int epoll_fd = -1;
+static int signal_fd = -1;
+static int arrival_fd = -1;
+static int eating_fd = -1;
+static int running = 1;
+
+// Grupy jedzą tyle samo - kolejność końców jedzenia to kolejność potwierdzeń płatności
+static int *eating = NULL;
+static int eating_head = 0;
+static int eating_count = 0;
+static long long *eating_end_ns = NULL;
+
+static int arrived = 0;
+static int in_flight = 0;
+static int seated = 0;
+static int rejected = 0;
+static int finished = 0;
+static int failed = 0;
+static long long *seat_rtt_ns = NULL;
+
+static int compare_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static int epoll_watch(int fd) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static void arm_timer(int fd, long long delay_ns, long long interval_ns) {
+    struct itimerspec its;
+    its.it_value.tv_sec = delay_ns / 1000000000LL;
+    its.it_value.tv_nsec = delay_ns % 1000000000LL;
+    its.it_interval.tv_sec = interval_ns / 1000000000LL;
+    its.it_interval.tv_nsec = interval_ns % 1000000000LL;
+    if (timerfd_settime(fd, 0, &its, NULL) == -1) {
+        handle_error("generator: timerfd_settime failed");
+    }
+}
+
+static int send_message(int queue, long mtype, int index) {
+    Message msg;
+    msg.mtype = mtype;
+    msg.group_id = group_base + index;
+    msg.group_size = groups[index].size;
+    msg.table_type = 0;
+    msg.table_index = queue == QUEUE_DISHES ? -1 : 0;
+    if (transport_send(queue, &msg, 0) == -1) {
+        if (running) {
+            fprintf(stderr, "generator: wysyłka do %s: %s\n",
+                    transport_address(queue == QUEUE_PAYMENT ? SOCKET_CASHIER : SOCKET_SEATING), strerror(errno));
+        }
+        running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+static void finish_group(int index, int outcome) {
+    groups[index].state = GROUP_DONE;
+    in_flight--;
+    finished++;
+    if (lifecycle_enabled) {
+        groups[index].life.outcome = (int8_t)outcome;
+        groups[index].life.departure_ns = monotonic_ns();
+        lifecycle_append(&groups[index].life);
+    }
+}
+
+// Grupy w toku przy końcu przebiegu - rekord z wynikiem ewakuacji lub przerwania
+static void record_unfinished(int outcome) {
+    for (int index = 0; index < arrived; index++) {
+        if (groups[index].state != GROUP_DONE) {
+            groups[index].life.outcome = (int8_t)outcome;
+            groups[index].life.departure_ns = monotonic_ns();
+            lifecycle_append(&groups[index].life);
+        }
+    }
+}
+
+static void arrive(void) {
+    int index = arrived++;
+    groups[index].size = rand_r(&seed) % 3 + 1;
+    groups[index].state = GROUP_SEATING;
+    groups[index].sent_ns = monotonic_ns();
+    groups[index].life.group_id = group_base + index;
+    groups[index].life.group_size = (int8_t)groups[index].size;
+    groups[index].life.table_index = -1;
+    groups[index].life.arrival_ns = groups[index].sent_ns;
+    in_flight++;
+    send_message(QUEUE_SEAT, MSG_TYPE_SEAT_REQUEST, index);
+}
+
+// Grupa należy do tego generatora i czeka na odpowiedź danej klasy
+static int own_group(const Message *msg, int state) {
+    int index = msg->group_id - group_base;
+    return index >= 0 && index < arrived && groups[index].state == state ? index : -1;
+}
+
+static void handle_seat_reply(const Message *msg) {
+    int index = own_group(msg, GROUP_SEATING);
+    if (index == -1) {
+        return;
+    }
+    if (msg->table_type == 0 || msg->table_index < 0) {
+        rejected++;
+        finish_group(index, LIFECYCLE_REJECTED);
+        return;
+    }
+    long long now = monotonic_ns();
+    seat_rtt_ns[seated++] = now - groups[index].sent_ns;
+    groups[index].life.seated_ns = now;
+    groups[index].life.table_type = (int8_t)msg->table_type;
+    groups[index].life.table_index = (int16_t)msg->table_index;
+    if (seat_only) {
+        send_message(QUEUE_DISHES, MSG_TYPE_DISHES, index);
+        finish_group(index, LIFECYCLE_SERVED);
+    } else {
+        groups[index].state = GROUP_PAYING;
+        send_message(QUEUE_PAYMENT, MSG_TYPE_PAYMENT, index);
+    }
+}
+
+static void handle_pay_reply(const Message *msg) {
+    int index = own_group(msg, GROUP_PAYING);
+    if (index == -1) {
+        return;
+    }
+    groups[index].state = GROUP_EATING;
+    long long now = monotonic_ns();
+    groups[index].life.pay_wait_ns = now - groups[index].life.seated_ns;  // Płatność wysłana zaraz po usadzeniu
+    int tail = (eating_head + eating_count) % group_count;
+    eating[tail] = index;
+    eating_end_ns[tail] = now + eat_ms * 1000000LL;
+    if (eating_count++ == 0) {
+        arm_timer(eating_fd, eat_ms * 1000000LL, 0);
+    }
+}
+
+// Kończy jedzenie grup, którym minął czas, i ustawia timer na następną
+static void finish_eating(void) {
+    long long now = monotonic_ns();
+    while (eating_count > 0 && eating_end_ns[eating_head] <= now) {
+        int index = eating[eating_head];
+        eating_head = (eating_head + 1) % group_count;
+        eating_count--;
+        groups[index].life.eat_ns = now - (groups[index].life.seated_ns + groups[index].life.pay_wait_ns);
+        send_message(QUEUE_DISHES, MSG_TYPE_DISHES, index);
+        finish_group(index, LIFECYCLE_SERVED);
+    }
+    if (eating_count > 0) {
+        long long delay = eating_end_ns[eating_head] - now;
+        arm_timer(eating_fd, delay > 0 ? delay : 1, 0);
+    }
+}
+
+// Odbiera wszystkie czekające odpowiedzi klasy (bez czekania); -1, gdy usługa zamknęła połączenie
+static int drain_replies(int queue) {
+    Message msg;
+    while (transport_receive(queue, &msg, 0, IPC_NOWAIT) != -1) {
+        if (queue == QUEUE_SEAT_REPLY) {
+            handle_seat_reply(&msg);
+        } else {
+            handle_pay_reply(&msg);
+        }
+    }
+    if (errno == ENOMSG || errno == EINTR) {
+        return 0;
+    }
+    return -1;
+}
+
+static void setup_wait(int seat_fd, int pay_fd) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    if (sigprocmask(SIG_BLOCK, &signals, NULL) == -1) {
+        handle_error("generator: sigprocmask failed");
+    }
+    signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    arrival_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    eating_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (signal_fd == -1 || epoll_fd == -1 || arrival_fd == -1 || eating_fd == -1 ||
+        epoll_watch(signal_fd) == -1 || epoll_watch(arrival_fd) == -1 || epoll_watch(eating_fd) == -1 ||
+        epoll_watch(seat_fd) == -1 || (pay_fd != -1 && epoll_watch(pay_fd) == -1)) {
+        handle_error("generator: signalfd/timerfd/epoll failed");
+    }
+}
+
+static void run(void) {
+    int seat_fd = transport_poll_fd(QUEUE_SEAT_REPLY);
+    int pay_fd = seat_only ? -1 : transport_poll_fd(QUEUE_PAY_REPLY);
+    if (seat_fd == -1 || (!seat_only && pay_fd == -1)) {
+        fprintf(stderr, "generator: brak połączenia z %s: %s\n",
+                transport_address(seat_fd == -1 ? SOCKET_SEATING : SOCKET_CASHIER), strerror(errno));
+        failed = 1;
+        return;
+    }
+    setup_wait(seat_fd, pay_fd);
+
+    if (interval_ms > 0) {
+        arm_timer(arrival_fd, 1, interval_ms * 1000000LL);
+    }
+
+    while (running && finished < group_count) {
+        // Pętla zamknięta: nowe grupy wchodzą, gdy zwalnia się miejsce w oknie
+        while (interval_ms == 0 && running && arrived < group_count && in_flight < window) {
+            arrive();
+        }
+        transport_flush();
+
+        struct epoll_event events[MAX_EVENTS];
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        for (int i = 0; i < n && running; i++) {
+            int fd = events[i].data.fd;
+            uint64_t expirations;
+            if (fd == signal_fd) {
+                struct signalfd_siginfo info;
+                while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                    running = 0;
+                }
+            } else if (fd == arrival_fd) {
+                if (read(arrival_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+                    continue;
+                }
+                for (uint64_t k = 0; k < expirations && arrived < group_count && running; k++) {
+                    arrive();
+                }
+                if (arrived == group_count) {
+                    arm_timer(arrival_fd, 0, 0);
+                }
+            } else if (fd == eating_fd) {
+                if (read(eating_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                    finish_eating();
+                }
+            } else if (fd == seat_fd || fd == pay_fd) {
+                if (drain_replies(fd == seat_fd ? QUEUE_SEAT_REPLY : QUEUE_PAY_REPLY) == -1) {
+                    if (errno != ECONNRESET) {
+                        fprintf(stderr, "generator: odbiór: %s\n", strerror(errno));
+                    }
+                    running = 0;  // Usługa zamknięta - koniec symulacji baru
+                }
+            }
+        }
+        if (transport_fire_alarm()) {
+            running = 0;
+        }
+    }
+    transport_flush();
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Użycie: %s [-n GRUPY] [--interval-ms MS] [--window W] [--eat-ms MS] [--seat-only]\n", program);
+    fprintf(stderr, "          [--node N] [--seating A] [--cashier A] [--seed S] [--lifecycle PLIK]\n");
+    fprintf(stderr, "  -n N             liczba grup (domyślnie %d, maks. %d)\n", DEFAULT_GROUPS, GROUP_ID_STRIDE - 1);
+    fprintf(stderr, "  --interval-ms MS odstęp przybyć grup (domyślnie %d; 0 = pętla zamknięta z oknem W)\n",
+            CLIENT_ARRIVAL_INTERVAL_MS);
+    fprintf(stderr, "  --window W       grupy w toku przy --interval-ms 0 (domyślnie %d)\n", DEFAULT_WINDOW);
+    fprintf(stderr, "  --eat-ms MS      czas jedzenia (domyślnie %d)\n", EATING_TIME * 1000);
+    fprintf(stderr, "  --seat-only      naczynia zaraz po usadzeniu - obciąża tylko usługę obsługi\n");
+    fprintf(stderr, "  --node N         numer generatora 1..%d (domyślnie 1) - przedział identyfikatorów grup; każdy\n",
+            GROUP_NODE_MAX);
+    fprintf(stderr, "                   generator połączony z tym samym barem musi mieć inny numer\n");
+    fprintf(stderr, "  --seating A      adres usługi obsługi: unix:ŚCIEŻKA lub tcp:HOST:PORT (domyślnie %s\n", SOCKET_SEATING_ENV);
+    fprintf(stderr, "                   lub gniazdo unix instancji BAR_INSTANCE)\n");
+    fprintf(stderr, "  --cashier A      adres usługi kasjera (domyślnie %s lub gniazdo unix instancji)\n", SOCKET_CASHIER_ENV);
+    fprintf(stderr, "  --lifecycle PLIK dopisuje rekordy cyklu życia grup do PLIK (tworzy, gdy nie istnieje)\n");
+}
+
+int main(int argc, char *argv[]) {
+    seed = (unsigned int)time(NULL) ^ (unsigned int)getpid();
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            group_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--interval-ms") == 0 && i + 1 < argc) {
+            interval_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+            window = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--eat-ms") == 0 && i + 1 < argc) {
+            eat_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--node") == 0 && i + 1 < argc) {
+            node = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seat-only") == 0) {
+            seat_only = 1;
+        } else if (strcmp(argv[i], "--seating") == 0 && i + 1 < argc) {
+            setenv(SOCKET_SEATING_ENV, argv[++i], 1);
+        } else if (strcmp(argv[i], "--cashier") == 0 && i + 1 < argc) {
+            setenv(SOCKET_CASHIER_ENV, argv[++i], 1);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--lifecycle") == 0 && i + 1 < argc) {
+            lifecycle_path = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (group_count < 1 || group_count >= GROUP_ID_STRIDE || node < 1 || node > GROUP_NODE_MAX || interval_ms < 0 ||
+        window < 1 || eat_ms < 1) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    transport_select(TRANSPORT_SOCKET);
+    group_base = node * GROUP_ID_STRIDE;  // Przedział 0 należy do grup baru
+
+    groups = calloc((size_t)group_count, sizeof(Group));
+    eating = calloc((size_t)group_count, sizeof(int));
+    eating_end_ns = calloc((size_t)group_count, sizeof(long long));
+    seat_rtt_ns = calloc((size_t)group_count, sizeof(long long));
+    if (groups == NULL || eating == NULL || eating_end_ns == NULL || seat_rtt_ns == NULL) {
+        handle_error("generator: calloc failed");
+    }
+    if (lifecycle_path != NULL &&
+        lifecycle_create(lifecycle_path, LIFECYCLE_MIN_CAPACITY > group_count ? LIFECYCLE_MIN_CAPACITY : group_count,
+                         0) == -1) {
+        fprintf(stderr, "generator: plik rekordów %s: %s\n", lifecycle_path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    long long start = monotonic_ns();
+    run();
+    double elapsed_s = (monotonic_ns() - start) / 1e9;
+
+    int evacuated = transport_fire_alarm() ? in_flight : 0;
+    if (lifecycle_enabled) {
+        record_unfinished(evacuated > 0 ? LIFECYCLE_EVACUATED : LIFECYCLE_INTERRUPTED);
+    }
+    printf("GENERATOR %d: %d grup wysłanych, %d usadzonych, %d odrzuconych, %d zakończonych%s",
+           getpid(), arrived, seated, rejected, finished, transport_fire_alarm() ? ", POŻAR" : "");
+    if (evacuated > 0) {
+        printf(" (%d ewakuowanych)", evacuated);
+    }
+    printf("\n");
+    if (seated > 0) {
+        qsort(seat_rtt_ns, (size_t)seated, sizeof(long long), compare_ll);
+        printf("GENERATOR %d: oczekiwanie na stolik p50 %.3f ms, p99 %.3f ms; %.0f grup/s przez %.2f s\n",
+               getpid(), seat_rtt_ns[seated / 2] / 1e6, seat_rtt_ns[(long long)seated * 99 / 100] / 1e6,
+               finished / elapsed_s, elapsed_s);
+    }
+
+    free(seat_rtt_ns);
+    free(eating_end_ns);
+    free(eating);
+    free(groups);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,99 +1,238 @@
 #include "common.h"
 #include "utils.h"
+#include "transport.h"
+#include "trace.h"
+#include "lockprof.h"
+#include "schedprof.h"
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#define POLL_TICK_MS 10  // Takt odpytywania kolejki płatności dla backendów bez deskryptora (sysv, ring)
 
-static int msg_queue_id = -1;
 static SharedState *shared_state = NULL;
 static int running = 1;
 
-// Funkcja obsługująca sygnały
-static void signal_handler(int sig) {
-    (void)sig;
-    running = 0;
-}
+// Jeden epoll nad kolejką płatności (mq) lub taktem odpytywania, signalfd i timerfd końca płatności
+static int epoll_fd = -1;
+static int signal_fd = -1;
+static int queue_fd = -1;    // Deskryptor kolejki płatności (tylko mq)
+static int tick_fd = -1;
+static int payment_fd = -1;  // Timer końca obsługi bieżącej płatności
+
+static Message current;  // Płatność w trakcie obsługi
+static int busy = 0;
+static long long payment_start = 0;  // Początek odcinka TRACE_KASJER_PAYMENT
+static int fire_received = 0;  // MSG_TYPE_FIRE od kierownika (gniazda)
 
 // Funkcja sprawdzająca flagę pożaru
 static int check_fire_alarm(void) {
+    if (fire_received) {
+        return 1;
+    }
     if (shared_state != NULL) {
         return shared_state->fire_alarm;
     }
     return 0;
 }
 
+static int epoll_set(int op, int fd, unsigned int events) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+    return epoll_ctl(epoll_fd, op, fd, &ev);
+}
+
+static int arm_timer(int fd, long long delay_ns, long long interval_ns) {
+    struct itimerspec its;
+    its.it_value.tv_sec = delay_ns / 1000000000LL;
+    its.it_value.tv_nsec = delay_ns % 1000000000LL;
+    its.it_interval.tv_sec = interval_ns / 1000000000LL;
+    its.it_interval.tv_nsec = interval_ns % 1000000000LL;
+    return timerfd_settime(fd, 0, &its, NULL);
+}
+
+static void setup_wait(void) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    if (sigprocmask(SIG_BLOCK, &signals, NULL) == -1) {
+        handle_error("KASJER: sigprocmask failed");
+    }
+
+    signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    payment_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (signal_fd == -1 || payment_fd == -1 || epoll_fd == -1 ||
+        epoll_set(EPOLL_CTL_ADD, signal_fd, EPOLLIN) == -1 || epoll_set(EPOLL_CTL_ADD, payment_fd, EPOLLIN) == -1) {
+        handle_error("KASJER: signalfd/timerfd/epoll failed");
+    }
+
+    queue_fd = transport_poll_fd(QUEUE_PAYMENT);
+    if (queue_fd != -1) {
+        if (epoll_set(EPOLL_CTL_ADD, queue_fd, EPOLLIN) == -1) {
+            handle_error("KASJER: epoll_ctl (kolejka) failed");
+        }
+    } else {
+        long long tick_ns = POLL_TICK_MS * 1000000LL;
+        tick_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (tick_fd == -1 || arm_timer(tick_fd, tick_ns, tick_ns) == -1 ||
+            epoll_set(EPOLL_CTL_ADD, tick_fd, EPOLLIN) == -1) {
+            handle_error("KASJER: timerfd failed");
+        }
+    }
+}
+
+// Kolejka płatności jest obserwowana tylko wtedy, gdy kasa jest wolna (inaczej epoll budziłby
+// kasjera w kółko, dopóki czekają kolejni klienci)
+static void watch_queue(int enabled) {
+    if (queue_fd != -1 && epoll_set(EPOLL_CTL_MOD, queue_fd, enabled ? EPOLLIN : 0) == -1) {
+        log_message("KASJER: Błąd epoll_ctl (kolejka): %s", strerror(errno));
+    }
+}
+
+// Płatność w toku w pamięci współdzielonej - punkt kontrolny zapisuje ją jako czekającą w kolejce.
+// cashier_updating obejmuje odbiór płatności i wysyłkę potwierdzenia: kasjer zatrzymany w tym oknie
+// mógł zdjąć wiadomość z kolejki, ale jeszcze jej nie ogłosić (kierownik wznawia go wtedy na chwilę).
+static void set_updating(int updating) {
+    __atomic_store_n(&shared_state->cashier_updating, updating, __ATOMIC_SEQ_CST);
+}
+
+static void publish_payment(const Message *msg) {
+    shared_state->cashier_group_size = msg != NULL ? msg->group_size : 0;
+    shared_state->cashier_table_type = msg != NULL ? msg->table_type : 0;
+    shared_state->cashier_table_index = msg != NULL ? msg->table_index : 0;
+    __atomic_store_n(&shared_state->cashier_group_id, msg != NULL ? msg->group_id : 0, __ATOMIC_SEQ_CST);
+}
+
+// Rozpoczęcie obsługi płatności - koniec wyznacza timer, kasjer w tym czasie reaguje na sygnały
+static void start_payment(const Message *msg) {
+    log_message("KASJER: Otrzymał płatność od grupy #%d (rozmiar: %d)", msg->group_id, msg->group_size);
+
+    current = *msg;
+    busy = 1;
+    publish_payment(msg);
+    payment_start = trace_begin();
+    watch_queue(0);
+    if (arm_timer(payment_fd, PAYMENT_TIME * 1000000000LL, 0) == -1) {
+        handle_error("KASJER: timerfd_settime failed");
+    }
+}
+
+static void finish_payment(void) {
+    busy = 0;
+    watch_queue(1);
+
+    Message paid_msg;
+    paid_msg.mtype = current.group_id;  // Typ odpowiedzi: group_id (własna kolejka potwierdzeń płatności)
+    paid_msg.group_id = current.group_id;
+    paid_msg.group_size = current.group_size;
+    paid_msg.table_type = current.table_type;  // Stolik z płatności - w protokole potokowym jedyna odpowiedź
+    paid_msg.table_index = current.table_index;  // dla klienta niesie też usadzenie
+
+    TRACE_END(TRACE_KASJER_PAYMENT, payment_start, current.group_id, current.group_size);
+    long long reply_start = trace_begin();
+    set_updating(1);
+    publish_payment(NULL);
+    int sent = transport_send(QUEUE_PAY_REPLY, &paid_msg, 0);  // Wysyła potwierdzenie płatności
+    set_updating(0);
+    if (sent == -1) {
+        return;
+    }
+    TRACE_END(TRACE_KASJER_REPLY, reply_start, current.group_id, 0);
+
+    log_message("KASJER: Płatność przetworzona - grupa #%d może odebrać danie", current.group_id);
+}
+
+// Sen w epoll do sygnału, końca płatności lub (gdy kasa wolna) nowej płatności w kolejce
+static void wait_for_work(void) {
+    struct epoll_event events[4];
+    int n = epoll_wait(epoll_fd, events, 4, -1);
+    for (int i = 0; i < n; i++) {
+        int fd = events[i].data.fd;
+        if (fd == signal_fd) {
+            struct signalfd_siginfo info;
+            while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                running = 0;
+            }
+        } else if (fd == payment_fd || fd == tick_fd) {
+            uint64_t expirations;
+            if (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations) && fd == payment_fd &&
+                busy && running && !check_fire_alarm()) {
+                finish_payment();
+            }
+        }
+    }
+}
+
 int main(void) {
-    signal(SIGTERM, signal_handler);
-    signal(SIGINT, signal_handler);
-    
-    // Otwarcie kolejki komunikatów
-    msg_queue_id = get_message_queue();
-    if (msg_queue_id == -1) {
-        handle_error("KASJER: get_message_queue failed");
+    trace_init("kasjer");
+    lockprof_init("kasjer", NULL);
+    schedprof_init("kasjer", SCHEDPROF_SLOT_KASJER);
+    if (transport_listen(SOCKET_CASHIER) == -1) {
+        handle_error("KASJER: transport_listen failed");
+    }
+    setup_wait();
+
+    // Otwarcie kolejek: płatności (wejście) i potwierdzeń płatności (wyjście)
+    if (transport_backend() == TRANSPORT_SYSV) {
+        get_message_queue(QUEUE_PAYMENT);
+        get_message_queue(QUEUE_PAY_REPLY);
     }
-    
+
     shared_state = get_shared_memory();
     if (shared_state == NULL) {
         handle_error("KASJER: get_shared_memory failed");
     }
-    
+
+    role_signal_ready();
+
     log_message("KASJER: Kasa otwarta, czekam na klientów");
-    
-    Message msg;
-    ssize_t msg_size = sizeof(Message) - sizeof(long);
-    
+
     // Główna pętla symulacji
-    while (running) {
-        if (check_fire_alarm()) {
-            break;
-        }
-        
-        ssize_t received = msgrcv(msg_queue_id, &msg, msg_size, MSG_TYPE_PAYMENT, 0);  // Odbiera wiadomość o płatności
-        
-        if (received == -1) {
-            if (errno == EINTR) {
-                if (!running) {
-                    break;
-                }
-                continue;
-            } else {
-                log_message("KASJER: Błąd msgrcv: %s", strerror(errno));
-                if (!running) {
-                    break;
+    while (running && !check_fire_alarm()) {
+        if (!busy) {
+            Message msg;
+            long long receive_start = trace_begin();
+            set_updating(1);
+            ssize_t received = transport_receive(QUEUE_PAYMENT, &msg, 0, IPC_NOWAIT);
+            if (received != -1) {
+                TRACE_END(TRACE_KASJER_RECEIVE, receive_start, msg.group_id, (int)msg.mtype);
+                if (msg.mtype == MSG_TYPE_FIRE) {
+                    fire_received = 1;
+                } else {
+                    start_payment(&msg);
                 }
+            }
+            set_updating(0);
+            if (received != -1) {
                 continue;
             }
+            if (errno != ENOMSG && errno != EAGAIN && errno != EINTR) {
+                log_message("KASJER: Błąd odbioru płatności: %s", strerror(errno));
+            }
         }
-        
-        if (check_fire_alarm()) {
-            break;
-        }
-        
-        log_message("KASJER: Otrzymał płatność od grupy #%d (rozmiar: %d)", msg.group_id, msg.group_size);
-        
-        sleep(1);  // Symulacja przetwarzania płatności
-        
-        if (check_fire_alarm()) {
-            break;
-        }
-        
-        Message paid_msg;
-        paid_msg.mtype = 2000 + msg.group_id;  // Typ odpowiedzi: 2000 + group_id
-        paid_msg.group_id = msg.group_id;
-        paid_msg.group_size = msg.group_size;
-        paid_msg.table_type = 0;
-        paid_msg.table_index = 0;
-        
-        if (msgsnd(msg_queue_id, &paid_msg, msg_size, 0) == -1) {  // Wysyła potwierdzenie płatności
-            if (!running) break;
-            continue;
-        }
-        
-        log_message("KASJER: Płatność przetworzona - grupa #%d może odebrać danie", msg.group_id);
+
+        transport_flush();  // Potwierdzenia zebrane w ramkach wychodzą przed snem
+        wait_for_work();
+    }
+
+    // Przy gniazdach klienci z innych węzłów dowiadują się o pożarze od usługi
+    if (check_fire_alarm() && transport_backend() == TRANSPORT_SOCKET) {
+        Message alarm;
+        memset(&alarm, 0, sizeof(alarm));
+        alarm.mtype = MSG_TYPE_FIRE;
+        log_message("KASJER: Alarm pożarowy rozgłoszony do %d połączeń", transport_broadcast(&alarm));
     }
-    
+    transport_flush();
+
     log_message("KASJER: Kasa zamknięta");
-    
+
     if (shared_state != NULL) {
         shmdt(shared_state);
     }
-    
+
     return EXIT_SUCCESS;
 }
@@ -1,157 +1,408 @@
 #include "common.h"
 #include "utils.h"
+#include "transport.h"
+#include "schedule.h"
+#include "lockprof.h"
+#include "schedprof.h"
 
 static pid_t pid_obsluga = -1;
 static pid_t pid_kasjer = -1;
 static pid_t clients_pgid = -1;
 static int running = 1;
 
+static long long start_ns = 0;  // Start zegara symulacji (SharedState.simulation_start_ns)
+static TimerWheel wheel;
+static int double_sent = 0;
+static int paused = 0;          // Obsługa i kasjer wstrzymani przez "pause"
+static long long soak_ms = 0;   // Przebieg długotrwały (SOAK_ENV): czas trwania, 0 = SIMULATION_TIME
+
+// Statystyki opóźnienia wysyłki zdarzeń względem planu
+static int dispatched = 0;
+static double jitter_sum_ms = 0.0;
+static double jitter_max_ms = 0.0;
+
 static void signal_handler(int sig) {
     (void)sig;
     running = 0;
 }
 
-int main(int argc, char *argv[]) {
-    signal(SIGTERM, signal_handler);
-    signal(SIGINT, signal_handler);
-    
-    if (argc > 1) pid_obsluga = atoi(argv[1]);
-    if (argc > 2) pid_kasjer = atoi(argv[2]);
-    if (argc > 3) clients_pgid = atoi(argv[3]);
-    
-    int shm_id = shmget(SHM_KEY, sizeof(SharedState), 0);
-    time_t start_time = time(NULL);  
+// Wysyła do obsługi wiadomość sterującą (rezerwacja / zwolnienie rezerwacji / punkt kontrolny)
+static void send_to_obsluga(long mtype, int count, int lead_ms, int duration_ms) {
+    Message msg;
+    msg.mtype = mtype;
+    msg.group_id = getpid();
+    msg.group_size = count;
+    msg.table_type = lead_ms;
+    msg.table_index = duration_ms;
+
+    // Kierownik nie może czekać na obsługę - pełna kolejka poleceń oznacza pominięte polecenie
+    if (transport_send(QUEUE_CONTROL, &msg, IPC_NOWAIT) == -1) {
+        log_message("KIEROWNIK: Nie wysłano polecenia %ld do obsługi: %s", mtype, strerror(errno));
+    }
+    transport_flush();
+}
+
+// Gniazda: flaga w pamięci współdzielonej nie dociera do klientów na innych węzłach - obsługa
+// i kasjer rozgłaszają alarm swoim połączeniom
+static void send_fire(void) {
+    if (transport_backend() != TRANSPORT_SOCKET) {
+        return;
+    }
+    send_to_obsluga(MSG_TYPE_FIRE, 0, 0, 0);
+
+    Message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.mtype = MSG_TYPE_FIRE;
+    msg.group_id = getpid();
+    if (transport_send(QUEUE_PAYMENT, &msg, IPC_NOWAIT) == -1) {
+        log_message("KIEROWNIK: Nie wysłano alarmu do kasjera: %s", strerror(errno));
+    }
+    transport_flush();
+}
+
+static void resume_workers(void) {
+    if (!paused) {
+        return;
+    }
+    if (pid_obsluga > 0) kill(pid_obsluga, SIGCONT);
+    if (pid_kasjer > 0) kill(pid_kasjer, SIGCONT);
+    paused = 0;
+}
+
+// Aktualna grupa klientów - bar zakłada nową, gdy poprzednia opustoszeje
+static void refresh_clients_pgid(void) {
+    int shm_id = shmget(ipc_key(IPC_SHM), sizeof(SharedState), 0);
+    if (shm_id == -1) {
+        return;
+    }
+    SharedState *state = (SharedState *)shmat(shm_id, NULL, 0);
+    if (state == (void *)-1) {
+        return;
+    }
+    if (state->clients_pgid > 0) {
+        clients_pgid = state->clients_pgid;
+    }
+    shmdt(state);
+}
+
+// SIGSTOP dociera asynchronicznie - czeka, aż proces będzie zatrzymany (stan T w /proc/PID/stat)
+static int wait_stopped(pid_t pid, long long deadline_ns) {
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    while (monotonic_ns() < deadline_ns) {
+        FILE *stat_file = fopen(path, "r");
+        if (stat_file == NULL) {
+            return -1;
+        }
+        char state = 0;
+        int parsed = fscanf(stat_file, "%*d (%*[^)]) %c", &state);
+        fclose(stat_file);
+        if (parsed == 1 && (state == 'T' || state == 't')) {
+            return 0;
+        }
+        usleep(200);
+    }
+    return -1;
+}
+
+// Zatrzymuje kasjera poza oknem zmiany płatności w toku - zatrzymany w tym oknie mógł zdjąć
+// płatność z kolejki, nie ogłaszając jej w pamięci współdzielonej, więc jest wznawiany na chwilę
+static int stop_cashier(SharedState *state, long long deadline_ns) {
+    for (;;) {
+        kill(pid_kasjer, SIGSTOP);
+        if (wait_stopped(pid_kasjer, deadline_ns) == -1) {
+            return -1;
+        }
+        if (!__atomic_load_n(&state->cashier_updating, __ATOMIC_SEQ_CST)) {
+            return 0;
+        }
+        kill(pid_kasjer, SIGCONT);
+        usleep(1000);
+    }
+}
+
+// Punkt kontrolny w spójnej chwili: bar wstrzymuje przybycia, klienci i kasjer stoją (SIGSTOP jak
+// przy "pause"), a obsługa zdejmuje zaległe żądania i dopiero potem odbiera polecenie zapisu.
+// Kierownik wznawia role, gdy obsługa zwiększy checkpoint_seq (najdłużej CHECKPOINT_WAIT_MS).
+static void checkpoint(void) {
+    int shm_id = shmget(ipc_key(IPC_SHM), sizeof(SharedState), 0);
+    SharedState *state = shm_id != -1 ? (SharedState *)shmat(shm_id, NULL, 0) : (void *)-1;
+    if (state == (void *)-1 || transport_backend() == TRANSPORT_SOCKET) {
+        send_to_obsluga(MSG_TYPE_CHECKPOINT, 0, 0, 0);  // Gniazda: obsługa zgłosi brak punktu kontrolnego
+        if (state != (void *)-1) {
+            shmdt(state);
+        }
+        return;
+    }
+
+    long long deadline_ns = monotonic_ns() + CHECKPOINT_WAIT_MS * 1000000LL;
+    unsigned int seq = __atomic_load_n(&state->checkpoint_seq, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&state->checkpoint_active, 1, __ATOMIC_SEQ_CST);
+    refresh_clients_pgid();
+    if (clients_pgid > 0) {
+        killpg(clients_pgid, SIGSTOP);
+    }
+    if (pid_kasjer > 0 && stop_cashier(state, deadline_ns) == -1) {
+        log_message("KIEROWNIK: Kasjer nie zatrzymał się przed punktem kontrolnym");
+    }
+    if (paused && pid_obsluga > 0) {
+        kill(pid_obsluga, SIGCONT);  // Punkt w trakcie "pause" - obsługa pracuje tylko na czas zapisu
+    }
+
+    send_to_obsluga(MSG_TYPE_CHECKPOINT, 0, 0, 0);
+    while (__atomic_load_n(&state->checkpoint_seq, __ATOMIC_SEQ_CST) == seq && monotonic_ns() < deadline_ns) {
+        usleep(1000);
+    }
+    if (__atomic_load_n(&state->checkpoint_seq, __ATOMIC_SEQ_CST) == seq) {
+        log_message("KIEROWNIK: Obsługa nie zapisała punktu kontrolnego w ciągu %d ms - wznawiam role",
+                    CHECKPOINT_WAIT_MS);
+    }
+
+    if (paused && pid_obsluga > 0) {
+        kill(pid_obsluga, SIGSTOP);
+    }
+    if (!paused && pid_kasjer > 0) {
+        kill(pid_kasjer, SIGCONT);
+    }
+    if (clients_pgid > 0) {
+        killpg(clients_pgid, SIGCONT);
+    }
+    __atomic_store_n(&state->checkpoint_active, 0, __ATOMIC_SEQ_CST);
+    shmdt(state);
+}
+
+static void fire(void) {
+    log_message("KIEROWNIK: >>> SYGNAŁ 3 (POŻAR) - ewakuacja wszystkich klientów");
+    resume_workers();
+
+    int shm_id = shmget(ipc_key(IPC_SHM), sizeof(SharedState), 0);
     if (shm_id != -1) {
         SharedState *state = (SharedState *)shmat(shm_id, NULL, 0);
         if (state != (void *)-1) {
-            if (state->simulation_start_time > 0) {
-                start_time = state->simulation_start_time;
-            }
-            if (clients_pgid <= 0 && state->clients_pgid > 0) {
-                clients_pgid = state->clients_pgid;
-            }
+            state->fire_alarm = 1;  // Ustawia flagę pożaru w pamięci współdzielonej
             shmdt(state);
         }
     }
-    
-    int sigusr1_sent = 0;
-    int sigusr2_sent = 0;
-    int fire_sent = 0;
-    time_t sigusr1_sent_time = 0;
-    int sigusr1_retry_attempted = 0;
-    
-    while (running) {
-        time_t current_time = time(NULL);
-        int elapsed = (int)(current_time - start_time);
-        
-        // Sygnal 1 - podwojenie stolikow
-        if (SIGNAL1_TIME > 0 && !sigusr1_sent && elapsed >= SIGNAL1_TIME) {
-            if (pid_obsluga > 0) {
+    refresh_clients_pgid();
+    send_fire();
+
+    kill(getppid(), SIGUSR1);
+
+    if (clients_pgid > 0) {
+        killpg(clients_pgid, SIGTERM);  // Masowa ewakuacja wszystkich klientów (grupa procesów)
+    }
+
+    sleep(2);
+
+    if (pid_obsluga > 0) {
+        kill(pid_obsluga, SIGTERM);
+    }
+    if (pid_kasjer > 0) {
+        kill(pid_kasjer, SIGTERM);
+    }
+}
+
+static void close_bar(void) {
+    log_message("KIEROWNIK: Koniec symulacji - zamykanie baru");
+    resume_workers();
+
+    kill(getppid(), SIGUSR1);
+
+    sleep(2);
+
+    refresh_clients_pgid();
+    if (clients_pgid > 0) {
+        killpg(clients_pgid, SIGTERM);  // Zakończenie wszystkich klientów
+    }
+
+    sleep(1);
+
+    if (pid_obsluga > 0) {
+        kill(pid_obsluga, SIGTERM);
+    }
+    if (pid_kasjer > 0) {
+        kill(pid_kasjer, SIGTERM);
+    }
+
+    log_message("KIEROWNIK: Bar zamknięty");
+}
+
+// Wykonuje zdarzenie; zwraca 1, gdy symulacja się kończy
+static int dispatch(const ScheduledEvent *event) {
+    switch (event->action) {
+        case ACTION_DOUBLE:
+            if (pid_obsluga <= 0) break;
+            if (!double_sent) {
                 log_message("KIEROWNIK: >>> SYGNAŁ 1 (SIGUSR1) - podwojenie stolików 3-osobowych");
-                kill(pid_obsluga, SIGUSR1);
-                sigusr1_sent = 1;
-                sigusr1_sent_time = current_time;
-            } 
-        }
-        
-        // Próba ponownego wysłania sygnału 1 po 3 sekundach (powinno się nie powieść)
-        if (sigusr1_sent && !sigusr1_retry_attempted && 
-            (current_time - sigusr1_sent_time) >= 3) {
-            if (pid_obsluga > 0) {
-                log_message("KIEROWNIK: >>> Próba ponownego wysłania SYGNAŁU 1 (SIGUSR1) po 3 sekundach");
-                kill(pid_obsluga, SIGUSR1);
-                sigusr1_retry_attempted = 1;
+                double_sent = 1;
+            } else {
+                log_message("KIEROWNIK: >>> Próba ponownego wysłania SYGNAŁU 1 (SIGUSR1)");
             }
-        }
-        
-        // Sygnal 2 - rezerwacja stolikow
-        if (SIGNAL2_TIME > 0 && !sigusr2_sent && elapsed >= SIGNAL2_TIME) {
-            if (pid_obsluga > 0) {
-                int tables_to_reserve = RESERVED_TABLE_COUNT;
-                
-                log_message("KIEROWNIK: >>> SYGNAŁ 2 (SIGUSR2) - rezerwacja %d stolików", tables_to_reserve);
-                
-                int msg_id = msgget(MSG_KEY, 0);
-                if (msg_id != -1) {
-                    Message reserve_msg;
-                    reserve_msg.mtype = MSG_TYPE_RESERVE_SEATS;
-                    reserve_msg.group_id = getpid();
-                    reserve_msg.group_size = tables_to_reserve;
-                    reserve_msg.table_type = 0;
-                    reserve_msg.table_index = 0;
-                    
-                    ssize_t msg_size = sizeof(Message) - sizeof(long);
-                    msgsnd(msg_id, &reserve_msg, msg_size, 0);  // Wysyła wiadomość o rezerwacji
-                }
-                kill(pid_obsluga, SIGUSR2);
-                sigusr2_sent = 1;
-            }
-        }
-        
-        // Sygnal 3 - pozar
-        if (SIGNAL3_TIME > 0 && !fire_sent && elapsed >= SIGNAL3_TIME) {
-            fire_sent = 1;
-            log_message("KIEROWNIK: >>> SYGNAŁ 3 (POŻAR) - ewakuacja wszystkich klientów");
-            
-            int shm_id = shmget(SHM_KEY, sizeof(SharedState), 0);
-            if (shm_id != -1) {
-                SharedState *state = (SharedState *)shmat(shm_id, NULL, 0);
-                if (state != (void *)-1) {
-                    state->fire_alarm = 1;  // Ustawia flagę pożaru w pamięci współdzielonej
-                    if (clients_pgid <= 0 && state->clients_pgid > 0) {
-                        clients_pgid = state->clients_pgid;
-                    }
-                    shmdt(state);
-                }
-            }
-            
-            kill(getppid(), SIGUSR1);
-            
-            if (clients_pgid > 0) {
-                killpg(clients_pgid, SIGTERM);  // Masowa ewakuacja wszystkich klientów (grupa procesów)
-            }
-            
-            sleep(2);
-            
-            if (pid_obsluga > 0) {
-                kill(pid_obsluga, SIGTERM);
-            }
-            if (pid_kasjer > 0) {
-                kill(pid_kasjer, SIGTERM);
+            kill(pid_obsluga, SIGUSR1);
+            break;
+        case ACTION_RESERVE:
+            if (pid_obsluga <= 0) break;
+            log_message("KIEROWNIK: >>> SYGNAŁ 2 (SIGUSR2) - rezerwacja %d stolików za %d ms na %d ms", event->arg,
+                        event->lead_ms, event->duration_ms > 0 ? event->duration_ms : RESERVATION_DEFAULT_MS);
+            send_to_obsluga(MSG_TYPE_RESERVE_SEATS, event->arg, event->lead_ms,
+                            event->duration_ms);  // Wysyła wiadomość o rezerwacji
+            kill(pid_obsluga, SIGUSR2);
+            if (soak_ms > 0 && event->line == 0) {
+                // Jedno zdarzenie w kole naraz - pamięć kierownika nie rośnie z czasem przebiegu
+                wheel_add_reservation(&wheel, event->due_ms + SOAK_RESERVE_PERIOD_S * 1000LL, event->arg,
+                                      event->duration_ms, event->lead_ms, 0);
             }
-            
             break;
-        }
-        
-        if (elapsed >= SIMULATION_TIME) {
+        case ACTION_RELEASE:
+            log_message("KIEROWNIK: >>> Zwolnienie zarezerwowanych stolików");
+            send_to_obsluga(MSG_TYPE_RELEASE_SEATS, 0, 0, 0);
+            break;
+        case ACTION_PAUSE:
+            if (paused) break;
+            log_message("KIEROWNIK: >>> Wstrzymanie obsługi i kasjera na %d ms", event->arg);
+            if (pid_obsluga > 0) kill(pid_obsluga, SIGSTOP);
+            if (pid_kasjer > 0) kill(pid_kasjer, SIGSTOP);
+            paused = 1;
+            wheel_add(&wheel, event->due_ms + event->arg, ACTION_RESUME, 0, event->line);
+            break;
+        case ACTION_RESUME:
+            if (!paused) break;
+            log_message("KIEROWNIK: >>> Wznowienie obsługi i kasjera");
+            resume_workers();
+            break;
+        case ACTION_CHECKPOINT:
+            if (pid_obsluga <= 0) break;
+            log_message("KIEROWNIK: >>> Punkt kontrolny - wstrzymanie przybyć, klientów i kasjera");
+            checkpoint();
+            break;
+        case ACTION_FIRE:
+            fire();
+            return 1;
+        case ACTION_END:
+            close_bar();
+            return 1;
+    }
+    return 0;
+}
+
+// Po przywróceniu punktu kontrolnego zdarzenia skryptu sprzed jego chwili już się odbyły
+static void skip_restored(long long restored_ms, int x3_doubled) {
+    int skipped = 0;
+    ScheduledEvent *event;
+    while ((event = wheel_pop_due(&wheel, restored_ms)) != NULL) {
+        skipped++;
+        free(event);
+    }
+    double_sent = x3_doubled;
+    log_message("KIEROWNIK: Wznowienie od %lld ms - pominięto %d zdarzeń skryptu", restored_ms, skipped);
+}
+
+static void record_jitter(const ScheduledEvent *event, long long dispatch_ns) {
+    double jitter_ms = (dispatch_ns - (start_ns + event->due_ms * 1000000LL)) / 1e6;
+    dispatched++;
+    jitter_sum_ms += jitter_ms;
+    if (jitter_ms > jitter_max_ms) {
+        jitter_max_ms = jitter_ms;
+    }
+    if (event->line > 0) {
+        log_message("KIEROWNIK: Zdarzenie %s @%lld ms (linia %d) - opóźnienie %.3f ms",
+                   schedule_action_name(event->action), event->due_ms, event->line, jitter_ms);
+    } else {
+        log_message("KIEROWNIK: Zdarzenie %s @%lld ms - opóźnienie %.3f ms",
+                   schedule_action_name(event->action), event->due_ms, jitter_ms);
+    }
+}
+
+// Śpi do najbliższego zdarzenia (clock_nanosleep na CLOCK_MONOTONIC) i wysyła wszystkie zaległe
+static void run_schedule(void) {
+    int finished = 0;
+
+    while (running && !finished) {
+        long long next_ms = wheel_next_due(&wheel);
+        if (next_ms < 0) {
             break;
         }
-        
-        sleep(1);
-    }
-    
-    if (!fire_sent) {
-        log_message("KIEROWNIK: Koniec symulacji - zamykanie baru");
-        
-        kill(getppid(), SIGUSR1);
-        
-        sleep(2);
-        
-        if (clients_pgid > 0) {
-            killpg(clients_pgid, SIGTERM);  // Zakończenie wszystkich klientów
+
+        long long wake_ns = start_ns + next_ms * 1000000LL;
+        struct timespec wake;
+        wake.tv_sec = wake_ns / 1000000000LL;
+        wake.tv_nsec = wake_ns % 1000000000LL;
+        int rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+        if (rc == EINTR) {
+            continue;  // Sprawdza running
         }
-        
-        sleep(1);
-        
-        if (pid_obsluga > 0) {
-            kill(pid_obsluga, SIGTERM);
+
+        long long now_ns = monotonic_ns();
+        ScheduledEvent *event;
+        while (!finished && (event = wheel_pop_due(&wheel, (now_ns - start_ns) / 1000000LL)) != NULL) {
+            long long dispatch_ns = monotonic_ns();
+            record_jitter(event, dispatch_ns);
+            finished = dispatch(event);
+            free(event);
         }
-        if (pid_kasjer > 0) {
-            kill(pid_kasjer, SIGTERM);
+    }
+
+    if (dispatched > 0) {
+        log_message("KIEROWNIK: Opóźnienie wysyłki: %d zdarzeń, średnio %.3f ms, maks. %.3f ms",
+                   dispatched, jitter_sum_ms / dispatched, jitter_max_ms);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    signal(SIGTERM, signal_handler);
+    signal(SIGINT, signal_handler);
+    lockprof_init("kierownik", NULL);
+    schedprof_init("kierownik", SCHEDPROF_SLOT_KIEROWNIK);
+
+    if (argc > 1) pid_obsluga = atoi(argv[1]);
+    if (argc > 2) pid_kasjer = atoi(argv[2]);
+    if (argc > 3) clients_pgid = atoi(argv[3]);
+    const char *script = argc > 4 && argv[4][0] != '\0' ? argv[4] : NULL;
+    const char *soak = getenv(SOAK_ENV);
+    soak_ms = soak != NULL ? atoll(soak) * 1000LL : 0;
+
+    // Skrypt wczytywany przed zgłoszeniem gotowości - błąd kończy start baru
+    wheel_init(&wheel);
+    if (script != NULL) {
+        char error[256];
+        int loaded = schedule_load(&wheel, script, error, sizeof(error));
+        if (loaded == -1) {
+            log_message("KIEROWNIK: Błąd skryptu %s", error);
+            fprintf(stderr, "KIEROWNIK: Błąd skryptu %s\n", error);
+            wheel_free(&wheel);
+            return EXIT_FAILURE;
         }
-        
-        log_message("KIEROWNIK: Bar zamknięty");
+        log_message("KIEROWNIK: Wczytano skrypt %s (%d zdarzeń)", script, loaded);
+    } else if (soak_ms > 0) {
+        schedule_load_soak(&wheel);
+    } else {
+        schedule_load_default(&wheel);
     }
-    
+    wheel_add(&wheel, soak_ms > 0 ? soak_ms : SIMULATION_TIME * 1000LL, ACTION_END, 0, 0);
+
+    // Gotowość zgłaszana po dołączeniu do IPC; zegar symulacji startuje dopiero po otwarciu bramki przez bar
+    SharedState *state = get_shared_memory();
+    role_signal_ready();
+    if (role_wait_start() == -1) {
+        shmdt(state);
+        wheel_free(&wheel);
+        return EXIT_SUCCESS;
+    }
+
+    start_ns = state->simulation_start_ns > 0 ? state->simulation_start_ns : monotonic_ns();
+    if (clients_pgid <= 0 && state->clients_pgid > 0) {
+        clients_pgid = state->clients_pgid;
+    }
+    if (state->restored_ms > 0) {
+        skip_restored(state->restored_ms, state->x3_doubled);
+    }
+    shmdt(state);
+
+    run_schedule();
+
+    // Przerwanie przez bar (SIGTERM): role kończy bar, kierownik tylko wznawia wstrzymanych
+    resume_workers();
+    wheel_free(&wheel);
+
     return EXIT_SUCCESS;
 }
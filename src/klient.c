@@ -1,11 +1,23 @@
 #include "common.h"
 #include "utils.h"
+#include "transport.h"
+#include "checkpoint.h"
+#include "trace.h"
+#include "lockprof.h"
+#include "lifecycle.h"
 #include <pthread.h>
 
-static int msg_queue_id = -1;
+// Etap, od którego grupa zaczyna cykl życia (wznowienie po przywróceniu punktu kontrolnego)
+#define STAGE_ENTER 0       // Nowa grupa: wejście, żądanie stolika
+#define STAGE_SEAT_REPLY 1  // Żądanie już w kolejce lub grupa w kolejce oczekujących - czeka na stolik
+#define STAGE_PAY_REPLY 2   // Płatność już w kolejce - czeka na potwierdzenie
+#define STAGE_EAT 3         // Przy stoliku po zapłacie - je i oddaje naczynia
+
 static int group_id = 0;
 static int group_size = 0;
 static int running = 1;
+static GroupLifecycle life;  // Rekord cyklu życia bieżącej grupy (bar --lifecycle)
+static int pipeline = 0;     // Protokół potokowy (bar --pipeline): stolik i płatność w jednym żądaniu
 
 typedef struct {
     int member_id;
@@ -20,9 +32,12 @@ static MemberArgs *member_args = NULL;
 static volatile int can_start_eating = 0;
 static volatile int can_exit_flag = 0;
 
-// Funkcja sprawdzająca flagę pożaru
+// Funkcja sprawdzająca flagę pożaru (przy gniazdach także alarm rozgłoszony przez usługę)
 static int check_fire_alarm(void) {
-    int shm_id = shmget(SHM_KEY, sizeof(SharedState), 0);
+    if (transport_fire_alarm()) {
+        return 1;
+    }
+    int shm_id = shmget(ipc_key(IPC_SHM), sizeof(SharedState), 0);
     if (shm_id != -1) {
         SharedState *state = (SharedState *)shmat(shm_id, NULL, 0);
         if (state != (void *)-1) {
@@ -38,11 +53,11 @@ static int check_fire_alarm(void) {
 static void *member_thread_func(void *arg) {
     MemberArgs *args = (MemberArgs *)arg;
     
-    while (!(*args->can_eat) && (*args->running)) {
+    while (!(*args->can_eat) && !(*args->can_exit) && (*args->running)) {
         usleep(10000);
     }
     
-    if (!(*args->running)) {
+    if (!(*args->running) || *args->can_exit) {
         return NULL;
     }
     
@@ -53,6 +68,18 @@ static void *member_thread_func(void *arg) {
     return NULL;
 }
 
+// Funkcja zwalniająca pamięć wątków (po ich zakończeniu)
+static void free_threads(void) {
+    if (member_threads != NULL) {
+        free(member_threads);
+        member_threads = NULL;
+    }
+    if (member_args != NULL) {
+        free(member_args);
+        member_args = NULL;
+    }
+}
+
 // Funkcja czyszcząca wątki
 static void cleanup_threads(void) {
     if (group_size > 1 && member_threads != NULL) {
@@ -63,14 +90,7 @@ static void cleanup_threads(void) {
         }
     }
     
-    if (member_threads != NULL) {
-        free(member_threads);
-        member_threads = NULL;
-    }
-    if (member_args != NULL) {
-        free(member_args);
-        member_args = NULL;
-    }
+    free_threads();
 }
 
 // Funkcja obsługująca sygnały
@@ -78,30 +98,21 @@ static void signal_handler(int sig) {
     (void)sig;
     running = 0;
     can_exit_flag = 1;
+    transport_interrupt();
 }
 
-int main(int argc, char *argv[]) {
-    srand(time(NULL) ^ getpid());
-    
-    if (argc > 1) {
-        group_size = atoi(argv[1]);
-        if (group_size < 1 || group_size > 3) {
-            group_size = (rand() % 3) + 1;
-        }
-    } else {
-        group_size = (rand() % 3) + 1;
-    }
-    
-    group_id = getpid();
-    
-    log_message("KLIENT #%d: Grupa %d-osobowa wchodzi do baru", group_id, group_size);
-    
-    signal(SIGTERM, signal_handler);
-    signal(SIGINT, signal_handler);
-    
-    msg_queue_id = get_message_queue();
-    if (msg_queue_id == -1) {
-        handle_error("KLIENT: get_message_queue failed");
+// Cykl życia jednej grupy: wejście, rezerwacja stolika, płatność, jedzenie, oddanie naczyń
+static int run_group(int stage) {
+    can_start_eating = 0;
+    can_exit_flag = 0;
+    memset(&life, 0, sizeof(life));
+    life.group_id = group_id;
+    life.group_size = (int8_t)group_size;
+    life.outcome = LIFECYCLE_INTERRUPTED;  // Zmieniany w punktach zakończenia pobytu
+    life.arrival_ns = monotonic_ns();
+    
+    if (stage == STAGE_ENTER) {
+        log_message("KLIENT #%d: Grupa %d-osobowa wchodzi do baru", group_id, group_size);
     }
     
     // Tworzenie watkow dla czlonkow grupy
@@ -127,117 +138,165 @@ int main(int argc, char *argv[]) {
                 for (int j = 0; j < i; j++) {
                     pthread_join(member_threads[j], NULL);
                 }
-                free(member_threads);
-                free(member_args);
+                free_threads();
                 return EXIT_FAILURE;
             }
         }
     }
     
-    // 5% szansa ze klient nie zamawia
-    int orders = (rand() % 100) < NO_ORDER_PROBABILITY ? 0 : 1;
+    long long pay_start = 0;
+    // Grupa wznowiona z punktu kontrolnego kończy pobyt w zwykłym protokole (patrz bar.c, restore_queues())
+    int pipelined = pipeline && stage == STAGE_ENTER;
     
-    if (!orders) {
-        log_message("KLIENT #%d: Nie zamawia - wychodzi (5%% przypadek)", group_id);
-        running = 0;
-        cleanup_threads();
-        return EXIT_SUCCESS;
-    }
-    
-    // Wysyłanie żądania rezerwacji stolika
-    Message seat_request;
-    seat_request.mtype = MSG_TYPE_SEAT_REQUEST;
-    seat_request.group_id = group_id;
-    seat_request.group_size = group_size;
-    seat_request.table_type = 0;
-    seat_request.table_index = 0;
+    if (stage == STAGE_ENTER) {
+        // 5% szansa ze klient nie zamawia
+        int orders = (rand() % 100) < NO_ORDER_PROBABILITY ? 0 : 1;
     
-    ssize_t msg_size = sizeof(Message) - sizeof(long);
+        if (!orders) {
+            log_message("KLIENT #%d: Nie zamawia - wychodzi (5%% przypadek)", group_id);
+            life.outcome = LIFECYCLE_NO_ORDER;
+            cleanup_threads();
+            return EXIT_SUCCESS;
+        }
     
-    if (msgsnd(msg_queue_id, &seat_request, msg_size, 0) == -1) {
-        perror("KLIENT: msgsnd (rezerwacja) failed");
-        running = 0;
-        cleanup_threads();
-        return EXIT_FAILURE;
+        // Wysyłanie żądania rezerwacji stolika (w protokole potokowym razem z płatnością)
+        Message seat_request;
+        seat_request.mtype = pipelined ? MSG_TYPE_SEAT_AND_PAY : MSG_TYPE_SEAT_REQUEST;
+        seat_request.group_id = group_id;
+        seat_request.group_size = group_size;
+        seat_request.table_type = 0;
+        seat_request.table_index = 0;
+    
+        long long request_start = trace_begin();
+        if (transport_send(QUEUE_SEAT, &seat_request, 0) == -1) {
+            perror("KLIENT: msgsnd (rezerwacja) failed");
+            running = 0;
+            cleanup_threads();
+            return EXIT_FAILURE;
+        }
+        TRACE_END(TRACE_KLIENT_REQUEST, request_start, group_id, group_size);
+        if (pipelined) {
+            pay_start = trace_begin();  // Potwierdzenie płatności jest odpowiedzią na to żądanie
+        }
     }
     
-    // Oczekiwanie na odpowiedz
-    Message seat_response;
-    long reply_type = 1000 + group_id;
-    
-    ssize_t received = msgrcv(msg_queue_id, &seat_response, msg_size, reply_type, 0);
-    if (received == -1) {
-        if (errno == EINTR && !running) {
-            if (check_fire_alarm()) {
-                log_message("KLIENT #%d: POŻAR! Ewakuacja", group_id);
+    if (stage <= STAGE_SEAT_REPLY && !pipelined) {
+        // Oczekiwanie na odpowiedz
+        Message seat_response;
+        long reply_type = group_id;  // Odpowiedzi obsługi mają własną klasę ruchu - typ to po prostu group_id
+    
+        long long seat_start = trace_begin();
+        ssize_t received = transport_receive(QUEUE_SEAT_REPLY, &seat_response, reply_type, 0);
+        if (received == -1) {
+            if (errno == EINTR && (!running || transport_fire_alarm())) {
+                if (check_fire_alarm()) {
+                    log_message("KLIENT #%d: POŻAR! Ewakuacja", group_id);
+                    life.outcome = LIFECYCLE_EVACUATED;
+                }
+                cleanup_threads();
+                return EXIT_SUCCESS;
             }
+            log_message("KLIENT #%d: Błąd msgrcv (oczekiwanie na stolik): %s", group_id, strerror(errno));
+            running = 0;
+            cleanup_threads();
+            return EXIT_FAILURE;
+        }
+        TRACE_END(TRACE_KLIENT_SEAT, seat_start, group_id, seat_response.table_type);
+    
+        if (seat_response.table_type == 0 || seat_response.table_index < 0) {
+            log_message("KLIENT #%d: Brak wolnych miejsc - wychodzi BEZ odbierania dania", group_id);
+            life.outcome = LIFECYCLE_REJECTED;
             cleanup_threads();
             return EXIT_SUCCESS;
         }
-        log_message("KLIENT #%d: Błąd msgrcv (oczekiwanie na stolik): %s", group_id, strerror(errno));
-        running = 0;
-        cleanup_threads();
-        return EXIT_FAILURE;
-    }
     
-    if (seat_response.table_type == 0 || seat_response.table_index < 0) {
-        log_message("KLIENT #%d: Brak wolnych miejsc - wychodzi BEZ odbierania dania", group_id);
-        running = 0;
-        cleanup_threads();
-        return EXIT_SUCCESS;
+        log_message("KLIENT #%d: Stolik %d-os. zarezerwowany -> płaci", 
+                   group_id, seat_response.table_type);
+        life.seated_ns = monotonic_ns();
+        life.table_type = (int8_t)seat_response.table_type;
+        life.table_index = (int16_t)seat_response.table_index;
+    
+        // Platnosc
+        Message payment_msg;
+        payment_msg.mtype = MSG_TYPE_PAYMENT;
+        payment_msg.group_id = group_id;
+        payment_msg.group_size = group_size;
+        payment_msg.table_type = seat_response.table_type;
+        payment_msg.table_index = seat_response.table_index;
+    
+        pay_start = trace_begin();
+        life.pay_wait_ns = monotonic_ns();  // Początek - zamieniany na czas oczekiwania po potwierdzeniu
+        if (transport_send(QUEUE_PAYMENT, &payment_msg, 0) == -1) {
+            if (!running) {
+                cleanup_threads();
+                return EXIT_SUCCESS;
+            }
+            perror("KLIENT: msgsnd (płatność) failed");
+            running = 0;
+            cleanup_threads();
+            return EXIT_FAILURE;
+        }
     }
     
-    log_message("KLIENT #%d: Stolik %d-os. zarezerwowany -> płaci", 
-               group_id, seat_response.table_type);
-    
-    // Platnosc
-    Message payment_msg;
-    payment_msg.mtype = MSG_TYPE_PAYMENT;
-    payment_msg.group_id = group_id;
-    payment_msg.group_size = group_size;
-    payment_msg.table_type = seat_response.table_type;
-    payment_msg.table_index = seat_response.table_index;
+    if (stage <= STAGE_PAY_REPLY) {
+        // Oczekiwanie na potwierdzenie platnosci
+        Message payment_response;
+        long payment_reply_type = group_id;
+        if (stage == STAGE_PAY_REPLY) {
+            pay_start = trace_begin();  // Wznowiona grupa: płatność wysłano przed punktem kontrolnym
+            life.pay_wait_ns = monotonic_ns();
+        }
     
-    if (msgsnd(msg_queue_id, &payment_msg, msg_size, 0) == -1) {
-        if (!running) {
+        ssize_t payment_received = transport_receive(QUEUE_PAY_REPLY, &payment_response, payment_reply_type, 0);
+        if (payment_received == -1) {
+            life.pay_wait_ns = 0;
+            if (errno == EINTR && (!running || transport_fire_alarm())) {
+                if (check_fire_alarm()) {
+                    log_message("KLIENT #%d: POŻAR! Ewakuacja", group_id);
+                    life.outcome = LIFECYCLE_EVACUATED;
+                }
+                cleanup_threads();
+                return EXIT_SUCCESS;
+            }
+            log_message("KLIENT #%d: Błąd oczekiwania na potwierdzenie płatności", group_id);
+            running = 0;
+            cleanup_threads();
+            return EXIT_FAILURE;
+        }
+        TRACE_END(TRACE_KLIENT_PAY, pay_start, group_id, 0);
+        
+        // Odmowa stolika w tej kolejce: protokół potokowy (także odmowa wznowiona z punktu kontrolnego)
+        if (payment_response.table_type == 0 || payment_response.table_index < 0) {
+            log_message("KLIENT #%d: Brak wolnych miejsc - wychodzi BEZ odbierania dania", group_id);
+            life.outcome = LIFECYCLE_REJECTED;
             cleanup_threads();
             return EXIT_SUCCESS;
         }
-        perror("KLIENT: msgsnd (płatność) failed");
-        running = 0;
-        cleanup_threads();
-        return EXIT_FAILURE;
-    }
+        if (pipelined) {
+            // Jedyna odpowiedź protokołu potokowego - potwierdzenie płatności niesie też stolik
+            log_message("KLIENT #%d: Stolik %d-os. zarezerwowany i opłacony",
+                       group_id, payment_response.table_type);
+            life.seated_ns = monotonic_ns();  // Czekanie na płatność wliczone w czekanie na stolik
+            life.table_type = (int8_t)payment_response.table_type;
+            life.table_index = (int16_t)payment_response.table_index;
+        } else {
+            life.pay_wait_ns = monotonic_ns() - life.pay_wait_ns;
+        }
+        
+        log_message("KLIENT #%d: Płatność przyjęta -> odbiera danie", group_id);
     
-    // Oczekiwanie na potwierdzenie platnosci
-    Message payment_response;
-    long payment_reply_type = 2000 + group_id;
+        long long pickup_start = trace_begin();
+        sleep(DISH_PICKUP_TIME);
+        TRACE_END(TRACE_KLIENT_PICKUP, pickup_start, group_id, 0);
     
-    ssize_t payment_received = msgrcv(msg_queue_id, &payment_response, msg_size, payment_reply_type, 0);
-    if (payment_received == -1) {
-        if (errno == EINTR && !running) {
+        if (!running) {
             if (check_fire_alarm()) {
                 log_message("KLIENT #%d: POŻAR! Ewakuacja", group_id);
+                life.outcome = LIFECYCLE_EVACUATED;
             }
             cleanup_threads();
             return EXIT_SUCCESS;
         }
-        log_message("KLIENT #%d: Błąd oczekiwania na potwierdzenie płatności", group_id);
-        running = 0;
-        cleanup_threads();
-        return EXIT_FAILURE;
-    }
-    
-    log_message("KLIENT #%d: Płatność przyjęta -> odbiera danie", group_id);
-    
-    sleep(1);
-    
-    if (!running) {
-        if (check_fire_alarm()) {
-            log_message("KLIENT #%d: POŻAR! Ewakuacja", group_id);
-        }
-        cleanup_threads();
-        return EXIT_SUCCESS;
     }
     
     // Sygnalizacja watkom ze mozna jesc
@@ -245,11 +304,16 @@ int main(int argc, char *argv[]) {
     
     log_message("KLIENT #%d: Rozpoczyna jedzenie (czas: %ds)", group_id, EATING_TIME);
     
+    long long eat_start = trace_begin();
+    long long eat_begin_ns = monotonic_ns();
     sleep(EATING_TIME);
+    TRACE_END(TRACE_KLIENT_EAT, eat_start, group_id, 0);
+    life.eat_ns = monotonic_ns() - eat_begin_ns;
     
     if (!running) {
         if (check_fire_alarm()) {
             log_message("KLIENT #%d: POŻAR! Ewakuacja", group_id);
+            life.outcome = LIFECYCLE_EVACUATED;
         }
         cleanup_threads();
         return EXIT_SUCCESS;
@@ -274,19 +338,145 @@ int main(int argc, char *argv[]) {
     dishes_msg.table_type = 0;
     dishes_msg.table_index = -1;
     
-    if (msgsnd(msg_queue_id, &dishes_msg, msg_size, 0) == -1) {
+    long long dishes_start = trace_begin();
+    if (transport_send(QUEUE_DISHES, &dishes_msg, 0) == -1) {
         if (!running) {
-            if (member_threads) free(member_threads);
-            if (member_args) free(member_args);
+            free_threads();
             return EXIT_SUCCESS;
         }
         perror("KLIENT: msgsnd (naczynia) failed");
     }
+    TRACE_END(TRACE_KLIENT_DISHES, dishes_start, group_id, group_size);
     
     log_message("KLIENT #%d: Oddał naczynia (%d szt.) i wychodzi z baru", group_id, group_size);
+    life.outcome = LIFECYCLE_SERVED;
     
-    if (member_threads) free(member_threads);
-    if (member_args) free(member_args);
+    free_threads();
     
     return EXIT_SUCCESS;
 }
+
+// Cykl życia grupy ze skrzynką odpowiedzi transportu (backend pierścieni) na czas jej trwania.
+// Grupa wznowiona z punktu kontrolnego zakłada skrzynkę przed startem zegara (bariera gotowości
+// baru), bo odpowiedź na jej żądanie z przywróconej kolejki może przyjść zaraz po starcie.
+static int run_group_with_mailbox(int stage) {
+    if (transport_mailbox_open(group_id) == -1) {
+        log_message("KLIENT #%d: Brak wolnej skrzynki odpowiedzi - wychodzi", group_id);
+        if (stage != STAGE_ENTER) {
+            role_signal_ready();
+        }
+        return EXIT_SUCCESS;
+    }
+    if (stage != STAGE_ENTER) {
+        role_signal_ready();
+        if (role_wait_start() == -1) {
+            transport_mailbox_close(group_id);
+            return EXIT_SUCCESS;
+        }
+        log_message("KLIENT #%d: Grupa %d-osobowa wznawia pobyt po przywróceniu (etap: %s)", group_id, group_size,
+                   stage == STAGE_SEAT_REPLY ? RESUME_SEAT : stage == STAGE_PAY_REPLY ? RESUME_PAY : RESUME_EAT);
+    }
+    int status = run_group(stage);
+    transport_mailbox_close(group_id);
+    if (lifecycle_enabled) {
+        life.departure_ns = monotonic_ns();
+        lifecycle_append(&life);
+    }
+    return status;
+}
+
+static int parse_stage(const char *name) {
+    if (strcmp(name, RESUME_SEAT) == 0) return STAGE_SEAT_REPLY;
+    if (strcmp(name, RESUME_PAY) == 0) return STAGE_PAY_REPLY;
+    if (strcmp(name, RESUME_EAT) == 0) return STAGE_EAT;
+    return -1;
+}
+
+// Tryb puli: proces czeka na przydział grupy od baru, obsługuje ją i wraca do puli
+static int run_pool_worker(void) {
+    SharedState *state = get_shared_memory();
+    int status = EXIT_SUCCESS;
+    
+    while (running) {
+        Message assignment;
+        
+        __atomic_add_fetch(&state->pool_idle, 1, __ATOMIC_SEQ_CST);
+        ssize_t received = transport_receive(QUEUE_POOL, &assignment, MSG_TYPE_POOL_ASSIGN, 0);
+        __atomic_sub_fetch(&state->pool_idle, 1, __ATOMIC_SEQ_CST);
+        
+        if (received == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (running) {
+                log_message("KLIENT: Błąd msgrcv (pula): %s", strerror(errno));
+                status = EXIT_FAILURE;
+            }
+            break;
+        }
+        
+        group_id = assignment.group_id;
+        group_size = assignment.group_size;
+        if (run_group_with_mailbox(STAGE_ENTER) != EXIT_SUCCESS) {
+            status = EXIT_FAILURE;
+            break;
+        }
+    }
+    
+    __atomic_sub_fetch(&state->pool_size, 1, __ATOMIC_SEQ_CST);
+    shmdt(state);
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    srand(time(NULL) ^ getpid());
+    
+    signal(SIGTERM, signal_handler);
+    signal(SIGINT, signal_handler);
+    trace_init("klient");
+    lockprof_init("klient", NULL);
+    lifecycle_init();
+    pipeline = getenv(PIPELINE_ENV) != NULL;
+    
+    // Otwarcie kolejek przed pierwszym użyciem (błąd kończy proces w get_message_queue())
+    if (transport_backend() == TRANSPORT_SYSV) {
+        for (int queue = 0; queue < QUEUE_COUNT; queue++) {
+            get_message_queue(queue);
+        }
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "--pool") == 0) {
+        return run_pool_worker();
+    }
+    
+    // Wznowienie grupy z punktu kontrolnego: klient --resume ETAP GROUP_ID ROZMIAR
+    if (argc > 1 && strcmp(argv[1], "--resume") == 0) {
+        int stage = argc > 4 ? parse_stage(argv[2]) : -1;
+        group_id = argc > 4 ? atoi(argv[3]) : 0;
+        group_size = argc > 4 ? atoi(argv[4]) : 0;
+        if (stage == -1 || group_id <= 0 || group_size < 1 || group_size > 3) {
+            fprintf(stderr, "KLIENT: Użycie: %s --resume seat|pay|eat GROUP_ID ROZMIAR\n", argv[0]);
+            role_signal_ready();  // Bar nie czeka na tę grupę do końca limitu gotowości
+            return EXIT_FAILURE;
+        }
+        return run_group_with_mailbox(stage);
+    }
+    
+    if (argc > 1) {
+        group_size = atoi(argv[1]);
+        if (group_size < 1 || group_size > 3) {
+            group_size = (rand() % 3) + 1;
+        }
+    } else {
+        group_size = (rand() % 3) + 1;
+    }
+    
+    // Identyfikator nadany przez bar (kolejne numery grup) - PID powtarza się w długim przebiegu,
+    // a odpowiedź adresowana do grupy, która już wyszła, trafiłaby do nowej grupy z tym samym PID
+    group_id = argc > 2 ? atoi(argv[2]) : 0;
+    if (group_id <= 0) {
+        group_id = getpid();
+    }
+    
+    return run_group_with_mailbox(STAGE_ENTER);
+}
@@ -0,0 +1,167 @@
+#include "lifecycle.h"
+#include "utils.h"
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+int lifecycle_enabled = 0;
+
+static LifecycleHeader *header = NULL;
+
+// Układ kolumn: nazwa i szerokość; offsety wynikają z pojemności pliku
+static const struct {
+    const char *name;
+    uint32_t width;
+} column_layout[LC_COLUMNS] = {
+    {"committed", 1}, {"group_id", 4}, {"group_size", 1}, {"outcome", 1},
+    {"table_type", 1}, {"table_index", 2}, {"arrival_ns", 8}, {"seated_ns", 8},
+    {"pay_wait_ns", 8}, {"eat_ns", 8}, {"departure_ns", 8}, {"writer_pid", 4},
+};
+
+static const char *outcome_names[LIFECYCLE_OUTCOMES] = {
+    "?", "obsłużona", "odrzucona", "ewakuowana", "bez zamówienia", "przerwana",
+};
+
+const char *lifecycle_outcome_name(int outcome) {
+    if (outcome < 0 || outcome >= LIFECYCLE_OUTCOMES) {
+        return "?";
+    }
+    return outcome_names[outcome];
+}
+
+static uint64_t align_up(uint64_t value) {
+    return (value + LIFECYCLE_ALIGN - 1) / LIFECYCLE_ALIGN * LIFECYCLE_ALIGN;
+}
+
+// Nagłówek z tabelą kolumn; zwraca rozmiar pliku
+static uint64_t layout_header(LifecycleHeader *hdr, uint64_t capacity) {
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = LIFECYCLE_MAGIC;
+    hdr->version = LIFECYCLE_VERSION;
+    hdr->capacity = capacity;
+    hdr->column_count = LC_COLUMNS;
+    uint64_t offset = align_up(sizeof(LifecycleHeader));
+    for (int c = 0; c < LC_COLUMNS; c++) {
+        snprintf(hdr->columns[c].name, sizeof(hdr->columns[c].name), "%s", column_layout[c].name);
+        hdr->columns[c].width = column_layout[c].width;
+        hdr->columns[c].offset = offset;
+        offset = align_up(offset + capacity * column_layout[c].width);
+    }
+    return offset;
+}
+
+// Mapuje cały plik i sprawdza nagłówek; NULL przy błędzie (errno)
+static LifecycleHeader *map_file(const char *path, int writable, size_t *size) {
+    int fd = open(path, (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (fd == -1) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(LifecycleHeader)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    LifecycleHeader *hdr = data;
+    if (hdr->magic != LIFECYCLE_MAGIC || hdr->version != LIFECYCLE_VERSION || hdr->column_count != LC_COLUMNS ||
+        hdr->columns[LC_COLUMNS - 1].offset + hdr->capacity * hdr->columns[LC_COLUMNS - 1].width >
+            (uint64_t)st.st_size) {
+        munmap(data, (size_t)st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return hdr;
+}
+
+int lifecycle_create(const char *path, uint64_t capacity, int truncate) {
+    if (truncate && unlink(path) == -1 && errno != ENOENT) {
+        return -1;
+    }
+
+    // Nagłówek zapisany w pliku tymczasowym, link() publikuje plik atomowo (EEXIST - inny proces był pierwszy)
+    char tmp_path[PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp-%d", path, (int)getpid());
+    int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return -1;
+    }
+    LifecycleHeader hdr;
+    uint64_t file_size = layout_header(&hdr, capacity);
+    int rc = (ftruncate(fd, (off_t)file_size) == -1 || pwrite(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)) ? -1 : 0;
+    close(fd);
+    if (rc == 0 && link(tmp_path, path) == -1 && errno != EEXIST) {
+        rc = -1;
+    }
+    int saved_errno = errno;
+    unlink(tmp_path);
+    if (rc == -1) {
+        errno = saved_errno;
+        return -1;
+    }
+
+    size_t size;
+    header = map_file(path, 1, &size);
+    if (header == NULL) {
+        return -1;
+    }
+    lifecycle_enabled = 1;
+    return 0;
+}
+
+void lifecycle_init(void) {
+    const char *path = getenv(LIFECYCLE_ENV);
+    if (path == NULL || path[0] == '\0' || header != NULL) {
+        return;
+    }
+    size_t size;
+    header = map_file(path, 1, &size);
+    if (header == NULL) {
+        fprintf(stderr, "LIFECYCLE: Nie można zmapować %s: %s\n", path, strerror(errno));
+        return;
+    }
+    lifecycle_enabled = 1;
+}
+
+void lifecycle_set_start(long long start_ns) {
+    if (header != NULL) {
+        __atomic_store_n(&header->start_ns, (int64_t)start_ns, __ATOMIC_RELEASE);
+    }
+}
+
+#define COLUMN(type, c) ((type *)((char *)header + header->columns[c].offset))
+
+long long lifecycle_append(const GroupLifecycle *record) {
+    if (header == NULL) {
+        return -1;
+    }
+    uint64_t index = __atomic_fetch_add(&header->next, 1, __ATOMIC_RELAXED);
+    if (index >= header->capacity) {
+        __atomic_fetch_add(&header->dropped, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+
+    COLUMN(int32_t, LC_GROUP_ID)[index] = record->group_id;
+    COLUMN(int8_t, LC_GROUP_SIZE)[index] = record->group_size;
+    COLUMN(int8_t, LC_OUTCOME)[index] = record->outcome;
+    COLUMN(int8_t, LC_TABLE_TYPE)[index] = record->table_type;
+    COLUMN(int16_t, LC_TABLE_INDEX)[index] = record->table_index;
+    COLUMN(int64_t, LC_ARRIVAL)[index] = record->arrival_ns;
+    COLUMN(int64_t, LC_SEATED)[index] = record->seated_ns;
+    COLUMN(int64_t, LC_PAY_WAIT)[index] = record->pay_wait_ns;
+    COLUMN(int64_t, LC_EAT)[index] = record->eat_ns;
+    COLUMN(int64_t, LC_DEPARTURE)[index] = record->departure_ns;
+    COLUMN(int32_t, LC_WRITER)[index] = (int32_t)getpid();
+    // Czytelnik, który widzi committed == 1, widzi też wszystkie kolumny rekordu
+    __atomic_store_n(&COLUMN(uint8_t, LC_COMMITTED)[index], 1, __ATOMIC_RELEASE);
+    return (long long)index;
+}
+
+const LifecycleHeader *lifecycle_map_read(const char *path, size_t *size) {
+    return map_file(path, 0, size);
+}
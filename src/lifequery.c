@@ -0,0 +1,257 @@
+#include "common.h"
+#include "lifecycle.h"
+#include <sys/mman.h>
+
+// Zapytania o rekordy cyklu życia grup (bar --lifecycle PLIK). Plik jest mapowany tylko do
+// odczytu i czytany kolumnami - także w trakcie przebiegu (liczą się rekordy z committed == 1).
+// Wynik: liczba grup według wyniku pobytu, percentyle etapów oraz czekanie na stolik według
+// rodzaju stolika i wielkości grupy; --csv wypisuje wybrane rekordy.
+
+#define MAX_TABLE_TYPE 4
+#define MAX_GROUP_SIZE 3
+
+typedef struct {
+    const LifecycleHeader *header;
+    const uint8_t *committed;
+    const int32_t *group_id;
+    const int8_t *group_size;
+    const int8_t *outcome;
+    const int8_t *table_type;
+    const int16_t *table_index;
+    const int64_t *arrival;
+    const int64_t *seated;
+    const int64_t *pay_wait;
+    const int64_t *eat;
+    const int64_t *departure;
+    const int32_t *writer;
+} Columns;
+
+static int compare_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static long long percentile(const long long *sorted, size_t n, int p) {
+    size_t index = (n * (size_t)p + 99) / 100;
+    return sorted[index > 0 ? index - 1 : 0];
+}
+
+// Wiersz percentyli (ms) dla wartości; sortuje values w miejscu
+static void print_stats(const char *label, long long *values, size_t n) {
+    if (n == 0) {
+        printf("%-22s %8d %10s %10s %10s %10s\n", label, 0, "-", "-", "-", "-");
+        return;
+    }
+    qsort(values, n, sizeof(long long), compare_ll);
+    printf("%-22s %8zu %10.3f %10.3f %10.3f %10.3f\n", label, n, percentile(values, n, 50) / 1e6,
+           percentile(values, n, 90) / 1e6, percentile(values, n, 99) / 1e6, values[n - 1] / 1e6);
+}
+
+// Wyrównanie etykiet z polskimi znakami (printf liczy bajty, nie znaki)
+static const char *pad_label(char *buf, size_t size, const char *text, int width) {
+    int chars = 0;
+    for (const char *p = text; *p != '\0'; p++) {
+        chars += ((unsigned char)*p & 0xc0) != 0x80;
+    }
+    snprintf(buf, size, "%s%*s", text, width > chars ? width - chars : 0, "");
+    return buf;
+}
+
+static int parse_outcome(const char *text) {
+    for (int outcome = 1; outcome < LIFECYCLE_OUTCOMES; outcome++) {
+        if (strcmp(text, lifecycle_outcome_name(outcome)) == 0) {
+            return outcome;
+        }
+    }
+    int outcome = atoi(text);
+    return outcome >= 1 && outcome < LIFECYCLE_OUTCOMES ? outcome : -1;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Użycie: %s PLIK [--outcome W] [--size N] [--csv]\n", program);
+    fprintf(stderr, "  PLIK         plik rekordów z bar --lifecycle (lub generator --lifecycle)\n");
+    fprintf(stderr, "  --outcome W  tylko grupy z wynikiem W: numer 1..%d lub nazwa (\"obsłużona\", \"odrzucona\",\n",
+            LIFECYCLE_OUTCOMES - 1);
+    fprintf(stderr, "               \"ewakuowana\", \"bez zamówienia\", \"przerwana\")\n");
+    fprintf(stderr, "  --size N     tylko grupy N-osobowe\n");
+    fprintf(stderr, "  --csv        rekordy na stdout (czasy w ms od startu zegara symulacji) zamiast podsumowania\n");
+}
+
+static void print_csv(const Columns *c, const uint32_t *selected, size_t n) {
+    long long origin = c->header->start_ns;
+    printf("group_id,group_size,outcome,table_type,table_index,arrival_ms,seated_ms,pay_wait_ms,eat_ms,"
+           "departure_ms,writer_pid\n");
+    for (size_t k = 0; k < n; k++) {
+        uint32_t i = selected[k];
+        printf("%d,%d,%d,%d,%d,%.3f,", c->group_id[i], c->group_size[i], c->outcome[i], c->table_type[i],
+               c->table_index[i], (c->arrival[i] - origin) / 1e6);
+        if (c->seated[i] != 0) {
+            printf("%.3f", (c->seated[i] - origin) / 1e6);
+        }
+        printf(",%.3f,%.3f,%.3f,%d\n", c->pay_wait[i] / 1e6, c->eat[i] / 1e6, (c->departure[i] - origin) / 1e6,
+               c->writer[i]);
+    }
+}
+
+static void print_summary(const Columns *c, const uint32_t *selected, size_t n) {
+    long long *values = malloc((n > 0 ? n : 1) * sizeof(long long));
+    if (values == NULL) {
+        perror("lifequery: malloc failed");
+        return;
+    }
+    char label[64];
+
+    size_t by_outcome[LIFECYCLE_OUTCOMES] = {0};
+    for (size_t k = 0; k < n; k++) {
+        int outcome = c->outcome[selected[k]];
+        by_outcome[outcome >= 0 && outcome < LIFECYCLE_OUTCOMES ? outcome : 0]++;
+    }
+    printf("%s %8s\n", pad_label(label, sizeof(label), "wynik pobytu", 22), "grupy");
+    for (int outcome = 0; outcome < LIFECYCLE_OUTCOMES; outcome++) {
+        if (by_outcome[outcome] > 0) {
+            printf("%s %8zu\n", pad_label(label, sizeof(label), lifecycle_outcome_name(outcome), 22),
+                   by_outcome[outcome]);
+        }
+    }
+
+    printf("\n%s %8s %10s %10s %10s %10s\n", pad_label(label, sizeof(label), "etap (ms)", 22), "liczba", "p50",
+           "p90", "p99", "max");
+    size_t m = 0;
+    for (size_t k = 0; k < n; k++) {
+        uint32_t i = selected[k];
+        if (c->seated[i] != 0) {
+            values[m++] = c->seated[i] - c->arrival[i];
+        }
+    }
+    print_stats(pad_label(label, sizeof(label), "czekanie na stolik", 22), values, m);
+    m = 0;
+    for (size_t k = 0; k < n; k++) {
+        if (c->pay_wait[selected[k]] > 0) {
+            values[m++] = c->pay_wait[selected[k]];
+        }
+    }
+    print_stats(pad_label(label, sizeof(label), "czekanie na płatność", 22), values, m);
+    m = 0;
+    for (size_t k = 0; k < n; k++) {
+        if (c->eat[selected[k]] > 0) {
+            values[m++] = c->eat[selected[k]];
+        }
+    }
+    print_stats(pad_label(label, sizeof(label), "jedzenie", 22), values, m);
+    m = 0;
+    for (size_t k = 0; k < n; k++) {
+        uint32_t i = selected[k];
+        values[m++] = c->departure[i] - c->arrival[i];
+    }
+    print_stats(pad_label(label, sizeof(label), "pobyt", 22), values, m);
+
+    printf("\n%s %8s %10s %10s %10s %10s\n", pad_label(label, sizeof(label), "czekanie na stolik", 22),
+           "liczba", "p50", "p90", "p99", "max");
+    for (int type = 1; type <= MAX_TABLE_TYPE; type++) {
+        m = 0;
+        for (size_t k = 0; k < n; k++) {
+            uint32_t i = selected[k];
+            if (c->table_type[i] == type && c->seated[i] != 0) {
+                values[m++] = c->seated[i] - c->arrival[i];
+            }
+        }
+        if (m > 0) {
+            snprintf(label, sizeof(label), "stolik %d-os.", type);
+            print_stats(label, values, m);
+        }
+    }
+    for (int size = 1; size <= MAX_GROUP_SIZE; size++) {
+        m = 0;
+        for (size_t k = 0; k < n; k++) {
+            uint32_t i = selected[k];
+            if (c->group_size[i] == size && c->seated[i] != 0) {
+                values[m++] = c->seated[i] - c->arrival[i];
+            }
+        }
+        if (m > 0) {
+            snprintf(label, sizeof(label), "grupa %d-os.", size);
+            print_stats(label, values, m);
+        }
+    }
+    free(values);
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL;
+    int outcome_filter = 0;
+    int size_filter = 0;
+    int csv = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--outcome") == 0 && i + 1 < argc) {
+            outcome_filter = parse_outcome(argv[++i]);
+            if (outcome_filter == -1) {
+                print_usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size_filter = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            csv = 1;
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (path == NULL) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    size_t size;
+    const LifecycleHeader *header = lifecycle_map_read(path, &size);
+    if (header == NULL) {
+        fprintf(stderr, "lifequery: %s: %s\n", path, errno == EINVAL ? "nieznany format pliku" : strerror(errno));
+        return 2;
+    }
+    Columns c = {
+        header,
+        lifecycle_column(header, LC_COMMITTED), lifecycle_column(header, LC_GROUP_ID),
+        lifecycle_column(header, LC_GROUP_SIZE), lifecycle_column(header, LC_OUTCOME),
+        lifecycle_column(header, LC_TABLE_TYPE), lifecycle_column(header, LC_TABLE_INDEX),
+        lifecycle_column(header, LC_ARRIVAL), lifecycle_column(header, LC_SEATED),
+        lifecycle_column(header, LC_PAY_WAIT), lifecycle_column(header, LC_EAT),
+        lifecycle_column(header, LC_DEPARTURE), lifecycle_column(header, LC_WRITER),
+    };
+
+    uint64_t next = __atomic_load_n(&header->next, __ATOMIC_ACQUIRE);
+    uint64_t count = next < header->capacity ? next : header->capacity;
+    uint32_t *selected = malloc((count > 0 ? count : 1) * sizeof(uint32_t));
+    if (selected == NULL) {
+        perror("lifequery: malloc failed");
+        return 2;
+    }
+    size_t n = 0;
+    uint64_t pending = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        if (__atomic_load_n(&c.committed[i], __ATOMIC_ACQUIRE) != 1) {
+            pending++;  // Indeks zarezerwowany, zapis w toku (lub proces zginął w trakcie)
+            continue;
+        }
+        if ((outcome_filter == 0 || c.outcome[i] == outcome_filter) &&
+            (size_filter == 0 || c.group_size[i] == size_filter)) {
+            selected[n++] = (uint32_t)i;
+        }
+    }
+
+    if (csv) {
+        print_csv(&c, selected, n);
+    } else {
+        printf("lifequery: %s - %llu rekordów (%zu wybranych), w toku %llu, odrzuconych (pełny plik) %llu\n\n",
+               path, (unsigned long long)(count - pending), n, (unsigned long long)pending,
+               (unsigned long long)header->dropped);
+        print_summary(&c, selected, n);
+    }
+
+    free(selected);
+    munmap((void *)header, size);
+    return 0;
+}
@@ -0,0 +1,359 @@
+#include "lockprof.h"
+#include <stdarg.h>
+
+#define LOCKPROF_NAME_LEN 48
+
+int lockprof_enabled = 0;
+
+// Miejsce w procesie - rozpoznawane po wskaźnikach do stałych napisów, liczniki własne
+// albo we wspólnym profilu instancji
+typedef struct {
+    const char *lock;   // Nazwa semafora ("SEM_SHARED_STATE", "log")
+    const char *site;   // Miejsce wywołania
+    LockStats *stats;
+    LockStats local;
+} LockSite;
+
+// Miejsce wspólnego profilu - procesy różnych programów rozpoznają je po nazwach
+typedef struct {
+    int ready;          // Nazwy zapisane, miejsce można porównywać
+    char lock[LOCKPROF_NAME_LEN];
+    char site[LOCKPROF_NAME_LEN];
+    LockStats stats;
+} SharedSite;
+
+// Segment IPC_LOCKPROF. Rejestracja miejsc jest bez blokady (zatrzymany proces nie wstrzymuje
+// pozostałych): dwa procesy rejestrujące naraz tę samą nazwę mogą dostać osobne pozycje - raport
+// scala je po nazwach.
+typedef struct {
+    int site_count;     // Zajęte pozycje sites[] (może przekroczyć LOCKPROF_SHARED_SITES)
+    int processes;      // Procesy dopisujące liczniki
+    SharedSite sites[LOCKPROF_SHARED_SITES];
+    LockStats overflow; // Miejsca ponad LOCKPROF_SHARED_SITES
+} SharedProfile;
+
+static LockSite sites[LOCKPROF_MAX_SITES];
+static int site_count = 0;
+static int sites_busy = 0;      // Blokada wirująca rejestracji (wątki członków grupy klienta logują równolegle)
+static LockStats overflow;      // Miejsca procesu ponad LOCKPROF_MAX_SITES
+static SharedProfile *shared = NULL;
+static int shared_owner = 0;    // Proces założył wspólny profil i wypisuje jego raport
+static __thread int held_depth = 0;  // Semafory trzymane przez wątek (wejścia zagnieżdżone)
+static int report_top = 0;
+static FILE *report_stream = NULL;
+static char report_role[32];
+static int reported = 0;
+
+static int report_size(void) {
+    const char *top = getenv(LOCKPROF_ENV);
+    return top != NULL && top[0] != '\0' ? atoi(top) : 0;
+}
+
+static SharedProfile *attach_shared(int shm_id) {
+    void *addr = shmat(shm_id, NULL, 0);
+    return addr == (void *)-1 ? NULL : (SharedProfile *)addr;
+}
+
+int lockprof_create_shared(void) {
+    if (report_size() < 1 || shared != NULL) {
+        return 0;
+    }
+    int shm_id = shmget(ipc_key(IPC_LOCKPROF), sizeof(SharedProfile), IPC_CREAT | 0600);
+    if (shm_id == -1 || (shared = attach_shared(shm_id)) == NULL) {
+        return -1;
+    }
+    memset(shared, 0, sizeof(SharedProfile));
+    shared_owner = 1;
+    return 0;
+}
+
+void lockprof_init(const char *role, FILE *report) {
+    if (lockprof_enabled) {
+        return;
+    }
+    report_top = report_size();
+    if (report_top < 1) {
+        return;
+    }
+    report_stream = report;
+    snprintf(report_role, sizeof(report_role), "%s", role);
+    if (report == NULL && shared == NULL) {
+        int shm_id = shmget(ipc_key(IPC_LOCKPROF), sizeof(SharedProfile), 0);
+        shared = shm_id != -1 ? attach_shared(shm_id) : NULL;
+    }
+    if (shared != NULL) {
+        __atomic_add_fetch(&shared->processes, 1, __ATOMIC_RELAXED);
+    }
+    lockprof_enabled = 1;
+    if (shared == NULL || shared_owner) {
+        atexit(lockprof_report);
+    }
+}
+
+int lockprof_holding(void) {
+    return held_depth > 0;
+}
+
+static int bucket_of(unsigned long long ns) {
+    int bucket = ns > 1 ? 63 - __builtin_clzll(ns) : 0;
+    return bucket < LOCKPROF_BUCKETS ? bucket : LOCKPROF_BUCKETS - 1;
+}
+
+static void update_max(unsigned long long *max, unsigned long long value) {
+    unsigned long long seen = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (value > seen && !__atomic_compare_exchange_n(max, &seen, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Liczniki wspólnego profilu dla nazw miejsca (raz na miejsce w procesie)
+static LockStats *shared_stats(const char *lock, const char *site) {
+    int count = __atomic_load_n(&shared->site_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count && i < LOCKPROF_SHARED_SITES; i++) {
+        SharedSite *entry = &shared->sites[i];
+        if (__atomic_load_n(&entry->ready, __ATOMIC_ACQUIRE) && strcmp(entry->site, site) == 0 &&
+            strcmp(entry->lock, lock) == 0) {
+            return &entry->stats;
+        }
+    }
+    int index = __atomic_fetch_add(&shared->site_count, 1, __ATOMIC_ACQ_REL);
+    if (index >= LOCKPROF_SHARED_SITES) {
+        return &shared->overflow;
+    }
+    SharedSite *entry = &shared->sites[index];
+    snprintf(entry->lock, sizeof(entry->lock), "%s", lock);
+    snprintf(entry->site, sizeof(entry->site), "%s", site);
+    __atomic_store_n(&entry->ready, 1, __ATOMIC_RELEASE);
+    return &entry->stats;
+}
+
+// Miejsca są rozpoznawane po wskaźnikach do stałych napisów - bez porównywania tekstu
+static LockStats *find_site(const char *lock, const char *site) {
+    int count = __atomic_load_n(&site_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
+        if (sites[i].site == site && sites[i].lock == lock) {
+            return sites[i].stats;
+        }
+    }
+
+    while (__atomic_exchange_n(&sites_busy, 1, __ATOMIC_ACQUIRE)) {
+    }
+    LockStats *found = NULL;
+    for (int i = 0; i < site_count; i++) {
+        if (sites[i].site == site && sites[i].lock == lock) {
+            found = sites[i].stats;
+        }
+    }
+    if (found == NULL && site_count < LOCKPROF_MAX_SITES) {
+        LockSite *added = &sites[site_count];
+        added->lock = lock;
+        added->site = site;
+        added->stats = shared != NULL ? shared_stats(lock, site) : &added->local;
+        found = added->stats;
+        __atomic_store_n(&site_count, site_count + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&sites_busy, 0, __ATOMIC_RELEASE);
+    if (found == NULL) {
+        found = shared != NULL ? &shared->overflow : &overflow;
+    }
+    return found;
+}
+
+LockHold lockprof_acquired_at(const char *lock, const char *site, long long wait_start_ns) {
+    LockHold hold = {find_site(lock, site), monotonic_ns()};
+    held_depth++;
+    unsigned long long wait_ns = (unsigned long long)(hold.acquired_ns - wait_start_ns);
+    __atomic_add_fetch(&hold.stats->count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hold.stats->wait_total_ns, wait_ns, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hold.stats->wait_hist[bucket_of(wait_ns)], 1, __ATOMIC_RELAXED);
+    update_max(&hold.stats->wait_max_ns, wait_ns);
+    return hold;
+}
+
+void lockprof_released_at(const LockHold *hold) {
+    held_depth--;
+    unsigned long long hold_ns = (unsigned long long)(monotonic_ns() - hold->acquired_ns);
+    __atomic_add_fetch(&hold->stats->hold_total_ns, hold_ns, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hold->stats->hold_hist[bucket_of(hold_ns)], 1, __ATOMIC_RELAXED);
+    update_max(&hold->stats->hold_max_ns, hold_ns);
+}
+
+static void report_line(const char *format, ...) {
+    char line[1024];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (report_stream != NULL) {
+        fprintf(report_stream, "%s\n", line);
+    } else {
+        log_message("%s", line);
+    }
+}
+
+// Górna granica przedziału, w którym leży percentyl (histogram nie zna dokładnych wartości)
+static unsigned long long percentile_bound(const unsigned long long *hist, unsigned long long count, int percent) {
+    unsigned long long target = (count * (unsigned long long)percent + 99) / 100;
+    unsigned long long seen = 0;
+    for (int i = 0; i < LOCKPROF_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen >= target) {
+            return 2ULL << i;
+        }
+    }
+    return 2ULL << (LOCKPROF_BUCKETS - 1);
+}
+
+static void format_us(char *out, size_t size, double ns) {
+    if (ns < 1e3) {
+        snprintf(out, size, "%.0f ns", ns);
+    } else if (ns < 1e6) {
+        snprintf(out, size, "%.1f µs", ns / 1e3);
+    } else {
+        snprintf(out, size, "%.2f ms", ns / 1e6);
+    }
+}
+
+// Niezerowe przedziały histogramu: "≤1.0 µs:12 ≤2.0 µs:3 ..."
+static void format_hist(char *out, size_t size, const unsigned long long *hist) {
+    size_t used = 0;
+    out[0] = '\0';
+    for (int i = 0; i < LOCKPROF_BUCKETS && used < size; i++) {
+        if (hist[i] == 0) {
+            continue;
+        }
+        char bound[32];
+        format_us(bound, sizeof(bound), (double)(2ULL << i));
+        int n = snprintf(out + used, size - used, "%s≤%s:%llu", used > 0 ? " " : "", bound, hist[i]);
+        if (n < 0) {
+            break;
+        }
+        used += (size_t)n;
+    }
+}
+
+// Miejsce w raporcie - kopia liczników (wiersze raportu idą przez log_message(), który sam jest mierzony)
+typedef struct {
+    const char *lock;
+    const char *site;
+    LockStats stats;
+} ReportSite;
+
+static void add_stats(LockStats *total, const LockStats *stats) {
+    total->count += stats->count;
+    total->wait_total_ns += stats->wait_total_ns;
+    total->hold_total_ns += stats->hold_total_ns;
+    total->wait_max_ns = stats->wait_max_ns > total->wait_max_ns ? stats->wait_max_ns : total->wait_max_ns;
+    total->hold_max_ns = stats->hold_max_ns > total->hold_max_ns ? stats->hold_max_ns : total->hold_max_ns;
+    for (int i = 0; i < LOCKPROF_BUCKETS; i++) {
+        total->wait_hist[i] += stats->wait_hist[i];
+        total->hold_hist[i] += stats->hold_hist[i];
+    }
+}
+
+// Wspólny profil: pozycje o tych samych nazwach (rejestracja bez blokady) scalane w jedno miejsce
+static int collect_shared(ReportSite *report) {
+    int count = 0;
+    int registered = __atomic_load_n(&shared->site_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < registered && i < LOCKPROF_SHARED_SITES; i++) {
+        const SharedSite *entry = &shared->sites[i];
+        if (!__atomic_load_n(&entry->ready, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        int k = 0;
+        while (k < count && (strcmp(report[k].site, entry->site) != 0 || strcmp(report[k].lock, entry->lock) != 0)) {
+            k++;
+        }
+        if (k == count) {
+            memset(&report[count], 0, sizeof(report[count]));
+            report[count].lock = entry->lock;
+            report[count].site = entry->site;
+            count++;
+        }
+        add_stats(&report[k].stats, &entry->stats);
+    }
+    return count;
+}
+
+static int collect_local(ReportSite *report) {
+    int count = __atomic_load_n(&site_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
+        report[i].lock = sites[i].lock;
+        report[i].site = sites[i].site;
+        report[i].stats = *sites[i].stats;
+    }
+    return count;
+}
+
+static int compare_sites(const void *a, const void *b) {
+    const LockStats *x = &(*(const ReportSite *const *)a)->stats;
+    const LockStats *y = &(*(const ReportSite *const *)b)->stats;
+    unsigned long long cx = x->wait_total_ns + x->hold_total_ns;
+    unsigned long long cy = y->wait_total_ns + y->hold_total_ns;
+    return (cx < cy) - (cx > cy);
+}
+
+void lockprof_report(void) {
+    if (!lockprof_enabled || reported || (shared != NULL && !shared_owner)) {
+        return;
+    }
+    static ReportSite copies[LOCKPROF_SHARED_SITES];
+    int count = shared != NULL ? collect_shared(copies) : collect_local(copies);
+    if (count == 0) {
+        return;
+    }
+    reported = 1;
+    int n = report_top;
+
+    // Ranking po łącznym czasie czekania i trzymania - sekcje najdroższe dla całego przebiegu
+    const ReportSite *ranked[LOCKPROF_SHARED_SITES];
+    for (int i = 0; i < count; i++) {
+        ranked[i] = &copies[i];
+    }
+    qsort(ranked, (size_t)count, sizeof(ranked[0]), compare_sites);
+    if (n > count) {
+        n = count;
+    }
+
+    const char *role = report_role;
+    if (shared != NULL) {
+        role = "razem";
+        report_line("LOCKPROF razem: profil wspólny %d procesów instancji, %d miejsc wejścia do semaforów, "
+                    "raport %d najdroższych (czekanie + trzymanie)",
+                    __atomic_load_n(&shared->processes, __ATOMIC_RELAXED), count, n);
+    } else {
+        report_line("LOCKPROF %s: %d miejsc wejścia do semaforów, raport %d najdroższych (czekanie + trzymanie)",
+                    role, count, n);
+    }
+    for (int i = 0; i < n; i++) {
+        const LockStats *site = &ranked[i]->stats;
+        if (site->count == 0) {
+            continue;  // Miejsce zarejestrowane przez inny wątek w trakcie raportu
+        }
+        char wait_mean[32], wait_p99[32], wait_max[32], hold_mean[32], hold_p99[32], hold_max[32];
+        char wait_total[32], hold_total[32];
+        format_us(wait_total, sizeof(wait_total), (double)site->wait_total_ns);
+        format_us(wait_mean, sizeof(wait_mean), (double)site->wait_total_ns / site->count);
+        format_us(wait_p99, sizeof(wait_p99), (double)percentile_bound(site->wait_hist, site->count, 99));
+        format_us(wait_max, sizeof(wait_max), (double)site->wait_max_ns);
+        format_us(hold_total, sizeof(hold_total), (double)site->hold_total_ns);
+        format_us(hold_mean, sizeof(hold_mean), (double)site->hold_total_ns / site->count);
+        format_us(hold_p99, sizeof(hold_p99), (double)percentile_bound(site->hold_hist, site->count, 99));
+        format_us(hold_max, sizeof(hold_max), (double)site->hold_max_ns);
+
+        report_line("LOCKPROF %s: %d. %s @ %s: %llu wejść; czekanie %s (śr. %s, p99 ≤%s, max %s); "
+                    "trzymanie %s (śr. %s, p99 ≤%s, max %s)",
+                    role, i + 1, ranked[i]->lock, ranked[i]->site, site->count, wait_total, wait_mean, wait_p99,
+                    wait_max, hold_total, hold_mean, hold_p99, hold_max);
+
+        char hist[512];
+        format_hist(hist, sizeof(hist), site->wait_hist);
+        report_line("LOCKPROF %s:    histogram czekania: %s", role, hist);
+        format_hist(hist, sizeof(hist), site->hold_hist);
+        report_line("LOCKPROF %s:    histogram trzymania: %s", role, hist);
+    }
+    const LockStats *rest = shared != NULL ? &shared->overflow : &overflow;
+    if (rest->count > 0) {
+        report_line("LOCKPROF %s: %llu wejść w miejscach ponad limit %d zliczono łącznie jako (pozostałe miejsca)",
+                    role, rest->count, shared != NULL ? LOCKPROF_SHARED_SITES : LOCKPROF_MAX_SITES);
+    }
+}
@@ -1,24 +1,46 @@
 #include "common.h"
 #include "utils.h"
+#include "transport.h"
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include "occupancy.h"
+#include "seating.h"
+#include "checkpoint.h"
+#include "trace.h"
+#include "lockprof.h"
+#include "schedprof.h"
 
 static SharedState *shared_state = NULL;
-static int msg_queue_id = -1;
 static int sem_id = -1;
 static int running = 1;
 
-#define MAX_GROUPS 100
-static int group_to_table_type[MAX_GROUPS];
-static int group_to_table_index[MAX_GROUPS];
+// Oczekiwanie na pracę: jeden epoll nad kolejkami wejściowymi, signalfd i taktem odpytywania
+#define POLL_TICK_MS 10  // Takt dla backendów bez deskryptora kolejki (sysv, ring)
+static const int input_queues[] = {QUEUE_SEAT, QUEUE_DISHES, QUEUE_CONTROL};  // W kolejności priorytetu
+static int epoll_fd = -1;
+static int signal_fd = -1;
+static int tick_fd = -1;
+static int reservation_fd = -1;  // Timer najbliższego startu lub końca rezerwacji (czas bezwzględny)
+static long long reservation_armed_ms = -1;
 
-// Kolejka oczekujacych klientow
-#define MAX_WAITING 50
-typedef struct {
-    int group_id;
-    int group_size;
-} WaitingClient;
+static Seating seating;
+static SharedState *hall = NULL;  // Stan sali: pamięć współdzielona lub (gniazda) prywatna kopia usługi
+static SharedState private_hall;
+static int fire_announced = 0;    // Alarm rozgłoszony klientom połączonym z usługą (gniazda)
+static unsigned int reserve_seed = 0;  // Strumień losowy dla wyboru rezerwowanych stolików
+static int traced_group = 0;           // Grupa bieżącej wiadomości w odcinkach śledzenia (lock)
+static LockHold hall_hold;             // Bieżące wejście do SEM_SHARED_STATE w profilu blokad
 
-static WaitingClient waiting_queue[MAX_WAITING];
-static int waiting_count = 0;
+// Protokół potokowy: płatności usadzonych grup, których nie przyjęła pełna kolejka kasjera. Obsługa
+// nie czeka na kasjera (przekazanie bywa pod SEM_SHARED_STATE) - pętla główna ponawia wysyłkę poza
+// semaforem. Grupa ma najwyżej jedną płatność, więc wystarcza MAX_GROUPS miejsc.
+static Message payment_backlog[MAX_GROUPS];
+static int payment_backlog_count = 0;
+
+// Kolejki zapisywane w punkcie kontrolnym (pula jest lokalna dla baru)
+static const int checkpoint_queues[] = {QUEUE_SEAT, QUEUE_DISHES, QUEUE_PAYMENT, QUEUE_CONTROL,
+                                        QUEUE_SEAT_REPLY, QUEUE_PAY_REPLY};
 
 // Funkcja semaforowa wait
 static void sem_wait_op(int sem_id, int sem_num) {
@@ -45,267 +67,193 @@ static void sem_signal_op(int sem_id, int sem_num) {
     }
 }
 
-// Funkcja znajdująca wolne stoliki
-static int find_free_table(int group_size, int *table_type, int *table_index) {
-    if (group_size == 1) {
-        for (int i = 0; i < X1; i++) {
-            if (shared_state->table_1[i] == 0) {
-                *table_type = 1;
-                *table_index = i;
-                return 1;
-            }
-        }
+// Zapamiętuje chwilę usadzenia pierwszej grupy (pomiar czasu startu, wywoływane pod SEM_SHARED_STATE)
+static void note_first_seat(void) {
+    if (shared_state->first_seat_ns == 0) {
+        shared_state->first_seat_ns = monotonic_ns();
     }
-    
-    if (group_size <= 2) {
-        for (int i = 0; i < X2; i++) {
-            int occupied = shared_state->table_2[i];
-            if (occupied == -1) continue;  // Pomija zarezerwowane stoliki
-            if (occupied == 0) {
-                *table_type = 2;
-                *table_index = i;
-                return 1;
-            }
-            if (group_size == 1 && occupied == 1 && occupied + group_size <= 2) {
-                *table_type = 2;
-                *table_index = i;
-                return 1;
-            }
-        }
+}
+
+// Alarm pożarowy: flaga w pamięci współdzielonej węzła baru lub polecenie MSG_TYPE_FIRE od kierownika
+static int fire_alarm(void) {
+    return shared_state->fire_alarm || fire_announced;
+}
+
+// Przy gniazdach klienci z innych węzłów nie widzą flagi pożaru - dostają rozgłoszony komunikat
+static void announce_fire(void) {
+    if (fire_announced || transport_backend() != TRANSPORT_SOCKET) {
+        return;
     }
+    fire_announced = 1;
+
+    Message alarm;
+    memset(&alarm, 0, sizeof(alarm));
+    alarm.mtype = MSG_TYPE_FIRE;
+    log_message("OBSLUGA: Alarm pożarowy rozgłoszony do %d połączeń", transport_broadcast(&alarm));
+}
+
+// Odmowa stolika: w kolejce odpowiedzi obsługi albo (protokół potokowy) w kolejce potwierdzeń
+// płatności - płatność odrzuconej grupy nie trafia do kasjera
+static void send_reject(int reply_queue, int group_id, int group_size, int flags) {
+    Message response;
+    response.mtype = group_id;
+    response.group_id = group_id;
+    response.group_size = group_size;
+    response.table_type = 0;
+    response.table_index = -1;
     
-    int x3_limit = shared_state->effective_x3;
-    if (group_size <= 3) {
-        for (int i = 0; i < x3_limit; i++) {
-            int occupied = shared_state->table_3[i];
-            if (occupied == -1) continue;  // Pomija zarezerwowane stoliki
-            if (occupied == 0) {
-                *table_type = 3;
-                *table_index = i;
-                return 1;
-            }
-            if (occupied == group_size && occupied + group_size <= 3) {
-                *table_type = 3;
-                *table_index = i;
-                return 1;
-            }
-        }
-    }
+    transport_send(reply_queue, &response, flags);
+}
+
+// Protokół potokowy: usadzona grupa trafia od razu do kolejki kasjera, potwierdzenie płatności
+// (ze stolikiem) jest jedyną odpowiedzią dla klienta. Pełna kolejka kasjera - płatność czeka
+// w payment_backlog (za wcześniejszymi, żeby zachować kolejność).
+static int forward_payment(int group_id, int group_size, int table_type, int table_index) {
+    Message payment;
+    payment.mtype = MSG_TYPE_PAYMENT;
+    payment.group_id = group_id;
+    payment.group_size = group_size;
+    payment.table_type = table_type;
+    payment.table_index = table_index;
     
-    if (group_size <= 4) {
-        for (int i = 0; i < X4; i++) {
-            int occupied = shared_state->table_4[i];
-            if (occupied == -1) continue;  // Pomija zarezerwowane stoliki
-            if (occupied == 0) {
-                *table_type = 4;
-                *table_index = i;
-                return 1;
-            }
-            if (occupied == group_size && occupied + group_size <= 4) {
-                *table_type = 4;
-                *table_index = i;
-                return 1;
-            }
-        }
+    long long reply_start = trace_begin();
+    int sent = payment_backlog_count == 0 ? transport_send(QUEUE_PAYMENT, &payment, IPC_NOWAIT) : -1;
+    TRACE_END(TRACE_OBSLUGA_REPLY, reply_start, group_id, table_type);
+    if (sent == -1 && (payment_backlog_count > 0 || errno == EAGAIN) && payment_backlog_count < MAX_GROUPS) {
+        payment_backlog[payment_backlog_count++] = payment;
+        return 0;
     }
-    
-    return 0;
+    return sent;
 }
 
-// Funkcja alokująca stolik
-static void allocate_table(int table_type, int table_index, int group_size, int group_id) {
-    switch (table_type) {
-        case 1:
-            shared_state->table_1[table_index] = 1;
-            shared_state->table_1_groups[table_index][0] = group_id;
-            break;
-        case 2:
-            shared_state->table_2[table_index] += group_size;
-            for (int i = 0, assigned = 0; i < 2 && assigned < group_size; i++) {
-                if (shared_state->table_2_groups[table_index][i] == 0) {
-                    shared_state->table_2_groups[table_index][i] = group_id;
-                    assigned++;
-                }
-            }
-            break;
-        case 3:
-            shared_state->table_3[table_index] += group_size;
-            for (int i = 0, assigned = 0; i < 3 && assigned < group_size; i++) {
-                if (shared_state->table_3_groups[table_index][i] == 0) {
-                    shared_state->table_3_groups[table_index][i] = group_id;
-                    assigned++;
-                }
-            }
-            break;
-        case 4:
-            shared_state->table_4[table_index] += group_size;
-            for (int i = 0, assigned = 0; i < 4 && assigned < group_size; i++) {
-                if (shared_state->table_4_groups[table_index][i] == 0) {
-                    shared_state->table_4_groups[table_index][i] = group_id;
-                    assigned++;
-                }
-            }
-            break;
-        default:
-            log_message("OBSLUGA: Błąd - nieprawidłowy typ stolika: %d", table_type);
-            return;
+// Ponawia zaległe płatności protokołu potokowego (poza SEM_SHARED_STATE); zwraca liczbę pozostałych
+static int flush_payment_backlog(void) {
+    int sent = 0;
+    while (sent < payment_backlog_count && transport_send(QUEUE_PAYMENT, &payment_backlog[sent], IPC_NOWAIT) == 0) {
+        sent++;
     }
-    shared_state->total_free_seats -= group_size;
+    if (sent > 0) {
+        memmove(payment_backlog, payment_backlog + sent, (size_t)(payment_backlog_count - sent) * sizeof(Message));
+        payment_backlog_count -= sent;
+    }
+    return payment_backlog_count;
 }
 
-// Funkcja zwalniająca stolik
-static void free_table(int table_type, int table_index, int group_size, int group_id) {
-    int is_reserved = 0;
+// Funkcja wysyłająca odpowiedź do klienta usadzonego z kolejki oczekujących
+static void reply_seated_from_queue(void *ctx, const WaitingClient *client, int table_type, int table_index) {
+    (void)ctx;
+    int group_id = client->group_id;
+    int group_size = client->group_size;
+    note_first_seat();
     
-    switch (table_type) {
-        case 1:
-            if (shared_state->table_1[table_index] == -1) {
-                is_reserved = 1;  // Stolik zarezerwowany - nie zwalniaj
-                break;
-            }
-            shared_state->table_1[table_index] = 0;
-            shared_state->table_1_groups[table_index][0] = 0;
-            break;
-        case 2:
-            if (shared_state->table_2[table_index] == -1) {
-                is_reserved = 1;
-                break;
-            }
-            shared_state->table_2[table_index] -= group_size;
-            if (shared_state->table_2[table_index] < 0) {
-                shared_state->table_2[table_index] = 0;
-            }
-            for (int i = 0; i < 2; i++) {
-                if (shared_state->table_2_groups[table_index][i] == group_id) {
-                    shared_state->table_2_groups[table_index][i] = 0;
-                }
-            }
-            break;
-        case 3:
-            if (shared_state->table_3[table_index] == -1) {
-                is_reserved = 1;
-                break;
-            }
-            shared_state->table_3[table_index] -= group_size;
-            if (shared_state->table_3[table_index] < 0) {
-                shared_state->table_3[table_index] = 0;
-            }
-            for (int i = 0; i < 3; i++) {
-                if (shared_state->table_3_groups[table_index][i] == group_id) {
-                    shared_state->table_3_groups[table_index][i] = 0;
-                }
-            }
-            break;
-        case 4:
-            if (shared_state->table_4[table_index] == -1) {
-                is_reserved = 1;
-                break;
-            }
-            shared_state->table_4[table_index] -= group_size;
-            if (shared_state->table_4[table_index] < 0) {
-                shared_state->table_4[table_index] = 0;
-            }
-            for (int i = 0; i < 4; i++) {
-                if (shared_state->table_4_groups[table_index][i] == group_id) {
-                    shared_state->table_4_groups[table_index][i] = 0;
-                }
-            }
-            break;
-        default:
-            log_message("OBSLUGA: Błąd - nieprawidłowy typ stolika: %d", table_type);
-            return;
+    if (client->pipelined) {
+        if (forward_payment(group_id, group_size, table_type, table_index) == -1) {
+            log_message("OBSLUGA: Błąd przekazania płatności grupy #%d do kasjera", group_id);
+        } else {
+            log_message("OBSLUGA: Klient #%d z kolejki -> stolik %d-os.[%d] (płatność przekazana kasjerowi)",
+                       group_id, table_type, table_index);
+        }
+        return;
     }
     
-    if (!is_reserved) {
-        shared_state->total_free_seats += group_size;
+    Message response;
+    response.mtype = group_id;  // Typ odpowiedzi: group_id (własna kolejka odpowiedzi obsługi)
+    response.group_id = group_id;
+    response.group_size = group_size;
+    response.table_type = table_type;
+    response.table_index = table_index;
+    
+    long long reply_start = trace_begin();
+    int sent = transport_send(QUEUE_SEAT_REPLY, &response, 0);
+    TRACE_END(TRACE_OBSLUGA_REPLY, reply_start, group_id, table_type);
+    if (sent == -1) {
+        log_message("OBSLUGA: Błąd wysyłania do klienta #%d z kolejki", group_id);
+    } else {
+        log_message("OBSLUGA: Klient #%d z kolejki -> stolik %d-os.[%d]", 
+                   group_id, table_type, table_index);
     }
 }
 
-// Funkcja synchronizująca kolejkę oczekujących klientów z pamięcią dzieloną
-static void sync_waiting_queue_to_shared(void) {
-    shared_state->waiting_count = waiting_count;
-    for (int i = 0; i < waiting_count && i < MAX_WAITING_GROUPS; i++) {
-        shared_state->waiting_group_ids[i] = waiting_queue[i].group_id;
-        shared_state->waiting_group_sizes[i] = waiting_queue[i].group_size;
-    }
-    for (int i = waiting_count; i < MAX_WAITING_GROUPS; i++) {
-        shared_state->waiting_group_ids[i] = 0;
-        shared_state->waiting_group_sizes[i] = 0;
+// Czas zegara symulacji w ms - podstawa przedziałów rezerwacji
+static long long simulation_now_ms(void) {
+    long long start_ns = shared_state->simulation_start_ns;
+    if (start_ns == 0) {
+        return 0;
     }
+    return (monotonic_ns() - start_ns) / 1000000LL;
 }
 
-// Funkcja dodająca klienta do kolejki oczekujących
-static int add_to_waiting_queue(int group_id, int group_size) {
-    if (waiting_count >= MAX_WAITING) {
-        return 0;
+static void log_reservation(void *ctx, const TableRef *table, int event) {
+    (void)ctx;
+    if (event == RESERVATION_STARTED) {
+        log_message("OBSLUGA: Zarezerwowano stolik %d-os.[%d]", table->type, table->index);
+    } else {
+        log_message("OBSLUGA: Rezerwacja stolika %d-os.[%d] wygasła", table->type, table->index);
     }
-    waiting_queue[waiting_count].group_id = group_id;
-    waiting_queue[waiting_count].group_size = group_size;
-    waiting_count++;
-    sync_waiting_queue_to_shared();
-    return 1;
 }
 
-// Funkcja próbująca obsłużyć klientów z kolejki oczekujących
-static void try_serve_waiting_clients(void) {
-    ssize_t msg_size = sizeof(Message) - sizeof(long);
-    
-    while (waiting_count > 0) {
-        int group_id = waiting_queue[0].group_id;
-        int group_size = waiting_queue[0].group_size;
-        
-        int table_type, table_index;
-        if (find_free_table(group_size, &table_type, &table_index)) {
-            allocate_table(table_type, table_index, group_size, group_id);
-            
-            int group_idx = group_id % MAX_GROUPS;
-            group_to_table_type[group_idx] = table_type;
-            group_to_table_index[group_idx] = table_index;
-            
-            Message response;
-            response.mtype = 1000 + group_id;  // Typ odpowiedzi: 1000 + group_id
-            response.group_id = group_id;
-            response.group_size = group_size;
-            response.table_type = table_type;
-            response.table_index = table_index;
-            
-            if (msgsnd(msg_queue_id, &response, msg_size, 0) == -1) {
-                log_message("OBSLUGA: Błąd wysyłania do klienta #%d z kolejki", group_id);
-            } else {
-                log_message("OBSLUGA: Klient #%d z kolejki -> stolik %d-os.[%d]", 
-                           group_id, table_type, table_index);
-            }
-            
-            for (int j = 0; j < waiting_count - 1; j++) {
-                waiting_queue[j] = waiting_queue[j + 1];
-            }
-            waiting_count--;
-            sync_waiting_queue_to_shared();
-        } else {
-            break;
+// Ustawia timer rezerwacji na najbliższe zdarzenie indeksu (wywoływane pod SEM_SHARED_STATE)
+static void arm_reservation_timer(void) {
+    long long next_ms = seating_next_reservation_ms(&seating);
+    if (next_ms == reservation_armed_ms) {
+        return;
+    }
+
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if (next_ms >= 0) {
+        long long due_ns = shared_state->simulation_start_ns + next_ms * 1000000LL;
+        its.it_value.tv_sec = due_ns / 1000000000LL;
+        its.it_value.tv_nsec = due_ns % 1000000000LL;
+        if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) {
+            its.it_value.tv_nsec = 1;  // Zerowy czas rozbroiłby timer
         }
     }
+    if (timerfd_settime(reservation_fd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
+        log_message("OBSLUGA: Błąd timerfd_settime (rezerwacje): %s", strerror(errno));
+        return;
+    }
+    reservation_armed_ms = next_ms;
+}
+
+// Wejście do sekcji krytycznej sali: przed obsługą wiadomości rezerwacje są przesuwane do bieżącej
+// chwili, a stoliki zwolnione przez wygaśnięcie trafiają do kolejki oczekujących.
+// site - miejsce wywołania w profilu blokad (stały napis)
+static void lock_hall(const char *site) {
+    long long lock_start = trace_begin();
+    long long wait_start = lockprof_begin();
+    sem_wait_op(sem_id, SEM_SHARED_STATE);
+    hall_hold = lockprof_acquired("SEM_SHARED_STATE", site, wait_start);
+    TRACE_END(TRACE_OBSLUGA_LOCK, lock_start, traced_group, 0);
+    if (seating_advance(&seating, simulation_now_ms()) > 0 && !fire_alarm()) {
+        seating_serve_waiting(&seating, reply_seated_from_queue, NULL);
+    }
 }
 
-// Funkcja obsługująca sygnały
-static void signal_handler(int sig) {
+static void unlock_hall(void) {
+    arm_reservation_timer();
+    if (hall != shared_state) {
+        seating_mirror(hall, shared_state);  // Kopia dla wizualizacji i kontroli przebiegu
+    }
+    lockprof_released(&hall_hold);
+    sem_signal_op(sem_id, SEM_SHARED_STATE);
+}
+
+// Obsługa sygnału odebranego przez signalfd (poza procedurą obsługi sygnału - semafory są bezpieczne)
+static void handle_signal(int sig) {
     if (sig == SIGUSR1) {
-        sem_wait_op(sem_id, SEM_SHARED_STATE);
+        lock_hall("double_x3");
         
-        if (shared_state->x3_doubled == 0) {
-            shared_state->x3_doubled = 1;
-            int old_x3 = shared_state->effective_x3;
-            shared_state->effective_x3 = X3 * 2;  // Podwojenie stolików 3-osobowych
-            int new_seats = X3 * 3;
-            shared_state->total_free_seats += new_seats;
-            
+        int old_x3 = hall->effective_x3;
+        int new_seats = seating_double_x3(&seating);
+        if (new_seats > 0) {
             log_message("OBSLUGA: X3 podwojone: %d -> %d stolików (+%d miejsc)", 
-                       old_x3, shared_state->effective_x3, new_seats);
+                       old_x3, hall->effective_x3, new_seats);
         } else {
             log_message("OBSLUGA: SYGNAŁ 1 (SIGUSR1) otrzymany ponownie - operacja NIEMOŻLIWA (stoliki 3-osobowe już zostały podwojone)");
         }
         
-        sem_signal_op(sem_id, SEM_SHARED_STATE);
+        unlock_hall();
     } else if (sig == SIGUSR2) {
         // Rezerwacja obsługiwana przez MSG_TYPE_RESERVE_SEATS
     } else if (sig == SIGTERM || sig == SIGINT) {
@@ -313,13 +261,295 @@ static void signal_handler(int sig) {
     }
 }
 
+static int epoll_watch(int fd) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+// Sygnały trafiają do signalfd; kolejki z deskryptorem (mq) do epoll, pozostałe odpytuje takt timerfd
+static void setup_wait(void) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    sigaddset(&signals, SIGUSR2);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    if (sigprocmask(SIG_BLOCK, &signals, NULL) == -1) {
+        handle_error("OBSLUGA: sigprocmask failed");
+    }
+    
+    signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    reservation_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (signal_fd == -1 || epoll_fd == -1 || reservation_fd == -1 || epoll_watch(signal_fd) == -1 ||
+        epoll_watch(reservation_fd) == -1) {
+        handle_error("OBSLUGA: signalfd/timerfd/epoll failed");
+    }
+    
+    int needs_tick = 0;
+    for (size_t i = 0; i < sizeof(input_queues) / sizeof(input_queues[0]); i++) {
+        int fd = transport_poll_fd(input_queues[i]);
+        if (fd == -1) {
+            needs_tick = 1;
+        } else if (epoll_watch(fd) == -1 && errno != EEXIST) {  // Gniazda: jeden deskryptor dla wszystkich klas
+            handle_error("OBSLUGA: epoll_ctl (kolejka) failed");
+        }
+    }
+    
+    if (needs_tick) {
+        struct itimerspec its;
+        memset(&its, 0, sizeof(its));
+        its.it_value.tv_nsec = POLL_TICK_MS * 1000000L;
+        its.it_interval.tv_nsec = POLL_TICK_MS * 1000000L;
+        tick_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (tick_fd == -1 || timerfd_settime(tick_fd, 0, &its, NULL) == -1 || epoll_watch(tick_fd) == -1) {
+            handle_error("OBSLUGA: timerfd failed");
+        }
+    }
+}
+
+// Czeka na zdarzenie (timeout_ms = -1: aż do pracy lub sygnału, 0: tylko odbiór zaległych sygnałów)
+static void wait_for_work(int timeout_ms) {
+    struct epoll_event events[8];
+    int n = epoll_wait(epoll_fd, events, 8, timeout_ms);
+    for (int i = 0; i < n; i++) {
+        if (events[i].data.fd == signal_fd) {
+            struct signalfd_siginfo info;
+            while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                handle_signal((int)info.ssi_signo);
+            }
+        } else if (events[i].data.fd == tick_fd) {
+            uint64_t expirations;
+            if (read(tick_fd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) {
+                log_message("OBSLUGA: Błąd odczytu timerfd: %s", strerror(errno));
+            }
+        } else if (events[i].data.fd == reservation_fd) {
+            uint64_t expirations;
+            if (read(reservation_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                reservation_armed_ms = -1;  // Jednorazowy timer - po odczycie rozbrojony
+                lock_hall("reservation_timer");
+                unlock_hall();
+            }
+        }
+        // Kolejki mq są zgłaszane poziomowo - opróżnia je pętla główna
+    }
+}
+
+static int seated_groups(void) {
+    int count = 0;
+    for (int i = 0; i < MAX_GROUPS; i++) {
+        count += seating.seated[i].group_id != GROUP_SLOT_FREE;
+    }
+    return count;
+}
+
+// Dopisuje wiadomość do obrazu kolejek (rezerwa miejsca przed zdjęciem wiadomości - patrz snapshot_queue())
+static int pending_reserve(CheckpointMessage **pending, int count, int *capacity) {
+    if (count < *capacity) {
+        return 0;
+    }
+    int new_capacity = *capacity > 0 ? *capacity * 2 : 256;
+    CheckpointMessage *grown = realloc(*pending, (size_t)new_capacity * sizeof(CheckpointMessage));
+    if (grown == NULL) {
+        return -1;  // Reszta kolejki zostaje na miejscu - punkt będzie niepełny
+    }
+    *pending = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+// Obraz jednej kolejki. Podgląd (transport_peek()) nie rusza kolejki; backend bez podglądu (mq,
+// sysv bez MSG_COPY) jest opróżniany - zwraca liczbę zdjętych wiadomości, które trzeba odłożyć.
+// Przy wstrzymanych nadawcach i odbiorcach odłożenie zachowuje kolejność.
+static int snapshot_queue(int queue, CheckpointMessage **pending, int *count, int *capacity, int *skipped) {
+    int index = 0;
+    while (pending_reserve(pending, *count, capacity) == 0 &&
+           transport_peek(queue, index, &(*pending)[*count].msg) == 0) {
+        (*pending)[(*count)++].queue = queue;
+        index++;
+    }
+    if (index > 0 || errno != ENOSYS) {
+        return 0;
+    }
+    if (transport_backend() == TRANSPORT_MQ && (queue == QUEUE_SEAT_REPLY || queue == QUEUE_PAY_REPLY)) {
+        (*skipped)++;  // Kolejki odpowiedzi mq należą do grup (osobna kolejka na grupę)
+        return 0;
+    }
+    int drained = 0;
+    while (pending_reserve(pending, *count, capacity) == 0 &&
+           transport_receive(queue, &(*pending)[*count].msg, 0, IPC_NOWAIT) != -1) {
+        (*pending)[(*count)++].queue = queue;
+        drained++;
+    }
+    return drained;
+}
+
+// Punkt kontrolny: kierownik wstrzymał przybycia, klientów i kasjera (SIGSTOP), a pod SEM_SHARED_STATE
+// sala i mapa grup stoją w miejscu. Obraz obejmuje kolejki żądań i odpowiedzi, płatność w toku
+// kasjera (na początku kolejki płatności - po przywróceniu kasjer obsłuży ją od nowa) i zaległe
+// płatności protokołu potokowego (za kolejką płatności).
+static void write_checkpoint(void) {
+    if (transport_backend() == TRANSPORT_SOCKET) {
+        log_message("OBSLUGA: Punkt kontrolny niedostępny dla transportu socket (klienci na innych węzłach)");
+        __atomic_add_fetch(&shared_state->checkpoint_seq, 1, __ATOMIC_SEQ_CST);
+        return;
+    }
+
+    lock_hall("checkpoint");
+    long long begin_ns = monotonic_ns();
+
+    CheckpointMessage *pending = NULL;
+    int count = 0;
+    int capacity = 0;
+    int drained_start[QUEUE_COUNT] = {0};
+    int drained[QUEUE_COUNT] = {0};
+    int skipped = 0;
+    int cashier_recorded = 0;
+    int cashier_group = __atomic_load_n(&shared_state->cashier_group_id, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&shared_state->cashier_updating, __ATOMIC_SEQ_CST)) {
+        log_message("OBSLUGA: Kasjer w trakcie zmiany płatności - płatność w toku może nie trafić do punktu");
+    }
+    for (size_t q = 0; q < sizeof(checkpoint_queues) / sizeof(checkpoint_queues[0]); q++) {
+        int queue = checkpoint_queues[q];
+        if (queue == QUEUE_PAYMENT && cashier_group != 0 && pending_reserve(&pending, count, &capacity) == 0) {
+            CheckpointMessage *payment = &pending[count++];
+            payment->queue = QUEUE_PAYMENT;
+            payment->msg.mtype = MSG_TYPE_PAYMENT;
+            payment->msg.group_id = cashier_group;
+            payment->msg.group_size = shared_state->cashier_group_size;
+            payment->msg.table_type = shared_state->cashier_table_type;
+            payment->msg.table_index = shared_state->cashier_table_index;
+            cashier_recorded = 1;
+        }
+        drained_start[queue] = count;
+        drained[queue] = snapshot_queue(queue, &pending, &count, &capacity, &skipped);
+        for (int i = 0; queue == QUEUE_PAYMENT && i < payment_backlog_count; i++) {
+            if (pending_reserve(&pending, count, &capacity) == 0) {
+                pending[count].queue = QUEUE_PAYMENT;  // Płatności potokowe czekające na miejsce w kolejce
+                pending[count++].msg = payment_backlog[i];
+            }
+        }
+    }
+
+    const char *path = checkpoint_path();
+    long bytes = checkpoint_write(path, hall, &seating, seating.now_ms, pending, count);
+    int write_errno = errno;
+
+    int lost = 0;
+    for (int queue = 0; queue < QUEUE_COUNT; queue++) {
+        for (int i = drained_start[queue]; i < drained_start[queue] + drained[queue]; i++) {
+            if (transport_send(queue, &pending[i].msg, IPC_NOWAIT) == -1) {
+                lost++;
+            }
+        }
+    }
+    free(pending);
+
+    int groups = seated_groups();
+    int waiting = seating.waiting_count;
+    long long now_ms = seating.now_ms;
+    unlock_hall();
+    __atomic_add_fetch(&shared_state->checkpoint_seq, 1, __ATOMIC_SEQ_CST);  // Kierownik wznawia role
+
+    if (bytes == -1) {
+        log_message("OBSLUGA: Błąd zapisu punktu kontrolnego %s: %s", path, strerror(write_errno));
+    } else {
+        log_message("OBSLUGA: Punkt kontrolny @%lld ms -> %s: %d grup przy stolikach, %d w kolejce, "
+                   "%d wiadomości z kolejek, płatność u kasjera: %s (%ld B, %.3f ms)", now_ms, path, groups,
+                   waiting, count - cashier_recorded, cashier_recorded ? "tak" : "nie", bytes,
+                   (monotonic_ns() - begin_ns) / 1e6);
+    }
+    if (skipped > 0) {
+        log_message("OBSLUGA: Kolejki odpowiedzi transportu mq nie trafiają do punktu kontrolnego");
+    }
+    if (lost > 0) {
+        log_message("OBSLUGA: %d wiadomości nie wróciło do kolejek po punkcie kontrolnym", lost);
+    }
+}
+
+// Przywrócenie: stan usadzania kopiowany wprost z mapowanego pliku (bar odtworzył już salę
+// w pamięci współdzielonej). Grupy są wypisywane do logu, żeby barcheck znał stan początkowy.
+static void restore_checkpoint(const char *path) {
+    size_t size = 0;
+    const CheckpointFile *checkpoint = checkpoint_map(path, &size);
+    if (checkpoint == NULL) {
+        log_message("OBSLUGA: Nie można przywrócić punktu kontrolnego %s: %s", path, strerror(errno));
+        handle_error("OBSLUGA: checkpoint_map failed");
+    }
+
+    memcpy(&seating, &checkpoint->seating, sizeof(Seating));
+    seating.state = hall;
+    for (int i = 0; i < seating.waiting_count; i++) {
+        seating.waiting_queue[i].pipelined = 0;  // Wznowione grupy czekają na stolik w zwykłym protokole
+    }
+    seating_mirror(&checkpoint->hall, hall);
+
+    if (hall->x3_doubled) {
+        log_message("OBSLUGA: Przywrócone podwojenie X3 (%d stolików 3-os.)", hall->effective_x3);
+    }
+    int reserved = 0;
+    for (int type = 1; type <= 4; type++) {
+        int count = type == 1 ? X1 : type == 2 ? X2 : type == 3 ? hall->effective_x3 : X4;
+        const int *tables = type == 1 ? hall->table_1 : type == 2 ? hall->table_2 : type == 3 ? hall->table_3
+                                                                                               : hall->table_4;
+        for (int i = 0; i < count; i++) {
+            if (tables[i] == -1) {
+                log_message("OBSLUGA: Przywrócona rezerwacja stolika %d-os.[%d]", type, i);
+                reserved++;
+            }
+        }
+    }
+    for (int i = 0; i < MAX_GROUPS; i++) {
+        const SeatedGroup *group = &seating.seated[i];
+        if (group->group_id != GROUP_SLOT_FREE) {
+            log_message("OBSLUGA: Przywrócona grupa #%d (%d os.) przy stoliku %d-os.[%d]", group->group_id,
+                       checkpoint_group_size(hall, group->group_id), group->table_type, group->table_index);
+        }
+    }
+    for (int i = 0; i < seating.waiting_count; i++) {
+        log_message("OBSLUGA: Przywrócona grupa #%d (%d os.) w kolejce (pozycja %d)",
+                   seating.waiting_queue[i].group_id, seating.waiting_queue[i].group_size, i + 1);
+    }
+    log_message("OBSLUGA: Sala przywrócona z %s (@%lld ms): %d grup przy stolikach, %d w kolejce, %d rezerwacji",
+               path, checkpoint->sim_ms, seated_groups(), seating.waiting_count, reserved);
+
+    checkpoint_unmap(checkpoint, size);
+}
+
+// Przydział stolika dla żądania (pod SEM_SHARED_STATE)
+static int allocate_table(const Message *msg, int *table_type, int *table_index) {
+    long long allocate_start = trace_begin();
+    int seated = seating_seat_group(&seating, msg->group_id, msg->group_size, table_type, table_index);
+    TRACE_END(TRACE_OBSLUGA_ALLOCATE, allocate_start, msg->group_id, seated);
+    return seated;
+}
+
+// Pierwsza wiadomość z kolejek wejściowych w kolejności priorytetu (bez czekania)
+static ssize_t receive_request(Message *msg) {
+    ssize_t received = -1;
+    for (size_t i = 0; i < sizeof(input_queues) / sizeof(input_queues[0]); i++) {
+        received = transport_receive(input_queues[i], msg, 0, IPC_NOWAIT);
+        if (received != -1 || (errno != ENOMSG && errno != EAGAIN)) {
+            break;
+        }
+    }
+    return received;
+}
+
 int main(void) {
+    trace_init("obsluga");
+    lockprof_init("obsluga", NULL);
+    schedprof_init("obsluga", SCHEDPROF_SLOT_OBSLUGA);
     log_message("OBSLUGA: Start pracy obsługi");
     
-    signal(SIGUSR1, signal_handler);
-    signal(SIGUSR2, signal_handler);
-    signal(SIGTERM, signal_handler);
-    signal(SIGINT, signal_handler);
+    // Usługa gniazd nasłuchuje przed setup_wait() - jej deskryptor trafia do epoll
+    if (transport_listen(SOCKET_SEATING) == -1) {
+        handle_error("OBSLUGA: transport_listen failed");
+    }
+    setup_wait();
     
     // Pobranie pamięci dzielonej
     shared_state = get_shared_memory();
@@ -327,10 +557,14 @@ int main(void) {
         handle_error("OBSLUGA: get_shared_memory failed");
     }
     
-    // Pobranie kolejki komunikatów
-    msg_queue_id = get_message_queue();
-    if (msg_queue_id == -1) {
-        handle_error("OBSLUGA: get_message_queue failed");
+    // Pobranie kolejek: wejściowe (miejsca, naczynia, polecenia kierownika) i odpowiedzi do klientów
+    if (transport_backend() == TRANSPORT_SYSV) {
+        get_message_queue(QUEUE_SEAT);
+        get_message_queue(QUEUE_DISHES);
+        get_message_queue(QUEUE_CONTROL);
+        get_message_queue(QUEUE_SEAT_REPLY);
+        get_message_queue(QUEUE_PAYMENT);     // Protokół potokowy: płatności usadzonych grup
+        get_message_queue(QUEUE_PAY_REPLY);   // i odmowy dla nich
     }
     
     // Pobranie semaforów
@@ -339,219 +573,190 @@ int main(void) {
         handle_error("OBSLUGA: get_semaphores failed");
     }
 
+    log_message("OBSLUGA: Statystyki obłożenia: implementacja %s", occupancy_backend());
+    log_message("OBSLUGA: Alokator stolików: %s", seating_allocator());
+    log_message("OBSLUGA: Transport wiadomości: %s", transport_name(transport_backend()));
+    if (transport_backend() == TRANSPORT_SOCKET) {
+        log_message("OBSLUGA: Usługa pod adresem %s", transport_address(SOCKET_SEATING));
+    }
+
     Message msg;
-    ssize_t msg_size = sizeof(Message) - sizeof(long);
 
-    // Inicjalizacja tablicy grup do stolików
-    for (int i = 0; i < MAX_GROUPS; i++) {
-        group_to_table_type[i] = 0;
-        group_to_table_index[i] = -1;
+    // Inicjalizacja tablicy grup do stolików; przy gniazdach stan sali należy wyłącznie do usługi.
+    // Stan przywrócony z punktu kontrolnego trafia do logu przed zgłoszeniem gotowości - przed
+    // pierwszym komunikatem wznowionych klientów
+    hall = shared_state;
+    if (transport_backend() == TRANSPORT_SOCKET) {
+        seating_init_hall(&private_hall);
+        hall = &private_hall;
+    }
+    const char *restore = getenv(RESTORE_ENV);
+    if (restore != NULL && restore[0] != '\0') {
+        restore_checkpoint(restore);
+    } else {
+        seating_init(&seating, hall);
     }
+    seating_set_reservation_callback(&seating, log_reservation, NULL);
+    reserve_seed = (unsigned int)time(NULL) ^ (unsigned int)getpid();
+
+    role_signal_ready();
     
-    // Główna pętla obsługi klientów
+    // Główna pętla obsługi klientów: po obsłużonej wiadomości tylko odbiór sygnałów (bez czekania),
+    // przy pustych kolejkach sen w epoll do nadejścia pracy lub sygnału
+    int idle = 0;
     while (running) {
-        ssize_t received = -1;
-        
-        received = msgrcv(msg_queue_id, &msg, msg_size, MSG_TYPE_SEAT_REQUEST, IPC_NOWAIT);  // Żądanie rezerwacji stolika
-        
-        if (received == -1 && (errno == ENOMSG || errno == EAGAIN)) {
-            received = msgrcv(msg_queue_id, &msg, msg_size, MSG_TYPE_DISHES, IPC_NOWAIT);  // Oddanie naczyń
-        }
-        
-        if (received == -1 && (errno == ENOMSG || errno == EAGAIN)) {
-            received = msgrcv(msg_queue_id, &msg, msg_size, MSG_TYPE_RESERVE_SEATS, IPC_NOWAIT);  // Rezerwacja przez kierownika
+        // Zaległe płatności potokowe: sen najwyżej do następnej próby
+        int backlog = flush_payment_backlog();
+        if (idle) {
+            transport_flush();  // Odpowiedzi zebrane w ramkach wychodzą przed snem
         }
+        wait_for_work(idle ? (backlog > 0 ? POLL_TICK_MS : -1) : 0);
+        if (!running) break;
         
+        // Każda klasa ma własną kolejkę - odbiór bierze pierwszą wiadomość bez przeszukiwania innych typów
+        long long dequeue_start = trace_begin();
+        ssize_t received = receive_request(&msg);
+        idle = (received == -1);
         if (received == -1) {
-            if (errno == ENOMSG || errno == EAGAIN) {
-                usleep(10000);
-                continue;
-            }
-            if (errno == EINTR) {
-                if (!running) break;
-                continue;
-            } else {
-                if (!running) break;
-                continue;
+            if (errno != ENOMSG && errno != EAGAIN && errno != EINTR) {
+                log_message("OBSLUGA: Błąd odbioru: %s", strerror(errno));
             }
+            continue;
         }
+        traced_group = msg.group_id;
+        TRACE_END(TRACE_OBSLUGA_DEQUEUE, dequeue_start, msg.group_id, (int)msg.mtype);
         
-        // Obsługa żądań rezerwacji stolika
-        if (msg.mtype == MSG_TYPE_SEAT_REQUEST) {
-            sem_wait_op(sem_id, SEM_SHARED_STATE);
+        // Obsługa żądań rezerwacji stolika (w protokole potokowym razem z płatnością)
+        if (msg.mtype == MSG_TYPE_SEAT_REQUEST || msg.mtype == MSG_TYPE_SEAT_AND_PAY) {
+            int pipelined = (msg.mtype == MSG_TYPE_SEAT_AND_PAY);
+            int reply_queue = pipelined ? QUEUE_PAY_REPLY : QUEUE_SEAT_REPLY;
+            lock_hall("seat_request");
             
             int table_type, table_index;
-            if (find_free_table(msg.group_size, &table_type, &table_index)) {
-                allocate_table(table_type, table_index, msg.group_size, msg.group_id);
-                
-                int group_idx = msg.group_id % MAX_GROUPS;
-                group_to_table_type[group_idx] = table_type;
-                group_to_table_index[group_idx] = table_index;
+            if (fire_alarm()) {
+                // Po ogłoszeniu pożaru nikt nie jest już usadzany
+                unlock_hall();
+                send_reject(reply_queue, msg.group_id, msg.group_size, 0);
+            } else if (allocate_table(&msg, &table_type, &table_index)) {
+                note_first_seat();
+                unlock_hall();
                 
-                sem_signal_op(sem_id, SEM_SHARED_STATE);
-                
-                Message response;
-                response.mtype = 1000 + msg.group_id;  // Typ odpowiedzi: 1000 + group_id
-                response.group_id = msg.group_id;
-                response.group_size = msg.group_size;
-                response.table_type = table_type;
-                response.table_index = table_index;
-                
-                if (msgsnd(msg_queue_id, &response, msg_size, 0) == -1) {
+                int sent;
+                if (pipelined) {
+                    sent = forward_payment(msg.group_id, msg.group_size, table_type, table_index);
+                } else {
+                    Message response;
+                    response.mtype = msg.group_id;  // Typ odpowiedzi: group_id
+                    response.group_id = msg.group_id;
+                    response.group_size = msg.group_size;
+                    response.table_type = table_type;
+                    response.table_index = table_index;
+                    
+                    long long reply_start = trace_begin();
+                    sent = transport_send(QUEUE_SEAT_REPLY, &response, 0);
+                    TRACE_END(TRACE_OBSLUGA_REPLY, reply_start, msg.group_id, table_type);
+                }
+                if (sent == -1) {
                     log_message("OBSLUGA: Błąd wysyłania odpowiedzi do #%d", msg.group_id);
                 }
                 
-                log_message("OBSLUGA: Stolik %d-os.[%d] -> grupa #%d", 
-                           table_type, table_index, msg.group_id);
+                log_message("OBSLUGA: Stolik %d-os.[%d] -> grupa #%d (%d os.%s)", 
+                           table_type, table_index, msg.group_id, msg.group_size,
+                           pipelined ? ", płatność przekazana kasjerowi" : "");
             } else {
-                if (add_to_waiting_queue(msg.group_id, msg.group_size)) {
+                if (seating_enqueue(&seating, msg.group_id, msg.group_size, pipelined)) {
                     log_message("OBSLUGA: Grupa #%d (%d os.) czeka w kolejce (pozycja %d)", 
-                               msg.group_id, msg.group_size, waiting_count);
+                               msg.group_id, msg.group_size, seating.waiting_count);
                 } else {
-                    Message response;
-                    response.mtype = 1000 + msg.group_id;
-                    response.group_id = msg.group_id;
-                    response.group_size = msg.group_size;
-                    response.table_type = 0;
-                    response.table_index = -1;
-                    
-                    msgsnd(msg_queue_id, &response, msg_size, 0);
+                    send_reject(reply_queue, msg.group_id, msg.group_size, 0);
                     log_message("OBSLUGA: Kolejka pełna - grupa #%d odrzucona", msg.group_id);
                 }
                 
-                sem_signal_op(sem_id, SEM_SHARED_STATE);
+                unlock_hall();
             }
             
         } else if (msg.mtype == MSG_TYPE_DISHES) {
-            sem_wait_op(sem_id, SEM_SHARED_STATE);
-            
-            int group_idx = msg.group_id % MAX_GROUPS;
-            int table_type = group_to_table_type[group_idx];
-            int table_index = group_to_table_index[group_idx];
+            lock_hall("dishes");
             
-            if (table_type > 0 && table_index >= 0) {
-                free_table(table_type, table_index, msg.group_size, msg.group_id);
-                shared_state->dirty_dishes += msg.group_size;
-                
+            long long release_start = trace_begin();
+            int served = 0;
+            if (seating_release_group(&seating, msg.group_id, msg.group_size)) {
                 log_message("OBSLUGA: Grupa #%d zwolniła stolik (naczynia: %d)", 
-                           msg.group_id, shared_state->dirty_dishes);
-                
-                group_to_table_type[group_idx] = 0;
-                group_to_table_index[group_idx] = -1;
+                           msg.group_id, hall->dirty_dishes);
+                seating_advance(&seating, seating.now_ms);  // Stolik mógł czekać na start rezerwacji
                 
-                try_serve_waiting_clients();  // Próbuje obsłużyć klientów z kolejki
+                if (!fire_alarm()) {
+                    served = seating_serve_waiting(&seating, reply_seated_from_queue, NULL);  // Próbuje obsłużyć klientów z kolejki
+                }
             }
+            TRACE_END(TRACE_OBSLUGA_RELEASE, release_start, msg.group_id, served);
             
-            sem_signal_op(sem_id, SEM_SHARED_STATE);
+            unlock_hall();
             
         } else if (msg.mtype == MSG_TYPE_RESERVE_SEATS) {  // Rezerwacja stolików przez kierownika
             int tables_to_reserve = msg.group_size;
             
-            sem_wait_op(sem_id, SEM_SHARED_STATE);
+            lock_hall("reserve_seats");
             
-            typedef struct {
-                int type;
-                int index;
-                int seats;
-            } TableInfo;
-            
-            TableInfo free_tables[100];
-            int free_count = 0;
+            // Przedział [start, koniec) w czasie zegara symulacji; zajęcie stolika zgłasza log_reservation()
+            long long start_ms = seating.now_ms + (msg.table_type > 0 ? msg.table_type : 0);
+            long long end_ms = start_ms + (msg.table_index > 0 ? msg.table_index : RESERVATION_DEFAULT_MS);
+            TableRef reserved[TABLE_SLOTS];
+            int tables_reserved = seating_reserve_tables(&seating, tables_to_reserve, start_ms, end_ms, &reserve_seed,
+                                                         reserved, TABLE_SLOTS);
+            int seats_reserved = 0;
             
-            for (int i = 0; i < X4; i++) {
-                if (shared_state->table_4[i] == 0) {
-                    free_tables[free_count].type = 4;
-                    free_tables[free_count].index = i;
-                    free_tables[free_count].seats = 4;
-                    free_count++;
+            for (int i = 0; i < tables_reserved; i++) {
+                if (start_ms > seating.now_ms) {
+                    log_message("OBSLUGA: Rezerwacja stolika %d-os.[%d] od %lld ms", reserved[i].type,
+                               reserved[i].index, start_ms);
                 }
+                seats_reserved += reserved[i].seats;
             }
             
-            int x3_limit = shared_state->effective_x3;
-            for (int i = 0; i < x3_limit; i++) {
-                if (shared_state->table_3[i] == 0) {
-                    free_tables[free_count].type = 3;
-                    free_tables[free_count].index = i;
-                    free_tables[free_count].seats = 3;
-                    free_count++;
-                }
-            }
+            log_message("OBSLUGA: Rezerwacja kierownika: %d stolików (%d miejsc) na %lld-%lld ms", 
+                       tables_reserved, seats_reserved, start_ms, end_ms);
             
-            for (int i = 0; i < X2; i++) {
-                if (shared_state->table_2[i] == 0) {
-                    free_tables[free_count].type = 2;
-                    free_tables[free_count].index = i;
-                    free_tables[free_count].seats = 2;
-                    free_count++;
-                }
-            }
+            unlock_hall();
             
-            for (int i = 0; i < X1; i++) {
-                if (shared_state->table_1[i] == 0) {
-                    free_tables[free_count].type = 1;
-                    free_tables[free_count].index = i;
-                    free_tables[free_count].seats = 1;
-                    free_count++;
-                }
-            }
+        } else if (msg.mtype == MSG_TYPE_RELEASE_SEATS) {  // Zwolnienie rezerwacji przez kierownika
+            lock_hall("release_seats");
             
-            int tables_reserved = 0;
-            int seats_reserved = 0;
+            int tables_released = seating_release_reservations(&seating);
+            log_message("OBSLUGA: Zwolniono rezerwację %d stolików", tables_released);
             
-            // Funkcja rezerwująca stoliki
-            if (free_count > 0 && tables_to_reserve > 0) {
-                int to_reserve = (tables_to_reserve < free_count) ? tables_to_reserve : free_count;
-                
-                for (int i = 0; i < to_reserve; i++) {
-                    int j = i + (rand() % (free_count - i));
-                    
-                    TableInfo temp = free_tables[i];
-                    free_tables[i] = free_tables[j];
-                    free_tables[j] = temp;
-                    
-                    int type = free_tables[i].type;
-                    int idx = free_tables[i].index;
-                    int seats = free_tables[i].seats;
-                    
-                    switch (type) {
-                        case 1: shared_state->table_1[idx] = -1; break;  // -1 = zarezerwowany
-                        case 2: shared_state->table_2[idx] = -1; break;
-                        case 3: shared_state->table_3[idx] = -1; break;
-                        case 4: shared_state->table_4[idx] = -1; break;
-                    }
-                    
-                    tables_reserved++;
-                    seats_reserved += seats;
-                    shared_state->total_free_seats -= seats;
-                    
-                    log_message("OBSLUGA: Zarezerwowano stolik %d-os.[%d]", type, idx);
-                }
+            if (!fire_alarm()) {
+                seating_serve_waiting(&seating, reply_seated_from_queue, NULL);  // Zwolnione stoliki dla kolejki
             }
             
-            shared_state->reserved_seats = seats_reserved;
+            unlock_hall();
             
-            log_message("OBSLUGA: Rezerwacja kierownika: %d stolików (%d miejsc)", 
-                       tables_reserved, seats_reserved);
+        } else if (msg.mtype == MSG_TYPE_CHECKPOINT) {  // Punkt kontrolny na polecenie kierownika
+            write_checkpoint();
             
-            sem_signal_op(sem_id, SEM_SHARED_STATE);
+        } else if (msg.mtype == MSG_TYPE_FIRE) {  // Pożar (gniazda): klienci dostają komunikat od usługi
+            announce_fire();
         }
     }
 
+    if (fire_alarm()) {
+        announce_fire();
+    }
+
     // Wyslij odpowiedzi do czekajacych w kolejce
-    ssize_t final_msg_size = sizeof(Message) - sizeof(long);
-    for (int i = 0; i < waiting_count; i++) {
-        Message response;
-        response.mtype = 1000 + waiting_queue[i].group_id;
-        response.group_id = waiting_queue[i].group_id;
-        response.group_size = waiting_queue[i].group_size;
-        response.table_type = 0;
-        response.table_index = -1;
-        msgsnd(msg_queue_id, &response, final_msg_size, IPC_NOWAIT);
+    for (int i = 0; i < seating.waiting_count; i++) {
+        const WaitingClient *client = &seating.waiting_queue[i];
+        send_reject(client->pipelined ? QUEUE_PAY_REPLY : QUEUE_SEAT_REPLY, client->group_id, client->group_size,
+                    IPC_NOWAIT);
+    }
+    if (flush_payment_backlog() > 0) {
+        log_message("OBSLUGA: %d płatności potokowych nie trafiło do kasjera przed zamknięciem", payment_backlog_count);
     }
+    transport_flush();
 
     int is_fire = 0;
     if (shared_state != NULL) {
-        is_fire = shared_state->fire_alarm;
+        is_fire = fire_alarm();
     }
     
     if (is_fire) {
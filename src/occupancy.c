@@ -0,0 +1,321 @@
+#include "occupancy.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OCCUPANCY_X86 1
+#endif
+
+// Surowe liczniki zbierane przez wszystkie implementacje
+typedef struct {
+    int reserved;
+    int free;
+    int full;
+    int partial;
+    int joinable1;
+    int joinable2;
+    int occupied;
+    int partial_free;
+    int fragmented;
+} ScanAcc;
+
+typedef void (*ScanFunc)(const int *occ, int count, int capacity, ScanAcc *acc);
+
+// Pętla skalarna - używana samodzielnie oraz dla "ogona" tablicy w wersjach SIMD
+static void scan_scalar(const int *occ, int count, int capacity, ScanAcc *acc) {
+    for (int i = 0; i < count; i++) {
+        int o = occ[i];
+        if (o == -1) {
+            acc->reserved++;
+        } else if (o == 0) {
+            acc->free++;
+        } else if (o > 0) {
+            acc->occupied += o;
+            if (o >= capacity) {
+                acc->full++;
+            } else {
+                int usable = (2 * o <= capacity) ? o : 0;  // Może dosiąść się tylko grupa tej samej wielkości
+                acc->partial++;
+                acc->partial_free += capacity - o;
+                acc->fragmented += capacity - o - usable;
+                if (o == 1 && capacity >= 2) acc->joinable1++;
+                if (o == 2 && capacity >= 4) acc->joinable2++;
+            }
+        }
+    }
+}
+
+#ifdef OCCUPANCY_X86
+
+static int hsum_128(__m128i v) {
+    int lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+// Wersja SSE2 - 4 stoliki na iterację (SSE2 jest zawsze dostępne na x86-64)
+static void scan_sse2(const int *occ, int count, int capacity, ScanAcc *acc) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i minus1 = _mm_set1_epi32(-1);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    const __m128i cap = _mm_set1_epi32(capacity);
+    const __m128i cap_m1 = _mm_set1_epi32(capacity - 1);
+    const __m128i cap_p1 = _mm_set1_epi32(capacity + 1);
+    const __m128i j1_en = _mm_set1_epi32(capacity >= 2 ? -1 : 0);
+    const __m128i j2_en = _mm_set1_epi32(capacity >= 4 ? -1 : 0);
+
+    __m128i a_res = zero, a_free = zero, a_full = zero, a_part = zero;
+    __m128i a_j1 = zero, a_j2 = zero, a_occ = zero, a_pfree = zero, a_frag = zero;
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i o = _mm_loadu_si128((const __m128i *)(occ + i));
+        __m128i m_pos = _mm_cmpgt_epi32(o, zero);
+        __m128i m_full = _mm_and_si128(m_pos, _mm_cmpgt_epi32(o, cap_m1));
+        __m128i m_part = _mm_andnot_si128(m_full, m_pos);
+        __m128i pfree = _mm_and_si128(_mm_sub_epi32(cap, o), m_part);
+        __m128i m_join = _mm_and_si128(m_part, _mm_cmpgt_epi32(cap_p1, _mm_add_epi32(o, o)));
+        __m128i usable = _mm_and_si128(o, m_join);
+
+        // Maski mają wartość -1, więc odejmowanie zwiększa licznik o 1
+        a_res = _mm_sub_epi32(a_res, _mm_cmpeq_epi32(o, minus1));
+        a_free = _mm_sub_epi32(a_free, _mm_cmpeq_epi32(o, zero));
+        a_full = _mm_sub_epi32(a_full, m_full);
+        a_part = _mm_sub_epi32(a_part, m_part);
+        a_j1 = _mm_sub_epi32(a_j1, _mm_and_si128(_mm_cmpeq_epi32(o, one), j1_en));
+        a_j2 = _mm_sub_epi32(a_j2, _mm_and_si128(_mm_cmpeq_epi32(o, two), j2_en));
+        a_occ = _mm_add_epi32(a_occ, _mm_and_si128(o, m_pos));
+        a_pfree = _mm_add_epi32(a_pfree, pfree);
+        a_frag = _mm_add_epi32(a_frag, _mm_sub_epi32(pfree, usable));
+    }
+
+    acc->reserved += hsum_128(a_res);
+    acc->free += hsum_128(a_free);
+    acc->full += hsum_128(a_full);
+    acc->partial += hsum_128(a_part);
+    acc->joinable1 += hsum_128(a_j1);
+    acc->joinable2 += hsum_128(a_j2);
+    acc->occupied += hsum_128(a_occ);
+    acc->partial_free += hsum_128(a_pfree);
+    acc->fragmented += hsum_128(a_frag);
+
+    scan_scalar(occ + i, count - i, capacity, acc);
+}
+
+__attribute__((target("avx2")))
+static int hsum_256(__m256i v) {
+    __m128i lo = _mm256_castsi256_si128(v);
+    __m128i hi = _mm256_extracti128_si256(v, 1);
+    return hsum_128(_mm_add_epi32(lo, hi));
+}
+
+// Wersja AVX2 - 8 stolików na iterację
+__attribute__((target("avx2")))
+static void scan_avx2(const int *occ, int count, int capacity, ScanAcc *acc) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i minus1 = _mm256_set1_epi32(-1);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+    const __m256i cap = _mm256_set1_epi32(capacity);
+    const __m256i cap_m1 = _mm256_set1_epi32(capacity - 1);
+    const __m256i cap_p1 = _mm256_set1_epi32(capacity + 1);
+    const __m256i j1_en = _mm256_set1_epi32(capacity >= 2 ? -1 : 0);
+    const __m256i j2_en = _mm256_set1_epi32(capacity >= 4 ? -1 : 0);
+
+    __m256i a_res = zero, a_free = zero, a_full = zero, a_part = zero;
+    __m256i a_j1 = zero, a_j2 = zero, a_occ = zero, a_pfree = zero, a_frag = zero;
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i o = _mm256_loadu_si256((const __m256i *)(occ + i));
+        __m256i m_pos = _mm256_cmpgt_epi32(o, zero);
+        __m256i m_full = _mm256_and_si256(m_pos, _mm256_cmpgt_epi32(o, cap_m1));
+        __m256i m_part = _mm256_andnot_si256(m_full, m_pos);
+        __m256i pfree = _mm256_and_si256(_mm256_sub_epi32(cap, o), m_part);
+        __m256i m_join = _mm256_and_si256(m_part, _mm256_cmpgt_epi32(cap_p1, _mm256_add_epi32(o, o)));
+        __m256i usable = _mm256_and_si256(o, m_join);
+
+        a_res = _mm256_sub_epi32(a_res, _mm256_cmpeq_epi32(o, minus1));
+        a_free = _mm256_sub_epi32(a_free, _mm256_cmpeq_epi32(o, zero));
+        a_full = _mm256_sub_epi32(a_full, m_full);
+        a_part = _mm256_sub_epi32(a_part, m_part);
+        a_j1 = _mm256_sub_epi32(a_j1, _mm256_and_si256(_mm256_cmpeq_epi32(o, one), j1_en));
+        a_j2 = _mm256_sub_epi32(a_j2, _mm256_and_si256(_mm256_cmpeq_epi32(o, two), j2_en));
+        a_occ = _mm256_add_epi32(a_occ, _mm256_and_si256(o, m_pos));
+        a_pfree = _mm256_add_epi32(a_pfree, pfree);
+        a_frag = _mm256_add_epi32(a_frag, _mm256_sub_epi32(pfree, usable));
+    }
+
+    acc->reserved += hsum_256(a_res);
+    acc->free += hsum_256(a_free);
+    acc->full += hsum_256(a_full);
+    acc->partial += hsum_256(a_part);
+    acc->joinable1 += hsum_256(a_j1);
+    acc->joinable2 += hsum_256(a_j2);
+    acc->occupied += hsum_256(a_occ);
+    acc->partial_free += hsum_256(a_pfree);
+    acc->fragmented += hsum_256(a_frag);
+
+    scan_scalar(occ + i, count - i, capacity, acc);
+}
+
+#endif // OCCUPANCY_X86
+
+static ScanFunc scan_impl = NULL;
+static const char *scan_impl_name = "scalar";
+static int scan_impl_lanes = 1;  // Tablice krótsze niż jeden wektor idą od razu do pętli skalarnej
+
+// Wybór implementacji przy pierwszym wywołaniu (wynik jest zawsze ten sam, więc wyścig jest nieszkodliwy)
+static ScanFunc resolve_scan(void) {
+    if (scan_impl != NULL) {
+        return scan_impl;
+    }
+
+    ScanFunc impl = scan_scalar;
+    const char *name = "scalar";
+    int lanes = 1;
+#ifdef OCCUPANCY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        impl = scan_avx2;
+        name = "avx2";
+        lanes = 8;
+    } else if (__builtin_cpu_supports("sse2")) {
+        impl = scan_sse2;
+        name = "sse2";
+        lanes = 4;
+    }
+#endif
+    scan_impl_lanes = lanes;
+    scan_impl_name = name;
+    scan_impl = impl;
+    return impl;
+}
+
+static void finish_stats(const ScanAcc *acc, int count, int capacity, TableTypeStats *out) {
+    out->tables = count;
+    out->tables_free = acc->free;
+    out->tables_partial = acc->partial;
+    out->tables_full = acc->full;
+    out->tables_reserved = acc->reserved;
+    out->tables_joinable[0] = acc->joinable1;
+    out->tables_joinable[1] = acc->joinable2;
+    out->seats_occupied = acc->occupied;
+    out->seats_free = acc->free * capacity + acc->partial_free;
+    out->seats_reserved = acc->reserved * capacity;
+    out->seats_fragmented = acc->fragmented;
+}
+
+static void scan_with(ScanFunc impl, const int *occ, int count, int capacity, TableTypeStats *out) {
+    ScanAcc acc;
+    memset(&acc, 0, sizeof(acc));
+    // Bez pełnego wektora wersja SIMD płaci tylko za przygotowanie rejestrów i sumy poziome
+    // (a AVX2 dodatkowo za przełączanie stanu rejestrów) - przy X1..X4 to każda tablica sali
+    if (impl != scan_scalar && count < scan_impl_lanes) {
+        impl = scan_scalar;
+    }
+    if (count > 0) {
+        impl(occ, count, capacity, &acc);
+    }
+    finish_stats(&acc, count, capacity, out);
+}
+
+void occupancy_scan_tables(const int *occ, int count, int capacity, TableTypeStats *out) {
+    scan_with(resolve_scan(), occ, count, capacity, out);
+}
+
+void occupancy_scan_tables_scalar(const int *occ, int count, int capacity, TableTypeStats *out) {
+    scan_with(scan_scalar, occ, count, capacity, out);
+}
+
+static void add_stats(TableTypeStats *dst, const TableTypeStats *src) {
+    dst->tables += src->tables;
+    dst->tables_free += src->tables_free;
+    dst->tables_partial += src->tables_partial;
+    dst->tables_full += src->tables_full;
+    dst->tables_reserved += src->tables_reserved;
+    dst->tables_joinable[0] += src->tables_joinable[0];
+    dst->tables_joinable[1] += src->tables_joinable[1];
+    dst->seats_occupied += src->seats_occupied;
+    dst->seats_free += src->seats_free;
+    dst->seats_reserved += src->seats_reserved;
+    dst->seats_fragmented += src->seats_fragmented;
+}
+
+static void stats_with(ScanFunc impl, const SharedState *state, OccupancyStats *out) {
+    int x3_count = state->effective_x3;
+    if (x3_count < 0) x3_count = 0;
+    if (x3_count > X3_MAX) x3_count = X3_MAX;
+
+    scan_with(impl, state->table_1, X1, 1, &out->type[0]);
+    scan_with(impl, state->table_2, X2, 2, &out->type[1]);
+    scan_with(impl, state->table_3, x3_count, 3, &out->type[2]);
+    scan_with(impl, state->table_4, X4, 4, &out->type[3]);
+
+    memset(&out->total, 0, sizeof(out->total));
+    for (int t = 0; t < 4; t++) {
+        add_stats(&out->total, &out->type[t]);
+    }
+}
+
+void occupancy_stats(const SharedState *state, OccupancyStats *out) {
+    stats_with(resolve_scan(), state, out);
+}
+
+void occupancy_stats_scalar(const SharedState *state, OccupancyStats *out) {
+    stats_with(scan_scalar, state, out);
+}
+
+int occupancy_stats_verify(const SharedState *state) {
+    OccupancyStats fast, reference;
+    occupancy_stats(state, &fast);
+    occupancy_stats_scalar(state, &reference);
+    return memcmp(&fast, &reference, sizeof(OccupancyStats)) == 0;
+}
+
+// Surowe liczniki jednej implementacji dla całej tablicy (bez zastępowania krótkich tablic pętlą skalarną)
+static void scan_raw(ScanFunc impl, const int *occ, int count, int capacity, ScanAcc *acc) {
+    memset(acc, 0, sizeof(*acc));
+    if (count > 0) {
+        impl(occ, count, capacity, acc);
+    }
+}
+
+int occupancy_scan_verify(const int *occ, int count, int capacity) {
+    ScanAcc reference, acc;
+    scan_raw(scan_scalar, occ, count, capacity, &reference);
+    int mismatches = 0;
+#ifdef OCCUPANCY_X86
+    resolve_scan();  // __builtin_cpu_init()
+    scan_raw(scan_sse2, occ, count, capacity, &acc);
+    mismatches += memcmp(&acc, &reference, sizeof(ScanAcc)) != 0;
+    if (__builtin_cpu_supports("avx2")) {
+        scan_raw(scan_avx2, occ, count, capacity, &acc);
+        mismatches += memcmp(&acc, &reference, sizeof(ScanAcc)) != 0;
+    }
+#else
+    (void)acc;
+#endif
+    return mismatches;
+}
+
+int occupancy_can_seat(const OccupancyStats *stats, int group_size) {
+    if (group_size < 1 || group_size > 4) {
+        return 0;
+    }
+    for (int t = group_size; t <= 4; t++) {
+        const TableTypeStats *ts = &stats->type[t - 1];
+        if (ts->tables_free > 0) {
+            return 1;
+        }
+        if (group_size <= 2 && ts->tables_joinable[group_size - 1] > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const char *occupancy_backend(void) {
+    resolve_scan();
+    return scan_impl_name;
+}
@@ -0,0 +1,434 @@
+#include "common.h"
+#include "utils.h"
+#include "snapshot.h"
+#include "recording.h"
+#include "lockprof.h"
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+// Publikator stanu sali: próbkuje SharedState ze stałą częstotliwością (jedno zajęcie semafora
+// na próbkę, niezależnie od liczby widzów) i rozsyła klatki subskrybentom przez gniazdo Unix.
+// Wolny subskrybent nie blokuje pozostałych - pomija klatki i dostaje potem klatkę kluczową.
+// Z --record każda klatka trafia też do pierścienia nagrania (poza semaforem - koszt dla sali
+// to wciąż jedna kopia SharedState na próbkę).
+
+#define MAX_SUBSCRIBERS 256
+#define LISTEN_BACKLOG 16
+
+typedef struct Subscriber {
+    int fd;
+    uint64_t seq;          // Ostatnia klatka wysłana w całości (0 = jeszcze żadna)
+    unsigned char *out;    // Niewysłana reszta wiadomości
+    size_t out_len;
+    size_t out_sent;
+    int watching_out;      // Zarejestrowany EPOLLOUT
+    struct Subscriber *next_dropped;
+} Subscriber;
+
+static SharedState *shared_state = NULL;
+static int sem_id = -1;
+static volatile sig_atomic_t running = 1;
+
+static Subscriber *subscribers[MAX_SUBSCRIBERS];
+static int subscriber_count = 0;
+// Odłączeni w bieżącej partii zdarzeń epoll - zwalniani po jej obsłużeniu
+static Subscriber *dropped = NULL;
+
+// Dwie ostatnie próbki; delta jest kodowana raz na klatkę i wysyłana wszystkim aktualnym subskrybentom
+static SharedState frames[2];
+static int current = 0;
+static uint64_t frame_seq = 0;
+static int64_t frame_ns = 0;
+static unsigned char *delta_message = NULL;
+static size_t delta_len = 0;          // 0 = brak delty dla bieżącej klatki
+static unsigned char *key_message = NULL;
+static uint64_t key_seq = 0;          // Klatka zakodowana w key_message
+
+static unsigned long frames_published = 0;
+static unsigned long keyframes_sent = 0;
+static unsigned long frames_skipped = 0;
+
+static Recording recording;
+static int recording_on = 0;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static LockHold state_hold;  // Bieżące wejście do SEM_SHARED_STATE w profilu blokad
+
+static int sem_op_state(int op) {
+    struct sembuf sem_op;
+    sem_op.sem_num = SEM_SHARED_STATE;
+    sem_op.sem_op = op;
+    sem_op.sem_flg = 0;
+    long long wait_start = lockprof_begin();
+    if (op > 0) {
+        lockprof_released(&state_hold);
+    }
+    while (semop(sem_id, &sem_op, 1) == -1) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    if (op < 0) {
+        state_hold = lockprof_acquired("SEM_SHARED_STATE", "publisher sample", wait_start);
+    }
+    return 0;
+}
+
+static void fill_header(unsigned char *message, int kind, size_t payload_len) {
+    SnapshotHeader header;
+    header.magic = SNAPSHOT_MAGIC;
+    header.kind = (uint32_t)kind;
+    header.state_size = sizeof(SharedState);
+    header.payload_len = (uint32_t)payload_len;
+    header.seq = frame_seq;
+    header.sampled_ns = frame_ns;
+    memcpy(message, &header, sizeof(header));
+}
+
+// Klatka kluczowa bieżącego stanu - kodowana najwyżej raz na klatkę, tylko gdy ktoś jej potrzebuje
+static const unsigned char *keyframe(void) {
+    if (key_seq != frame_seq) {
+        fill_header(key_message, SNAPSHOT_KEYFRAME, sizeof(SharedState));
+        memcpy(key_message + sizeof(SnapshotHeader), &frames[current], sizeof(SharedState));
+        key_seq = frame_seq;
+    }
+    return key_message;
+}
+
+// Pobiera nową próbkę; zwraca 1 gdy stan się zmienił, 0 bez zmian, -1 gdy pamięć usunięto
+static int sample(void) {
+    int next = 1 - current;
+    if (sem_op_state(-1) == -1) {
+        return -1;
+    }
+    memcpy(&frames[next], shared_state, sizeof(SharedState));
+    sem_op_state(1);
+
+    if (frame_seq > 0 && memcmp(&frames[next], &frames[current], sizeof(SharedState)) == 0) {
+        return 0;  // Bez zmian - bez nowej klatki (numeracja musi pozostać ciągła dla delt)
+    }
+
+    long payload = frame_seq > 0
+        ? snapshot_encode_delta(&frames[current], &frames[next], delta_message + sizeof(SnapshotHeader))
+        : -1;
+    current = next;
+    frame_seq++;
+    frame_ns = monotonic_ns();
+    if (payload > 0) {
+        fill_header(delta_message, SNAPSHOT_DELTA, (size_t)payload);
+        delta_len = sizeof(SnapshotHeader) + (size_t)payload;
+    } else {
+        delta_len = 0;  // Zmiana zbyt duża na deltę - wszyscy dostaną klatkę kluczową
+    }
+    frames_published++;
+    return 1;
+}
+
+static void watch_out(int epoll_fd, Subscriber *sub, int enable) {
+    if (sub->watching_out == enable) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | (enable ? EPOLLOUT : 0);
+    ev.data.ptr = sub;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, sub->fd, &ev);
+    sub->watching_out = enable;
+}
+
+static void drop_subscriber(int epoll_fd, Subscriber *sub) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sub->fd, NULL);
+    close(sub->fd);
+    sub->fd = -1;
+    for (int i = 0; i < subscriber_count; i++) {
+        if (subscribers[i] == sub) {
+            subscribers[i] = subscribers[--subscriber_count];
+            break;
+        }
+    }
+    sub->next_dropped = dropped;
+    dropped = sub;
+}
+
+static void free_dropped(void) {
+    while (dropped != NULL) {
+        Subscriber *sub = dropped;
+        dropped = sub->next_dropped;
+        free(sub->out);
+        free(sub);
+    }
+}
+
+// Wysyła niewysłaną resztę; zwraca -1 gdy subskrybent się rozłączył
+static int flush_subscriber(int epoll_fd, Subscriber *sub) {
+    while (sub->out_sent < sub->out_len) {
+        ssize_t n = send(sub->fd, sub->out + sub->out_sent, sub->out_len - sub->out_sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) {
+                watch_out(epoll_fd, sub, 1);
+                return 0;
+            }
+            return -1;
+        }
+        sub->out_sent += (size_t)n;
+    }
+    sub->out_len = 0;
+    sub->out_sent = 0;
+    watch_out(epoll_fd, sub, 0);
+    return 0;
+}
+
+// Kolejkuje bieżącą klatkę: deltę, jeśli subskrybent ma poprzednią, w przeciwnym razie klatkę kluczową
+static int publish_to(int epoll_fd, Subscriber *sub) {
+    if (sub->out_len > 0) {
+        frames_skipped++;  // Poprzednia klatka jeszcze w drodze - ta zostaje pominięta
+        return 0;
+    }
+    const unsigned char *message;
+    size_t len;
+    if (delta_len > 0 && sub->seq == frame_seq - 1) {
+        message = delta_message;
+        len = delta_len;
+    } else {
+        message = keyframe();
+        len = sizeof(SnapshotHeader) + sizeof(SharedState);
+        keyframes_sent++;
+    }
+    memcpy(sub->out, message, len);
+    sub->out_len = len;
+    sub->out_sent = 0;
+    sub->seq = frame_seq;
+    return flush_subscriber(epoll_fd, sub);
+}
+
+static void accept_subscribers(int epoll_fd, int listen_fd) {
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno != EAGAIN && errno != EINTR) {
+                perror("PUBLISHER: accept4 failed");
+            }
+            return;
+        }
+        if (subscriber_count >= MAX_SUBSCRIBERS) {
+            close(fd);
+            continue;
+        }
+
+        Subscriber *sub = calloc(1, sizeof(Subscriber));
+        if (sub != NULL) {
+            sub->out = malloc(sizeof(SnapshotHeader) + sizeof(SharedState));
+        }
+        if (sub == NULL || sub->out == NULL) {
+            free(sub);
+            close(fd);
+            continue;
+        }
+        sub->fd = fd;
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = sub;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            free(sub->out);
+            free(sub);
+            close(fd);
+            continue;
+        }
+        subscribers[subscriber_count++] = sub;
+
+        // Nowy widz od razu dostaje bieżący stan, nie czeka na zmianę
+        if (frame_seq > 0 && publish_to(epoll_fd, sub) == -1) {
+            drop_subscriber(epoll_fd, sub);
+        }
+    }
+}
+
+// Zdarzenie na gnieździe subskrybenta: rozłączenie lub możliwość dosłania klatki
+static void handle_subscriber(int epoll_fd, Subscriber *sub, unsigned int events) {
+    if (sub->fd == -1) {
+        return;  // Odłączony wcześniej w tej samej partii zdarzeń
+    }
+    if (events & EPOLLIN) {
+        char discard[256];
+        ssize_t n = recv(sub->fd, discard, sizeof(discard), MSG_DONTWAIT);
+        if (n == 0 || (n == -1 && errno != EAGAIN && errno != EINTR)) {
+            drop_subscriber(epoll_fd, sub);
+            return;
+        }
+    }
+    if (events & (EPOLLHUP | EPOLLERR)) {
+        drop_subscriber(epoll_fd, sub);
+        return;
+    }
+    if ((events & EPOLLOUT) && flush_subscriber(epoll_fd, sub) == -1) {
+        drop_subscriber(epoll_fd, sub);
+    }
+}
+
+static int open_listen_socket(void) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    struct sockaddr_un addr;
+    socklen_t addr_len = snapshot_socket_address(&addr);
+    if (bind(fd, (struct sockaddr *)&addr, addr_len) == -1 || listen(fd, LISTEN_BACKLOG) == -1) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    int hz = SNAPSHOT_DEFAULT_HZ;
+    const char *record_path = NULL;
+    long record_mb = RECORDING_DEFAULT_MB;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--instance") == 0) && i + 1 < argc) {
+            ipc_set_instance(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--hz") == 0 && i + 1 < argc) {
+            hz = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--record-mb") == 0 && i + 1 < argc) {
+            record_mb = atol(argv[++i]);
+        } else {
+            fprintf(stderr, "Użycie: %s [-i INSTANCJA] [--hz N] [--record PLIK [--record-mb N]]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (hz < 1 || hz > SNAPSHOT_MAX_HZ) {
+        fprintf(stderr, "PUBLISHER: --hz musi być w zakresie 1..%d\n", SNAPSHOT_MAX_HZ);
+        return EXIT_FAILURE;
+    }
+    if (record_path != NULL) {
+        if (record_mb < 1 || recording_create(&recording, record_path, (uint64_t)record_mb << 20, hz) == -1) {
+            fprintf(stderr, "PUBLISHER: Nie można utworzyć nagrania %s: %s\n", record_path,
+                    record_mb < 1 ? "--record-mb musi być dodatnie" : strerror(errno));
+            return EXIT_FAILURE;
+        }
+        recording_on = 1;
+    }
+    lockprof_init("publisher", NULL);
+
+    signal(SIGTERM, signal_handler);
+    signal(SIGINT, signal_handler);
+
+    int shm_id = shmget(ipc_key(IPC_SHM), sizeof(SharedState), 0);
+    if (shm_id == -1) {
+        fprintf(stderr, "PUBLISHER: Brak pamięci współdzielonej instancji %d - czy ./bin/bar działa?\n", ipc_instance());
+        return EXIT_FAILURE;
+    }
+    shared_state = (SharedState *)shmat(shm_id, NULL, SHM_RDONLY);
+    if (shared_state == (void *)-1) {
+        handle_error("PUBLISHER: shmat failed");
+    }
+    sem_id = get_semaphores();
+    if (sem_id == -1) {
+        handle_error("PUBLISHER: get_semaphores failed");
+    }
+
+    delta_message = malloc(sizeof(SnapshotHeader) + SNAPSHOT_MAX_PAYLOAD);
+    key_message = malloc(sizeof(SnapshotHeader) + sizeof(SharedState));
+    if (delta_message == NULL || key_message == NULL) {
+        handle_error("PUBLISHER: malloc failed");
+    }
+
+    int listen_fd = open_listen_socket();
+    if (listen_fd == -1) {
+        handle_error("PUBLISHER: bind/listen failed");
+    }
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    int tick_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epoll_fd == -1 || tick_fd == -1) {
+        handle_error("PUBLISHER: epoll/timerfd failed");
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;  // NULL = gniazdo nasłuchujące
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+    ev.data.ptr = &tick_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, tick_fd, &ev);
+
+    long long period_ns = 1000000000LL / hz;
+    struct itimerspec spec;
+    spec.it_value.tv_sec = period_ns / 1000000000LL;
+    spec.it_value.tv_nsec = period_ns % 1000000000LL;
+    spec.it_interval = spec.it_value;
+    timerfd_settime(tick_fd, 0, &spec, NULL);
+
+    log_message("PUBLISHER: Publikuję stan sali (instancja %d, %d Hz)%s%s", ipc_instance(), hz,
+               recording_on ? ", nagranie: " : "", recording_on ? record_path : "");
+
+    struct epoll_event events[64];
+    while (running) {
+        int n = epoll_wait(epoll_fd, events, 64, -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("PUBLISHER: epoll_wait failed");
+            break;
+        }
+        for (int i = 0; i < n && running; i++) {
+            if (events[i].data.ptr == NULL) {
+                accept_subscribers(epoll_fd, listen_fd);
+            } else if (events[i].data.ptr == &tick_fd) {
+                uint64_t expirations;
+                if (read(tick_fd, &expirations, sizeof(expirations)) == -1) {
+                    continue;
+                }
+                if (subscriber_count == 0 && !recording_on) {
+                    continue;  // Bez widzów i nagrania nie dotykamy semafora sali
+                }
+                int changed = sample();
+                if (changed == -1) {
+                    running = 0;  // Symulacja zakończona - semafory usunięte
+                    break;
+                }
+                if (changed && recording_on) {
+                    recording_append(&recording, frame_seq, frame_ns, &frames[current],
+                                     delta_message + sizeof(SnapshotHeader),
+                                     delta_len > 0 ? (long)(delta_len - sizeof(SnapshotHeader)) : -1);
+                }
+                for (int s = subscriber_count - 1; changed && s >= 0; s--) {
+                    if (publish_to(epoll_fd, subscribers[s]) == -1) {
+                        drop_subscriber(epoll_fd, subscribers[s]);
+                    }
+                }
+            } else {
+                handle_subscriber(epoll_fd, events[i].data.ptr, events[i].events);
+            }
+        }
+        free_dropped();
+    }
+
+    log_message("PUBLISHER: Koniec publikacji - klatki: %lu, klatki kluczowe: %lu, pominięte: %lu",
+               frames_published, keyframes_sent, frames_skipped);
+    if (recording_on) {
+        const RecordingHeader *rh = recording.header;
+        log_message("PUBLISHER: Nagranie %s - klatki: %llu (kluczowe %llu), nadpisane: %llu, %llu B w pierścieniu",
+                   record_path, (unsigned long long)rh->frames, (unsigned long long)rh->keyframes,
+                   (unsigned long long)rh->evicted, (unsigned long long)(rh->head - rh->tail));
+        recording_close(&recording);
+    }
+
+    while (subscriber_count > 0) {
+        drop_subscriber(epoll_fd, subscribers[0]);
+    }
+    free_dropped();
+    close(listen_fd);
+    close(tick_fd);
+    close(epoll_fd);
+    free(delta_message);
+    free(key_message);
+    shmdt(shared_state);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,291 @@
+#include "recording.h"
+#include "utils.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define DATA_OFFSET 4096  // Pierścień zaczyna się od drugiej strony pliku
+
+static uint64_t align_record(uint64_t len) {
+    return (len + RECORDING_ALIGN - 1) / RECORDING_ALIGN * RECORDING_ALIGN;
+}
+
+static uint64_t ring_offset(uint64_t capacity, uint64_t pos) {
+    return pos % capacity;
+}
+
+int recording_create(Recording *rec, const char *path, uint64_t capacity, int hz) {
+    memset(rec, 0, sizeof(Recording));
+    capacity = capacity / RECORDING_ALIGN * RECORDING_ALIGN;
+    if (capacity < 4 * align_record(RECORDING_KEY_BYTES)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return -1;
+    }
+    size_t size = DATA_OFFSET + (size_t)capacity;
+    if (ftruncate(fd, (off_t)size) == -1) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+
+    rec->header = data;
+    rec->data = (unsigned char *)data + DATA_OFFSET;
+    rec->map_size = size;
+    rec->header->magic = RECORDING_MAGIC;
+    rec->header->version = RECORDING_VERSION;
+    rec->header->state_size = sizeof(SharedState);
+    rec->header->hz = (uint32_t)hz;
+    rec->header->capacity = capacity;
+    return 0;
+}
+
+// Usuwa najstarszą klatkę (albo pusty koniec pierścienia za znacznikiem zawinięcia)
+static void evict_oldest(Recording *rec) {
+    RecordingHeader *h = rec->header;
+    uint64_t offset = ring_offset(h->capacity, h->tail);
+    uint64_t room = h->capacity - offset;
+    SnapshotHeader frame;
+    if (room >= sizeof(SnapshotHeader)) {
+        memcpy(&frame, rec->data + offset, sizeof(frame));
+    }
+    if (room < sizeof(SnapshotHeader) || frame.kind == RECORDING_WRAP) {
+        h->tail += room;
+        return;
+    }
+    h->tail += align_record(sizeof(SnapshotHeader) + frame.payload_len);
+    h->evicted++;
+}
+
+static int tail_is_keyframe(const Recording *rec) {
+    const RecordingHeader *h = rec->header;
+    uint64_t offset = ring_offset(h->capacity, h->tail);
+    if (h->capacity - offset < sizeof(SnapshotHeader)) {
+        return 0;
+    }
+    SnapshotHeader frame;
+    memcpy(&frame, rec->data + offset, sizeof(frame));
+    return frame.kind == SNAPSHOT_KEYFRAME;
+}
+
+// Początek klatki o rozmiarze need: bieżący koniec lub początek pierścienia, gdy do końca brakuje miejsca
+static uint64_t frame_start(const Recording *rec, uint64_t need) {
+    uint64_t room = rec->header->capacity - ring_offset(rec->header->capacity, rec->header->head);
+    return room < need ? rec->header->head + room : rec->header->head;
+}
+
+void recording_append(Recording *rec, uint64_t seq, int64_t sampled_ns, const SharedState *state,
+                      const unsigned char *delta, long delta_len) {
+    RecordingHeader *h = rec->header;
+    if (h == NULL) {
+        return;
+    }
+
+    // Delta tylko wtedy, gdy zapis nie nadpisze klatki kluczowej, od której trzeba ją odtwarzać
+    int kind = SNAPSHOT_KEYFRAME;
+    size_t payload_len = sizeof(SharedState);
+    if (delta_len >= 0 && h->frames > 0 && rec->since_key + (uint64_t)delta_len < RECORDING_KEY_INTERVAL) {
+        uint64_t need = align_record(sizeof(SnapshotHeader) + (uint64_t)delta_len);
+        if (frame_start(rec, need) + need <= rec->last_key + h->capacity) {
+            kind = SNAPSHOT_DELTA;
+            payload_len = (size_t)delta_len;
+        }
+    }
+    uint64_t need = align_record(sizeof(SnapshotHeader) + payload_len);
+    uint64_t start = frame_start(rec, need);
+
+    // Miejsce w pierścieniu: najstarsze klatki odpadają, początek nagrania zostaje na klatce kluczowej
+    while (start + need > h->tail + h->capacity) {
+        evict_oldest(rec);
+    }
+    while (h->tail < h->head && !tail_is_keyframe(rec)) {
+        evict_oldest(rec);
+    }
+    if (h->tail == h->head) {
+        h->tail = start;  // Pierścień pusty - nagranie zaczyna się od tej klatki (kluczowej)
+    }
+
+    uint64_t room = h->capacity - ring_offset(h->capacity, h->head);
+    if (start != h->head && room >= sizeof(SnapshotHeader)) {
+        SnapshotHeader wrap;
+        memset(&wrap, 0, sizeof(wrap));
+        wrap.magic = SNAPSHOT_MAGIC;
+        wrap.kind = RECORDING_WRAP;
+        memcpy(rec->data + ring_offset(h->capacity, h->head), &wrap, sizeof(wrap));
+    }
+
+    SnapshotHeader frame;
+    frame.magic = SNAPSHOT_MAGIC;
+    frame.kind = (uint32_t)kind;
+    frame.state_size = sizeof(SharedState);
+    frame.payload_len = (uint32_t)payload_len;
+    frame.seq = seq;
+    frame.sampled_ns = sampled_ns;
+    unsigned char *out = rec->data + ring_offset(h->capacity, start);
+    memcpy(out, &frame, sizeof(frame));
+    memcpy(out + sizeof(frame), kind == SNAPSHOT_KEYFRAME ? (const void *)state : (const void *)delta, payload_len);
+
+    if (kind == SNAPSHOT_KEYFRAME) {
+        rec->last_key = start;
+        rec->since_key = 0;
+        h->keyframes++;
+    } else {
+        rec->since_key += payload_len;
+    }
+    h->frames++;
+    __atomic_store_n(&h->head, start + need, __ATOMIC_RELEASE);  // Czytelnik w trakcie nagrania widzi całą klatkę
+}
+
+void recording_close(Recording *rec) {
+    if (rec->header != NULL) {
+        msync(rec->header, rec->map_size, MS_ASYNC);
+        munmap(rec->header, rec->map_size);
+        rec->header = NULL;
+    }
+}
+
+int recording_open(RecordingReplay *replay, const char *path) {
+    memset(replay, 0, sizeof(RecordingReplay));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < DATA_OFFSET) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    const RecordingHeader *h = data;
+    if (h->magic != RECORDING_MAGIC || h->version != RECORDING_VERSION || h->state_size != sizeof(SharedState) ||
+        h->capacity == 0 || DATA_OFFSET + h->capacity > (uint64_t)st.st_size) {
+        munmap(data, (size_t)st.st_size);
+        errno = EINVAL;
+        return -1;
+    }
+    replay->header = h;
+    replay->data = (const unsigned char *)data + DATA_OFFSET;
+    replay->map_size = (size_t)st.st_size;
+
+    // Indeks: klatki od tail do head; pierwsza użyteczna to klatka kluczowa
+    uint64_t head = __atomic_load_n(&h->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = h->tail;
+    size_t capacity = 0;
+    uint64_t pos = tail;
+    while (pos < head) {
+        uint64_t offset = ring_offset(h->capacity, pos);
+        uint64_t room = h->capacity - offset;
+        SnapshotHeader frame;
+        if (room < sizeof(SnapshotHeader)) {
+            pos += room;
+            continue;
+        }
+        memcpy(&frame, replay->data + offset, sizeof(frame));
+        if (frame.magic != SNAPSHOT_MAGIC) {
+            break;  // Nadpisane w trakcie czytania (nagranie w toku)
+        }
+        if (frame.kind == RECORDING_WRAP) {
+            pos += room;
+            continue;
+        }
+        uint64_t size = align_record(sizeof(SnapshotHeader) + frame.payload_len);
+        if (frame.payload_len > SNAPSHOT_MAX_PAYLOAD || size > room ||
+            (frame.kind == SNAPSHOT_KEYFRAME && frame.payload_len != sizeof(SharedState))) {
+            break;
+        }
+        if (frame.kind == SNAPSHOT_KEYFRAME || replay->count > 0) {
+            if (replay->count == capacity) {
+                capacity = capacity > 0 ? capacity * 2 : 1024;
+                RecordingFrame *grown = realloc(replay->frames, capacity * sizeof(RecordingFrame));
+                if (grown == NULL) {
+                    recording_replay_close(replay);
+                    errno = ENOMEM;
+                    return -1;
+                }
+                replay->frames = grown;
+            }
+            RecordingFrame *entry = &replay->frames[replay->count];
+            entry->offset = offset;
+            entry->sampled_ns = frame.sampled_ns;
+            entry->kind = frame.kind;
+            entry->key = frame.kind == SNAPSHOT_KEYFRAME ? (uint32_t)replay->count
+                                                          : replay->frames[replay->count - 1].key;
+            replay->count++;
+        }
+        pos += size;
+    }
+    replay->current = replay->count;
+    return 0;
+}
+
+static int apply_frame(RecordingReplay *replay, size_t index) {
+    const RecordingFrame *entry = &replay->frames[index];
+    SnapshotHeader frame;
+    memcpy(&frame, replay->data + entry->offset, sizeof(frame));
+    const unsigned char *payload = replay->data + entry->offset + sizeof(SnapshotHeader);
+    if (frame.magic != SNAPSHOT_MAGIC || frame.kind != entry->kind) {
+        return -1;
+    }
+    if (frame.kind == SNAPSHOT_KEYFRAME) {
+        memcpy(&replay->state, payload, sizeof(SharedState));
+        return 0;
+    }
+    return snapshot_apply_delta(&replay->state, payload, frame.payload_len);
+}
+
+int recording_seek(RecordingReplay *replay, size_t index) {
+    if (index >= replay->count) {
+        return -1;
+    }
+    // Do przodu w obrębie tej samej klatki kluczowej - same kolejne delty
+    size_t first = replay->frames[index].key;
+    if (replay->current < replay->count && replay->current <= index && first <= replay->current) {
+        first = replay->current + 1;
+    }
+    for (size_t i = first; i <= index; i++) {
+        if (apply_frame(replay, i) == -1) {
+            replay->current = replay->count;
+            return -1;
+        }
+    }
+    replay->current = index;
+    return 0;
+}
+
+size_t recording_find(const RecordingReplay *replay, int64_t sampled_ns) {
+    size_t lo = 0;
+    size_t hi = replay->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (replay->frames[mid].sampled_ns <= sampled_ns) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo > 0 ? lo - 1 : 0;
+}
+
+void recording_replay_close(RecordingReplay *replay) {
+    free(replay->frames);
+    replay->frames = NULL;
+    replay->count = 0;
+    if (replay->header != NULL) {
+        munmap((void *)replay->header, replay->map_size);
+        replay->header = NULL;
+    }
+}
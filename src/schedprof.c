@@ -0,0 +1,214 @@
+#include "schedprof.h"
+#include "utils.h"
+#include <sys/mman.h>
+
+static int profile_enabled = 0;
+static int reported = 0;
+static char profile_role[32];
+static char profile_desc[96];
+static long long base_wait_ns = 0;
+static long long base_slices = 0;
+static long long base_preempted = 0;
+
+static int env_set(const char *value) {
+    return value != NULL && value[0] != '\0';
+}
+
+int schedprof_parse_cpus(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+    const char *p = list;
+    while (*p != '\0') {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= CPU_SETSIZE) {
+            return -1;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            p++;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first || last >= CPU_SETSIZE) {
+                return -1;
+            }
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, set);
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            return -1;
+        }
+    }
+    return CPU_COUNT(set) > 0 ? CPU_COUNT(set) : -1;
+}
+
+// /proc/self/schedstat: czas na CPU, czas czekania w kolejce planisty (ns), liczba przydziałów CPU
+static int read_schedstat(long long *wait_ns, long long *slices) {
+    FILE *f = fopen("/proc/self/schedstat", "r");
+    if (f == NULL) {
+        return -1;
+    }
+    long long run_ns;
+    int fields = fscanf(f, "%lld %lld %lld", &run_ns, wait_ns, slices);
+    fclose(f);
+    return fields == 3 ? 0 : -1;
+}
+
+// Wywłaszczenia: przełączenia kontekstu, których proces nie oddał sam (nonvoluntary_ctxt_switches)
+static long long read_preempted(void) {
+    FILE *f = fopen("/proc/self/status", "r");
+    if (f == NULL) {
+        return -1;
+    }
+    char line[128];
+    long long value = -1;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "nonvoluntary_ctxt_switches: %lld", &value) == 1) {
+            break;
+        }
+    }
+    fclose(f);
+    return value;
+}
+
+// Najdłuższe jednorazowe czekanie w kolejce (ms) - tylko przy włączonym kernel.sched_schedstats
+static double read_wait_max_ms(void) {
+    FILE *f = fopen("/proc/self/sched", "r");
+    if (f == NULL) {
+        return -1;
+    }
+    char line[160];
+    double value = -1;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *colon = strchr(line, ':');
+        if (colon != NULL && strstr(line, "wait_max") != NULL && strstr(line, "wait_max") < colon) {
+            value = atof(colon + 1);
+            break;
+        }
+    }
+    fclose(f);
+    return value;
+}
+
+// Rdzeń roli: slot-ty element listy (modulo liczba rdzeni)
+static int pick_cpu(const cpu_set_t *set, int slot) {
+    int count = CPU_COUNT(set);
+    int wanted = slot % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, set) && wanted-- == 0) {
+            return cpu;
+        }
+    }
+    return -1;
+}
+
+void schedprof_init(const char *role, int slot) {
+    const char *cpus = getenv(SCHEDPROF_CPUS_ENV);
+    const char *rt = getenv(SCHEDPROF_RT_ENV);
+    if (profile_enabled || (!env_set(cpus) && !env_set(rt) && !env_set(getenv(SCHEDPROF_REPORT_ENV)))) {
+        return;
+    }
+    snprintf(profile_role, sizeof(profile_role), "%s", role);
+    int len = 0;
+
+    cpu_set_t set;
+    if (env_set(cpus) && schedprof_parse_cpus(cpus, &set) > 0) {
+        int cpu = pick_cpu(&set, slot);
+        cpu_set_t own;
+        CPU_ZERO(&own);
+        CPU_SET(cpu, &own);
+        if (sched_setaffinity(0, sizeof(own), &own) == -1) {
+            log_message("SCHED %s: sched_setaffinity(%d) failed: %s", role, cpu, strerror(errno));
+        } else {
+            len += snprintf(profile_desc + len, sizeof(profile_desc) - len, "CPU %d, ", cpu);
+        }
+    }
+
+    if (env_set(rt)) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = atoi(rt);
+        if (sched_setscheduler(0, SCHED_FIFO, &param) == -1) {
+            log_message("SCHED %s: sched_setscheduler(SCHED_FIFO, %d) failed: %s", role, param.sched_priority,
+                        strerror(errno));
+        } else {
+            len += snprintf(profile_desc + len, sizeof(profile_desc) - len, "SCHED_FIFO %d, ", param.sched_priority);
+        }
+        // Bez błędów stron w ścieżce obsługi - także dla przyszłych mapowań (pierścienie, bufory śledzenia)
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == -1) {
+            log_message("SCHED %s: mlockall failed: %s", role, strerror(errno));
+        } else {
+            len += snprintf(profile_desc + len, sizeof(profile_desc) - len, "mlockall, ");
+        }
+    }
+
+    if (len == 0) {
+        snprintf(profile_desc, sizeof(profile_desc), "domyślny");
+    } else {
+        profile_desc[len - 2] = '\0';  // Bez końcowego ", "
+    }
+    log_message("SCHED %s: Profil planisty: %s", role, profile_desc);
+
+    read_schedstat(&base_wait_ns, &base_slices);
+    base_preempted = read_preempted();
+    profile_enabled = 1;
+    atexit(schedprof_report);
+}
+
+int schedprof_confine_clients(void) {
+    const char *cpus = getenv(SCHEDPROF_CPUS_ENV);
+    cpu_set_t services;
+    if (!env_set(cpus) || schedprof_parse_cpus(cpus, &services) <= 0) {
+        return 0;
+    }
+
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) {
+        return -1;
+    }
+    cpu_set_t remaining;
+    CPU_ZERO(&remaining);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && !CPU_ISSET(cpu, &services)) {
+            CPU_SET(cpu, &remaining);
+        }
+    }
+    if (CPU_COUNT(&remaining) == 0) {
+        return 0;
+    }
+    if (sched_setaffinity(0, sizeof(remaining), &remaining) == -1) {
+        return -1;
+    }
+    return CPU_COUNT(&remaining);
+}
+
+void schedprof_report(void) {
+    if (!profile_enabled || reported) {
+        return;
+    }
+    reported = 1;
+
+    long long wait_ns, slices;
+    if (read_schedstat(&wait_ns, &slices) == -1) {
+        log_message("SCHED %s: brak /proc/self/schedstat - raport pominięty", profile_role);
+        return;
+    }
+    wait_ns -= base_wait_ns;
+    slices -= base_slices;
+    long long preempted = read_preempted();
+    double wait_max_ms = read_wait_max_ms();
+
+    char max_str[48];
+    if (wait_max_ms >= 0) {
+        snprintf(max_str, sizeof(max_str), "%.3f ms", wait_max_ms);
+    } else {
+        snprintf(max_str, sizeof(max_str), "nieznane - kernel.sched_schedstats=0");
+    }
+    log_message("SCHED %s: czekanie na CPU %.3f ms w %lld przydziałach (%.2f us/przydział, maks. %s), "
+                "wywłaszczenia %lld (%s)",
+                profile_role, wait_ns / 1e6, slices, slices > 0 ? wait_ns / 1e3 / slices : 0.0, max_str,
+                preempted >= 0 && base_preempted >= 0 ? preempted - base_preempted : -1, profile_desc);
+}
@@ -0,0 +1,247 @@
+#include "schedule.h"
+#include <limits.h>
+
+#define WHEEL_MASK (SCHEDULE_WHEEL_SLOTS - 1)
+#define SCRIPT_LINE_MAX 256
+
+void wheel_init(TimerWheel *wheel) {
+    memset(wheel, 0, sizeof(TimerWheel));
+}
+
+static ScheduledEvent *wheel_insert(TimerWheel *wheel, long long due_ms, int action, int arg, int line) {
+    ScheduledEvent *event = malloc(sizeof(ScheduledEvent));
+    if (event == NULL) {
+        return NULL;
+    }
+    event->due_ms = due_ms;
+    event->action = action;
+    event->arg = arg;
+    event->duration_ms = 0;
+    event->lead_ms = 0;
+    event->line = line;
+    event->next = NULL;
+
+    // Zdarzenie z przeszłości trafia do slotu najbliższego ticku, a nie o cały obrót dalej
+    long long tick = due_ms > wheel->cursor_ms ? due_ms : wheel->cursor_ms;
+    ScheduledEvent **link = &wheel->slots[tick & WHEEL_MASK];
+    while (*link != NULL) {
+        link = &(*link)->next;
+    }
+    *link = event;
+    wheel->pending++;
+    return event;
+}
+
+int wheel_add(TimerWheel *wheel, long long due_ms, int action, int arg, int line) {
+    return wheel_insert(wheel, due_ms, action, arg, line) != NULL ? 0 : -1;
+}
+
+int wheel_add_reservation(TimerWheel *wheel, long long due_ms, int count, int duration_ms, int lead_ms, int line) {
+    ScheduledEvent *event = wheel_insert(wheel, due_ms, ACTION_RESERVE, count, line);
+    if (event == NULL) {
+        return -1;
+    }
+    event->duration_ms = duration_ms;
+    event->lead_ms = lead_ms;
+    return 0;
+}
+
+ScheduledEvent *wheel_pop_due(TimerWheel *wheel, long long now_ms) {
+    while (wheel->pending > 0 && wheel->cursor_ms <= now_ms) {
+        // Slot zawiera też zdarzenia z kolejnych obrotów - zostają na miejscu
+        ScheduledEvent **link = &wheel->slots[wheel->cursor_ms & WHEEL_MASK];
+        while (*link != NULL) {
+            ScheduledEvent *event = *link;
+            if (event->due_ms <= wheel->cursor_ms) {
+                *link = event->next;
+                event->next = NULL;
+                wheel->pending--;
+                return event;
+            }
+            link = &event->next;
+        }
+        wheel->cursor_ms++;
+    }
+    if (wheel->pending == 0 && wheel->cursor_ms <= now_ms) {
+        wheel->cursor_ms = now_ms + 1;
+    }
+    return NULL;
+}
+
+long long wheel_next_due(const TimerWheel *wheel) {
+    long long next = -1;
+    if (wheel->pending == 0) {
+        return -1;
+    }
+    for (int i = 0; i < SCHEDULE_WHEEL_SLOTS; i++) {
+        for (const ScheduledEvent *event = wheel->slots[i]; event != NULL; event = event->next) {
+            if (next == -1 || event->due_ms < next) {
+                next = event->due_ms;
+            }
+        }
+    }
+    return next;
+}
+
+void wheel_free(TimerWheel *wheel) {
+    for (int i = 0; i < SCHEDULE_WHEEL_SLOTS; i++) {
+        ScheduledEvent *event = wheel->slots[i];
+        while (event != NULL) {
+            ScheduledEvent *next = event->next;
+            free(event);
+            event = next;
+        }
+        wheel->slots[i] = NULL;
+    }
+    wheel->pending = 0;
+}
+
+const char *schedule_action_name(int action) {
+    switch (action) {
+        case ACTION_DOUBLE: return "double";
+        case ACTION_RESERVE: return "reserve";
+        case ACTION_RELEASE: return "release";
+        case ACTION_FIRE: return "fire";
+        case ACTION_PAUSE: return "pause";
+        case ACTION_RESUME: return "resume";
+        case ACTION_END: return "end";
+        case ACTION_CHECKPOINT: return "checkpoint";
+        default: return "?";
+    }
+}
+
+static int parse_action(const char *name) {
+    if (strcmp(name, "double") == 0) return ACTION_DOUBLE;
+    if (strcmp(name, "reserve") == 0) return ACTION_RESERVE;
+    if (strcmp(name, "release") == 0) return ACTION_RELEASE;
+    if (strcmp(name, "fire") == 0) return ACTION_FIRE;
+    if (strcmp(name, "pause") == 0) return ACTION_PAUSE;
+    if (strcmp(name, "checkpoint") == 0) return ACTION_CHECKPOINT;
+    return 0;
+}
+
+int schedule_load(TimerWheel *wheel, const char *path, char *error, size_t error_size) {
+    char dummy[1];
+    if (error == NULL) {
+        error = dummy;
+        error_size = sizeof(dummy);
+    }
+    error[0] = '\0';
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        snprintf(error, error_size, "%s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    char line[SCRIPT_LINE_MAX];
+    int line_no = 0;
+    int loaded = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_no++;
+
+        char *comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        char action_name[32];
+        long long due_ms;
+        long long arg = -1;
+        long long duration_ms = 0;
+        long long lead_ms = 0;
+        char extra[2];
+        int fields = sscanf(line, "%lld %31s %lld %lld %lld %1s", &due_ms, action_name, &arg, &duration_ms,
+                            &lead_ms, extra);
+        if (fields <= 0) {
+            continue;  // Pusta linia lub komentarz
+        }
+
+        int action = fields >= 2 ? parse_action(action_name) : 0;
+        if (fields == 1 || fields == 6 || due_ms < 0) {
+            snprintf(error, error_size, "%s:%d: oczekiwano \"<czas_ms> <akcja> [argumenty]\"", path, line_no);
+            fclose(file);
+            return -1;
+        }
+        if (action == 0) {
+            snprintf(error, error_size, "%s:%d: nieznana akcja \"%s\"", path, line_no, action_name);
+            fclose(file);
+            return -1;
+        }
+
+        if (action == ACTION_RESERVE) {
+            if (fields < 3) arg = RESERVED_TABLE_COUNT;
+            if (arg < 1 || arg > X1 + X2 + X3_MAX + X4) {
+                snprintf(error, error_size, "%s:%d: reserve wymaga liczby stolików 1..%d", path, line_no,
+                         X1 + X2 + X3_MAX + X4);
+                fclose(file);
+                return -1;
+            }
+            if (duration_ms < 0 || duration_ms > INT_MAX || lead_ms < 0 || lead_ms > INT_MAX) {
+                snprintf(error, error_size, "%s:%d: reserve: czas trwania i wyprzedzenie w ms >= 0", path, line_no);
+                fclose(file);
+                return -1;
+            }
+        } else if (fields > 3) {
+            snprintf(error, error_size, "%s:%d: akcja %s przyjmuje co najwyżej jeden argument", path, line_no,
+                     action_name);
+            fclose(file);
+            return -1;
+        } else if (action == ACTION_PAUSE) {
+            if (fields < 3 || arg < 1 || arg > INT_MAX) {
+                snprintf(error, error_size, "%s:%d: pause wymaga czasu w ms", path, line_no);
+                fclose(file);
+                return -1;
+            }
+        } else if (fields == 3) {
+            snprintf(error, error_size, "%s:%d: akcja %s nie przyjmuje argumentu", path, line_no, action_name);
+            fclose(file);
+            return -1;
+        } else {
+            arg = 0;
+        }
+
+        int added = (action == ACTION_RESERVE)
+                        ? wheel_add_reservation(wheel, due_ms, (int)arg, (int)duration_ms, (int)lead_ms, line_no)
+                        : wheel_add(wheel, due_ms, action, (int)arg, line_no);
+        if (added == -1) {
+            snprintf(error, error_size, "%s:%d: brak pamięci", path, line_no);
+            fclose(file);
+            return -1;
+        }
+        loaded++;
+    }
+
+    fclose(file);
+    return loaded;
+}
+
+int schedule_load_default(TimerWheel *wheel) {
+    int count = 0;
+
+    if (SIGNAL1_TIME > 0) {
+        count += wheel_add(wheel, SIGNAL1_TIME * 1000LL, ACTION_DOUBLE, 0, 0) == 0;
+        // Ponowna próba po 3 sekundach (powinna się nie powieść)
+        count += wheel_add(wheel, (SIGNAL1_TIME + 3) * 1000LL, ACTION_DOUBLE, 0, 0) == 0;
+    }
+    if (SIGNAL2_TIME > 0) {
+        count += wheel_add(wheel, SIGNAL2_TIME * 1000LL, ACTION_RESERVE, RESERVED_TABLE_COUNT, 0) == 0;
+    }
+    if (SIGNAL3_TIME > 0) {
+        count += wheel_add(wheel, SIGNAL3_TIME * 1000LL, ACTION_FIRE, 0, 0) == 0;
+    }
+    return count;
+}
+
+int schedule_load_soak(TimerWheel *wheel) {
+    int count = 0;
+
+    if (SIGNAL1_TIME > 0) {
+        count += wheel_add(wheel, SIGNAL1_TIME * 1000LL, ACTION_DOUBLE, 0, 0) == 0;
+    }
+    if (SIGNAL2_TIME > 0) {
+        count += wheel_add(wheel, SIGNAL2_TIME * 1000LL, ACTION_RESERVE, RESERVED_TABLE_COUNT, 0) == 0;
+    }
+    return count;
+}
@@ -0,0 +1,146 @@
+#include "common.h"
+#include "seating.h"
+#include <stdint.h>
+
+// Generator wyspecjalizowanego alokatora dla układu sali z include/common.h (X1..X4).
+// Wypisuje nagłówek obj/seating_fixed.h dołączany przez seating.c: stan stolików spakowany
+// w jedno słowo 64-bitowe (4 bity na stolik, w kolejności table_slot()), stałe masek dla każdego
+// rozmiaru grupy i rozwinięte pakowanie sali. Układ, który nie mieści się w słowie, dostaje
+// SEATING_FIXED 0 - seating.c używa wtedy ogólnych pętli.
+
+#define FIELD_BITS 4
+#define MAX_FIELDS (64 / FIELD_BITS)
+
+typedef struct {
+    int type;      // Liczba miejsc przy stoliku
+    int index;     // Indeks w table_X[]
+    int optional;  // Stolik 3-os. dostawiany przy podwojeniu (aktywny dla index < effective_x3)
+} Field;
+
+static Field fields[TABLE_SLOTS];
+static int field_count = 0;
+
+static void add_tables(int type, int count, int optional_from) {
+    for (int i = 0; i < count; i++) {
+        fields[field_count].type = type;
+        fields[field_count].index = i;
+        fields[field_count].optional = i >= optional_from;
+        field_count++;
+    }
+}
+
+// Maska bitów 3 pól spełniających warunek (najstarszy bit pola = wynik fixed_zero_fields())
+static uint64_t field_mask(int min_capacity) {
+    uint64_t mask = 0;
+    for (int f = 0; f < field_count; f++) {
+        if (fields[f].type >= min_capacity) {
+            mask |= 0x8ULL << (f * FIELD_BITS);
+        }
+    }
+    return mask;
+}
+
+static uint64_t repeat_field(uint64_t value) {
+    uint64_t word = 0;
+    for (int f = 0; f < field_count; f++) {
+        word |= value << (f * FIELD_BITS);
+    }
+    return word;
+}
+
+static void emit_generic(void) {
+    printf("#define SEATING_FIXED 0\n");
+    printf("#define SEATING_FIXED_LAYOUT \"ogólny (%d stolików nie mieści się w słowie 64-bitowym)\"\n",
+           TABLE_SLOTS);
+}
+
+static void emit_fixed(void) {
+    printf("#include <stdint.h>\n\n");
+    printf("#define SEATING_FIXED 1\n");
+    printf("#define SEATING_FIXED_LAYOUT \"stały X1=%d X2=%d X3_MAX=%d X4=%d (%d stolików w słowie 64-bitowym)\"\n",
+           X1, X2, X3_MAX, X4, field_count);
+    printf("#define FIXED_FIELD_BITS %d\n", FIELD_BITS);
+    printf("#define FIXED_CLOSED 0xFULL  // Pole stolika zarezerwowanego lub niedostawionego\n");
+    printf("#define FIXED_ONES 0x%016llxULL  // 1 w każdym polu\n", (unsigned long long)repeat_field(0x1));
+    printf("#define FIXED_LOW3 0x%016llxULL\n", (unsigned long long)repeat_field(0x7));
+    printf("#define FIXED_HIGH 0x%016llxULL\n\n", (unsigned long long)repeat_field(0x8));
+
+    printf("_Static_assert(X1 == %d && X2 == %d && X3_MAX == %d && X4 == %d,\n", X1, X2, X3_MAX, X4);
+    printf("               \"obj/seating_fixed.h wygenerowano dla innego układu sali\");\n\n");
+
+    // Grupa g siada przy pustym stoliku o pojemności >= g albo dosiada się do stolika z dokładnie
+    // g zajętymi miejscami, jeśli 2 * g <= pojemność (zasada równoliczności z seating_find_free_table());
+    // stolik 4-os. z dwiema grupami 1-os. odrzuca dla grupy 2-os. dopiero seating.c (join_mixes_sizes())
+    printf("// Pola, w których grupa [rozmiar] może usiąść przy pustym stoliku / dosiąść się do grupy tej samej wielkości\n");
+    printf("static const uint64_t fixed_empty_mask[5] = {0");
+    for (int g = 1; g <= 4; g++) {
+        printf(", 0x%016llxULL", (unsigned long long)field_mask(g));
+    }
+    printf("};\n");
+    printf("static const uint64_t fixed_join_mask[5] = {0");
+    for (int g = 1; g <= 4; g++) {
+        printf(", 0x%016llxULL", (unsigned long long)field_mask(2 * g));
+    }
+    printf("};\n\n");
+
+    printf("// Najstarszy bit każdego pola równego zero (bez przeniesień między polami)\n");
+    printf("static inline uint64_t fixed_zero_fields(uint64_t x) {\n");
+    printf("    uint64_t t = (x & FIXED_LOW3) + FIXED_LOW3;\n");
+    printf("    return ~(t | x) & FIXED_HIGH;\n");
+    printf("}\n\n");
+
+    printf("// Kandydaci dla grupy 1..4: bit 3 pola stolika, kolejność bitów = kolejność przeszukiwania\n");
+    printf("static inline uint64_t fixed_candidates(uint64_t packed, int group_size) {\n");
+    printf("    return (fixed_zero_fields(packed) & fixed_empty_mask[group_size]) |\n");
+    printf("           (fixed_zero_fields(packed ^ (FIXED_ONES * (uint64_t)group_size)) & fixed_join_mask[group_size]);\n");
+    printf("}\n\n");
+
+    printf("// Stolik pola: typ i indeks w table_X[] (bez rozgałęzień slot_table())\n");
+    printf("static const unsigned char fixed_slot_type[%d] = {", field_count);
+    for (int f = 0; f < field_count; f++) {
+        printf("%s%d", f > 0 ? ", " : "", fields[f].type);
+    }
+    printf("};\n");
+    printf("static const unsigned char fixed_slot_index[%d] = {", field_count);
+    for (int f = 0; f < field_count; f++) {
+        printf("%s%d", f > 0 ? ", " : "", fields[f].index);
+    }
+    printf("};\n\n");
+
+    printf("static inline uint64_t fixed_field(int cell) {\n");
+    printf("    return cell < 0 ? FIXED_CLOSED : (uint64_t)cell;\n");
+    printf("}\n\n");
+
+    printf("// Pakowanie całej sali (inicjalizacja, podwojenie X3, zwolnienie wszystkich rezerwacji)\n");
+    printf("static inline uint64_t fixed_pack(const SharedState *s) {\n");
+    printf("    uint64_t packed = 0;\n");
+    for (int f = 0; f < field_count; f++) {
+        const Field *field = &fields[f];
+        if (field->optional) {
+            printf("    packed |= (s->effective_x3 > %d ? fixed_field(s->table_%d[%d]) : FIXED_CLOSED) << %d;\n",
+                   field->index, field->type, field->index, f * FIELD_BITS);
+        } else {
+            printf("    packed |= fixed_field(s->table_%d[%d]) << %d;\n", field->type, field->index, f * FIELD_BITS);
+        }
+    }
+    printf("    return packed;\n");
+    printf("}\n");
+}
+
+int main(void) {
+    add_tables(1, X1, X1);
+    add_tables(2, X2, X2);
+    add_tables(3, X3_MAX, X3);
+    add_tables(4, X4, X4);
+
+    printf("// Wygenerowane przez bin/seatgen (src/seatgen.c) z układu sali w include/common.h - nie edytować.\n");
+    printf("#ifndef SEATING_FIXED_H\n");
+    printf("#define SEATING_FIXED_H\n\n");
+    if (field_count > MAX_FIELDS) {
+        emit_generic();
+    } else {
+        emit_fixed();
+    }
+    printf("\n#endif // SEATING_FIXED_H\n");
+    return 0;
+}
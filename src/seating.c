@@ -0,0 +1,793 @@
+#include "seating.h"
+#include "occupancy.h"
+#include "seating_fixed.h"  // Wygenerowany przez bin/seatgen (obj/seating_fixed.h)
+
+#define SEATING_PREFILTER_TABLES 64  // Od tylu stolików seating_seat_group() sprawdza najpierw statystyki obłożenia
+
+// --- Indeks rezerwacji ---
+
+// Numer stolika w indeksie rezerwacji: kolejno stoliki 1-, 2-, 3- i 4-osobowe
+static int table_slot(int type, int index) {
+    switch (type) {
+        case 1: return index;
+        case 2: return X1 + index;
+        case 3: return X1 + X2 + index;
+        case 4: return X1 + X2 + X3_MAX + index;
+        default: return -1;
+    }
+}
+
+static TableRef slot_table(int slot) {
+    TableRef table;
+    if (slot < X1) {
+        table.type = 1;
+        table.index = slot;
+    } else if (slot < X1 + X2) {
+        table.type = 2;
+        table.index = slot - X1;
+    } else if (slot < X1 + X2 + X3_MAX) {
+        table.type = 3;
+        table.index = slot - X1 - X2;
+    } else {
+        table.type = 4;
+        table.index = slot - X1 - X2 - X3_MAX;
+    }
+    table.seats = table.type;
+    return table;
+}
+
+static int *table_cell(SharedState *state, const TableRef *table) {
+    switch (table->type) {
+        case 1: return &state->table_1[table->index];
+        case 2: return &state->table_2[table->index];
+        case 3: return &state->table_3[table->index];
+        default: return &state->table_4[table->index];
+    }
+}
+
+// --- Spakowany stan stolików ---
+
+#if SEATING_FIXED
+// Przepisuje komórkę stolika do jego pola w słowie (po każdej zmianie komórki)
+static void packed_update(Seating *seating, int type, int index) {
+    TableRef table = {type, index, type};
+    int shift = table_slot(type, index) * FIXED_FIELD_BITS;
+    seating->packed_tables = (seating->packed_tables & ~(FIXED_CLOSED << shift)) |
+                             (fixed_field(*table_cell(seating->state, &table)) << shift);
+}
+
+static void packed_rebuild(Seating *seating) {
+    seating->packed_tables = fixed_pack(seating->state);
+}
+#else
+static void packed_update(Seating *seating, int type, int index) {
+    (void)seating;
+    (void)type;
+    (void)index;
+}
+
+static void packed_rebuild(Seating *seating) {
+    seating->packed_tables = 0;
+}
+#endif
+
+static void reservations_reset(Seating *seating) {
+    for (int i = 0; i < MAX_RESERVATIONS; i++) {
+        seating->reservations[i].state = RESERVATION_FREE;
+        seating->reservations[i].generation++;
+        seating->free_reservations[i] = MAX_RESERVATIONS - 1 - i;
+    }
+    seating->free_reservation_count = MAX_RESERVATIONS;
+    memset(seating->table_reservation_count, 0, sizeof(seating->table_reservation_count));
+    seating->reservation_event_count = 0;
+    seating->waiting_reservations = 0;
+}
+
+// Pozycja pierwszej rezerwacji stolika kończącej się po t (przedziały są rozłączne,
+// więc posortowane po starcie są też posortowane po końcu)
+static int first_ending_after(const Seating *seating, int slot, long long t) {
+    int lo = 0;
+    int hi = seating->table_reservation_count[slot];
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (seating->reservations[seating->table_reservations[slot][mid]].end_ms > t) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// Czy przedział [start_ms, end_ms) koliduje z którąś rezerwacją stolika
+static int table_overlaps(const Seating *seating, int slot, long long start_ms, long long end_ms) {
+    int pos = first_ending_after(seating, slot, start_ms);
+    return pos < seating->table_reservation_count[slot] &&
+           seating->reservations[seating->table_reservations[slot][pos]].start_ms < end_ms;
+}
+
+// Stolik nie dostaje grupy, jeśli jego rezerwacja zaczyna się przed przewidywanym odejściem grupy
+static int reservation_blocks(const Seating *seating, int type, int index) {
+    int slot = table_slot(type, index);
+    return seating->table_reservation_count[slot] > 0 &&
+           table_overlaps(seating, slot, seating->now_ms, seating->now_ms + EXPECTED_STAY_MS);
+}
+
+// Dwie grupy 1-os. przy stoliku 4-os. zajmują 2 miejsca jak jedna grupa 2-os. - grupa 2-os. dosiada się
+// tylko do jednej grupy tej samej wielkości (przy pozostałych stolikach liczba zajętych miejsc wystarcza)
+static int join_mixes_sizes(const Seating *seating, int type, int index, int group_size) {
+    if (type != 4 || group_size != 2) {
+        return 0;
+    }
+    const int *seats = seating->state->table_4_groups[index];
+    int first = 0, count = 0;
+    for (int s = 0; s < 4; s++) {
+        if (seats[s] != 0) {
+            if (first == 0) first = seats[s];
+            count += seats[s] == first;
+        }
+    }
+    return first != 0 && count != group_size;
+}
+
+// Kopiec min zdarzeń; przy równym czasie koniec przed startem (stolik zwolniony i zajęty w tej samej ms)
+static int reservation_event_before(const ReservationEvent *a, const ReservationEvent *b) {
+    if (a->due_ms != b->due_ms) return a->due_ms < b->due_ms;
+    return a->is_start < b->is_start;
+}
+
+static void reservation_event_push(Seating *seating, long long due_ms, int id, int is_start) {
+    ReservationEvent ev = {due_ms, id, seating->reservations[id].generation, is_start};
+    int i = seating->reservation_event_count++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!reservation_event_before(&ev, &seating->reservation_events[parent])) break;
+        seating->reservation_events[i] = seating->reservation_events[parent];
+        i = parent;
+    }
+    seating->reservation_events[i] = ev;
+}
+
+static ReservationEvent reservation_event_pop(Seating *seating) {
+    ReservationEvent *heap = seating->reservation_events;
+    ReservationEvent top = heap[0];
+    ReservationEvent last = heap[--seating->reservation_event_count];
+    int count = seating->reservation_event_count;
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= count) break;
+        if (child + 1 < count && reservation_event_before(&heap[child + 1], &heap[child])) {
+            child++;
+        }
+        if (!reservation_event_before(&heap[child], &last)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (count > 0) {
+        heap[i] = last;
+    }
+    return top;
+}
+
+static int reservation_event_stale(const Seating *seating, const ReservationEvent *ev) {
+    const Reservation *r = &seating->reservations[ev->id];
+    return r->generation != ev->generation || r->state == RESERVATION_FREE;
+}
+
+static void reservation_add(Seating *seating, int slot, long long start_ms, long long end_ms) {
+    int id = seating->free_reservations[--seating->free_reservation_count];
+    Reservation *r = &seating->reservations[id];
+    r->start_ms = start_ms;
+    r->end_ms = end_ms;
+    r->table = slot;
+    r->state = RESERVATION_PENDING;
+
+    int pos = first_ending_after(seating, slot, start_ms);
+    int *ids = seating->table_reservations[slot];
+    memmove(&ids[pos + 1], &ids[pos], (size_t)(seating->table_reservation_count[slot] - pos) * sizeof(int));
+    ids[pos] = id;
+    seating->table_reservation_count[slot]++;
+
+    reservation_event_push(seating, start_ms, id, 1);
+    reservation_event_push(seating, end_ms, id, 0);
+}
+
+// Zajęcie stolika przez rezerwację; stolik z grupą czeka, aż grupa odejdzie
+static void reservation_activate(Seating *seating, int id) {
+    Reservation *r = &seating->reservations[id];
+    TableRef table = slot_table(r->table);
+    int *cell = table_cell(seating->state, &table);
+
+    if (*cell != 0) {
+        if (r->state != RESERVATION_WAITING) {
+            r->state = RESERVATION_WAITING;
+            seating->waiting_reservations++;
+        }
+        return;
+    }
+    if (r->state == RESERVATION_WAITING) {
+        seating->waiting_reservations--;
+    }
+    *cell = -1;  // -1 = zarezerwowany
+    packed_update(seating, table.type, table.index);
+    seating->state->total_free_seats -= table.seats;
+    seating->state->reserved_seats += table.seats;
+    r->state = RESERVATION_ACTIVE;
+
+    if (seating->on_reservation != NULL) {
+        seating->on_reservation(seating->reservation_ctx, &table, RESERVATION_STARTED);
+    }
+}
+
+// Koniec rezerwacji: usunięcie z indeksu i zwrot stolika; zwraca 1, jeśli stolik był zajęty
+static int reservation_finish(Seating *seating, int id) {
+    Reservation *r = &seating->reservations[id];
+    int slot = r->table;
+    int *ids = seating->table_reservations[slot];
+    int pos = first_ending_after(seating, slot, r->start_ms);
+    seating->table_reservation_count[slot]--;
+    memmove(&ids[pos], &ids[pos + 1], (size_t)(seating->table_reservation_count[slot] - pos) * sizeof(int));
+
+    int was_active = (r->state == RESERVATION_ACTIVE);
+    if (r->state == RESERVATION_WAITING) {
+        seating->waiting_reservations--;
+    }
+    r->state = RESERVATION_FREE;
+    r->generation++;
+    seating->free_reservations[seating->free_reservation_count++] = id;
+
+    if (was_active) {
+        TableRef table = slot_table(slot);
+        *table_cell(seating->state, &table) = 0;
+        packed_update(seating, table.type, table.index);
+        seating->state->total_free_seats += table.seats;
+        seating->state->reserved_seats -= table.seats;
+        if (seating->on_reservation != NULL) {
+            seating->on_reservation(seating->reservation_ctx, &table, RESERVATION_EXPIRED);
+        }
+    }
+    return was_active;
+}
+
+void seating_init(Seating *seating, SharedState *state) {
+    seating->state = state;
+    seating->waiting_count = 0;
+    for (int i = 0; i < MAX_GROUPS; i++) {
+        seating->seated[i].group_id = GROUP_SLOT_FREE;
+    }
+    seating->now_ms = 0;
+    seating->on_reservation = NULL;
+    seating->reservation_ctx = NULL;
+    for (int i = 0; i < MAX_RESERVATIONS; i++) {
+        seating->reservations[i].generation = 0;
+    }
+    reservations_reset(seating);
+    packed_rebuild(seating);
+}
+
+void seating_init_hall(SharedState *state) {
+    memset(state, 0, sizeof(SharedState));
+    state->total_free_seats = MAX_PERSONS;
+    state->effective_x3 = X3;
+    state->clients_pgid = -1;
+}
+
+// Wygenerowany alokator: kandydaci dla grupy to bity spakowanego słowa w kolejności przeszukiwania
+// wersji ogólnej, więc pierwszy kandydat bez blokującej rezerwacji i bez mieszania wielkości grup
+// jest tym samym stolikiem
+int seating_find_free_table(Seating *seating, int group_size, int *table_type, int *table_index) {
+#if SEATING_FIXED
+    if (group_size >= 1 && group_size <= 4) {
+        uint64_t candidates = fixed_candidates(seating->packed_tables, group_size);
+        while (candidates != 0) {
+            int slot = __builtin_ctzll(candidates) / FIXED_FIELD_BITS;
+            int type = fixed_slot_type[slot];
+            int index = fixed_slot_index[slot];
+            if (!reservation_blocks(seating, type, index) && !join_mixes_sizes(seating, type, index, group_size)) {
+                *table_type = type;
+                *table_index = index;
+                return 1;
+            }
+            candidates &= candidates - 1;
+        }
+        return 0;
+    }
+#endif
+    return seating_find_free_table_generic(seating, group_size, table_type, table_index);
+}
+
+// Funkcja znajdująca wolne stoliki
+int seating_find_free_table_generic(Seating *seating, int group_size, int *table_type, int *table_index) {
+    SharedState *shared_state = seating->state;
+
+    if (group_size == 1) {
+        for (int i = 0; i < X1; i++) {
+            if (shared_state->table_1[i] == 0 && !reservation_blocks(seating, 1, i)) {
+                *table_type = 1;
+                *table_index = i;
+                return 1;
+            }
+        }
+    }
+
+    if (group_size <= 2) {
+        for (int i = 0; i < X2; i++) {
+            int occupied = shared_state->table_2[i];
+            if (occupied == -1) continue;  // Pomija zarezerwowane stoliki
+            if (reservation_blocks(seating, 2, i)) continue;  // i te, których rezerwacja zaraz się zacznie
+            if (occupied == 0) {
+                *table_type = 2;
+                *table_index = i;
+                return 1;
+            }
+            if (group_size == 1 && occupied == 1 && occupied + group_size <= 2) {
+                *table_type = 2;
+                *table_index = i;
+                return 1;
+            }
+        }
+    }
+
+    int x3_limit = shared_state->effective_x3;
+    if (group_size <= 3) {
+        for (int i = 0; i < x3_limit; i++) {
+            int occupied = shared_state->table_3[i];
+            if (occupied == -1) continue;  // Pomija zarezerwowane stoliki
+            if (reservation_blocks(seating, 3, i)) continue;  // i te, których rezerwacja zaraz się zacznie
+            if (occupied == 0) {
+                *table_type = 3;
+                *table_index = i;
+                return 1;
+            }
+            if (occupied == group_size && occupied + group_size <= 3) {
+                *table_type = 3;
+                *table_index = i;
+                return 1;
+            }
+        }
+    }
+
+    if (group_size <= 4) {
+        for (int i = 0; i < X4; i++) {
+            int occupied = shared_state->table_4[i];
+            if (occupied == -1) continue;  // Pomija zarezerwowane stoliki
+            if (reservation_blocks(seating, 4, i)) continue;  // i te, których rezerwacja zaraz się zacznie
+            if (occupied == 0) {
+                *table_type = 4;
+                *table_index = i;
+                return 1;
+            }
+            if (occupied == group_size && occupied + group_size <= 4 &&
+                !join_mixes_sizes(seating, 4, i, group_size)) {
+                *table_type = 4;
+                *table_index = i;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// Funkcja alokująca stolik
+int seating_allocate_table(Seating *seating, int table_type, int table_index, int group_size, int group_id) {
+    SharedState *shared_state = seating->state;
+
+    switch (table_type) {
+        case 1:
+            shared_state->table_1[table_index] = 1;
+            shared_state->table_1_groups[table_index][0] = group_id;
+            break;
+        case 2:
+            shared_state->table_2[table_index] += group_size;
+            for (int i = 0, assigned = 0; i < 2 && assigned < group_size; i++) {
+                if (shared_state->table_2_groups[table_index][i] == 0) {
+                    shared_state->table_2_groups[table_index][i] = group_id;
+                    assigned++;
+                }
+            }
+            break;
+        case 3:
+            shared_state->table_3[table_index] += group_size;
+            for (int i = 0, assigned = 0; i < 3 && assigned < group_size; i++) {
+                if (shared_state->table_3_groups[table_index][i] == 0) {
+                    shared_state->table_3_groups[table_index][i] = group_id;
+                    assigned++;
+                }
+            }
+            break;
+        case 4:
+            shared_state->table_4[table_index] += group_size;
+            for (int i = 0, assigned = 0; i < 4 && assigned < group_size; i++) {
+                if (shared_state->table_4_groups[table_index][i] == 0) {
+                    shared_state->table_4_groups[table_index][i] = group_id;
+                    assigned++;
+                }
+            }
+            break;
+        default:
+            return -1;
+    }
+    packed_update(seating, table_type, table_index);
+    shared_state->total_free_seats -= group_size;
+    return 0;
+}
+
+int seating_verify_fixed(Seating *seating) {
+#if SEATING_FIXED
+    if (seating->packed_tables != fixed_pack(seating->state)) {
+        return 0;
+    }
+#endif
+    for (int group_size = 1; group_size <= 4; group_size++) {
+        int fixed_type = 0, fixed_index = 0, generic_type = 0, generic_index = 0;
+        int fixed_found = seating_find_free_table(seating, group_size, &fixed_type, &fixed_index);
+        int generic_found = seating_find_free_table_generic(seating, group_size, &generic_type, &generic_index);
+        if (fixed_found != generic_found ||
+            (fixed_found && (fixed_type != generic_type || fixed_index != generic_index))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+const char *seating_allocator(void) {
+    return SEATING_FIXED_LAYOUT;
+}
+
+// Funkcja zwalniająca stolik
+int seating_free_table(Seating *seating, int table_type, int table_index, int group_size, int group_id) {
+    SharedState *shared_state = seating->state;
+    int is_reserved = 0;
+
+    switch (table_type) {
+        case 1:
+            if (shared_state->table_1[table_index] == -1) {
+                is_reserved = 1;  // Stolik zarezerwowany - nie zwalniaj
+                break;
+            }
+            shared_state->table_1[table_index] = 0;
+            shared_state->table_1_groups[table_index][0] = 0;
+            break;
+        case 2:
+            if (shared_state->table_2[table_index] == -1) {
+                is_reserved = 1;
+                break;
+            }
+            shared_state->table_2[table_index] -= group_size;
+            if (shared_state->table_2[table_index] < 0) {
+                shared_state->table_2[table_index] = 0;
+            }
+            for (int i = 0; i < 2; i++) {
+                if (shared_state->table_2_groups[table_index][i] == group_id) {
+                    shared_state->table_2_groups[table_index][i] = 0;
+                }
+            }
+            break;
+        case 3:
+            if (shared_state->table_3[table_index] == -1) {
+                is_reserved = 1;
+                break;
+            }
+            shared_state->table_3[table_index] -= group_size;
+            if (shared_state->table_3[table_index] < 0) {
+                shared_state->table_3[table_index] = 0;
+            }
+            for (int i = 0; i < 3; i++) {
+                if (shared_state->table_3_groups[table_index][i] == group_id) {
+                    shared_state->table_3_groups[table_index][i] = 0;
+                }
+            }
+            break;
+        case 4:
+            if (shared_state->table_4[table_index] == -1) {
+                is_reserved = 1;
+                break;
+            }
+            shared_state->table_4[table_index] -= group_size;
+            if (shared_state->table_4[table_index] < 0) {
+                shared_state->table_4[table_index] = 0;
+            }
+            for (int i = 0; i < 4; i++) {
+                if (shared_state->table_4_groups[table_index][i] == group_id) {
+                    shared_state->table_4_groups[table_index][i] = 0;
+                }
+            }
+            break;
+        default:
+            return -1;
+    }
+
+    packed_update(seating, table_type, table_index);
+    if (!is_reserved) {
+        shared_state->total_free_seats += group_size;
+    }
+    return 0;
+}
+
+// --- Mapa grupa -> stolik ---
+
+static unsigned int group_home(int group_id) {
+    return ((unsigned int)group_id * 2654435761u) & (MAX_GROUPS - 1);  // Haszowanie Knutha
+}
+
+static SeatedGroup *group_find(Seating *seating, int group_id) {
+    unsigned int slot = group_home(group_id);
+    for (int probe = 0; probe < MAX_GROUPS; probe++) {
+        SeatedGroup *entry = &seating->seated[slot];
+        if (entry->group_id == group_id) {
+            return entry;
+        }
+        if (entry->group_id == GROUP_SLOT_FREE) {
+            return NULL;
+        }
+        slot = (slot + 1) & (MAX_GROUPS - 1);
+    }
+    return NULL;
+}
+
+static SeatedGroup *group_insert(Seating *seating, int group_id) {
+    SeatedGroup *entry = group_find(seating, group_id);
+    if (entry != NULL) {
+        return entry;
+    }
+    unsigned int slot = group_home(group_id);
+    for (int probe = 0; probe < MAX_GROUPS; probe++) {
+        entry = &seating->seated[slot];
+        if (entry->group_id == GROUP_SLOT_FREE) {
+            entry->group_id = group_id;
+            return entry;
+        }
+        slot = (slot + 1) & (MAX_GROUPS - 1);
+    }
+    return NULL;
+}
+
+// Usuwa wpis przesuwając w jego miejsce dalsze wpisy tego samego łańcucha - bez znaczników usunięcia
+// wyszukiwanie nie wydłuża się po tysiącach grup, które przeszły przez salę
+static void group_remove(Seating *seating, SeatedGroup *entry) {
+    unsigned int hole = (unsigned int)(entry - seating->seated);
+    unsigned int slot = hole;
+    for (;;) {
+        slot = (slot + 1) & (MAX_GROUPS - 1);
+        SeatedGroup *next = &seating->seated[slot];
+        if (next->group_id == GROUP_SLOT_FREE) {
+            break;
+        }
+        // Wpis może zająć dziurę, jeśli jego pozycja domowa nie leży cyklicznie w (hole, slot]
+        unsigned int home = group_home(next->group_id);
+        if (((slot - home) & (MAX_GROUPS - 1)) >= ((slot - hole) & (MAX_GROUPS - 1))) {
+            seating->seated[hole] = *next;
+            hole = slot;
+        }
+    }
+    seating->seated[hole].group_id = GROUP_SLOT_FREE;
+}
+
+int seating_seat_group(Seating *seating, int group_id, int group_size, int *table_type, int *table_index) {
+    // Szybka decyzja o przyjęciu tylko w dużej sali: przy kilkunastu stolikach skan statystyk kosztuje
+    // tyle, co samo przeszukanie, i przy wolnych miejscach byłby drugim przejściem po sali
+    if (TABLE_SLOTS >= SEATING_PREFILTER_TABLES) {
+        OccupancyStats stats;
+        occupancy_stats(seating->state, &stats);
+        if (!occupancy_can_seat(&stats, group_size)) {
+            return 0;
+        }
+    }
+
+    if (!seating_find_free_table(seating, group_size, table_type, table_index)) {
+        return 0;
+    }
+    SeatedGroup *entry = group_insert(seating, group_id);
+    if (entry == NULL || seating_allocate_table(seating, *table_type, *table_index, group_size, group_id) == -1) {
+        if (entry != NULL) {
+            group_remove(seating, entry);
+        }
+        return 0;
+    }
+
+    entry->table_type = *table_type;
+    entry->table_index = *table_index;
+    return 1;
+}
+
+int seating_release_group(Seating *seating, int group_id, int group_size) {
+    SeatedGroup *entry = group_find(seating, group_id);
+    if (entry == NULL) {
+        return 0;
+    }
+
+    seating_free_table(seating, entry->table_type, entry->table_index, group_size, group_id);
+    seating->state->dirty_dishes += group_size;
+
+    group_remove(seating, entry);
+    return 1;
+}
+
+void seating_mirror(const SharedState *hall, SharedState *dst) {
+    memcpy(dst->table_1, hall->table_1, sizeof(hall->table_1));
+    memcpy(dst->table_2, hall->table_2, sizeof(hall->table_2));
+    memcpy(dst->table_3, hall->table_3, sizeof(hall->table_3));
+    memcpy(dst->table_4, hall->table_4, sizeof(hall->table_4));
+    memcpy(dst->table_1_groups, hall->table_1_groups, sizeof(hall->table_1_groups));
+    memcpy(dst->table_2_groups, hall->table_2_groups, sizeof(hall->table_2_groups));
+    memcpy(dst->table_3_groups, hall->table_3_groups, sizeof(hall->table_3_groups));
+    memcpy(dst->table_4_groups, hall->table_4_groups, sizeof(hall->table_4_groups));
+    dst->reserved_seats = hall->reserved_seats;
+    dst->dirty_dishes = hall->dirty_dishes;
+    dst->x3_doubled = hall->x3_doubled;
+    dst->effective_x3 = hall->effective_x3;
+    dst->total_free_seats = hall->total_free_seats;
+    memcpy(dst->waiting_group_ids, hall->waiting_group_ids, sizeof(hall->waiting_group_ids));
+    memcpy(dst->waiting_group_sizes, hall->waiting_group_sizes, sizeof(hall->waiting_group_sizes));
+    dst->waiting_count = hall->waiting_count;
+}
+
+// Funkcja synchronizująca kolejkę oczekujących klientów z pamięcią dzieloną
+static void sync_waiting_queue_to_shared(Seating *seating) {
+    SharedState *shared_state = seating->state;
+    int waiting_count = seating->waiting_count;
+
+    shared_state->waiting_count = waiting_count;
+    for (int i = 0; i < waiting_count && i < MAX_WAITING_GROUPS; i++) {
+        shared_state->waiting_group_ids[i] = seating->waiting_queue[i].group_id;
+        shared_state->waiting_group_sizes[i] = seating->waiting_queue[i].group_size;
+    }
+    for (int i = waiting_count; i < MAX_WAITING_GROUPS; i++) {
+        shared_state->waiting_group_ids[i] = 0;
+        shared_state->waiting_group_sizes[i] = 0;
+    }
+}
+
+int seating_enqueue(Seating *seating, int group_id, int group_size, int pipelined) {
+    if (seating->waiting_count >= MAX_WAITING) {
+        return 0;
+    }
+    seating->waiting_queue[seating->waiting_count].group_id = group_id;
+    seating->waiting_queue[seating->waiting_count].group_size = group_size;
+    seating->waiting_queue[seating->waiting_count].pipelined = pipelined;
+    seating->waiting_count++;
+    sync_waiting_queue_to_shared(seating);
+    return 1;
+}
+
+int seating_serve_waiting(Seating *seating, SeatedCallback on_seated, void *ctx) {
+    int served = 0;
+
+    while (seating->waiting_count > 0) {
+        WaitingClient client = seating->waiting_queue[0];
+
+        int table_type, table_index;
+        if (!seating_seat_group(seating, client.group_id, client.group_size, &table_type, &table_index)) {
+            break;
+        }
+
+        for (int j = 0; j < seating->waiting_count - 1; j++) {
+            seating->waiting_queue[j] = seating->waiting_queue[j + 1];
+        }
+        seating->waiting_count--;
+        sync_waiting_queue_to_shared(seating);
+        served++;
+
+        if (on_seated != NULL) {
+            on_seated(ctx, &client, table_type, table_index);
+        }
+    }
+
+    return served;
+}
+
+int seating_double_x3(Seating *seating) {
+    SharedState *shared_state = seating->state;
+
+    if (shared_state->x3_doubled) {
+        return 0;
+    }
+
+    shared_state->x3_doubled = 1;
+    shared_state->effective_x3 = X3 * 2;  // Podwojenie stolików 3-osobowych
+    int new_seats = X3 * 3;
+    shared_state->total_free_seats += new_seats;
+    packed_rebuild(seating);
+    return new_seats;
+}
+
+void seating_set_reservation_callback(Seating *seating, ReservationCallback callback, void *ctx) {
+    seating->on_reservation = callback;
+    seating->reservation_ctx = ctx;
+}
+
+int seating_reserve_tables(Seating *seating, int count, long long start_ms, long long end_ms,
+                           unsigned int *seed, TableRef *reserved, int max_reserved) {
+    SharedState *shared_state = seating->state;
+
+    if (count <= 0 || end_ms <= start_ms) {
+        return 0;
+    }
+
+    // Kandydaci od stolików 4-osobowych; rezerwacja od teraz wymaga wolnego stolika
+    TableRef candidates[TABLE_SLOTS];
+    int candidate_count = 0;
+    int immediate = (start_ms <= seating->now_ms);
+
+    for (int slot = TABLE_SLOTS - 1; slot >= 0; slot--) {
+        TableRef table = slot_table(slot);
+        if (table.type == 3 && table.index >= shared_state->effective_x3) continue;
+        if (seating->table_reservation_count[slot] >= RESERVATIONS_PER_TABLE) continue;
+        if (immediate && *table_cell(shared_state, &table) != 0) continue;
+        if (table_overlaps(seating, slot, start_ms, end_ms)) continue;
+        candidates[candidate_count++] = table;
+    }
+
+    int to_reserve = (count < candidate_count) ? count : candidate_count;
+    for (int i = 0; i < to_reserve; i++) {
+        int j = i + (rand_r(seed) % (candidate_count - i));
+
+        TableRef temp = candidates[i];
+        candidates[i] = candidates[j];
+        candidates[j] = temp;
+
+        reservation_add(seating, table_slot(candidates[i].type, candidates[i].index), start_ms, end_ms);
+        if (reserved != NULL && i < max_reserved) {
+            reserved[i] = candidates[i];
+        }
+    }
+
+    seating_advance(seating, seating->now_ms);  // Rezerwacje od teraz zajmują stoliki od razu
+    return to_reserve;
+}
+
+int seating_advance(Seating *seating, long long now_ms) {
+    int released = 0;
+
+    if (now_ms > seating->now_ms) {
+        seating->now_ms = now_ms;
+    }
+    while (seating->reservation_event_count > 0 && seating->reservation_events[0].due_ms <= seating->now_ms) {
+        ReservationEvent ev = reservation_event_pop(seating);
+        if (reservation_event_stale(seating, &ev)) {
+            continue;
+        }
+        if (ev.is_start) {
+            reservation_activate(seating, ev.id);
+        } else {
+            released += reservation_finish(seating, ev.id);
+        }
+    }
+
+    // Rezerwacje czekające na odejście grupy zajmują stoliki, które się w międzyczasie zwolniły
+    for (int id = 0; seating->waiting_reservations > 0 && id < MAX_RESERVATIONS; id++) {
+        if (seating->reservations[id].state == RESERVATION_WAITING) {
+            reservation_activate(seating, id);
+        }
+    }
+    return released;
+}
+
+long long seating_next_reservation_ms(Seating *seating) {
+    while (seating->reservation_event_count > 0 &&
+           reservation_event_stale(seating, &seating->reservation_events[0])) {
+        reservation_event_pop(seating);
+    }
+    return seating->reservation_event_count > 0 ? seating->reservation_events[0].due_ms : -1;
+}
+
+int seating_release_reservations(Seating *seating) {
+    SharedState *shared_state = seating->state;
+    int released = 0;
+
+    for (int id = 0; id < MAX_RESERVATIONS; id++) {
+        if (seating->reservations[id].state == RESERVATION_ACTIVE) {
+            TableRef table = slot_table(seating->reservations[id].table);
+            *table_cell(shared_state, &table) = 0;
+            shared_state->total_free_seats += table.seats;
+            released++;
+        }
+    }
+
+    reservations_reset(seating);
+    packed_rebuild(seating);
+    shared_state->reserved_seats = 0;
+    return released;
+}
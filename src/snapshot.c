@@ -0,0 +1,197 @@
+#include "snapshot.h"
+#include "utils.h"
+#include <poll.h>
+#include <stddef.h>
+
+// Niezmienione słowa, od których opłaca się zacząć nowy odcinek (nagłówek odcinka = 2 słowa)
+#define RUN_GAP 3
+
+socklen_t snapshot_socket_address(struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+    // Przestrzeń abstrakcyjna (sun_path[0] == '\0') - gniazdo znika razem z publikatorem
+    int n = snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, "milkbar-snapshot-%d", ipc_instance());
+    return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + n);
+}
+
+long snapshot_encode_delta(const SharedState *prev, const SharedState *cur, unsigned char *out) {
+    const uint32_t *a = (const uint32_t *)prev;
+    const uint32_t *b = (const uint32_t *)cur;
+    size_t len = 0;
+    size_t i = 0;
+
+    while (i < SNAPSHOT_WORDS) {
+        if (a[i] == b[i]) {
+            i++;
+            continue;
+        }
+        // Odcinek kończy się dopiero po RUN_GAP kolejnych niezmienionych słowach
+        size_t start = i;
+        size_t end = i + 1;
+        size_t same = 0;
+        for (size_t j = end; j < SNAPSHOT_WORDS && same < RUN_GAP; j++) {
+            if (a[j] == b[j]) {
+                same++;
+            } else {
+                same = 0;
+                end = j + 1;
+            }
+        }
+
+        size_t words = end - start;
+        size_t need = (2 + words) * sizeof(uint32_t);
+        if (len + need >= SNAPSHOT_MAX_PAYLOAD) {
+            return -1;
+        }
+        uint32_t run[2] = {(uint32_t)start, (uint32_t)words};
+        memcpy(out + len, run, sizeof(run));
+        memcpy(out + len + sizeof(run), b + start, words * sizeof(uint32_t));
+        len += need;
+        i = end;
+    }
+    return (long)len;
+}
+
+int snapshot_apply_delta(SharedState *state, const unsigned char *payload, size_t len) {
+    uint32_t *words = (uint32_t *)state;
+    size_t pos = 0;
+
+    while (pos < len) {
+        uint32_t run[2];
+        if (len - pos < sizeof(run)) {
+            return -1;
+        }
+        memcpy(run, payload + pos, sizeof(run));
+        pos += sizeof(run);
+        size_t bytes = (size_t)run[1] * sizeof(uint32_t);
+        if (run[0] > SNAPSHOT_WORDS || run[1] > SNAPSHOT_WORDS - run[0] || len - pos < bytes) {
+            return -1;
+        }
+        memcpy(words + run[0], payload + pos, bytes);
+        pos += bytes;
+    }
+    return 0;
+}
+
+int snapshot_connect(SnapshotClient *client) {
+    memset(client, 0, sizeof(SnapshotClient));
+    client->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (client->fd == -1) {
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    socklen_t addr_len = snapshot_socket_address(&addr);
+    if (connect(client->fd, (struct sockaddr *)&addr, addr_len) == -1) {
+        int saved = errno;
+        close(client->fd);
+        client->fd = -1;
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+// Nakłada jedną kompletną wiadomość z bufora (od offset); zwraca jej długość, 0 gdy niekompletna, -1 przy błędzie
+static long apply_message(SnapshotClient *client, size_t offset) {
+    SnapshotHeader header;
+    const unsigned char *message = client->in + offset;
+    size_t available = client->in_len - offset;
+    if (available < sizeof(header)) {
+        return 0;
+    }
+    memcpy(&header, message, sizeof(header));
+    if (header.magic != SNAPSHOT_MAGIC || header.state_size != sizeof(SharedState) ||
+        header.payload_len > SNAPSHOT_MAX_PAYLOAD) {
+        errno = EPROTO;
+        return -1;
+    }
+    if (available < sizeof(header) + header.payload_len) {
+        return 0;
+    }
+
+    const unsigned char *payload = message + sizeof(header);
+    if (header.kind == SNAPSHOT_KEYFRAME && header.payload_len == sizeof(SharedState)) {
+        memcpy(&client->state, payload, sizeof(SharedState));
+        client->have_state = 1;
+        client->keyframes++;
+    } else if (header.kind == SNAPSHOT_DELTA && client->have_state && header.seq == client->seq + 1) {
+        if (snapshot_apply_delta(&client->state, payload, header.payload_len) == -1) {
+            errno = EPROTO;
+            return -1;
+        }
+    } else {
+        errno = EPROTO;  // Delta bez klatki bazowej - publikator nigdy tego nie wysyła
+        return -1;
+    }
+    client->seq = header.seq;
+    client->sampled_ns = header.sampled_ns;
+    client->frames++;
+    return (long)(sizeof(header) + header.payload_len);
+}
+
+int snapshot_receive(SnapshotClient *client, int timeout_ms) {
+    int applied = 0;
+    int wait_ms = timeout_ms;
+
+    for (;;) {
+        if (client->in_capacity - client->in_len < sizeof(SnapshotHeader) + SNAPSHOT_MAX_PAYLOAD) {
+            size_t capacity = client->in_len + 2 * (sizeof(SnapshotHeader) + SNAPSHOT_MAX_PAYLOAD);
+            unsigned char *in = realloc(client->in, capacity);
+            if (in == NULL) {
+                return -1;
+            }
+            client->in = in;
+            client->in_capacity = capacity;
+        }
+
+        struct pollfd pfd = {.fd = client->fd, .events = POLLIN, .revents = 0};
+        int ready = poll(&pfd, 1, wait_ms);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                return applied;
+            }
+            return -1;
+        }
+        if (ready == 0) {
+            return applied;
+        }
+
+        ssize_t n = recv(client->fd, client->in + client->in_len, client->in_capacity - client->in_len, MSG_DONTWAIT);
+        if (n == 0) {
+            return -1;  // Publikator zakończył pracę
+        }
+        if (n == -1) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return -1;
+        }
+        client->in_len += (size_t)n;
+        client->bytes += (unsigned long long)n;
+
+        size_t consumed = 0;
+        long used;
+        while ((used = apply_message(client, consumed)) > 0) {
+            consumed += (size_t)used;
+            applied++;
+        }
+        if (used == -1) {
+            return -1;
+        }
+        client->in_len -= consumed;
+        memmove(client->in, client->in + consumed, client->in_len);
+        wait_ms = 0;  // Po pierwszej porcji tylko dobieramy to, co już czeka
+    }
+}
+
+void snapshot_close(SnapshotClient *client) {
+    if (client->fd != -1) {
+        close(client->fd);
+    }
+    free(client->in);
+    client->fd = -1;
+    client->in = NULL;
+    client->in_len = 0;
+    client->in_capacity = 0;
+}
@@ -0,0 +1,352 @@
+#include "soak.h"
+#include "utils.h"
+#include <stdarg.h>
+#include <dirent.h>
+
+#define MQ_DIR "/dev/mqueue"  // Kolejki POSIX widoczne jako pliki (jeśli system plików jest zamontowany)
+
+typedef struct {
+    char name[32];               // "obsluga.rss_kb", "klienci.procesy", "ipc.kolejki_bajty", ...
+    long long tolerance;         // Dopuszczalny wzrost minimum między częściami przebiegu
+    long long bound;             // Znane ograniczenie (log przy limicie rozmiaru) lub 0
+    long long lo[SOAK_BUCKETS];  // Minimum próbek przedziału
+    long long hi[SOAK_BUCKETS];  // Maksimum próbek przedziału
+    int buckets;                 // Zapełnione przedziały
+    int per_bucket;              // Próbek na przedział (podwajane przy łączeniu)
+    int in_bucket;               // Próbek w ostatnim przedziale
+    long long samples;
+    long long first;
+    long long last;
+    long long value;             // Wartość bieżącej próbki
+    int sampled;                 // Wartość zebrana w bieżącej próbce
+} SoakMetric;
+
+static SoakMetric metrics[SOAK_MAX_METRICS];
+static int metric_count = 0;
+static int header_written = 0;
+static FILE *csv = NULL;
+static long long log_limit = 0;
+static long long sample_count = 0;
+
+// Klienci bieżącej próbki
+static long long clients_alive = 0;
+static long long clients_rss_max = 0;
+static long long clients_fd_max = 0;
+
+const char *soak_csv_path(void) {
+    static char path[64];
+    if (ipc_instance() == 0) {
+        snprintf(path, sizeof(path), "logs/soak.csv");
+    } else {
+        snprintf(path, sizeof(path), SOAK_CSV_FORMAT, ipc_instance());
+    }
+    return path;
+}
+
+int soak_init(long long log_bound) {
+    log_limit = log_bound;
+    csv = fopen(soak_csv_path(), "w");
+    return csv != NULL ? 0 : -1;
+}
+
+static SoakMetric *metric(const char *name, long long tolerance) {
+    for (int i = 0; i < metric_count; i++) {
+        if (strcmp(metrics[i].name, name) == 0) {
+            return &metrics[i];
+        }
+    }
+    if (metric_count == SOAK_MAX_METRICS || header_written) {
+        return NULL;  // Zestaw kolumn CSV ustala pierwsza próbka
+    }
+    SoakMetric *m = &metrics[metric_count++];
+    memset(m, 0, sizeof(*m));
+    snprintf(m->name, sizeof(m->name), "%s", name);
+    m->tolerance = tolerance;
+    m->per_bucket = 1;
+    return m;
+}
+
+static void set_value(const char *name, long long value, long long tolerance) {
+    SoakMetric *m = metric(name, tolerance);
+    if (m != NULL) {
+        m->value = value;
+        m->sampled = 1;
+    }
+}
+
+// Dopisuje próbkę do historii; pełna historia jest łączona parami (stała pamięć dla dowolnie długiego przebiegu)
+static void record(SoakMetric *m, long long value) {
+    if (m->samples == 0) {
+        m->first = value;
+    }
+    m->last = value;
+    m->samples++;
+
+    if (m->buckets > 0 && m->in_bucket < m->per_bucket) {
+        int b = m->buckets - 1;
+        if (value < m->lo[b]) m->lo[b] = value;
+        if (value > m->hi[b]) m->hi[b] = value;
+        m->in_bucket++;
+        return;
+    }
+    if (m->buckets == SOAK_BUCKETS) {
+        for (int i = 0; i < SOAK_BUCKETS / 2; i++) {
+            long long lo = m->lo[2 * i] < m->lo[2 * i + 1] ? m->lo[2 * i] : m->lo[2 * i + 1];
+            long long hi = m->hi[2 * i] > m->hi[2 * i + 1] ? m->hi[2 * i] : m->hi[2 * i + 1];
+            m->lo[i] = lo;
+            m->hi[i] = hi;
+        }
+        m->buckets = SOAK_BUCKETS / 2;
+        m->per_bucket *= 2;
+    }
+    m->lo[m->buckets] = value;
+    m->hi[m->buckets] = value;
+    m->buckets++;
+    m->in_bucket = 1;
+}
+
+// RSS w kB z /proc/PID/statm (drugie pole: strony rezydentne)
+static long long process_rss_kb(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/statm", (int)pid);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    long long size = 0, resident = -1;
+    if (fscanf(f, "%lld %lld", &size, &resident) != 2) {
+        resident = -1;
+    }
+    fclose(f);
+    return resident >= 0 ? resident * (sysconf(_SC_PAGESIZE) / 1024) : -1;
+}
+
+static long long process_fds(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/fd", (int)pid);
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return -1;
+    }
+    long long count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+void soak_begin_sample(void) {
+    for (int i = 0; i < metric_count; i++) {
+        metrics[i].sampled = 0;
+    }
+    clients_alive = 0;
+    clients_rss_max = 0;
+    clients_fd_max = 0;
+}
+
+void soak_process(const char *role, pid_t pid) {
+    if (pid <= 0) {
+        return;
+    }
+    long long rss = process_rss_kb(pid);
+    long long fds = process_fds(pid);
+    char name[32];
+    if (rss >= 0) {
+        snprintf(name, sizeof(name), "%s.rss_kb", role);
+        set_value(name, rss, SOAK_RSS_TOLERANCE_KB);
+    }
+    if (fds >= 0) {
+        snprintf(name, sizeof(name), "%s.fd", role);
+        set_value(name, fds, 0);
+    }
+}
+
+void soak_client(pid_t pid) {
+    long long rss = process_rss_kb(pid);
+    long long fds = process_fds(pid);
+    if (rss < 0 || fds < 0) {
+        return;  // Proces właśnie się zakończył
+    }
+    clients_alive++;
+    if (rss > clients_rss_max) clients_rss_max = rss;
+    if (fds > clients_fd_max) clients_fd_max = fds;
+}
+
+// Obiekty System V instancji z /proc/sysvipc/{shm,sem,msg}; dla kolejek także bajty (kolumna cbytes)
+static void count_sysv(const char *path, long long *objects, long long *queue_bytes) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return;
+    }
+    long long first_key = ipc_key(0);
+    char line[512];
+    if (fgets(line, sizeof(line), f) == NULL) {  // Nagłówek
+        fclose(f);
+        return;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        long long key, id, cbytes;
+        unsigned int perms;
+        int fields = sscanf(line, "%lld %lld %o %lld", &key, &id, &perms, &cbytes);
+        if (fields < 2 || key < first_key || key >= first_key + IPC_INSTANCE_STRIDE) {
+            continue;
+        }
+        (*objects)++;
+        if (queue_bytes != NULL && fields == 4) {
+            *queue_bytes += cbytes;
+        }
+    }
+    fclose(f);
+}
+
+// Kolejki POSIX instancji (także skrzynki odpowiedzi grup) i bajty w nich (pole QSIZE)
+static void count_mqueues(long long *objects, long long *queue_bytes) {
+    DIR *dir = opendir(MQ_DIR);
+    if (dir == NULL) {
+        return;
+    }
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "milkbar-%d-", ipc_instance());
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, prefix, strlen(prefix)) != 0) {
+            continue;
+        }
+        (*objects)++;
+        char path[300];
+        snprintf(path, sizeof(path), "%s/%s", MQ_DIR, entry->d_name);
+        FILE *f = fopen(path, "r");
+        if (f != NULL) {
+            long long qsize = 0;
+            if (fscanf(f, "QSIZE:%lld", &qsize) == 1) {
+                *queue_bytes += qsize;
+            }
+            fclose(f);
+        }
+    }
+    closedir(dir);
+}
+
+void soak_end_sample(long long elapsed_ms) {
+    set_value("klienci.procesy", clients_alive, 0);
+    set_value("klienci.rss_kb_max", clients_rss_max, SOAK_RSS_TOLERANCE_KB);
+    set_value("klienci.fd_max", clients_fd_max, 0);
+
+    long long objects = 0, queue_bytes = 0;
+    count_sysv("/proc/sysvipc/shm", &objects, NULL);
+    count_sysv("/proc/sysvipc/sem", &objects, NULL);
+    count_sysv("/proc/sysvipc/msg", &objects, &queue_bytes);
+    count_mqueues(&objects, &queue_bytes);
+    set_value("ipc.obiekty", objects, 0);
+    set_value("ipc.kolejki_bajty", queue_bytes, 0);
+
+    SoakMetric *log_metric = metric("log.bajty", 0);
+    if (log_metric != NULL) {
+        log_metric->bound = log_limit;
+        log_metric->value = log_total_bytes();
+        log_metric->sampled = 1;
+    }
+
+    if (csv != NULL && !header_written) {
+        fprintf(csv, "czas_s");
+        for (int i = 0; i < metric_count; i++) {
+            fprintf(csv, ",%s", metrics[i].name);
+        }
+        fprintf(csv, "\n");
+    }
+    header_written = 1;
+
+    if (csv != NULL) {
+        fprintf(csv, "%.1f", elapsed_ms / 1000.0);
+    }
+    for (int i = 0; i < metric_count; i++) {
+        SoakMetric *m = &metrics[i];
+        if (m->sampled) {
+            record(m, m->value);
+        }
+        if (csv != NULL) {
+            if (m->sampled) {
+                fprintf(csv, ",%lld", m->value);
+            } else {
+                fprintf(csv, ",");  // Rola nie działa
+            }
+        }
+    }
+    if (csv != NULL) {
+        fprintf(csv, "\n");
+        fflush(csv);
+    }
+    sample_count++;
+}
+
+static long long window_floor(const SoakMetric *m, int from, int to) {
+    long long floor = m->lo[from];
+    for (int i = from + 1; i < to; i++) {
+        if (m->lo[i] < floor) floor = m->lo[i];
+    }
+    return floor;
+}
+
+static void report_line(const char *format, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    log_message("%s", line);
+    printf("%s\n", line);
+}
+
+int soak_report(void) {
+    int growing = 0;
+
+    if (csv != NULL) {
+        fclose(csv);
+        csv = NULL;
+    }
+    report_line("SOAK: %lld próbek, %d metryk (próbki: %s)", sample_count, metric_count, soak_csv_path());
+
+    for (int i = 0; i < metric_count; i++) {
+        const SoakMetric *m = &metrics[i];
+        long long max = m->hi[0];
+        for (int b = 1; b < m->buckets; b++) {
+            if (m->hi[b] > max) max = m->hi[b];
+        }
+
+        if (m->bound > 0) {
+            // Log z limitem rozmiaru: rośnie aż do zapełnienia rotacji - oceniany względem ograniczenia
+            int over = max > m->bound;
+            growing += over;
+            report_line("SOAK: %-22s początek %lld, koniec %lld, maks. %lld, limit %lld - %s", m->name, m->first,
+                        m->last, max, m->bound, over ? "PRZEKROCZONY" : "OK");
+            continue;
+        }
+
+        // Rozgrzewka: pierwsza ćwiartka historii, reszta w trzech częściach
+        int warmup = m->buckets / 4;
+        int span = (m->buckets - warmup) / 3;
+        if (m->samples < SOAK_MIN_SAMPLES || span < 1) {
+            report_line("SOAK: %-22s początek %lld, koniec %lld, maks. %lld - za mało próbek", m->name, m->first,
+                        m->last, max);
+            continue;
+        }
+        long long floor1 = window_floor(m, warmup, warmup + span);
+        long long floor2 = window_floor(m, warmup + span, warmup + 2 * span);
+        long long floor3 = window_floor(m, warmup + 2 * span, m->buckets);
+        int grows = floor1 < floor2 && floor2 < floor3 && floor3 - floor1 > m->tolerance;
+        growing += grows;
+        report_line("SOAK: %-22s początek %lld, koniec %lld, maks. %lld, minima części %lld / %lld / %lld - %s",
+                    m->name, m->first, m->last, max, floor1, floor2, floor3, grows ? "ROŚNIE" : "OK");
+    }
+
+    if (growing > 0) {
+        report_line("SOAK: BŁĄD - %d metryk rośnie bez ograniczenia", growing);
+    } else {
+        report_line("SOAK: OK - zasoby wszystkich ról ograniczone");
+    }
+    return growing;
+}
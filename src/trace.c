@@ -0,0 +1,101 @@
+#include "trace.h"
+#include "utils.h"
+#include <dirent.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+int trace_enabled = 0;
+
+static TraceBuffer *buffer = NULL;
+
+static const char *event_names[TRACE_EVENT_COUNT] = {
+    "log",
+    "klient.request", "klient.seat", "klient.pay", "klient.pickup", "klient.eat", "klient.dishes",
+    "obsluga.dequeue", "obsluga.lock", "obsluga.allocate", "obsluga.release", "obsluga.reply",
+    "kasjer.receive", "kasjer.payment", "kasjer.reply",
+};
+
+const char *trace_event_name(int event) {
+    if (event < 0 || event >= TRACE_EVENT_COUNT) {
+        return "?";
+    }
+    return event_names[event];
+}
+
+static void trace_log_span(long long begin_ns) {
+    trace_record(TRACE_LOG, begin_ns, 0, 0);
+}
+
+void trace_init(const char *role) {
+    const char *dir = getenv(TRACE_ENV);
+    if (dir == NULL || dir[0] == '\0' || buffer != NULL) {
+        return;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), TRACE_FILE_FORMAT, dir, (int)getpid());
+    size_t size = sizeof(TraceBuffer) + (size_t)TRACE_CAPACITY * sizeof(TraceEvent);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1 || ftruncate(fd, (off_t)size) == -1) {
+        fprintf(stderr, "TRACE: Nie można utworzyć %s: %s\n", path, strerror(errno));
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "TRACE: mmap %s failed: %s\n", path, strerror(errno));
+        return;
+    }
+
+    buffer = data;
+    buffer->magic = TRACE_MAGIC;
+    buffer->version = TRACE_VERSION;
+    buffer->pid = (int32_t)getpid();
+    buffer->capacity = TRACE_CAPACITY;
+    snprintf(buffer->role, sizeof(buffer->role), "%s", role);
+    trace_enabled = 1;
+    log_trace_hook = trace_log_span;
+}
+
+void trace_record(int event, long long begin_ns, int group_id, int arg) {
+    if (buffer == NULL) {
+        return;
+    }
+    // Sygnały są obsługiwane przez signalfd, ale licznik pozostaje atomowy na wypadek zapisu z handlera
+    uint32_t slot = __atomic_fetch_add(&buffer->count, 1, __ATOMIC_RELAXED);
+    if (slot >= buffer->capacity) {
+        return;
+    }
+    TraceEvent *ev = &buffer->events[slot];
+    ev->begin_ns = begin_ns;
+    ev->duration_ns = monotonic_ns() - begin_ns;
+    ev->event = event;
+    ev->group_id = group_id;
+    ev->arg = arg;
+}
+
+int trace_reset_dir(const char *dir) {
+    if (mkdir(dir, 0755) == -1 && errno != EEXIST) {
+        return -1;
+    }
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        return -1;
+    }
+    int removed = 0;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (strncmp(entry->d_name, "trace-", 6) == 0 && len > 10 && strcmp(entry->d_name + len - 4, ".bin") == 0) {
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+            removed += unlink(path) == 0;
+        }
+    }
+    closedir(d);
+    return removed;
+}
@@ -0,0 +1,300 @@
+#include "common.h"
+#include "trace.h"
+#include <dirent.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Scalanie buforów śledzenia (bar --trace KATALOG) w jeden plik JSON formatu Chrome trace
+// (chrome://tracing, ui.perfetto.dev). Każdy proces to osobny ślad; czas w µs od najwcześniejszego
+// odcinka. Odcinki "queue.*" na śladzie klienta są wyliczane przy scalaniu: od wysłania żądania
+// do jego odbioru przez obsługę lub kasjera - czas spędzony w kolejce.
+
+#define MARK_SEAT_SENT 0      // Koniec klient.request
+#define MARK_SEAT_TAKEN 1     // Koniec obsluga.dequeue z żądaniem stolika
+#define MARK_PAY_SENT 2       // Początek klient.pay
+#define MARK_PAY_TAKEN 3      // Koniec kasjer.receive
+
+typedef struct {
+    const TraceBuffer *buffer;
+    size_t size;
+    uint32_t count;  // Odcinki w buforze (bez nadmiaru ponad capacity)
+} TraceFile;
+
+typedef struct {
+    int group_id;
+    int kind;        // MARK_*
+    long long ns;
+    int pid;         // Proces klienta (ślad, na którym ląduje odcinek kolejki)
+} Mark;
+
+static TraceFile *files = NULL;
+static int file_count = 0;
+
+static int load_file(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        fprintf(stderr, "tracemerge: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(TraceBuffer)) {
+        close(fd);
+        fprintf(stderr, "tracemerge: %s: plik za krótki\n", path);
+        return -1;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "tracemerge: mmap %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    const TraceBuffer *buffer = data;
+    if (buffer->magic != TRACE_MAGIC || buffer->version != TRACE_VERSION ||
+        (size_t)st.st_size < sizeof(TraceBuffer) + (size_t)buffer->capacity * sizeof(TraceEvent)) {
+        fprintf(stderr, "tracemerge: %s: nieznany format bufora\n", path);
+        munmap(data, (size_t)st.st_size);
+        return -1;
+    }
+
+    TraceFile *grown = realloc(files, (size_t)(file_count + 1) * sizeof(TraceFile));
+    if (grown == NULL) {
+        munmap(data, (size_t)st.st_size);
+        return -1;
+    }
+    files = grown;
+    files[file_count].buffer = buffer;
+    files[file_count].size = (size_t)st.st_size;
+    files[file_count].count = buffer->count < buffer->capacity ? buffer->count : buffer->capacity;
+    if (buffer->count > buffer->capacity) {
+        fprintf(stderr, "tracemerge: %s (%s): pominięto %u odcinków ponad pojemność bufora\n", path, buffer->role,
+                buffer->count - buffer->capacity);
+    }
+    file_count++;
+    return 0;
+}
+
+static int load_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        fprintf(stderr, "tracemerge: %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (strncmp(entry->d_name, "trace-", 6) != 0 || len <= 10 || strcmp(entry->d_name + len - 4, ".bin") != 0) {
+            continue;
+        }
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        load_file(path);
+    }
+    closedir(d);
+    return 0;
+}
+
+static int compare_marks(const void *a, const void *b) {
+    const Mark *x = a;
+    const Mark *y = b;
+    if (x->group_id != y->group_id) return x->group_id < y->group_id ? -1 : 1;
+    if (x->ns != y->ns) return x->ns < y->ns ? -1 : 1;
+    return x->kind - y->kind;
+}
+
+static int compare_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static void write_span(FILE *out, int *first, const char *name, const char *cat, int pid, long long begin_ns,
+                       long long duration_ns, int group_id, int arg) {
+    fprintf(out, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,"
+                 "\"args\":{\"group\":%d,\"arg\":%d}}",
+            *first ? "" : ",", name, cat, begin_ns / 1e3, duration_ns / 1e3, pid, pid, group_id, arg);
+    *first = 0;
+}
+
+// Odcinki kolejek: para znaczników (wysłanie, odbiór) tej samej grupy, kolejne w czasie
+static int write_queue_spans(FILE *out, int *first, long long origin_ns) {
+    size_t capacity = 0;
+    for (int f = 0; f < file_count; f++) {
+        capacity += files[f].count;
+    }
+    Mark *marks = malloc((capacity > 0 ? capacity : 1) * sizeof(Mark));
+    if (marks == NULL) {
+        return -1;
+    }
+
+    size_t count = 0;
+    for (int f = 0; f < file_count; f++) {
+        const TraceBuffer *buffer = files[f].buffer;
+        for (uint32_t i = 0; i < files[f].count; i++) {
+            const TraceEvent *ev = &buffer->events[i];
+            Mark mark = {ev->group_id, -1, 0, buffer->pid};
+            if (ev->event == TRACE_KLIENT_REQUEST) {
+                mark.kind = MARK_SEAT_SENT;
+                mark.ns = ev->begin_ns + ev->duration_ns;
+            } else if (ev->event == TRACE_OBSLUGA_DEQUEUE &&
+                       (ev->arg == MSG_TYPE_SEAT_REQUEST || ev->arg == MSG_TYPE_SEAT_AND_PAY)) {
+                mark.kind = MARK_SEAT_TAKEN;
+                mark.ns = ev->begin_ns + ev->duration_ns;
+            } else if (ev->event == TRACE_KLIENT_PAY) {
+                mark.kind = MARK_PAY_SENT;
+                mark.ns = ev->begin_ns;
+            } else if (ev->event == TRACE_KASJER_RECEIVE) {
+                mark.kind = MARK_PAY_TAKEN;
+                mark.ns = ev->begin_ns + ev->duration_ns;
+            }
+            if (mark.kind != -1 && mark.group_id > 0) {
+                marks[count++] = mark;
+            }
+        }
+    }
+    qsort(marks, count, sizeof(Mark), compare_marks);
+
+    int spans = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (marks[i].kind != MARK_SEAT_SENT && marks[i].kind != MARK_PAY_SENT) {
+            continue;
+        }
+        int taken = marks[i].kind == MARK_SEAT_SENT ? MARK_SEAT_TAKEN : MARK_PAY_TAKEN;
+        for (size_t j = i + 1; j < count && marks[j].group_id == marks[i].group_id; j++) {
+            if (marks[j].kind == taken) {
+                write_span(out, first, taken == MARK_SEAT_TAKEN ? "queue.seat" : "queue.payment", "queue",
+                           marks[i].pid, marks[i].ns - origin_ns, marks[j].ns - marks[i].ns, marks[i].group_id, 0);
+                spans++;
+                break;
+            }
+        }
+    }
+    free(marks);
+    return spans;
+}
+
+// Podsumowanie na stderr: liczba, średnia, p99 i maksimum czasu trwania każdego punktu śledzenia
+static void print_summary(void) {
+    fprintf(stderr, "%-18s %8s %12s %12s %12s\n", "odcinek", "liczba", "średnia µs", "p99 µs", "max µs");
+    for (int event = 0; event < TRACE_EVENT_COUNT; event++) {
+        size_t count = 0;
+        for (int f = 0; f < file_count; f++) {
+            for (uint32_t i = 0; i < files[f].count; i++) {
+                count += files[f].buffer->events[i].event == event;
+            }
+        }
+        if (count == 0) {
+            continue;
+        }
+        long long *durations = malloc(count * sizeof(long long));
+        if (durations == NULL) {
+            return;
+        }
+        size_t n = 0;
+        double sum = 0;
+        for (int f = 0; f < file_count; f++) {
+            for (uint32_t i = 0; i < files[f].count; i++) {
+                const TraceEvent *ev = &files[f].buffer->events[i];
+                if (ev->event == event) {
+                    durations[n++] = ev->duration_ns;
+                    sum += ev->duration_ns;
+                }
+            }
+        }
+        qsort(durations, n, sizeof(long long), compare_ll);
+        size_t p99 = (n * 99 + 99) / 100 - 1;
+        fprintf(stderr, "%-18s %8zu %12.1f %12.1f %12.1f\n", trace_event_name(event), n, sum / n / 1e3,
+                durations[p99] / 1e3, durations[n - 1] / 1e3);
+        free(durations);
+    }
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Użycie: %s KATALOG [-o PLIK.json]\n", program);
+    fprintf(stderr, "  KATALOG    katalog buforów z bar --trace\n");
+    fprintf(stderr, "  -o PLIK    wynik w formacie Chrome trace (domyślnie KATALOG/trace.json)\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *dir = NULL;
+    const char *output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (argv[i][0] != '-' && dir == NULL) {
+            dir = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (dir == NULL) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    if (load_dir(dir) == -1) {
+        return 2;
+    }
+    if (file_count == 0) {
+        fprintf(stderr, "tracemerge: Brak buforów śledzenia w %s\n", dir);
+        return 2;
+    }
+
+    char default_output[PATH_MAX];
+    if (output == NULL) {
+        snprintf(default_output, sizeof(default_output), "%s/trace.json", dir);
+        output = default_output;
+    }
+    FILE *out = fopen(output, "w");
+    if (out == NULL) {
+        fprintf(stderr, "tracemerge: %s: %s\n", output, strerror(errno));
+        return 2;
+    }
+
+    long long origin_ns = LLONG_MAX;
+    size_t total = 0;
+    for (int f = 0; f < file_count; f++) {
+        for (uint32_t i = 0; i < files[f].count; i++) {
+            if (files[f].buffer->events[i].begin_ns < origin_ns) {
+                origin_ns = files[f].buffer->events[i].begin_ns;
+            }
+        }
+        total += files[f].count;
+    }
+    if (origin_ns == LLONG_MAX) {
+        origin_ns = 0;
+    }
+
+    int first = 1;
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (int f = 0; f < file_count; f++) {
+        const TraceBuffer *buffer = files[f].buffer;
+        fprintf(out, "%s\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+                first ? "" : ",", buffer->pid, buffer->pid, buffer->role, buffer->pid);
+        first = 0;
+        for (uint32_t i = 0; i < files[f].count; i++) {
+            const TraceEvent *ev = &buffer->events[i];
+            write_span(out, &first, trace_event_name(ev->event), buffer->role, buffer->pid, ev->begin_ns - origin_ns,
+                       ev->duration_ns, ev->group_id, ev->arg);
+        }
+    }
+    int queue_spans = write_queue_spans(out, &first, origin_ns);
+    fprintf(out, "\n]}\n");
+    if (fclose(out) != 0) {
+        fprintf(stderr, "tracemerge: %s: %s\n", output, strerror(errno));
+        return 2;
+    }
+
+    fprintf(stderr, "tracemerge: %d procesów, %zu odcinków, %d odcinków kolejek -> %s\n", file_count, total,
+            queue_spans, output);
+    print_summary();
+
+    for (int f = 0; f < file_count; f++) {
+        munmap((void *)files[f].buffer, files[f].size);
+    }
+    free(files);
+    return 0;
+}
@@ -0,0 +1,1101 @@
+#include "transport.h"
+#include "utils.h"
+#include "wire.h"
+#include <linux/futex.h>
+#include <mqueue.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+static int backend = -1;
+static int ring_shm_id = -1;
+static RingTransport *rings = NULL;
+static volatile sig_atomic_t interrupted = 0;
+
+static mqd_t mq_fds[QUEUE_COUNT];  // Kolejki POSIX klas żądań otwarte w procesie
+static int mq_fds_ready = 0;
+static int mq_owner = 0;            // Proces, który utworzył kolejki (bar) - usuwa je w transport_destroy()
+static mqd_t mq_replies[2] = {(mqd_t)-1, (mqd_t)-1};  // Własne kolejki odpowiedzi grupy
+static int mq_reply_group = 0;
+static const struct timespec mq_no_wait = {0, 0};  // Termin w przeszłości - mq_timed*() nie czeka
+
+static const size_t message_size = sizeof(Message) - sizeof(long);
+
+void transport_select(int id) {
+    backend = id;
+    setenv(TRANSPORT_ENV, transport_name(id), 1);
+}
+
+int transport_parse(const char *name) {
+    if (strcmp(name, "sysv") == 0) return TRANSPORT_SYSV;
+    if (strcmp(name, "ring") == 0) return TRANSPORT_RING;
+    if (strcmp(name, "mq") == 0) return TRANSPORT_MQ;
+    if (strcmp(name, "socket") == 0) return TRANSPORT_SOCKET;
+    return -1;
+}
+
+int transport_backend(void) {
+    if (backend == -1) {
+        const char *env = getenv(TRANSPORT_ENV);
+        backend = env != NULL ? transport_parse(env) : -1;
+        if (backend == -1) {
+            backend = TRANSPORT_SYSV;
+        }
+    }
+    return backend;
+}
+
+const char *transport_name(int id) {
+    switch (id) {
+        case TRANSPORT_RING: return "ring";
+        case TRANSPORT_MQ: return "mq";
+        case TRANSPORT_SOCKET: return "socket";
+        default: return "sysv";
+    }
+}
+
+static int is_reply_queue(int queue) {
+    return queue == QUEUE_SEAT_REPLY || queue == QUEUE_PAY_REPLY;
+}
+
+static long futex(unsigned int *word, int op, unsigned int value, const struct timespec *timeout) {
+    return syscall(SYS_futex, word, op, value, timeout, NULL, 0);
+}
+
+// Czeka, aż *word przestanie mieć wartość value (najwyżej TRANSPORT_WAIT_SLICE_MS)
+static void futex_wait(unsigned int *word, unsigned int value) {
+    struct timespec slice = {0, TRANSPORT_WAIT_SLICE_MS * 1000000L};
+    futex(word, FUTEX_WAIT, value, &slice);  // EAGAIN / ETIMEDOUT / EINTR - wywołujący sprawdza stan sam
+}
+
+static void futex_wake(unsigned int *word, int count) {
+    futex(word, FUTEX_WAKE, (unsigned int)count, NULL);
+}
+
+// Segment pierścieni dołączany przy pierwszym użyciu
+static RingTransport *attach_rings(void) {
+    if (rings == NULL) {
+        int id = shmget(ipc_key(IPC_RING), sizeof(RingTransport), 0);
+        if (id == -1) {
+            handle_error("transport: shmget (pierścienie) failed");
+        }
+        void *addr = shmat(id, NULL, 0);
+        if (addr == (void *)-1) {
+            handle_error("transport: shmat (pierścienie) failed");
+        }
+        rings = (RingTransport *)addr;
+    }
+    return rings;
+}
+
+// --- Kolejki POSIX (jedna kolejka na klasę żądań, kolejki odpowiedzi zakładane przez grupy) ---
+
+static void mq_queue_name(char *name, size_t size, int queue, int group_id) {
+    if (is_reply_queue(queue)) {
+        snprintf(name, size, MQ_REPLY_NAME_FORMAT, ipc_instance(), queue, group_id);
+    } else {
+        snprintf(name, size, MQ_NAME_FORMAT, ipc_instance(), queue);
+    }
+}
+
+static long mq_system_limit(void) {
+    long limit = 10;  // Domyślna wartość jądra
+    FILE *file = fopen(MQ_MSG_MAX_PATH, "r");
+    if (file != NULL) {
+        if (fscanf(file, "%ld", &limit) != 1) {
+            limit = 10;
+        }
+        fclose(file);
+    }
+    return limit;
+}
+
+// Tworzy kolejkę o zadanej pojemności; bez uprawnień do przekroczenia msg_max zostaje limit systemowy
+static mqd_t mq_create(const char *name, long capacity) {
+    struct mq_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.mq_maxmsg = capacity;
+    attr.mq_msgsize = sizeof(Message);
+
+    mq_unlink(name);  // Pozostałość po przerwanym przebiegu
+    mqd_t mqd = mq_open(name, O_RDWR | O_CREAT | O_EXCL, 0600, &attr);
+    if (mqd == (mqd_t)-1 && errno == EINVAL && capacity > mq_system_limit()) {
+        fprintf(stderr, "transport: kolejka %s: pojemność %ld ponad msg_max - zostaje %ld\n",
+                name, capacity, mq_system_limit());
+        attr.mq_maxmsg = mq_system_limit();
+        mqd = mq_open(name, O_RDWR | O_CREAT | O_EXCL, 0600, &attr);
+    }
+    return mqd;
+}
+
+static void mq_reset_fds(void) {
+    if (!mq_fds_ready) {
+        for (int queue = 0; queue < QUEUE_COUNT; queue++) {
+            mq_fds[queue] = (mqd_t)-1;
+        }
+        mq_fds_ready = 1;
+    }
+}
+
+static void mq_create_queues(void) {
+    mq_reset_fds();
+    for (int queue = 0; queue < QUEUE_COUNT; queue++) {
+        if (is_reply_queue(queue)) {
+            continue;
+        }
+        char name[64];
+        mq_queue_name(name, sizeof(name), queue, 0);
+        mq_fds[queue] = mq_create(name, queue_capacity(queue));
+        if (mq_fds[queue] == (mqd_t)-1) {
+            handle_error("transport_create: mq_open failed");
+        }
+    }
+    mq_owner = 1;
+}
+
+static void mq_destroy_queues(void) {
+    for (int queue = 0; mq_fds_ready && queue < QUEUE_COUNT; queue++) {
+        if (mq_fds[queue] == (mqd_t)-1) {
+            continue;
+        }
+        mq_close(mq_fds[queue]);
+        mq_fds[queue] = (mqd_t)-1;
+        if (mq_owner) {
+            char name[64];
+            mq_queue_name(name, sizeof(name), queue, 0);
+            mq_unlink(name);
+        }
+    }
+    mq_owner = 0;
+}
+
+// Kolejka klasy żądań otwierana przy pierwszym użyciu
+static mqd_t mq_request(int queue) {
+    mq_reset_fds();
+    if (mq_fds[queue] == (mqd_t)-1) {
+        char name[64];
+        mq_queue_name(name, sizeof(name), queue, 0);
+        mq_fds[queue] = mq_open(name, O_RDWR);
+        if (mq_fds[queue] == (mqd_t)-1) {
+            handle_error("transport: mq_open failed");
+        }
+    }
+    return mq_fds[queue];
+}
+
+static struct timespec mq_slice_deadline(void) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);  // mq_timed*() przyjmują termin bezwzględny CLOCK_REALTIME
+    deadline.tv_nsec += TRANSPORT_WAIT_SLICE_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return deadline;
+}
+
+static int mq_send_to(mqd_t mqd, int queue, const Message *msg, int flags) {
+    if (mq_timedsend(mqd, (const char *)msg, sizeof(Message), 0, &mq_no_wait) == 0) {
+        return 0;
+    }
+    if (errno != ETIMEDOUT && errno != EAGAIN) {
+        return -1;
+    }
+    queue_note_full(queue);
+    if (flags & IPC_NOWAIT) {
+        errno = EAGAIN;
+        return -1;
+    }
+    // Czekanie w odcinkach - obsługa sygnałów z SA_RESTART wznawiałaby zwykłe mq_send()
+    for (;;) {
+        struct timespec deadline = mq_slice_deadline();
+        if (mq_timedsend(mqd, (const char *)msg, sizeof(Message), 0, &deadline) == 0) {
+            return 0;
+        }
+        if (errno != ETIMEDOUT && errno != EINTR) {
+            return -1;
+        }
+        if (interrupted) {
+            errno = EINTR;
+            return -1;
+        }
+    }
+}
+
+static ssize_t mq_receive_from(mqd_t mqd, Message *msg, int flags) {
+    for (;;) {
+        struct timespec deadline = (flags & IPC_NOWAIT) ? mq_no_wait : mq_slice_deadline();
+        if (mq_timedreceive(mqd, (char *)msg, sizeof(Message), NULL, &deadline) >= 0) {
+            return (ssize_t)message_size;
+        }
+        if (errno == ETIMEDOUT || errno == EAGAIN) {
+            if (flags & IPC_NOWAIT) {
+                errno = ENOMSG;
+                return -1;
+            }
+        } else if (errno != EINTR) {
+            return -1;
+        }
+        if (interrupted) {
+            errno = EINTR;
+            return -1;
+        }
+    }
+}
+
+// Odpowiedź do kolejki grupy - otwierana na czas jednej wysyłki (ENOENT, gdy grupa już wyszła)
+static int mq_send_reply(int queue, const Message *msg) {
+    char name[64];
+    mq_queue_name(name, sizeof(name), queue, (int)msg->mtype);
+    mqd_t mqd = mq_open(name, O_WRONLY);
+    if (mqd == (mqd_t)-1) {
+        return -1;
+    }
+    int result = mq_send_to(mqd, queue, msg, IPC_NOWAIT);
+    int saved_errno = errno;
+    mq_close(mqd);
+    errno = saved_errno;
+    return result;
+}
+
+static int mq_open_replies(int group_id) {
+    mq_reply_group = group_id;
+    for (int i = 0; i < 2; i++) {
+        char name[64];
+        mq_queue_name(name, sizeof(name), i == 0 ? QUEUE_SEAT_REPLY : QUEUE_PAY_REPLY, group_id);
+        mq_replies[i] = mq_create(name, MQ_REPLY_CAPACITY);
+        if (mq_replies[i] == (mqd_t)-1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void mq_close_replies(void) {
+    for (int i = 0; i < 2; i++) {
+        if (mq_replies[i] != (mqd_t)-1) {
+            char name[64];
+            mq_queue_name(name, sizeof(name), i == 0 ? QUEUE_SEAT_REPLY : QUEUE_PAY_REPLY, mq_reply_group);
+            mq_close(mq_replies[i]);
+            mq_unlink(name);
+            mq_replies[i] = (mqd_t)-1;
+        }
+    }
+    mq_reply_group = 0;
+}
+
+static ssize_t mq_receive_reply(int queue, Message *msg, long group_id, int flags) {
+    if (mq_reply_group == 0 || group_id != mq_reply_group) {
+        errno = ENOENT;
+        return -1;
+    }
+    return mq_receive_from(mq_replies[queue == QUEUE_PAY_REPLY], msg, flags);
+}
+
+// --- Gniazda (usługi obsługi i kasjera; klienci łączą się z nimi, odpowiedzi wracają połączeniem żądania) ---
+
+typedef struct {
+    Message msg[SOCKET_INBOX_CAPACITY];
+    int head;
+    int count;
+} SocketInbox;
+
+typedef struct {
+    int group_id;  // MAILBOX_FREE lub grupa czekająca na odpowiedź
+    int peer;
+} SocketRoute;
+
+static const char *const socket_env[SOCKET_SERVICES] = {SOCKET_SEATING_ENV, SOCKET_CASHIER_ENV};
+static const char *const socket_role[SOCKET_SERVICES] = {"obsluga", "kasjer"};
+static char socket_addr[SOCKET_SERVICES][WIRE_ADDR_MAX];
+
+static int sock_service = -1;  // Usługa otwarta w procesie przez transport_listen()
+static int sock_listen_fd = -1;
+static int sock_epoll_fd = -1;  // Gniazdo nasłuchujące i połączenia klientów (data.u32: 0 lub slot + 1)
+static WireConn *sock_peers[SOCKET_MAX_PEERS];
+static SocketRoute sock_routes[SOCKET_ROUTE_SLOTS];
+static WireConn *sock_upstream[SOCKET_SERVICES];  // Połączenia z usługami (strona klienta)
+static int sock_upstream_lost[SOCKET_SERVICES];
+static SocketInbox sock_inbox[QUEUE_COUNT];
+static volatile sig_atomic_t sock_fire = 0;
+
+// Usługa obsługująca klasę ruchu (-1: QUEUE_POOL zostaje kolejką System V)
+static int socket_service_of(int queue) {
+    switch (queue) {
+        case QUEUE_PAYMENT:
+        case QUEUE_PAY_REPLY: return SOCKET_CASHIER;
+        case QUEUE_POOL: return -1;
+        default: return SOCKET_SEATING;
+    }
+}
+
+const char *transport_address(int service) {
+    if (socket_addr[service][0] == '\0') {
+        const char *env = getenv(socket_env[service]);
+        if (env != NULL && env[0] != '\0') {
+            snprintf(socket_addr[service], WIRE_ADDR_MAX, "%s", env);
+        } else {
+            snprintf(socket_addr[service], WIRE_ADDR_MAX, SOCKET_PATH_FORMAT, ipc_instance(), socket_role[service]);
+        }
+    }
+    return socket_addr[service];
+}
+
+static unsigned int route_home(int group_id) {
+    return ((unsigned int)group_id * 2654435761u) & (SOCKET_ROUTE_SLOTS - 1);
+}
+
+static void route_set(int group_id, int peer) {
+    unsigned int i = route_home(group_id);
+    for (int probe = 0; probe < SOCKET_ROUTE_SLOTS; probe++, i = (i + 1) & (SOCKET_ROUTE_SLOTS - 1)) {
+        SocketRoute *route = &sock_routes[i];
+        if (route->group_id == group_id && route->peer != peer) {
+            // Dwa połączenia z tym samym group_id - odpowiedź trafi tylko do ostatniego
+            fprintf(stderr, "transport: grupa #%d czeka już w innym połączeniu - generatory z tym samym --node?\n",
+                    group_id);
+        }
+        if (route->group_id == group_id || route->group_id == MAILBOX_FREE) {
+            route->group_id = group_id;
+            route->peer = peer;
+            return;
+        }
+    }
+}
+
+// Usuwa trasę przesuwając w jej miejsce dalsze trasy łańcucha (bez znaczników usunięcia - przez
+// usługę przechodzą dziesiątki tysięcy grup, a wyszukiwanie ma zostać krótkie)
+static void route_remove(unsigned int hole) {
+    unsigned int i = hole;
+    for (;;) {
+        i = (i + 1) & (SOCKET_ROUTE_SLOTS - 1);
+        if (sock_routes[i].group_id == MAILBOX_FREE) {
+            break;
+        }
+        unsigned int home = route_home(sock_routes[i].group_id);
+        if (((i - home) & (SOCKET_ROUTE_SLOTS - 1)) >= ((i - hole) & (SOCKET_ROUTE_SLOTS - 1))) {
+            sock_routes[hole] = sock_routes[i];
+            hole = i;
+        }
+    }
+    sock_routes[hole].group_id = MAILBOX_FREE;
+}
+
+// Zdejmuje trasę odpowiedzi grupy; -1, gdy grupa nie czeka (rozłączona lub już obsłużona)
+static int route_take(int group_id) {
+    unsigned int i = route_home(group_id);
+    for (int probe = 0; probe < SOCKET_ROUTE_SLOTS; probe++, i = (i + 1) & (SOCKET_ROUTE_SLOTS - 1)) {
+        if (sock_routes[i].group_id == group_id) {
+            int peer = sock_routes[i].peer;
+            route_remove(i);
+            return peer;
+        }
+        if (sock_routes[i].group_id == MAILBOX_FREE) {
+            break;
+        }
+    }
+    return -1;
+}
+
+static void drop_peer(int slot) {
+    wire_conn_free(sock_peers[slot]);  // close() usuwa deskryptor także z epoll
+    sock_peers[slot] = NULL;
+    for (unsigned int i = 0; i < SOCKET_ROUTE_SLOTS; i++) {
+        // Po przesunięciu na miejsce i może trafić kolejna trasa tego połączenia - sprawdzana ponownie
+        while (sock_routes[i].group_id != MAILBOX_FREE && sock_routes[i].peer == slot) {
+            route_remove(i);
+        }
+    }
+}
+
+static int inbox_room(void) {
+    for (int queue = 0; queue < QUEUE_COUNT; queue++) {
+        if (sock_inbox[queue].count == SOCKET_INBOX_CAPACITY) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void inbox_put(int queue, const Message *msg) {
+    SocketInbox *inbox = &sock_inbox[queue];
+    inbox->msg[(inbox->head + inbox->count) % SOCKET_INBOX_CAPACITY] = *msg;
+    inbox->count++;
+}
+
+// Pierwsza wiadomość o typie mtype (0 = dowolna); kolejność pozostałych jest zachowana
+static int inbox_take(int queue, Message *msg, long mtype) {
+    SocketInbox *inbox = &sock_inbox[queue];
+    for (int k = 0; k < inbox->count; k++) {
+        int pos = (inbox->head + k) % SOCKET_INBOX_CAPACITY;
+        if (mtype != 0 && inbox->msg[pos].mtype != mtype) {
+            continue;
+        }
+        *msg = inbox->msg[pos];
+        for (; k > 0; k--) {
+            int prev = (inbox->head + k - 1) % SOCKET_INBOX_CAPACITY;
+            inbox->msg[(inbox->head + k) % SOCKET_INBOX_CAPACITY] = inbox->msg[prev];
+        }
+        inbox->head = (inbox->head + 1) % SOCKET_INBOX_CAPACITY;
+        inbox->count--;
+        return 1;
+    }
+    return 0;
+}
+
+// Dekoduje odebrane dane połączenia do skrzynek klas ruchu (peer = -1: połączenie z usługą)
+static int decode(WireConn *conn, int peer) {
+    int queue;
+    Message msg;
+    while (inbox_room()) {
+        int rc = wire_next(conn, &queue, &msg);
+        if (rc <= 0) {
+            return rc;
+        }
+        if (queue == WIRE_BROADCAST) {
+            if (msg.mtype == MSG_TYPE_FIRE) {
+                sock_fire = 1;
+                interrupted = 1;  // Oczekujące odbiory kończą się EINTR - jak po sygnale ewakuacji
+            }
+            continue;
+        }
+        if (peer >= 0 && (queue == QUEUE_SEAT || queue == QUEUE_PAYMENT) && msg.group_id > 0) {
+            route_set(msg.group_id, peer);
+        }
+        inbox_put(queue, &msg);
+    }
+    return 0;
+}
+
+static void accept_peers(void) {
+    for (;;) {
+        int fd = accept4(sock_listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            return;  // EAGAIN - brak kolejnych połączeń
+        }
+        int slot = 0;
+        while (slot < SOCKET_MAX_PEERS && sock_peers[slot] != NULL) {
+            slot++;
+        }
+        WireConn *conn = slot < SOCKET_MAX_PEERS ? wire_conn_new(fd) : NULL;
+        if (conn == NULL) {
+            close(fd);
+            continue;
+        }
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u32 = (uint32_t)slot + 1;
+        if (epoll_ctl(sock_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            wire_conn_free(conn);
+            continue;
+        }
+        sock_peers[slot] = conn;
+    }
+}
+
+// Dane połączenia czekające na miejsce w skrzynkach - dekodowane przy kolejnym odczycie
+static int sock_stalled = 0;
+
+// Czyta i dekoduje dane połączenia; -1, gdy połączenie zostało zamknięte lub złamało protokół
+static int read_conn(WireConn *conn, int peer) {
+    if (!inbox_room()) {
+        sock_stalled = 1;  // Dane czekają w gnieździe - epoll zgłosi je ponownie
+        return 0;
+    }
+    if (wire_fill(conn) == -1 || decode(conn, peer) == -1) {
+        return -1;
+    }
+    if (!inbox_room()) {
+        sock_stalled = 1;
+    }
+    return 0;
+}
+
+static void lose_upstream(int service) {
+    wire_conn_free(sock_upstream[service]);
+    sock_upstream[service] = NULL;
+    sock_upstream_lost[service] = 1;  // Usługa zamknięta (koniec symulacji) - odbiory kończą się ECONNRESET
+}
+
+// Odczytuje bez czekania wszystko, co nadeszło: nowe połączenia, żądania klientów, odpowiedzi usług
+static void socket_pump(void) {
+    if (sock_stalled && inbox_room()) {
+        sock_stalled = 0;
+        for (int slot = 0; sock_epoll_fd != -1 && slot < SOCKET_MAX_PEERS; slot++) {
+            if (sock_peers[slot] != NULL && decode(sock_peers[slot], slot) == -1) {
+                drop_peer(slot);
+            }
+        }
+        for (int service = 0; service < SOCKET_SERVICES; service++) {
+            if (sock_upstream[service] != NULL && decode(sock_upstream[service], -1) == -1) {
+                lose_upstream(service);
+            }
+        }
+        if (!inbox_room()) {
+            sock_stalled = 1;
+        }
+    }
+    if (sock_epoll_fd != -1) {
+        struct epoll_event events[64];
+        int n = epoll_wait(sock_epoll_fd, events, 64, 0);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u32 == 0) {
+                accept_peers();
+                continue;
+            }
+            int slot = (int)events[i].data.u32 - 1;
+            if (sock_peers[slot] != NULL && read_conn(sock_peers[slot], slot) == -1) {
+                drop_peer(slot);
+            }
+        }
+    }
+    for (int service = 0; service < SOCKET_SERVICES; service++) {
+        if (sock_upstream[service] != NULL && read_conn(sock_upstream[service], -1) == -1) {
+            lose_upstream(service);
+        }
+    }
+}
+
+// Wysyła ramki wszystkich połączeń (wait = 0: tyle, ile przyjmą gniazda)
+static void socket_flush_all(int wait) {
+    for (int slot = 0; sock_epoll_fd != -1 && slot < SOCKET_MAX_PEERS; slot++) {
+        if (sock_peers[slot] != NULL && wire_flush(sock_peers[slot], wait) == -1) {
+            drop_peer(slot);
+        }
+    }
+    for (int service = 0; service < SOCKET_SERVICES; service++) {
+        if (sock_upstream[service] != NULL && wire_flush(sock_upstream[service], wait) == -1) {
+            lose_upstream(service);
+        }
+    }
+}
+
+// Połączenie z usługą nawiązywane przy pierwszym użyciu; usługa może jeszcze nie nasłuchiwać
+static WireConn *socket_upstream(int service) {
+    if (sock_upstream[service] != NULL || sock_upstream_lost[service]) {
+        if (sock_upstream[service] == NULL) {
+            errno = ECONNRESET;
+        }
+        return sock_upstream[service];
+    }
+    const char *addr = transport_address(service);
+    int fd;
+    for (int waited_ms = 0;; waited_ms += 10) {
+        fd = wire_connect(addr);
+        if (fd != -1 || (errno != ECONNREFUSED && errno != ENOENT) || waited_ms >= SOCKET_CONNECT_TIMEOUT_MS ||
+            interrupted) {
+            break;
+        }
+        usleep(10000);
+    }
+    if (fd == -1) {
+        return NULL;
+    }
+    sock_upstream[service] = wire_conn_new(fd);
+    if (sock_upstream[service] == NULL) {
+        close(fd);
+        errno = ENOMEM;
+    }
+    return sock_upstream[service];
+}
+
+static int socket_serves(int queue) {
+    return sock_service != -1 && socket_service_of(queue) == sock_service;
+}
+
+static int socket_send(int queue, const Message *msg) {
+    WireConn *conn;
+    int slot = -1;
+    int service = socket_service_of(queue);
+    if (is_reply_queue(queue) && socket_serves(queue)) {
+        slot = route_take((int)msg->mtype);
+        if (slot == -1 || sock_peers[slot] == NULL) {
+            errno = ENOENT;  // Grupa już wyszła lub rozłączyła się
+            return -1;
+        }
+        conn = sock_peers[slot];
+    } else {
+        conn = socket_upstream(service);
+        if (conn == NULL) {
+            return -1;
+        }
+    }
+
+    // Pełna ramka wychodzi od razu; niepełna czeka na odbiór lub transport_flush()
+    if (wire_queue(conn, queue, msg) == -1 || (conn->frame_count == 0 && wire_flush(conn, 0) == -1)) {
+        int saved_errno = errno;
+        if (slot != -1) {
+            drop_peer(slot);
+        } else {
+            lose_upstream(service);
+        }
+        errno = saved_errno;
+        return -1;
+    }
+    return 0;
+}
+
+static ssize_t socket_receive(int queue, Message *msg, long mtype, int flags) {
+    int service = socket_service_of(queue);
+    for (;;) {
+        if (inbox_take(queue, msg, mtype)) {
+            return (ssize_t)message_size;
+        }
+        socket_flush_all(!(flags & IPC_NOWAIT));
+        socket_pump();
+        if (inbox_take(queue, msg, mtype)) {
+            return (ssize_t)message_size;
+        }
+        if (interrupted) {
+            errno = EINTR;
+            return -1;
+        }
+        if (!socket_serves(queue) && socket_upstream(service) == NULL) {
+            return -1;  // ECONNRESET po zamknięciu usługi lub błąd połączenia
+        }
+        if (flags & IPC_NOWAIT) {
+            errno = ENOMSG;
+            return -1;
+        }
+
+        struct pollfd pfd = {socket_serves(queue) ? sock_epoll_fd : sock_upstream[service]->fd, POLLIN, 0};
+        poll(&pfd, 1, TRANSPORT_WAIT_SLICE_MS);
+    }
+}
+
+int transport_listen(int service) {
+    if (transport_backend() != TRANSPORT_SOCKET) {
+        return 0;
+    }
+    sock_listen_fd = wire_listen(transport_address(service));
+    sock_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = 0;
+    if (sock_listen_fd == -1 || sock_epoll_fd == -1 ||
+        epoll_ctl(sock_epoll_fd, EPOLL_CTL_ADD, sock_listen_fd, &ev) == -1) {
+        int saved_errno = errno;
+        transport_reset();
+        errno = saved_errno;
+        return -1;
+    }
+    sock_service = service;
+    return 0;
+}
+
+void transport_reset(void) {
+    for (int slot = 0; slot < SOCKET_MAX_PEERS; slot++) {
+        if (sock_peers[slot] != NULL) {
+            wire_conn_free(sock_peers[slot]);
+            sock_peers[slot] = NULL;
+        }
+    }
+    for (int service = 0; service < SOCKET_SERVICES; service++) {
+        wire_conn_free(sock_upstream[service]);
+        sock_upstream[service] = NULL;
+        sock_upstream_lost[service] = 0;
+    }
+    if (sock_listen_fd != -1) {
+        close(sock_listen_fd);
+        sock_listen_fd = -1;
+    }
+    if (sock_epoll_fd != -1) {
+        close(sock_epoll_fd);
+        sock_epoll_fd = -1;
+    }
+    sock_service = -1;
+    sock_stalled = 0;
+    memset(sock_routes, 0, sizeof(sock_routes));
+    memset(sock_inbox, 0, sizeof(sock_inbox));
+}
+
+void transport_flush(void) {
+    if (transport_backend() == TRANSPORT_SOCKET) {
+        socket_flush_all(1);
+    }
+}
+
+int transport_broadcast(const Message *msg) {
+    int sent = 0;
+    for (int slot = 0; sock_epoll_fd != -1 && slot < SOCKET_MAX_PEERS; slot++) {
+        if (sock_peers[slot] == NULL) {
+            continue;
+        }
+        if (wire_queue(sock_peers[slot], WIRE_BROADCAST, msg) == -1 || wire_flush(sock_peers[slot], 1) == -1) {
+            drop_peer(slot);
+            continue;
+        }
+        sent++;
+    }
+    return sent;
+}
+
+int transport_fire_alarm(void) {
+    return sock_fire;
+}
+
+void transport_create(void) {
+    if (transport_backend() == TRANSPORT_MQ) {
+        mq_create_queues();
+        return;
+    }
+    if (transport_backend() != TRANSPORT_RING) {
+        return;
+    }
+    ring_shm_id = shmget(ipc_key(IPC_RING), sizeof(RingTransport), IPC_CREAT | 0600);
+    if (ring_shm_id == -1) {
+        handle_error("transport_create: shmget failed");
+    }
+    RingTransport *t = attach_rings();
+    memset(t, 0, sizeof(RingTransport));
+    for (int queue = 0; queue < QUEUE_COUNT; queue++) {
+        for (unsigned int i = 0; i < RING_CAPACITY; i++) {
+            t->rings[queue].cells[i].seq = i;
+        }
+    }
+}
+
+void transport_destroy(void) {
+    mq_destroy_queues();
+    if (transport_backend() == TRANSPORT_SOCKET) {
+        transport_reset();
+        for (int service = 0; service < SOCKET_SERVICES; service++) {
+            wire_unlink(transport_address(service));
+        }
+    }
+    if (rings != NULL) {
+        shmdt(rings);
+        rings = NULL;
+    }
+    if (ring_shm_id != -1) {
+        shmctl(ring_shm_id, IPC_RMID, NULL);
+        ring_shm_id = -1;
+    }
+}
+
+void transport_interrupt(void) {
+    interrupted = 1;
+}
+
+// --- Pierścień żądań (kolejka ograniczona z numerami sekwencyjnymi komórek) ---
+
+static int ring_push(Ring *ring, const Message *msg) {
+    unsigned int pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    RingCell *cell;
+    for (;;) {
+        cell = &ring->cells[pos & (RING_CAPACITY - 1)];
+        unsigned int seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        int diff = (int)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -1;  // Pełny - komórka nie została jeszcze odczytana
+        } else {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+    cell->msg = *msg;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static int ring_pop(Ring *ring, Message *msg) {
+    unsigned int pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    RingCell *cell;
+    for (;;) {
+        cell = &ring->cells[pos & (RING_CAPACITY - 1)];
+        unsigned int seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        int diff = (int)(seq - (pos + 1));
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -1;  // Pusty
+        } else {
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+    *msg = cell->msg;
+    __atomic_store_n(&cell->seq, pos + RING_CAPACITY, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static int ring_send(Ring *ring, int queue, const Message *msg, int flags) {
+    if (ring_push(ring, msg) == -1) {
+        queue_note_full(queue);
+        if (flags & IPC_NOWAIT) {
+            errno = EAGAIN;
+            return -1;
+        }
+        // Pełny pierścień to stan wyjątkowy - nadawca odczekuje, aż odbiorca zwolni komórki
+        while (ring_push(ring, msg) == -1) {
+            if (interrupted) {
+                errno = EINTR;
+                return -1;
+            }
+            usleep(1000);
+        }
+    }
+    // Budzenie tylko wtedy, gdy konsument śpi - w przeciwnym razie wysyłka nie robi wywołań systemowych
+    if (__atomic_load_n(&ring->waiters, __ATOMIC_SEQ_CST) > 0) {
+        __atomic_add_fetch(&ring->wake, 1, __ATOMIC_SEQ_CST);
+        futex_wake(&ring->wake, 1);
+    }
+    return 0;
+}
+
+static ssize_t ring_receive(Ring *ring, Message *msg, int flags) {
+    for (;;) {
+        if (ring_pop(ring, msg) == 0) {
+            return (ssize_t)message_size;
+        }
+        if (flags & IPC_NOWAIT) {
+            errno = ENOMSG;
+            return -1;
+        }
+        if (interrupted) {
+            errno = EINTR;
+            return -1;
+        }
+        // Zgłoszenie snu przed ponownym sprawdzeniem - producent, który to zobaczy, zmieni słowo futeksu
+        unsigned int wake = __atomic_load_n(&ring->wake, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&ring->waiters, 1, __ATOMIC_SEQ_CST);
+        if (ring_pop(ring, msg) == 0) {
+            __atomic_sub_fetch(&ring->waiters, 1, __ATOMIC_SEQ_CST);
+            return (ssize_t)message_size;
+        }
+        futex_wait(&ring->wake, wake);
+        __atomic_sub_fetch(&ring->waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+// --- Skrzynki odpowiedzi (haszowanie otwarte po group_id, usuwanie przez znacznik MAILBOX_DELETED) ---
+
+static unsigned int mailbox_home(int group_id) {
+    return ((unsigned int)group_id * 2654435761u) & (MAILBOX_SLOTS - 1);
+}
+
+static MailboxSlot *mailbox_find(int group_id) {
+    RingTransport *t = attach_rings();
+    unsigned int i = mailbox_home(group_id);
+    for (int probe = 0; probe < MAILBOX_SLOTS; probe++, i = (i + 1) & (MAILBOX_SLOTS - 1)) {
+        int owner = __atomic_load_n(&t->mailboxes[i].owner, __ATOMIC_ACQUIRE);
+        if (owner == group_id) {
+            return &t->mailboxes[i];
+        }
+        if (owner == MAILBOX_FREE) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+int transport_mailbox_open(int group_id) {
+    if (transport_backend() == TRANSPORT_MQ) {
+        if (mq_open_replies(group_id) == -1) {
+            int saved_errno = errno;
+            mq_close_replies();
+            errno = saved_errno;
+            return -1;
+        }
+        return 0;
+    }
+    if (transport_backend() != TRANSPORT_RING) {
+        return 0;
+    }
+    RingTransport *t = attach_rings();
+    unsigned int i = mailbox_home(group_id);
+    // Skrzynkę zakłada wyłącznie sama grupa, więc nie ma wyścigu o ten sam group_id
+    for (int probe = 0; probe < MAILBOX_SLOTS; probe++, i = (i + 1) & (MAILBOX_SLOTS - 1)) {
+        MailboxSlot *slot = &t->mailboxes[i];
+        int owner = __atomic_load_n(&slot->owner, __ATOMIC_ACQUIRE);
+        if (owner != MAILBOX_FREE && owner != MAILBOX_DELETED) {
+            continue;
+        }
+        // Nieodebrana odpowiedź poprzedniego właściciela; skrzynkę w trakcie zapisu (2) nadawca sam
+        // wycofa, gdy zobaczy nowego właściciela
+        for (int b = 0; b < 2; b++) {
+            unsigned int stale = 1;
+            __atomic_compare_exchange_n(&slot->box[b].full, &stale, 0, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+        }
+        if (__atomic_compare_exchange_n(&slot->owner, &owner, group_id, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            return 0;
+        }
+    }
+    errno = ENOSPC;
+    return -1;
+}
+
+void transport_mailbox_close(int group_id) {
+    if (transport_backend() == TRANSPORT_MQ) {
+        mq_close_replies();
+        return;
+    }
+    if (transport_backend() == TRANSPORT_SOCKET) {
+        socket_flush_all(1);  // Ostatnia wiadomość grupy (naczynia) nie czeka na odpowiedź
+        return;
+    }
+    if (transport_backend() != TRANSPORT_RING) {
+        return;
+    }
+    MailboxSlot *slot = mailbox_find(group_id);
+    if (slot != NULL) {
+        __atomic_store_n(&slot->owner, MAILBOX_DELETED, __ATOMIC_RELEASE);
+    }
+}
+
+static int mailbox_send(int queue, const Message *msg) {
+    MailboxSlot *slot = mailbox_find((int)msg->mtype);
+    if (slot == NULL) {
+        errno = ENOENT;  // Grupa już wyszła (np. ewakuacja)
+        return -1;
+    }
+    Mailbox *box = &slot->box[queue == QUEUE_PAY_REPLY];
+    unsigned int empty = 0;
+    if (!__atomic_compare_exchange_n(&box->full, &empty, 2, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        queue_note_full(queue);  // Grupa czeka na jedną odpowiedź naraz - druga to błąd protokołu
+        errno = EAGAIN;
+        return -1;
+    }
+    box->msg = *msg;
+    __atomic_store_n(&box->full, 1, __ATOMIC_SEQ_CST);
+    // Grupa mogła zamknąć skrzynkę po mailbox_find(), a inna zająć zwolniony slot - odpowiedź
+    // wycofana (gdy odbiorca zdążył ją wziąć, odrzuci ją po mtype)
+    if (__atomic_load_n(&slot->owner, __ATOMIC_SEQ_CST) != (int)msg->mtype) {
+        unsigned int published = 1;
+        __atomic_compare_exchange_n(&box->full, &published, 0, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+        errno = ENOENT;
+        return -1;
+    }
+    futex_wake(&box->full, 1);  // Grupa prawie zawsze śpi, czekając na odpowiedź
+    return 0;
+}
+
+static ssize_t mailbox_receive(int queue, Message *msg, long group_id, int flags) {
+    MailboxSlot *slot = mailbox_find((int)group_id);
+    if (slot == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+    Mailbox *box = &slot->box[queue == QUEUE_PAY_REPLY];
+    for (;;) {
+        unsigned int full = __atomic_load_n(&box->full, __ATOMIC_ACQUIRE);
+        if (full == 1) {
+            *msg = box->msg;
+            __atomic_store_n(&box->full, 0, __ATOMIC_RELEASE);
+            if (msg->mtype == group_id) {
+                return (ssize_t)message_size;
+            }
+            continue;  // Spóźniona odpowiedź dla poprzedniego właściciela slotu
+        }
+        if (flags & IPC_NOWAIT) {
+            errno = ENOMSG;
+            return -1;
+        }
+        if (interrupted) {
+            errno = EINTR;
+            return -1;
+        }
+        futex_wait(&box->full, full);
+    }
+}
+
+int transport_send(int queue, const Message *msg, int flags) {
+    if (transport_backend() == TRANSPORT_SYSV || (transport_backend() == TRANSPORT_SOCKET && queue == QUEUE_POOL)) {
+        return queue_send(queue, msg, flags);
+    }
+    if (transport_backend() == TRANSPORT_SOCKET) {
+        return socket_send(queue, msg);
+    }
+    if (transport_backend() == TRANSPORT_MQ) {
+        return is_reply_queue(queue) ? mq_send_reply(queue, msg) : mq_send_to(mq_request(queue), queue, msg, flags);
+    }
+    if (is_reply_queue(queue)) {
+        return mailbox_send(queue, msg);
+    }
+    return ring_send(&attach_rings()->rings[queue], queue, msg, flags);
+}
+
+ssize_t transport_receive(int queue, Message *msg, long mtype, int flags) {
+    if (transport_backend() == TRANSPORT_SYSV || (transport_backend() == TRANSPORT_SOCKET && queue == QUEUE_POOL)) {
+        return msgrcv(get_message_queue(queue), msg, message_size, mtype, flags);
+    }
+    if (transport_backend() == TRANSPORT_SOCKET) {
+        return socket_receive(queue, msg, mtype, flags);
+    }
+    if (transport_backend() == TRANSPORT_MQ) {
+        return is_reply_queue(queue) ? mq_receive_reply(queue, msg, mtype, flags) : mq_receive_from(mq_request(queue), msg, flags);
+    }
+    if (is_reply_queue(queue)) {
+        return mailbox_receive(queue, msg, mtype, flags);
+    }
+    return ring_receive(&attach_rings()->rings[queue], msg, flags);
+}
+
+// --- Podgląd kolejek bez zdejmowania wiadomości (punkt kontrolny) ---
+
+#ifndef MSG_COPY
+#define MSG_COPY 040000  // Linux: msgrcv() kopiuje wiadomość o numerze msgtyp, zostawiając ją w kolejce
+#endif
+
+static int ring_peek(Ring *ring, int index, Message *msg) {
+    unsigned int pos = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) + (unsigned int)index;
+    RingCell *cell = &ring->cells[pos & (RING_CAPACITY - 1)];
+    if (index >= RING_CAPACITY || __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != pos + 1) {
+        errno = ENOMSG;  // Koniec kolejki (lub komórka w trakcie zapisu)
+        return -1;
+    }
+    *msg = cell->msg;
+    return 0;
+}
+
+// Pełne skrzynki danej klasy odpowiedzi w kolejności slotów - każda grupa ma najwyżej jedną odpowiedź
+static int mailbox_peek(int queue, int index, Message *msg) {
+    RingTransport *t = attach_rings();
+    for (int i = 0; i < MAILBOX_SLOTS; i++) {
+        int owner = __atomic_load_n(&t->mailboxes[i].owner, __ATOMIC_ACQUIRE);
+        if (owner == MAILBOX_FREE || owner == MAILBOX_DELETED) {
+            continue;
+        }
+        Mailbox *box = &t->mailboxes[i].box[queue == QUEUE_PAY_REPLY];
+        if (__atomic_load_n(&box->full, __ATOMIC_ACQUIRE) != 1 || box->msg.mtype != owner || index-- > 0) {
+            continue;
+        }
+        *msg = box->msg;
+        return 0;
+    }
+    errno = ENOMSG;
+    return -1;
+}
+
+int transport_peek(int queue, int index, Message *msg) {
+    if (transport_backend() == TRANSPORT_SYSV) {
+        // ENOSYS: jądro bez CONFIG_CHECKPOINT_RESTORE nie zna MSG_COPY
+        return msgrcv(get_message_queue(queue), msg, message_size, index, IPC_NOWAIT | MSG_COPY) == -1 ? -1 : 0;
+    }
+    if (transport_backend() == TRANSPORT_RING) {
+        return is_reply_queue(queue) ? mailbox_peek(queue, index, msg)
+                                     : ring_peek(&attach_rings()->rings[queue], index, msg);
+    }
+    errno = ENOSYS;
+    return -1;
+}
+
+int transport_poll_fd(int queue) {
+    if (transport_backend() == TRANSPORT_SOCKET && queue != QUEUE_POOL) {
+        if (socket_serves(queue)) {
+            return sock_epoll_fd;
+        }
+        WireConn *conn = socket_upstream(socket_service_of(queue));
+        return conn != NULL ? conn->fd : -1;
+    }
+    if (transport_backend() != TRANSPORT_MQ || is_reply_queue(queue)) {
+        return -1;
+    }
+    return (int)mq_request(queue);  // W Linuksie mqd_t jest deskryptorem pliku
+}
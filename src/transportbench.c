@@ -0,0 +1,235 @@
+#include "common.h"
+#include "utils.h"
+#include "transport.h"
+
+// Pomiar backendów transportu na własnej instancji IPC (nie wymaga działającego baru):
+//   round-trip - klient wysyła żądanie QUEUE_SEAT, serwer odsyła odpowiedź QUEUE_SEAT_REPLY
+//   przepustowość - P producentów wysyła po M wiadomości QUEUE_DISHES do jednego konsumenta
+#define DEFAULT_ROUNDTRIPS 20000
+#define DEFAULT_PRODUCERS 4
+#define DEFAULT_MESSAGES 50000
+#define BENCH_GROUP_ID 1
+#define BENCH_STOP -1  // group_size wiadomości kończącej serwer
+
+static int compare_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static Message bench_message(long mtype, int group_id, int group_size) {
+    Message msg;
+    msg.mtype = mtype;
+    msg.group_id = group_id;
+    msg.group_size = group_size;
+    msg.table_type = 0;
+    msg.table_index = 0;
+    return msg;
+}
+
+// Serwer round-trip: odbija każde żądanie do skrzynki nadawcy
+static void echo_server(void) {
+    Message msg;
+    for (;;) {
+        if (transport_receive(QUEUE_SEAT, &msg, 0, 0) == -1) {
+            if (errno == EINTR) continue;
+            handle_error("transportbench: odbiór żądania failed");
+        }
+        if (msg.group_size == BENCH_STOP) {
+            _exit(EXIT_SUCCESS);
+        }
+        Message reply = bench_message(msg.group_id, msg.group_id, msg.group_size);
+        if (transport_send(QUEUE_SEAT_REPLY, &reply, 0) == -1) {
+            handle_error("transportbench: wysyłka odpowiedzi failed");
+        }
+    }
+}
+
+static void bench_roundtrip(int rounds) {
+    pid_t server = fork();
+    if (server == -1) {
+        handle_error("transportbench: fork failed");
+    }
+    if (server == 0) {
+        transport_reset();
+        if (transport_listen(SOCKET_SEATING) == -1) {
+            handle_error("transportbench: transport_listen failed");
+        }
+        echo_server();
+    }
+
+    if (transport_mailbox_open(BENCH_GROUP_ID) == -1) {
+        handle_error("transportbench: transport_mailbox_open failed");
+    }
+
+    long long *samples = malloc((size_t)rounds * sizeof(long long));
+    if (samples == NULL) {
+        handle_error("transportbench: malloc failed");
+    }
+
+    int warmup = rounds / 10;
+    for (int i = -warmup; i < rounds; i++) {
+        Message request = bench_message(MSG_TYPE_SEAT_REQUEST, BENCH_GROUP_ID, 1);
+        Message reply;
+        long long start = monotonic_ns();
+        if (transport_send(QUEUE_SEAT, &request, 0) == -1 ||
+            transport_receive(QUEUE_SEAT_REPLY, &reply, BENCH_GROUP_ID, 0) == -1) {
+            handle_error("transportbench: round-trip failed");
+        }
+        if (i >= 0) {
+            samples[i] = monotonic_ns() - start;
+        }
+    }
+
+    Message stop = bench_message(MSG_TYPE_SEAT_REQUEST, BENCH_GROUP_ID, BENCH_STOP);
+    transport_send(QUEUE_SEAT, &stop, 0);
+    transport_flush();
+    waitpid(server, NULL, 0);
+    transport_reset();
+    transport_mailbox_close(BENCH_GROUP_ID);
+
+    long long sum = 0;
+    for (int i = 0; i < rounds; i++) {
+        sum += samples[i];
+    }
+    qsort(samples, (size_t)rounds, sizeof(long long), compare_ll);
+    printf("  round-trip:     śr. %7.2f us   p50 %7.2f us   p99 %7.2f us   (%d wymian)\n",
+           (double)sum / rounds / 1e3, samples[rounds / 2] / 1e3,
+           samples[(int)((long long)rounds * 99 / 100)] / 1e3, rounds);
+    free(samples);
+}
+
+static void bench_throughput(int producers, int messages) {
+    pid_t *pids = malloc((size_t)producers * sizeof(pid_t));
+    if (pids == NULL) {
+        handle_error("transportbench: malloc failed");
+    }
+
+    // Gniazda: konsument jest usługą, producenci łączą się z nią jak klienci
+    if (transport_listen(SOCKET_SEATING) == -1) {
+        handle_error("transportbench: transport_listen failed");
+    }
+
+    long long start = monotonic_ns();
+    for (int p = 0; p < producers; p++) {
+        pids[p] = fork();
+        if (pids[p] == -1) {
+            handle_error("transportbench: fork failed");
+        }
+        if (pids[p] == 0) {
+            transport_reset();
+            for (int i = 0; i < messages; i++) {
+                Message msg = bench_message(MSG_TYPE_DISHES, p + 1, i);
+                if (transport_send(QUEUE_DISHES, &msg, 0) == -1) {
+                    handle_error("transportbench: wysyłka failed");
+                }
+            }
+            transport_flush();
+            _exit(EXIT_SUCCESS);
+        }
+    }
+
+    // Kontrola kolejności per producent - każdy backend zachowuje FIFO jednego nadawcy
+    int *next = calloc((size_t)producers, sizeof(int));
+    if (next == NULL) {
+        handle_error("transportbench: calloc failed");
+    }
+    long total = (long)producers * messages;
+    long out_of_order = 0;
+    for (long n = 0; n < total; n++) {
+        Message msg;
+        if (transport_receive(QUEUE_DISHES, &msg, 0, 0) == -1) {
+            if (errno == EINTR) {
+                n--;
+                continue;
+            }
+            handle_error("transportbench: odbiór failed");
+        }
+        int p = msg.group_id - 1;
+        if (msg.group_size != next[p]) {
+            out_of_order++;
+        }
+        next[p] = msg.group_size + 1;
+    }
+    long long elapsed = monotonic_ns() - start;
+
+    for (int p = 0; p < producers; p++) {
+        waitpid(pids[p], NULL, 0);
+    }
+    transport_reset();
+    printf("  przepustowość:  %7.0f tys. wiad./s   (%d nadawców x %d, %.1f ms%s)\n",
+           total / (elapsed / 1e9) / 1e3, producers, messages, elapsed / 1e6,
+           out_of_order > 0 ? ", BŁĄD KOLEJNOŚCI" : "");
+    free(next);
+    free(pids);
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Użycie: %s [--transport sysv|ring|mq|socket|all] [-n WYMIANY] [-p NADAWCY] [-m WIADOMOŚCI]\n", program);
+    fprintf(stderr, "  -n N   liczba wymian round-trip (domyślnie %d)\n", DEFAULT_ROUNDTRIPS);
+    fprintf(stderr, "  -p P   liczba nadawców w pomiarze przepustowości (domyślnie %d)\n", DEFAULT_PRODUCERS);
+    fprintf(stderr, "  -m M   wiadomości na nadawcę (domyślnie %d)\n", DEFAULT_MESSAGES);
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = DEFAULT_ROUNDTRIPS;
+    int producers = DEFAULT_PRODUCERS;
+    int messages = DEFAULT_MESSAGES;
+    int only = -1;  // -1 = wszystkie backendy
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--transport") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "all") != 0) {
+                only = transport_parse(argv[i]);
+                if (only == -1) {
+                    print_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+            }
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            producers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            messages = atoi(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (rounds < 1 || producers < 1 || messages < 1) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (ipc_claim_instance(-1, NULL) == -1) {
+        return EXIT_FAILURE;
+    }
+    create_shared_memory();
+    create_message_queues();
+    SharedState *state = get_shared_memory();
+
+    int backends[] = {TRANSPORT_SYSV, TRANSPORT_RING, TRANSPORT_MQ, TRANSPORT_SOCKET};
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        if (only != -1 && backends[b] != only) {
+            continue;
+        }
+        transport_select(backends[b]);
+        transport_create();
+        memset(state->queue_full, 0, sizeof(state->queue_full));
+
+        printf("Transport %s:\n", transport_name(backends[b]));
+        fflush(stdout);
+        bench_roundtrip(rounds);
+        fflush(stdout);
+        bench_throughput(producers, messages);
+        printf("  pełna kolejka:  %lu razy\n", state->queue_full[QUEUE_DISHES]);
+        fflush(stdout);
+    }
+
+    shmdt(state);
+    transport_destroy();
+    cleanup_ipc();
+    return EXIT_SUCCESS;
+}
@@ -1,22 +1,226 @@
 #include "common.h"
 #include "utils.h"
+#include "lockprof.h"
 #include <stdarg.h>
+#include <mqueue.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 static int log_fd = -1;
 static int log_sem_id = -1;
+static ino_t log_ino = 0;               // I-węzeł otwartego pliku logu (rotacja przez inny proces)
+static long long log_max_bytes = -1;    // -1 = konfiguracja rotacji jeszcze nie wczytana
+static long log_rotate_s = 0;
 static int shm_id = -1;
-static int msg_id = -1;
+static int msg_ids[QUEUE_COUNT];
+static int msg_ids_ready = 0;
 static int sem_id = -1;
+static int instance_id = -1;
+
+void (*log_trace_hook)(long long begin_ns) = NULL;
+
+// Pojemność kolejek w komunikatach (msg_qbytes = pojemność * rozmiar treści). Na każdą grupę przypada
+// najwyżej jedna wiadomość w każdej kolejce, więc 256 pokrywa z zapasem wszystkie grupy w sali i kolejce.
+static const int queue_capacities[QUEUE_COUNT] = {256, 256, 256, 16, 256, 256, 256};
+static const char *queue_names[QUEUE_COUNT] = {
+    "miejsca", "naczynia", "płatności", "polecenia", "pula", "odp. miejsca", "odp. płatności",
+};
+
+int ipc_instance(void) {
+    if (instance_id == -1) {
+        instance_id = 0;
+        const char *env = getenv(INSTANCE_ENV);
+        if (env != NULL) {
+            int id = atoi(env);
+            if (id >= 0 && id < MAX_INSTANCES) {
+                instance_id = id;
+            }
+        }
+    }
+    return instance_id;
+}
+
+void ipc_set_instance(int id) {
+    char buffer[16];
+    instance_id = id;
+    snprintf(buffer, sizeof(buffer), "%d", id);
+    setenv(INSTANCE_ENV, buffer, 1);  // Dziedziczone przez wszystkie uruchamiane role
+}
+
+static key_t instance_key(int id, int object) {
+    return (key_t)(IPC_KEY_BASE + id * IPC_INSTANCE_STRIDE + object);
+}
+
+key_t ipc_key(int object) {
+    return instance_key(ipc_instance(), object);
+}
+
+const char *log_file_path(void) {
+    static char path[64];
+    if (ipc_instance() == 0) {
+        snprintf(path, sizeof(path), "logs/symulacja.log");
+    } else {
+        snprintf(path, sizeof(path), "logs/symulacja-%d.log", ipc_instance());
+    }
+    return path;
+}
+
+int ipc_instance_in_use(int id) {
+    int id_shm = shmget(instance_key(id, IPC_SHM), 0, 0);
+    if (id_shm == -1) {
+        return 0;
+    }
+    
+    struct shmid_ds ds;
+    if (shmctl(id_shm, IPC_STAT, &ds) == -1) {
+        return 0;
+    }
+    
+    // Segment żywej instancji jest dołączony przez bar lub role (także po awarii samego baru).
+    // Segment jeszcze nigdy niedołączony należy do baru, który właśnie zajmuje instancję, o ile jego
+    // twórca żyje - sam PID twórcy nie wystarcza, bo po awarii może go dostać inny proces
+    if (ds.shm_nattch > 0) {
+        return 1;
+    }
+    if (ds.shm_atime == 0 && (kill(ds.shm_cpid, 0) == 0 || errno == EPERM)) {
+        return 1;
+    }
+    return 0;
+}
+
+// Kolejki odpowiedzi grup (MQ_REPLY_NAME_FORMAT) zostawione przez przebieg z --transport mq, który
+// uległ awarii - nazwy z systemu plików mqueue; bez niego nie da się ich wyliczyć
+static int remove_reply_queues(int id) {
+    DIR *dir = opendir(MQ_FS_DIR);
+    if (dir == NULL) {
+        return 0;
+    }
+    int removed = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int instance, queue, group_id, end = 0;
+        // Nazwa w katalogu to MQ_REPLY_NAME_FORMAT bez początkowego '/'
+        if (sscanf(entry->d_name, "milkbar-%d-%d-%d%n", &instance, &queue, &group_id, &end) != 3 ||
+            entry->d_name[end] != '\0' || instance != id) {
+            continue;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), MQ_REPLY_NAME_FORMAT, instance, queue, group_id);
+        if (mq_unlink(name) == 0) {
+            removed++;
+        }
+    }
+    closedir(dir);
+    return removed;
+}
+
+int ipc_remove_instance(int id) {
+    int removed = 0;
+    
+    int shms[] = {IPC_SHM, IPC_RING, IPC_LOCKPROF};
+    for (size_t i = 0; i < sizeof(shms) / sizeof(shms[0]); i++) {
+        int id_shm = shmget(instance_key(id, shms[i]), 0, 0);
+        if (id_shm != -1 && shmctl(id_shm, IPC_RMID, NULL) == 0) {
+            removed++;
+        }
+    }
+    
+    for (int queue = 0; queue < QUEUE_COUNT; queue++) {
+        int id_msg = msgget(instance_key(id, IPC_MSG_BASE + queue), 0);
+        if (id_msg != -1 && msgctl(id_msg, IPC_RMID, NULL) == 0) {
+            removed++;
+        }
+        
+        char name[64];
+        snprintf(name, sizeof(name), MQ_NAME_FORMAT, id, queue);
+        if (mq_unlink(name) == 0) {
+            removed++;
+        }
+    }
+    
+    removed += remove_reply_queues(id);
+    
+    int sems[] = {IPC_SEM, IPC_LOG_SEM};
+    for (size_t i = 0; i < sizeof(sems) / sizeof(sems[0]); i++) {
+        int id_sem = semget(instance_key(id, sems[i]), 0, 0);
+        if (id_sem != -1 && semctl(id_sem, 0, IPC_RMID) == 0) {
+            removed++;
+        }
+    }
+    
+    return removed;
+}
+
+int ipc_cleanup_stale(void) {
+    int cleaned = 0;
+    for (int id = 0; id < MAX_INSTANCES; id++) {
+        if (!ipc_instance_in_use(id) && ipc_remove_instance(id) > 0) {
+            cleaned++;
+        }
+    }
+    return cleaned;
+}
+
+int ipc_claim_instance(int requested, int *stale_removed) {
+    int first = (requested >= 0) ? requested : 0;
+    int last = (requested >= 0) ? requested : MAX_INSTANCES - 1;
+    
+    if (stale_removed != NULL) {
+        *stale_removed = 0;
+    }
+    
+    for (int id = first; id <= last; id++) {
+        if (ipc_instance_in_use(id)) {
+            if (requested >= 0) {
+                fprintf(stderr, "ipc_claim_instance: instancja %d jest używana przez działający bar\n", id);
+                return -1;
+            }
+            continue;
+        }
+        
+        int removed = ipc_remove_instance(id);  // Pozostałości po instancji, która uległa awarii
+        
+        // IPC_EXCL rozstrzyga wyścig dwóch barów uruchamianych jednocześnie
+        int id_shm = shmget(instance_key(id, IPC_SHM), sizeof(SharedState), IPC_CREAT | IPC_EXCL | 0600);
+        if (id_shm == -1) {
+            if (errno == EEXIST && requested < 0) {
+                continue;
+            }
+            perror("ipc_claim_instance: shmget failed");
+            return -1;
+        }
+        
+        shm_id = id_shm;
+        ipc_set_instance(id);
+        if (stale_removed != NULL) {
+            *stale_removed = removed;
+        }
+        return id;
+    }
+    
+    fprintf(stderr, "ipc_claim_instance: brak wolnej instancji\n");
+    return -1;
+}
 
 void handle_error(const char *msg) {
     perror(msg);
     exit(EXIT_FAILURE);
 }
 
+// Ścieżka pliku rotacji: symulacja.log.1 (najnowszy) .. symulacja.log.LOG_ROTATE_KEEP
+static void rotated_log_path(char *out, size_t size, int index) {
+    snprintf(out, size, "%s.%d", log_file_path(), index);
+}
+
 void init_logger(void) {
-    const char *log_file = "logs/symulacja.log";
+    const char *log_file = log_file_path();
     
     unlink(log_file);
+    for (int i = 1; i <= LOG_ROTATE_KEEP; i++) {
+        char rotated[80];
+        rotated_log_path(rotated, sizeof(rotated), i);
+        unlink(rotated);
+    }
     
     log_fd = creat(log_file, 0644);
     if (log_fd == -1) {
@@ -30,7 +234,7 @@ void init_logger(void) {
         exit(EXIT_FAILURE);
     }
     
-    log_sem_id = semget(LOG_SEM_KEY, 1, IPC_CREAT | 0600);
+    log_sem_id = semget(ipc_key(IPC_LOG_SEM), 1, IPC_CREAT | 0600);
     if (log_sem_id == -1) {
         perror("init_logger: semget log semaphore failed");
         exit(EXIT_FAILURE);
@@ -42,28 +246,73 @@ void init_logger(void) {
     }
 }
 
-void log_message(const char *format, ...) {
-    char buffer[1024];
-    char log_entry[2048];
-    va_list args;
-    time_t now;
-    struct tm *timeinfo;
-    pid_t pid = getpid();
-    
-    va_start(args, format);
-    vsnprintf(buffer, sizeof(buffer), format, args);
-    va_end(args);
-    
-    time(&now);
-    timeinfo = localtime(&now);
-    
-    snprintf(log_entry, sizeof(log_entry), 
-             "[%02d:%02d:%02d] [PID:%d] %s\n",
-             timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec,
-             (int)pid, buffer);
-    
+long long log_total_bytes(void) {
+    long long total = 0;
+    struct stat st;
+    if (stat(log_file_path(), &st) == 0) {
+        total += st.st_size;
+    }
+    for (int i = 1; i <= LOG_ROTATE_KEEP; i++) {
+        char rotated[80];
+        rotated_log_path(rotated, sizeof(rotated), i);
+        if (stat(rotated, &st) == 0) {
+            total += st.st_size;
+        }
+    }
+    return total;
+}
+
+static void load_log_rotation(void) {
+    const char *max_bytes = getenv(LOG_MAX_BYTES_ENV);
+    const char *period = getenv(LOG_ROTATE_S_ENV);
+    log_max_bytes = max_bytes != NULL ? atoll(max_bytes) : 0;
+    log_rotate_s = period != NULL ? atol(period) : 0;
+    if (log_max_bytes < 0) log_max_bytes = 0;
+    if (log_rotate_s < 0) log_rotate_s = 0;
+}
+
+static void reopen_log(void) {
+    struct stat st;
+    if (log_fd != -1) {
+        close(log_fd);
+    }
+    log_fd = open(log_file_path(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    log_ino = (log_fd != -1 && fstat(log_fd, &st) == 0) ? st.st_ino : 0;
+}
+
+// Wywoływana pod semaforem logu przed zapisem. Jedno stat() na zapis, tylko przy włączonej rotacji
+static void rotate_log_if_due(void) {
+    const char *path = log_file_path();
+    struct stat st;
+    if (stat(path, &st) == -1 || st.st_ino != log_ino) {
+        reopen_log();  // Plik przeniesiony przez inny proces
+        if (log_fd == -1 || fstat(log_fd, &st) == -1) {
+            return;
+        }
+    }
+
+    time_t now = time(NULL);
+    int due = (log_max_bytes > 0 && st.st_size >= log_max_bytes) ||
+              (log_rotate_s > 0 && st.st_size > 0 && now / log_rotate_s != st.st_mtime / log_rotate_s);
+    if (!due) {
+        return;
+    }
+
+    char from[80], to[80];
+    for (int i = LOG_ROTATE_KEEP - 1; i >= 1; i--) {
+        rotated_log_path(from, sizeof(from), i);
+        rotated_log_path(to, sizeof(to), i + 1);
+        rename(from, to);  // Brak pliku (ENOENT) - rotacji było mniej niż LOG_ROTATE_KEEP
+    }
+    rotated_log_path(to, sizeof(to), 1);
+    if (rename(path, to) == 0) {
+        reopen_log();
+    }
+}
+
+static void write_log_entry(const char *log_entry) {
     if (log_sem_id == -1) {
-        log_sem_id = semget(LOG_SEM_KEY, 1, 0);
+        log_sem_id = semget(ipc_key(IPC_LOG_SEM), 1, 0);
         if (log_sem_id == -1) {
             fprintf(stdout, "%s", log_entry);
             return;
@@ -71,7 +320,7 @@ void log_message(const char *format, ...) {
     }
     
     if (log_fd == -1) {
-        log_fd = open("logs/symulacja.log", O_WRONLY | O_APPEND, 0644);
+        log_fd = open(log_file_path(), O_WRONLY | O_APPEND, 0644);
     }
     
     struct sembuf sem_op;
@@ -79,6 +328,9 @@ void log_message(const char *format, ...) {
     sem_op.sem_op = -1;
     sem_op.sem_flg = 0;
     
+    // Zapis pod innym semaforem (obsługa pod SEM_SHARED_STATE) to osobne miejsce w profilu blokad
+    const char *log_site = lockprof_enabled && lockprof_holding() ? "log_message (zagnieżdżony)" : "log_message";
+    long long wait_start = lockprof_begin();
     while (semop(log_sem_id, &sem_op, 1) == -1) {
         if (errno == EINTR) {
             continue;
@@ -86,6 +338,14 @@ void log_message(const char *format, ...) {
         fprintf(stdout, "%s", log_entry);
         return;
     }
+    LockHold hold = lockprof_acquired("log", log_site, wait_start);
+    
+    if (log_max_bytes == -1) {
+        load_log_rotation();
+    }
+    if (log_max_bytes > 0 || log_rotate_s > 0) {
+        rotate_log_if_due();
+    }
     
     if (log_fd != -1) {
         ssize_t written = write(log_fd, log_entry, strlen(log_entry));
@@ -96,11 +356,40 @@ void log_message(const char *format, ...) {
         fprintf(stdout, "%s", log_entry);
     }
     
+    lockprof_released(&hold);
     sem_op.sem_op = 1;
     while (semop(log_sem_id, &sem_op, 1) == -1 && errno == EINTR) {
     }
 }
 
+void log_message(const char *format, ...) {
+    char buffer[1024];
+    char log_entry[2048];
+    va_list args;
+    time_t now;
+    struct tm *timeinfo;
+    pid_t pid = getpid();
+    long long trace_start = log_trace_hook != NULL ? monotonic_ns() : 0;
+    
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    
+    time(&now);
+    timeinfo = localtime(&now);
+    
+    snprintf(log_entry, sizeof(log_entry), 
+             "[%02d:%02d:%02d] [PID:%d] %s\n",
+             timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec,
+             (int)pid, buffer);
+    
+    write_log_entry(log_entry);
+    
+    if (log_trace_hook != NULL) {
+        log_trace_hook(trace_start);
+    }
+}
+
 void close_logger(void) {
     if (log_fd != -1) {
         close(log_fd);
@@ -111,7 +400,7 @@ void close_logger(void) {
 int create_shared_memory(void) {
     size_t size = sizeof(SharedState);
     
-    shm_id = shmget(SHM_KEY, size, IPC_CREAT | 0600);
+    shm_id = shmget(ipc_key(IPC_SHM), size, IPC_CREAT | 0600);
     if (shm_id == -1) {
         perror("create_shared_memory: shmget failed");
         exit(EXIT_FAILURE);
@@ -135,18 +424,30 @@ int create_shared_memory(void) {
     return shm_id;
 }
 
-int create_message_queue(void) {
-    msg_id = msgget(MSG_KEY, IPC_CREAT | 0600);
-    if (msg_id == -1) {
-        perror("create_message_queue: msgget failed");
-        exit(EXIT_FAILURE);
+void create_message_queues(void) {
+    for (int queue = 0; queue < QUEUE_COUNT; queue++) {
+        msg_ids[queue] = msgget(ipc_key(IPC_MSG_BASE + queue), IPC_CREAT | 0600);
+        if (msg_ids[queue] == -1) {
+            perror("create_message_queues: msgget failed");
+            exit(EXIT_FAILURE);
+        }
+        
+        struct msqid_ds ds;
+        if (msgctl(msg_ids[queue], IPC_STAT, &ds) == -1) {
+            perror("create_message_queues: msgctl IPC_STAT failed");
+            exit(EXIT_FAILURE);
+        }
+        ds.msg_qbytes = (msglen_t)queue_capacities[queue] * (sizeof(Message) - sizeof(long));
+        if (msgctl(msg_ids[queue], IPC_SET, &ds) == -1) {
+            fprintf(stderr, "create_message_queues: msgctl IPC_SET (kolejka %s): %s - zostaje limit domyślny\n",
+                    queue_names[queue], strerror(errno));
+        }
     }
-    
-    return msg_id;
+    msg_ids_ready = 1;
 }
 
 int create_semaphores(void) {
-    sem_id = semget(SEM_KEY, 1, IPC_CREAT | 0600);
+    sem_id = semget(ipc_key(IPC_SEM), SEM_COUNT, IPC_CREAT | 0600);
     if (sem_id == -1) {
         perror("create_semaphores: semget failed");
         exit(EXIT_FAILURE);
@@ -157,18 +458,73 @@ int create_semaphores(void) {
         exit(EXIT_FAILURE);
     }
     
+    if (semctl(sem_id, SEM_READY, SETVAL, 0) == -1 || semctl(sem_id, SEM_START, SETVAL, 0) == -1) {
+        perror("create_semaphores: semctl SETVAL SEM_READY/SEM_START failed");
+        exit(EXIT_FAILURE);
+    }
+    
     return sem_id;
 }
 
+long long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void role_signal_ready(void) {
+    struct sembuf sem_op = {SEM_READY, 1, 0};
+    while (semop(get_semaphores(), &sem_op, 1) == -1) {
+        if (errno != EINTR) {
+            perror("role_signal_ready: semop failed");
+            return;
+        }
+    }
+}
+
+int role_wait_start(void) {
+    struct sembuf sem_op = {SEM_START, -1, 0};
+    if (semop(get_semaphores(), &sem_op, 1) == -1) {
+        return -1;  // EINTR (zakończenie przed startem) lub usunięte semafory
+    }
+    return 0;
+}
+
+int wait_roles_ready(int count, int timeout_ms) {
+    struct sembuf sem_op = {SEM_READY, (short)-count, 0};
+    struct timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+    
+    if (semtimedop(sem_id, &sem_op, 1, &timeout) == -1) {
+        return -1;  // EAGAIN (upłynął czas) lub EINTR
+    }
+    return 0;
+}
+
+void release_start_gate(int count) {
+    struct sembuf sem_op = {SEM_START, (short)count, 0};
+    if (semop(sem_id, &sem_op, 1) == -1) {
+        perror("release_start_gate: semop failed");
+    }
+}
+
 void cleanup_ipc(void) {
     if (shm_id != -1) {
         shmctl(shm_id, IPC_RMID, NULL);
         shm_id = -1;
     }
     
-    if (msg_id != -1) {
-        msgctl(msg_id, IPC_RMID, NULL);
-        msg_id = -1;
+    int lockprof_shm = shmget(ipc_key(IPC_LOCKPROF), 0, 0);  // Wspólny profil blokad (bar --lockprof)
+    if (lockprof_shm != -1) {
+        shmctl(lockprof_shm, IPC_RMID, NULL);
+    }
+    
+    for (int queue = 0; msg_ids_ready && queue < QUEUE_COUNT; queue++) {
+        if (msg_ids[queue] != -1) {
+            msgctl(msg_ids[queue], IPC_RMID, NULL);
+            msg_ids[queue] = -1;
+        }
     }
     
     if (sem_id != -1) {
@@ -185,7 +541,7 @@ void cleanup_ipc(void) {
 }
 
 SharedState* get_shared_memory(void) {
-    int id = shmget(SHM_KEY, 0, 0);
+    int id = shmget(ipc_key(IPC_SHM), 0, 0);
     if (id == -1) {
         handle_error("get_shared_memory: shmget failed");
     }
@@ -198,16 +554,64 @@ SharedState* get_shared_memory(void) {
     return state;
 }
 
-int get_message_queue(void) {
-    int id = msgget(MSG_KEY, 0);
-    if (id == -1) {
-        handle_error("get_message_queue: msgget failed");
+int get_message_queue(int queue) {
+    if (!msg_ids_ready) {
+        for (int i = 0; i < QUEUE_COUNT; i++) {
+            msg_ids[i] = -1;
+        }
+        msg_ids_ready = 1;
     }
-    return id;
+    if (msg_ids[queue] == -1) {
+        msg_ids[queue] = msgget(ipc_key(IPC_MSG_BASE + queue), 0);
+        if (msg_ids[queue] == -1) {
+            handle_error("get_message_queue: msgget failed");
+        }
+    }
+    return msg_ids[queue];
+}
+
+// Licznik przepełnień w pamięci współdzielonej - segment dołączany dopiero przy pierwszym przepełnieniu
+void queue_note_full(int queue) {
+    static SharedState *state = NULL;
+    if (state == NULL) {
+        int id = shmget(ipc_key(IPC_SHM), 0, 0);
+        void *addr = id == -1 ? (void *)-1 : shmat(id, NULL, 0);
+        if (addr == (void *)-1) {
+            return;
+        }
+        state = (SharedState *)addr;
+    }
+    __atomic_add_fetch(&state->queue_full[queue], 1, __ATOMIC_RELAXED);
+}
+
+int queue_send(int queue, const Message *msg, int flags) {
+    int id = get_message_queue(queue);
+    size_t size = sizeof(Message) - sizeof(long);
+    
+    if (msgsnd(id, msg, size, IPC_NOWAIT) == 0) {
+        return 0;
+    }
+    if (errno != EAGAIN) {
+        return -1;
+    }
+    queue_note_full(queue);
+    if (flags & IPC_NOWAIT) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return msgsnd(id, msg, size, 0);  // Czeka tylko nadawca tej klasy ruchu
+}
+
+int queue_capacity(int queue) {
+    return queue_capacities[queue];
+}
+
+const char *queue_name(int queue) {
+    return queue >= 0 && queue < QUEUE_COUNT ? queue_names[queue] : "?";
 }
 
 int get_semaphores(void) {
-    int id = semget(SEM_KEY, 0, 0);
+    int id = semget(ipc_key(IPC_SEM), 0, 0);
     if (id == -1) {
         handle_error("get_semaphores: semget failed");
     }
@@ -0,0 +1,334 @@
+#include "wire.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define WIRE_SEND_TIMEOUT_MS 5000  // Brak postępu wysyłki tak długo oznacza martwego odbiorcę
+#define WIRE_POLL_SLICE_MS 100
+
+static void put_u32(unsigned char *p, uint32_t value) {
+    uint32_t be = htonl(value);
+    memcpy(p, &be, sizeof(be));
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    uint32_t be;
+    memcpy(&be, p, sizeof(be));
+    return ntohl(be);
+}
+
+// Rozbija "tcp:HOST:PORT" na host i port (ostatni dwukropek oddziela port)
+static int split_tcp(const char *addr, char *host, size_t host_size, const char **port) {
+    const char *rest = addr + 4;
+    const char *colon = strrchr(rest, ':');
+    if (colon == NULL || colon == rest || colon[1] == '\0' || (size_t)(colon - rest) >= host_size) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(host, rest, (size_t)(colon - rest));
+    host[colon - rest] = '\0';
+    *port = colon + 1;
+    return 0;
+}
+
+static int unix_address(const char *addr, struct sockaddr_un *sun) {
+    const char *path = addr + 5;
+    if (strlen(path) == 0 || strlen(path) >= sizeof(sun->sun_path)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(sun, 0, sizeof(*sun));
+    sun->sun_family = AF_UNIX;
+    strcpy(sun->sun_path, path);
+    return 0;
+}
+
+static int is_unix(const char *addr) {
+    return strncmp(addr, "unix:", 5) == 0;
+}
+
+static int is_tcp(const char *addr) {
+    return strncmp(addr, "tcp:", 4) == 0;
+}
+
+// Batching odbywa się w ramkach, więc algorytm Nagle'a tylko dokładałby opóźnienie
+static void set_nodelay(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+int wire_listen(const char *addr) {
+    int fd = -1;
+
+    if (is_unix(addr)) {
+        struct sockaddr_un sun;
+        if (unix_address(addr, &sun) == -1) {
+            return -1;
+        }
+        unlink(sun.sun_path);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1 || bind(fd, (struct sockaddr *)&sun, sizeof(sun)) == -1) {
+            goto fail;
+        }
+    } else if (is_tcp(addr)) {
+        char host[WIRE_ADDR_MAX];
+        const char *port;
+        if (split_tcp(addr, host, sizeof(host), &port) == -1) {
+            return -1;
+        }
+        struct addrinfo hints, *res;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        int rc = getaddrinfo(host, port, &hints, &res);
+        if (rc != 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        fd = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (fd == -1 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) == -1 ||
+            bind(fd, res->ai_addr, res->ai_addrlen) == -1) {
+            freeaddrinfo(res);
+            goto fail;
+        }
+        freeaddrinfo(res);
+    } else {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (listen(fd, SOMAXCONN) == -1) {
+        goto fail;
+    }
+    return fd;
+
+fail:
+    if (fd != -1) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+    }
+    return -1;
+}
+
+int wire_connect(const char *addr) {
+    int fd = -1;
+
+    if (is_unix(addr)) {
+        struct sockaddr_un sun;
+        if (unix_address(addr, &sun) == -1) {
+            return -1;
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1 || connect(fd, (struct sockaddr *)&sun, sizeof(sun)) == -1) {
+            goto fail;
+        }
+    } else if (is_tcp(addr)) {
+        char host[WIRE_ADDR_MAX];
+        const char *port;
+        if (split_tcp(addr, host, sizeof(host), &port) == -1) {
+            return -1;
+        }
+        struct addrinfo hints, *res;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host, port, &hints, &res) != 0) {
+            errno = EHOSTUNREACH;
+            return -1;
+        }
+        fd = socket(res->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1 || connect(fd, res->ai_addr, res->ai_addrlen) == -1) {
+            freeaddrinfo(res);
+            goto fail;
+        }
+        freeaddrinfo(res);
+    } else {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == -1) {
+        goto fail;
+    }
+    return fd;
+
+fail:
+    if (fd != -1) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+    }
+    return -1;
+}
+
+void wire_unlink(const char *addr) {
+    struct sockaddr_un sun;
+    if (is_unix(addr) && unix_address(addr, &sun) == 0) {
+        unlink(sun.sun_path);
+    }
+}
+
+WireConn *wire_conn_new(int fd) {
+    WireConn *conn = malloc(sizeof(WireConn));
+    if (conn == NULL) {
+        return NULL;
+    }
+    conn->fd = fd;
+    conn->out_len = 0;
+    conn->frame_start = 0;
+    conn->frame_count = 0;
+    conn->in_len = 0;
+    conn->in_pos = 0;
+    conn->in_frame_left = 0;
+    set_nodelay(fd);  // Dla gniazd unix setsockopt() kończy się błędem, który można pominąć
+    return conn;
+}
+
+void wire_conn_free(WireConn *conn) {
+    if (conn != NULL) {
+        close(conn->fd);
+        free(conn);
+    }
+}
+
+static void close_frame(WireConn *conn) {
+    if (conn->frame_count > 0) {
+        put_u32(&conn->out[conn->frame_start], (uint32_t)(conn->frame_count * WIRE_MESSAGE_SIZE));
+        conn->frame_count = 0;
+    }
+}
+
+// Wysyła zamknięte ramki; zwraca 1, gdy bufor jest pusty, 0 gdy gniazdo jest pełne, -1 przy błędzie
+static int send_some(WireConn *conn) {
+    while (conn->out_len > 0) {
+        ssize_t n = send(conn->fd, conn->out, conn->out_len, MSG_NOSIGNAL);
+        if (n > 0) {
+            memmove(conn->out, conn->out + n, conn->out_len - (size_t)n);
+            conn->out_len -= (size_t)n;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        } else {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+int wire_flush(WireConn *conn, int wait) {
+    close_frame(conn);
+
+    long long waited_ms = 0;
+    for (;;) {
+        size_t before = conn->out_len;
+        int rc = send_some(conn);
+        if (rc != 0 || !wait) {
+            return rc == -1 ? -1 : 0;
+        }
+        if (conn->out_len < before) {
+            waited_ms = 0;
+        }
+
+        struct pollfd pfd = {conn->fd, POLLOUT, 0};
+        if (poll(&pfd, 1, WIRE_POLL_SLICE_MS) == 0) {
+            waited_ms += WIRE_POLL_SLICE_MS;
+            if (waited_ms >= WIRE_SEND_TIMEOUT_MS) {
+                errno = ETIMEDOUT;
+                return -1;
+            }
+        }
+    }
+}
+
+int wire_queue(WireConn *conn, int queue, const Message *msg) {
+    if (conn->frame_count == 0) {
+        if (conn->out_len + WIRE_FRAME_MAX > sizeof(conn->out) && wire_flush(conn, 1) == -1) {
+            return -1;
+        }
+        conn->frame_start = conn->out_len;
+        conn->out_len += WIRE_HEADER_SIZE;
+    }
+
+    unsigned char *p = &conn->out[conn->out_len];
+    put_u32(p, (uint32_t)queue);
+    put_u32(p + 4, (uint32_t)msg->mtype);
+    put_u32(p + 8, (uint32_t)msg->group_id);
+    put_u32(p + 12, (uint32_t)msg->group_size);
+    put_u32(p + 16, (uint32_t)msg->table_type);
+    put_u32(p + 20, (uint32_t)msg->table_index);
+    conn->out_len += WIRE_MESSAGE_SIZE;
+
+    if (++conn->frame_count == WIRE_BATCH_MAX) {
+        close_frame(conn);
+    }
+    return 0;
+}
+
+int wire_pending(const WireConn *conn) {
+    return conn->out_len > 0;
+}
+
+ssize_t wire_fill(WireConn *conn) {
+    if (conn->in_pos > 0) {
+        memmove(conn->in, conn->in + conn->in_pos, conn->in_len - conn->in_pos);
+        conn->in_len -= conn->in_pos;
+        conn->in_pos = 0;
+    }
+    if (conn->in_len == sizeof(conn->in)) {
+        return 0;  // Najpierw trzeba zdekodować to, co już jest w buforze
+    }
+
+    ssize_t n = read(conn->fd, conn->in + conn->in_len, sizeof(conn->in) - conn->in_len);
+    if (n > 0) {
+        conn->in_len += (size_t)n;
+        return n;
+    }
+    if (n == 0) {
+        errno = ECONNRESET;
+        return -1;
+    }
+    return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+}
+
+int wire_next(WireConn *conn, int *queue, Message *msg) {
+    if (conn->in_frame_left == 0) {
+        if (conn->in_len - conn->in_pos < WIRE_HEADER_SIZE) {
+            return 0;
+        }
+        uint32_t length = get_u32(&conn->in[conn->in_pos]);
+        if (length == 0 || length % WIRE_MESSAGE_SIZE != 0 || length > WIRE_BATCH_MAX * WIRE_MESSAGE_SIZE) {
+            errno = EPROTO;
+            return -1;
+        }
+        conn->in_frame_left = (int)(length / WIRE_MESSAGE_SIZE);
+        conn->in_pos += WIRE_HEADER_SIZE;
+    }
+    if (conn->in_len - conn->in_pos < WIRE_MESSAGE_SIZE) {
+        return 0;
+    }
+
+    const unsigned char *p = &conn->in[conn->in_pos];
+    uint32_t q = get_u32(p);
+    if (q > WIRE_BROADCAST) {
+        errno = EPROTO;
+        return -1;
+    }
+    *queue = (int)q;
+    msg->mtype = (int32_t)get_u32(p + 4);
+    msg->group_id = (int32_t)get_u32(p + 8);
+    msg->group_size = (int32_t)get_u32(p + 12);
+    msg->table_type = (int32_t)get_u32(p + 16);
+    msg->table_index = (int32_t)get_u32(p + 20);
+    conn->in_pos += WIRE_MESSAGE_SIZE;
+    conn->in_frame_left--;
+    return 1;
+}
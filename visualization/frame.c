@@ -0,0 +1,182 @@
+#include "frame.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *color_codes[] = {
+    "\033[0m", "\033[0;31m", "\033[0;32m", "\033[0;33m", "\033[0;34m", "\033[0;36m", "\033[0;37m",
+};
+
+static const Cell blank_cell = {{' ', 0, 0, 0}, 1, COLOR_DEFAULT};
+
+int frame_init(Frame *frame, int rows, int cols) {
+    memset(frame, 0, sizeof(Frame));
+    return frame_resize(frame, rows, cols);
+}
+
+int frame_resize(Frame *frame, int rows, int cols) {
+    if (rows < 1) rows = 1;
+    if (cols < 1) cols = 1;
+    Cell *cells = malloc((size_t)rows * cols * sizeof(Cell));
+    Cell *shown = malloc((size_t)rows * cols * sizeof(Cell));
+    if (cells == NULL || shown == NULL) {
+        free(cells);
+        free(shown);
+        return -1;
+    }
+    free(frame->cells);
+    free(frame->shown);
+    frame->cells = cells;
+    frame->shown = shown;
+    frame->rows = rows;
+    frame->cols = cols;
+    frame->full_redraw = 1;
+    frame_clear(frame);
+    return 0;
+}
+
+void frame_free(Frame *frame) {
+    free(frame->cells);
+    free(frame->shown);
+    free(frame->out);
+    memset(frame, 0, sizeof(Frame));
+}
+
+void frame_clear(Frame *frame) {
+    size_t n = (size_t)frame->rows * frame->cols;
+    for (size_t i = 0; i < n; i++) {
+        frame->cells[i] = blank_cell;
+    }
+}
+
+static int utf8_length(unsigned char lead) {
+    if (lead < 0x80) return 1;
+    if ((lead & 0xE0) == 0xC0) return 2;
+    if ((lead & 0xF0) == 0xE0) return 3;
+    if ((lead & 0xF8) == 0xF0) return 4;
+    return 1;  // Niepoprawny bajt - traktowany jak pojedynczy znak
+}
+
+int frame_text(Frame *frame, int row, int col, int color, const char *format, ...) {
+    char text[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    if (row < 0 || row >= frame->rows) {
+        return col;
+    }
+    for (const char *p = text; *p != '\0'; ) {
+        int len = utf8_length((unsigned char)*p);
+        if (memchr(p, '\0', len) != NULL) {
+            break;  // Ucięty znak wielobajtowy na końcu bufora
+        }
+        if (col >= 0 && col < frame->cols) {
+            Cell *cell = &frame->cells[(size_t)row * frame->cols + col];
+            memset(cell->glyph, 0, sizeof(cell->glyph));
+            memcpy(cell->glyph, p, len);
+            cell->len = (unsigned char)len;
+            cell->color = (unsigned char)color;
+        }
+        col++;
+        p += len;
+    }
+    return col;
+}
+
+static int out_append(Frame *frame, const char *data, size_t len) {
+    if (frame->out_len + len > frame->out_capacity) {
+        size_t capacity = frame->out_capacity > 0 ? frame->out_capacity : 4096;
+        while (capacity < frame->out_len + len) {
+            capacity *= 2;
+        }
+        char *out = realloc(frame->out, capacity);
+        if (out == NULL) {
+            return -1;
+        }
+        frame->out = out;
+        frame->out_capacity = capacity;
+    }
+    memcpy(frame->out + frame->out_len, data, len);
+    frame->out_len += len;
+    return 0;
+}
+
+static void out_color(Frame *frame, int color) {
+    out_append(frame, color_codes[color & 0x7F], strlen(color_codes[color & 0x7F]));
+    if (color & COLOR_BOLD) {
+        out_append(frame, "\033[1m", 4);
+    }
+}
+
+long frame_flush(Frame *frame, int fd) {
+    int cursor_row = -1;
+    int cursor_col = -1;
+    int current_color = -1;
+    char move[32];
+
+    frame->out_len = 0;
+    if (frame->full_redraw) {
+        static const char clear[] = "\033[?25l\033[0m\033[H\033[2J";
+        out_append(frame, clear, sizeof(clear) - 1);
+        current_color = COLOR_DEFAULT;
+        cursor_row = 0;
+        cursor_col = 0;
+    }
+
+    for (int r = 0; r < frame->rows; r++) {
+        for (int c = 0; c < frame->cols; c++) {
+            size_t i = (size_t)r * frame->cols + c;
+            const Cell *cell = &frame->cells[i];
+            if (frame->full_redraw) {
+                if (memcmp(cell, &blank_cell, sizeof(Cell)) == 0) {
+                    continue;  // Ekran jest już wyczyszczony
+                }
+            } else if (memcmp(cell, &frame->shown[i], sizeof(Cell)) == 0) {
+                continue;
+            }
+
+            if (cursor_row != r || cursor_col != c) {
+                int n = snprintf(move, sizeof(move), "\033[%d;%dH", r + 1, c + 1);
+                out_append(frame, move, n);
+            }
+            if (cell->color != current_color) {
+                out_color(frame, cell->color);
+                current_color = cell->color;
+            }
+            out_append(frame, cell->glyph, cell->len);
+            cursor_row = r;
+            cursor_col = c + 1;
+        }
+    }
+    if (current_color != COLOR_DEFAULT && current_color != -1) {
+        out_append(frame, "\033[0m", 4);
+    }
+
+    memcpy(frame->shown, frame->cells, (size_t)frame->rows * frame->cols * sizeof(Cell));
+    frame->full_redraw = 0;
+    frame->last_bytes = frame->out_len;
+
+    size_t written = 0;
+    while (written < frame->out_len) {
+        ssize_t n = write(fd, frame->out + written, frame->out_len - written);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        written += (size_t)n;
+    }
+    return (long)written;
+}
+
+void frame_restore_terminal(Frame *frame, int fd) {
+    char tail[48];
+    int n = snprintf(tail, sizeof(tail), "\033[0m\033[%d;1H\033[?25h\n", frame->rows);
+    if (write(fd, tail, n) == -1) {
+        // Terminal zamknięty - nic do przywrócenia
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stddef.h>
+
+// Kolory komórek (ANSI)
+#define COLOR_DEFAULT 0
+#define COLOR_RED 1
+#define COLOR_GREEN 2
+#define COLOR_YELLOW 3
+#define COLOR_BLUE 4
+#define COLOR_CYAN 5
+#define COLOR_WHITE 6
+#define COLOR_BOLD 0x80  // Flaga pogrubienia, łączona z kolorem
+
+// Jedna komórka ekranu: jeden znak UTF-8 (1-4 bajty) i kolor
+typedef struct {
+    char glyph[4];
+    unsigned char len;
+    unsigned char color;
+} Cell;
+
+// Bufor klatki: bieżąca i poprzednio wysłana zawartość ekranu
+typedef struct {
+    int rows;
+    int cols;
+    Cell *cells;        // Budowana klatka
+    Cell *shown;        // Zawartość terminala po ostatnim frame_flush()
+    int full_redraw;    // Następny flush czyści ekran i rysuje wszystko
+    char *out;          // Bufor wyjściowy - jedna operacja write() na klatkę
+    size_t out_len;
+    size_t out_capacity;
+    size_t last_bytes;  // Liczba bajtów wysłanych w ostatniej klatce
+} Frame;
+
+/**
+ * Tworzy bufor klatki o podanym rozmiarze.
+ * @return 0 przy sukcesie, -1 przy braku pamięci
+ */
+int frame_init(Frame *frame, int rows, int cols);
+
+/**
+ * Zmienia rozmiar (np. po SIGWINCH) - następna klatka jest rysowana w całości.
+ * @return 0 przy sukcesie, -1 przy braku pamięci
+ */
+int frame_resize(Frame *frame, int rows, int cols);
+
+void frame_free(Frame *frame);
+
+/**
+ * Czyści budowaną klatkę (spacje bez koloru).
+ */
+void frame_clear(Frame *frame);
+
+/**
+ * Wpisuje tekst UTF-8 od pozycji (row, col), jeden znak na komórkę; tekst poza ekranem jest obcinany.
+ * @return kolumna za ostatnim wpisanym znakiem
+ */
+int frame_text(Frame *frame, int row, int col, int color, const char *format, ...)
+    __attribute__((format(printf, 5, 6)));
+
+/**
+ * Wysyła do fd tylko komórki różniące się od poprzedniej klatki (jedno write()).
+ * @return liczba wysłanych bajtów lub -1 przy błędzie zapisu
+ */
+long frame_flush(Frame *frame, int fd);
+
+/**
+ * Przywraca terminal (kolory, kursor) - wywoływane przy wyjściu.
+ */
+void frame_restore_terminal(Frame *frame, int fd);
+
+#endif // FRAME_H
@@ -1,226 +1,640 @@
 #include "../include/common.h"
+#include "../include/occupancy.h"
+#include "../include/utils.h"
+#include "../include/snapshot.h"
+#include "../include/lockprof.h"
+#include "../include/recording.h"
+#include "frame.h"
+#include <poll.h>
+#include <termios.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <sys/sem.h>
 
-// ANSI color codes
-#define RESET   "\033[0m"
-#define GREEN   "\033[32m"
-#define YELLOW  "\033[33m"
-#define RED     "\033[31m"
-#define BLUE    "\033[34m"
-#define CYAN    "\033[36m"
-#define WHITE   "\033[37m"
-#define BOLD    "\033[1m"
+#define DEFAULT_FPS 1
+#define REPLAY_FPS 20     // Domyślnie przy --replay - nagranie ma zwykle dziesiątki próbek na sekundę
+#define MAX_FPS 60
+#define REPLAY_MAX_SPEED 64.0
+#define REPLAY_MIN_SPEED (1.0 / 16)
 
-// Clear screen
-#define CLEAR_SCREEN "\033[2J\033[H"
+// Tryby rysowania stolików - wybierany najdokładniejszy, który mieści się na ekranie
+#define MODE_DETAILED 0   // [XX__ 2/4] - miejsca i grupy przy każdym stoliku
+#define MODE_COMPACT 1    // Jeden znak na stolik
+#define MODE_AGGREGATE 2  // Jeden znak na kilka stolików (stopień zapełnienia)
 
+#define STATS_ROWS 8      // Sekcja statystyk obłożenia (z pustą linią)
+#define FOOTER_ROWS 1
+
+// Źródło stanu: strumień publikatora (domyślnie), bezpośrednio pamięć współdzielona (--shm)
+// albo nagranie publikatora (--replay)
+static int use_shm = 0;
+static int use_replay = 0;
+static RecordingReplay replay;
+static int64_t replay_position_ns = 0;  // Chwila nagrania (sampled_ns) na ekranie
+static double replay_speed = 1.0;
+static int replay_paused = 0;
+static SnapshotClient client;
 static SharedState *shared_state = NULL;
 static int sem_id = -1;
-static volatile int running = 1;
+static volatile sig_atomic_t running = 1;
+static volatile sig_atomic_t resized = 0;
+static int verify_stats = 0;  // --verify: porównanie wersji SIMD ze skalarną w każdej klatce
+
+static const int group_colors[] = {COLOR_GREEN, COLOR_YELLOW, COLOR_BLUE, COLOR_CYAN};
 
 void signal_handler(int sig) {
-    (void)sig;
+    if (sig == SIGWINCH) {
+        resized = 1;
+        return;
+    }
     running = 0;
 }
 
-void sem_wait(int sem_id, int sem_num) {
+static LockHold state_hold;  // Bieżące wejście do SEM_SHARED_STATE w profilu blokad
+
+static int sem_op_state(int op) {
     struct sembuf sem_op;
-    sem_op.sem_num = sem_num;
-    sem_op.sem_op = -1;
+    sem_op.sem_num = SEM_SHARED_STATE;
+    sem_op.sem_op = op;
     sem_op.sem_flg = 0;
-    semop(sem_id, &sem_op, 1);
+    long long wait_start = lockprof_begin();
+    if (op > 0) {
+        lockprof_released(&state_hold);
+    }
+    while (semop(sem_id, &sem_op, 1) == -1) {
+        if (errno != EINTR) {
+            return -1;  // Semafor usunięty - symulacja zakończona
+        }
+    }
+    if (op < 0) {
+        state_hold = lockprof_acquired("SEM_SHARED_STATE", "viz take_snapshot", wait_start);
+    }
+    return 0;
 }
 
-void sem_signal(int sem_id, int sem_num) {
-    struct sembuf sem_op;
-    sem_op.sem_num = sem_num;
-    sem_op.sem_op = 1;
-    sem_op.sem_flg = 0;
-    semop(sem_id, &sem_op, 1);
-}
-
-static int get_group_id(int table_type, int table_index, int seat) {
-    switch (table_type) {
-        case 1: return shared_state->table_1_groups[table_index][seat];
-        case 2: return shared_state->table_2_groups[table_index][seat];
-        case 3: return shared_state->table_3_groups[table_index][seat];
-        case 4: return shared_state->table_4_groups[table_index][seat];
-        default: return 0;
-    }
-}
-
-static void collect_groups(int table_type, int table_index, int groups[4], int *group_count) {
-    *group_count = 0;
-    int max_seats = (table_type == 1) ? 1 : (table_type == 2) ? 2 : (table_type == 3) ? 3 : 4;
-    
-    for (int i = 0; i < max_seats; i++) {
-        int gid = get_group_id(table_type, table_index, i);
-        if (gid > 0) {
-            int found = 0;
-            for (int j = 0; j < *group_count; j++) {
-                if (groups[j] == gid) {
-                    found = 1;
-                    break;
-                }
-            }
-            if (!found) {
-                groups[(*group_count)++] = gid;
-            }
+static int attach_shm(void) {
+    int shm_id = shmget(ipc_key(IPC_SHM), sizeof(SharedState), 0);
+    if (shm_id == -1) {
+        fprintf(stderr, "Błąd: Nie można otworzyć shared memory. Upewnij się, że ./bin/bar (instancja %d) jest uruchomiony.\n", ipc_instance());
+        return -1;
+    }
+
+    shared_state = (SharedState *)shmat(shm_id, NULL, SHM_RDONLY);
+    if (shared_state == (void *)-1) {
+        perror("shmat failed");
+        shared_state = NULL;
+        return -1;
+    }
+
+    sem_id = semget(ipc_key(IPC_SEM), 0, 0);
+    if (sem_id == -1) {
+        fprintf(stderr, "Błąd: Nie można otworzyć semaforów.\n");
+        shmdt(shared_state);
+        shared_state = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static int attach_source(void) {
+    if (use_shm) {
+        return attach_shm();
+    }
+    if (snapshot_connect(&client) == -1) {
+        fprintf(stderr, "Błąd: Brak publikatora stanu instancji %d (%s).\n"
+                        "Uruchom ./bin/bar --publish 20 lub ./bin/publisher -i %d, albo użyj ./viz --shm.\n",
+                ipc_instance(), strerror(errno), ipc_instance());
+        return -1;
+    }
+    // Pierwsza klatka kluczowa - publikator wysyła ją najpóźniej po jednym okresie próbkowania
+    while (running && !client.have_state) {
+        if (snapshot_receive(&client, 1000) == -1) {
+            fprintf(stderr, "Błąd: Publikator zamknął połączenie.\n");
+            snapshot_close(&client);
+            return -1;
         }
     }
+    return running ? 0 : -1;
 }
 
-static int count_group_seats(int table_type, int table_index, int group_id) {
-    int max_seats = (table_type == 1) ? 1 : (table_type == 2) ? 2 : (table_type == 3) ? 3 : 4;
-    int count = 0;
-    
-    for (int i = 0; i < max_seats; i++) {
-        if (get_group_id(table_type, table_index, i) == group_id) {
-            count++;
+static void detach_source(void) {
+    if (use_replay) {
+        recording_replay_close(&replay);
+    } else if (use_shm) {
+        shmdt(shared_state);
+    } else {
+        snapshot_close(&client);
+    }
+}
+
+// Kopiuje bieżący stan sali; cała dalsza praca odbywa się na kopii.
+// Z --shm kopia powstaje pod semaforem, w przeciwnym razie z klatek publikatora (bez dotykania sali).
+static int take_snapshot(SharedState *snapshot) {
+    if (!use_shm) {
+        if (snapshot_receive(&client, 0) == -1) {
+            return -1;  // Publikator zakończył pracę razem z symulacją
         }
+        memcpy(snapshot, &client.state, sizeof(SharedState));
+        return 0;
     }
-    return count;
+    if (sem_op_state(-1) == -1) {
+        return -1;
+    }
+    memcpy(snapshot, shared_state, sizeof(SharedState));
+    sem_op_state(1);
+    return 0;
 }
 
-void print_table_status(int table_type, int table_index, int occupied, int capacity) {
+static void terminal_size(int *rows, int *cols) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        *rows = ws.ws_row;
+        *cols = ws.ws_col;
+        return;
+    }
+    const char *lines = getenv("LINES");
+    const char *columns = getenv("COLUMNS");
+    *rows = lines != NULL && atoi(lines) > 0 ? atoi(lines) : 24;
+    *cols = columns != NULL && atoi(columns) > 0 ? atoi(columns) : 80;
+}
+
+static int table_count(const SharedState *s, int type) {
+    switch (type) {
+        case 1: return X1;
+        case 2: return X2;
+        case 3: return s->effective_x3;
+        default: return X4;
+    }
+}
+
+static int table_occupied(const SharedState *s, int type, int index) {
+    switch (type) {
+        case 1: return s->table_1[index];
+        case 2: return s->table_2[index];
+        case 3: return s->table_3[index];
+        default: return s->table_4[index];
+    }
+}
+
+static const int *table_seats(const SharedState *s, int type, int index) {
+    switch (type) {
+        case 1: return s->table_1_groups[index];
+        case 2: return s->table_2_groups[index];
+        case 3: return s->table_3_groups[index];
+        default: return s->table_4_groups[index];
+    }
+}
+
+// Liczba różnych grup przy stoliku i kolor każdego miejsca - jeden przebieg po miejscach
+static int seat_colors(const int *seats, int capacity, int colors[4]) {
+    int seen[4];
+    int group_count = 0;
+    for (int i = 0; i < capacity; i++) {
+        colors[i] = -1;
+        if (seats[i] <= 0) continue;
+        int g = 0;
+        while (g < group_count && seen[g] != seats[i]) g++;
+        if (g == group_count) seen[group_count++] = seats[i];
+        colors[i] = g;
+    }
+    return group_count;
+}
+
+static int detailed_width(int occupied, int capacity) {
+    return occupied == 0 ? 3 : capacity + 6;  // "[ ]" lub "[XX__ 2/4]"
+}
+
+static void draw_table_detailed(Frame *f, int row, int col, const SharedState *s, int type, int index) {
+    int capacity = type;
+    int occupied = table_occupied(s, type, index);
+
     if (occupied == -1) {
-        printf(RED "[");
-        for (int i = 0; i < capacity; i++) {
-            printf("X");
-        }
-        printf(" %d/%d]" RESET, capacity, capacity);
+        col = frame_text(f, row, col, COLOR_RED, "[");
+        for (int i = 0; i < capacity; i++) col = frame_text(f, row, col, COLOR_RED, "X");
+        frame_text(f, row, col, COLOR_RED, " %d/%d]", capacity, capacity);
         return;
     }
-    
     if (occupied == 0) {
-        printf(WHITE "[ ]" RESET);
+        frame_text(f, row, col, COLOR_WHITE, "[ ]");
         return;
     }
-    
-    int groups[4] = {0, 0, 0, 0};
-    int group_count = 0;
-    collect_groups(table_type, table_index, groups, &group_count);
-    
-    printf("[");
-    
-    if (group_count == 1) {
-        for (int j = 0; j < occupied; j++) {
-            printf(GREEN "X" RESET);
-        }
-    } else if (group_count > 1) {
-        const char* colors[] = {GREEN, YELLOW, BLUE, CYAN};
-        for (int i = 0; i < group_count; i++) {
-            int group_seats = count_group_seats(table_type, table_index, groups[i]);
-            for (int j = 0; j < group_seats; j++) {
-                printf("%sX" RESET, colors[i % 4]);
+
+    int colors[4];
+    const int *seats = table_seats(s, type, index);
+    int groups = seat_colors(seats, capacity, colors);
+
+    col = frame_text(f, row, col, COLOR_DEFAULT, "[");
+    for (int i = 0; i < capacity; i++) {
+        if (colors[i] >= 0) {
+            col = frame_text(f, row, col, groups == 1 ? COLOR_GREEN : group_colors[colors[i]], "X");
+        }
+    }
+    for (int i = 0; i < capacity; i++) {
+        if (colors[i] < 0) col = frame_text(f, row, col, COLOR_WHITE, "_");
+    }
+    frame_text(f, row, col, COLOR_DEFAULT, " %d/%d]", occupied, capacity);
+}
+
+static void draw_table_compact(Frame *f, int row, int col, const SharedState *s, int type, int index) {
+    int occupied = table_occupied(s, type, index);
+    if (occupied == -1) {
+        frame_text(f, row, col, COLOR_RED, "R");
+    } else if (occupied == 0) {
+        frame_text(f, row, col, COLOR_WHITE, ".");
+    } else {
+        int colors[4];
+        int groups = seat_colors(table_seats(s, type, index), type, colors);
+        frame_text(f, row, col, groups == 1 ? COLOR_GREEN : COLOR_YELLOW, "%d", occupied);
+    }
+}
+
+// Jeden znak dla kolejnych `per_cell` stolików: stopień zapełnienia miejsc (bez zarezerwowanych)
+static void draw_bucket(Frame *f, int row, int col, const SharedState *s, int type, int first, int per_cell) {
+    static const char *shades[] = {".", "░", "▒", "▓", "█"};
+    int count = table_count(s, type);
+    int seats = 0, occupied = 0, reserved = 0;
+
+    for (int i = first; i < first + per_cell && i < count; i++) {
+        int occ = table_occupied(s, type, i);
+        if (occ == -1) {
+            reserved++;
+        } else {
+            seats += type;
+            occupied += occ;
+        }
+    }
+    if (seats == 0) {
+        frame_text(f, row, col, reserved > 0 ? COLOR_RED : COLOR_WHITE, reserved > 0 ? "R" : " ");
+        return;
+    }
+    int level = (occupied * 4 + seats - 1) / seats;
+    frame_text(f, row, col, occupied == 0 ? COLOR_WHITE : COLOR_GREEN, "%s", shades[level]);
+}
+
+// Rysuje sekcję stolików od wiersza row; zwraca wiersz za sekcją (także poza ekranem - do wyboru trybu)
+static int draw_tables(Frame *f, int row, const SharedState *s, int mode, int max_rows) {
+    int indent = 4;
+
+    for (int type = 1; type <= 4; type++) {
+        int count = table_count(s, type);
+        int col;
+
+        if (mode == MODE_DETAILED) {
+            col = frame_text(f, row, 0, COLOR_DEFAULT, "  Stoliki %d-osobowe (%d): ", type, count);
+            for (int i = 0; i < count; i++) {
+                int width = detailed_width(table_occupied(s, type, i), type);
+                if (col + width >= f->cols && col > indent) {
+                    row++;
+                    col = indent;
+                }
+                draw_table_detailed(f, row, col, s, type, i);
+                col += width + 1;
             }
+            if (type == 3 && count < X3_MAX) {
+                frame_text(f, row, col, COLOR_WHITE, "(max: %d)", X3_MAX);
+            }
+        } else if (mode == MODE_COMPACT) {
+            col = frame_text(f, row, 0, COLOR_DEFAULT, "  %d-os. (%d): ", type, count);
+            for (int i = 0; i < count; i++) {
+                if (col >= f->cols) {
+                    row++;
+                    col = indent;
+                }
+                draw_table_compact(f, row, col++, s, type, i);
+            }
+        } else {
+            // Każdy typ dostaje równą część dostępnych wierszy
+            int rows_per_type = max_rows / 4 > 0 ? max_rows / 4 : 1;
+            int label = snprintf(NULL, 0, "  %d-os. (%d, 1 znak = %d): ", type, count, count);
+            int capacity = (f->cols - label) + (rows_per_type - 1) * (f->cols - indent);
+            if (capacity < 1) capacity = 1;
+            int per_cell = (count + capacity - 1) / capacity;
+            if (per_cell < 1) per_cell = 1;
+            col = frame_text(f, row, 0, COLOR_DEFAULT, "  %d-os. (%d, 1 znak = %d): ", type, count, per_cell);
+            for (int i = 0; i < count; i += per_cell) {
+                if (col >= f->cols) {
+                    row++;
+                    col = indent;
+                }
+                draw_bucket(f, row, col++, s, type, i, per_cell);
+            }
+        }
+        row++;
+    }
+    return row;
+}
+
+static int draw_queue(Frame *f, int row, const SharedState *s, int last_row) {
+    if (s->waiting_count <= 0) {
+        return row;
+    }
+    frame_text(f, ++row, 0, COLOR_BOLD, "KOLEJKA OCZEKUJĄCYCH (%d grup):", s->waiting_count);
+    row++;
+
+    int shown = 0;
+    for (int i = 0; i < s->waiting_count && i < MAX_WAITING_GROUPS; i++) {
+        if (row >= last_row - 1 && i < s->waiting_count - 1) {
+            frame_text(f, row++, 0, COLOR_DEFAULT, "  ... i %d kolejnych", s->waiting_count - shown);
+            break;
+        }
+        int group_id = s->waiting_group_ids[i];
+        int group_size = s->waiting_group_sizes[i];
+        if (group_id <= 0) continue;
+        int col = frame_text(f, row, 0, COLOR_DEFAULT, "  [%d] Grupa #%d: %d os.  ", i + 1, group_id, group_size);
+        for (int j = 0; j < group_size; j++) {
+            col = frame_text(f, row, col, COLOR_YELLOW, "X");
         }
+        row++;
+        shown++;
+    }
+    return row;
+}
+
+static int draw_stats(Frame *f, int row, const OccupancyStats *stats, int stats_ok) {
+    frame_text(f, ++row, 0, COLOR_BOLD, "OBŁOŻENIE (%s):", occupancy_backend());
+    row++;
+    for (int t = 0; t < 4; t++) {
+        const TableTypeStats *ts = &stats->type[t];
+        frame_text(f, row++, 0, COLOR_DEFAULT, "  %d-os.: zajęte %d, wolne %d, zarezerwowane %d, fragmentacja %d",
+                   t + 1, ts->seats_occupied, ts->seats_free, ts->seats_reserved, ts->seats_fragmented);
+    }
+    frame_text(f, row++, 0, COLOR_DEFAULT, "  Razem: zajęte %d, wolne %d (użyteczne %d), zarezerwowane %d",
+               stats->total.seats_occupied, stats->total.seats_free,
+               stats->total.seats_free - stats->total.seats_fragmented, stats->total.seats_reserved);
+    if (!stats_ok) {
+        frame_text(f, row++, 0, COLOR_RED, "  BŁĄD: wynik SIMD różni się od wersji skalarnej!");
+    }
+    return row;
+}
+
+// Buduje całą klatkę z kopii stanu (bez semafora)
+static void render(Frame *f, const SharedState *s, int fps, unsigned long frame_no) {
+    OccupancyStats stats;
+    int stats_ok = 1;
+
+    occupancy_stats(s, &stats);
+    if (verify_stats) {
+        stats_ok = occupancy_stats_verify(s);
     }
-    
-    for (int j = occupied; j < capacity; j++) {
-        printf(WHITE "_" RESET);
-    }
-    
-    printf(" %d/%d]", occupied, capacity);
-}
-
-void visualize(void) {
-    printf(CLEAR_SCREEN);
-    sem_wait(sem_id, SEM_SHARED_STATE);
-    
-    if (shared_state->reserved_seats > 0) {
-        printf("  " RED "Zarezerwowane stoliki: %d miejsc (całe stoliki zarezerwowane do końca symulacji)" RESET "\n", 
-               shared_state->reserved_seats);
-    }
-
-    sem_signal(sem_id, SEM_SHARED_STATE);
-    
-    printf(BOLD "\nSTOLIKI:\n" RESET);
-    
-    sem_wait(sem_id, SEM_SHARED_STATE);
-    
-    int x3_count = shared_state->effective_x3;
-    
-    printf("\n  Stoliki 1-osobowe (%d): ", X1);
-    for (int i = 0; i < X1; i++) {
-        print_table_status(1, i, shared_state->table_1[i], 1);
-        printf(" ");
-    }
-    
-    printf("\n  Stoliki 2-osobowe (%d): ", X2);
-    for (int i = 0; i < X2; i++) {
-        print_table_status(2, i, shared_state->table_2[i], 2);
-        printf(" ");
-    }
-    
-    printf("\n  Stoliki 3-osobowe (%d): ", x3_count);
-    for (int i = 0; i < x3_count; i++) {
-        print_table_status(3, i, shared_state->table_3[i], 3);
-        printf(" ");
-    }
-    if (x3_count < X3_MAX) {
-        printf(WHITE " (max: %d)" RESET, X3_MAX);
-    }
-    
-    printf("\n  Stoliki 4-osobowe (%d): ", X4);
-    for (int i = 0; i < X4; i++) {
-        print_table_status(4, i, shared_state->table_4[i], 4);
-        printf(" ");
-    }
-    
-    if (shared_state->waiting_count > 0) {
-        printf(BOLD "\n\nKOLEJKA OCZEKUJĄCYCH (%d grup):\n" RESET, shared_state->waiting_count);
-        for (int i = 0; i < shared_state->waiting_count && i < MAX_WAITING_GROUPS; i++) {
-            int group_size = shared_state->waiting_group_sizes[i];
-            int group_id = shared_state->waiting_group_ids[i];
-            if (group_id > 0) {
-                printf("  [%d] Grupa #%d: %d os.  ", i + 1, group_id, group_size);
-                for (int j = 0; j < group_size; j++) {
-                    printf(YELLOW "X" RESET);
+
+    frame_clear(f);
+    int row = 0;
+    if (s->reserved_seats > 0) {
+        frame_text(f, row++, 2, COLOR_RED, "Zarezerwowane stoliki: %d miejsc", s->reserved_seats);
+    }
+    if (s->fire_alarm) {
+        frame_text(f, row++, 2, COLOR_RED | COLOR_BOLD, "POŻAR - ewakuacja");
+    }
+    frame_text(f, ++row, 0, COLOR_BOLD, "STOLIKI:");
+    row++;
+
+    // Najdokładniejszy tryb, który zostawia miejsce na statystyki i stopkę
+    int footer_row = f->rows - FOOTER_ROWS;
+    int tables_limit = footer_row - STATS_ROWS;
+    int mode = MODE_DETAILED;
+    int end = draw_tables(f, row, s, mode, tables_limit - row);
+    if (end > tables_limit) {
+        mode = MODE_COMPACT;
+        frame_clear(f);
+        row = 0;
+        frame_text(f, row++, 0, COLOR_BOLD, "STOLIKI (widok skrócony: . wolny, N zajęte miejsca, R rezerwacja):");
+        end = draw_tables(f, row, s, mode, tables_limit - row);
+    }
+    if (end > tables_limit) {
+        mode = MODE_AGGREGATE;
+        frame_clear(f);
+        row = 0;
+        frame_text(f, row++, 0, COLOR_BOLD, "STOLIKI (widok zbiorczy: . ░ ▒ ▓ █ zapełnienie, R rezerwacja):");
+        end = draw_tables(f, row, s, mode, tables_limit - row);
+    }
+
+    row = draw_queue(f, end, s, tables_limit);
+    if (row < tables_limit) {
+        row = tables_limit;
+    }
+    draw_stats(f, row, &stats, stats_ok);
+
+    if (use_replay) {
+        int64_t origin = s->simulation_start_ns > 0 ? s->simulation_start_ns : replay.frames[0].sampled_ns;
+        frame_text(f, footer_row, 0, COLOR_WHITE,
+                   "nagranie: t %.3f s (%.3f s) | klatka %zu/%zu | x%g%s | spacja pauza, </> 1 s, ^/v 10 s, "
+                   ",/. klatka, +/- tempo, q wyjście",
+                   (replay_position_ns - origin) / 1e9, (replay.frames[replay.count - 1].sampled_ns - origin) / 1e9,
+                   replay.current + 1, replay.count, replay_speed, replay_paused ? " PAUZA" : "");
+    } else if (use_shm) {
+        frame_text(f, footer_row, 0, COLOR_WHITE, "instancja %d | shm | %d fps | klatka %lu | %zu B | Ctrl+C - wyjście",
+                   ipc_instance(), fps, frame_no, f->last_bytes);
+    } else {
+        frame_text(f, footer_row, 0, COLOR_WHITE,
+                   "instancja %d | publikator: stan #%llu, %lu kluczowych, %llu B | %d fps | klatka %lu | %zu B",
+                   ipc_instance(), (unsigned long long)client.seq, client.keyframes, client.bytes,
+                   fps, frame_no, f->last_bytes);
+    }
+}
+
+// Przesuwa odtwarzanie na chwilę nagrania (w granicach nagrania)
+static void replay_move_to(int64_t position_ns) {
+    int64_t first = replay.frames[0].sampled_ns;
+    int64_t last = replay.frames[replay.count - 1].sampled_ns;
+    replay_position_ns = position_ns < first ? first : position_ns > last ? last : position_ns;
+}
+
+// Klawisze odtwarzania (terminal bez buforowania linii); zwraca 0 po 'q'
+static int handle_replay_keys(void) {
+    char keys[64];
+    ssize_t n = read(STDIN_FILENO, keys, sizeof(keys));
+    for (ssize_t i = 0; i < n; i++) {
+        // Strzałki: ESC [ A..D
+        if (keys[i] == '\033' && i + 2 < n && keys[i + 1] == '[') {
+            char code = keys[i + 2];
+            i += 2;
+            long long step = code == 'C' ? 1000000000LL : code == 'D' ? -1000000000LL
+                           : code == 'A' ? 10000000000LL : code == 'B' ? -10000000000LL : 0;
+            replay_move_to(replay_position_ns + step);
+            continue;
+        }
+        switch (keys[i]) {
+            case 'q':
+                return 0;
+            case ' ':
+                replay_paused = !replay_paused;
+                if (!replay_paused && replay.current + 1 == replay.count) {
+                    replay_move_to(replay.frames[0].sampled_ns);  // Wznowienie na końcu - od początku
                 }
-                printf("\n");
+                break;
+            case '+':
+                replay_speed = replay_speed * 2 > REPLAY_MAX_SPEED ? REPLAY_MAX_SPEED : replay_speed * 2;
+                break;
+            case '-':
+                replay_speed = replay_speed / 2 < REPLAY_MIN_SPEED ? REPLAY_MIN_SPEED : replay_speed / 2;
+                break;
+            case ',':
+                replay_paused = 1;
+                replay_move_to(replay.frames[replay.current > 0 ? replay.current - 1 : 0].sampled_ns);
+                break;
+            case '.':
+                replay_paused = 1;
+                replay_move_to(replay.frames[replay.current + 1 < replay.count ? replay.current + 1 : replay.current]
+                                   .sampled_ns);
+                break;
+            case 'g':
+                replay_move_to(replay.frames[0].sampled_ns);
+                break;
+            case 'G':
+                replay_move_to(replay.frames[replay.count - 1].sampled_ns);
+                break;
+        }
+    }
+    return 1;
+}
+
+// Odtwarzanie nagrania: chwila nagrania płynie z tempem replay_speed, klawisze czytane między klatkami
+static void run_replay(Frame *frame, int fps) {
+    struct termios saved;
+    int tty = isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved) == 0;
+    if (tty) {
+        struct termios raw = saved;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    }
+
+    replay_move_to(replay.frames[0].sampled_ns);
+    long long period_ns = 1000000000LL / fps;
+    long long last_ns = monotonic_ns();
+    unsigned long frame_no = 0;
+
+    while (running) {
+        if (resized) {
+            int rows, cols;
+            resized = 0;
+            terminal_size(&rows, &cols);
+            frame_resize(frame, rows, cols);
+        }
+        long long now_ns = monotonic_ns();
+        if (!replay_paused) {
+            replay_move_to(replay_position_ns + (int64_t)((now_ns - last_ns) * replay_speed));
+            if (replay_position_ns == replay.frames[replay.count - 1].sampled_ns) {
+                replay_paused = 1;  // Koniec nagrania
             }
         }
+        last_ns = now_ns;
+
+        if (recording_seek(&replay, recording_find(&replay, replay_position_ns)) == -1) {
+            break;  // Uszkodzona klatka
+        }
+        render(frame, &replay.state, fps, ++frame_no);
+        if (frame_flush(frame, STDOUT_FILENO) == -1) {
+            break;
+        }
+
+        struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+        if (poll(&pfd, tty ? 1 : 0, (int)(period_ns / 1000000)) > 0 && handle_replay_keys() == 0) {
+            break;
+        }
+    }
+
+    if (tty) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved);
     }
-    
-    sem_signal(sem_id, SEM_SHARED_STATE);
-    
-    fflush(stdout);
 }
 
-int main(void) {
+int main(int argc, char *argv[]) {
+    int fps = 0;
+    const char *replay_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--verify") == 0) {
+            verify_stats = 1;
+        } else if (strcmp(argv[i], "--shm") == 0) {
+            use_shm = 1;
+        } else if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--instance") == 0) && i + 1 < argc) {
+            ipc_set_instance(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            fps = atoi(argv[++i]);
+            if (fps < 1 || fps > MAX_FPS) {
+                fprintf(stderr, "Błąd: --fps musi być w zakresie 1..%d\n", MAX_FPS);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--lockprof") == 0 && i + 1 < argc) {
+            setenv(LOCKPROF_ENV, argv[++i], 1);  // Raport na stderr po przywróceniu terminala
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+            use_replay = 1;
+        }
+    }
+    if (fps == 0) {
+        fps = use_replay ? REPLAY_FPS : DEFAULT_FPS;
+    }
+    lockprof_init("viz", stderr);
+
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
-    
-    int shm_id = shmget(SHM_KEY, sizeof(SharedState), 0);
-    if (shm_id == -1) {
-        fprintf(stderr, "Błąd: Nie można otworzyć shared memory. Upewnij się, że ./bin/bar jest uruchomiony.\n");
+    signal(SIGWINCH, signal_handler);
+
+    if (use_replay) {
+        if (recording_open(&replay, replay_path) == -1) {
+            fprintf(stderr, "Błąd: Nie można otworzyć nagrania %s: %s\n", replay_path,
+                    errno == EINVAL ? "nieznany format" : strerror(errno));
+            return EXIT_FAILURE;
+        }
+        if (replay.count == 0) {
+            fprintf(stderr, "Błąd: Nagranie %s nie zawiera klatek.\n", replay_path);
+            recording_replay_close(&replay);
+            return EXIT_FAILURE;
+        }
+    } else if (attach_source() == -1) {
         return EXIT_FAILURE;
     }
-    
-    shared_state = (SharedState *)shmat(shm_id, NULL, 0);
-    if (shared_state == (void *)-1) {
-        perror("shmat failed");
+
+    int rows, cols;
+    terminal_size(&rows, &cols);
+    Frame frame;
+    if (frame_init(&frame, rows, cols) == -1) {
+        perror("frame_init failed");
+        detach_source();
         return EXIT_FAILURE;
     }
-    
-    sem_id = semget(SEM_KEY, 0, 0);
-    if (sem_id == -1) {
-        fprintf(stderr, "Błąd: Nie można otworzyć semaforów.\n");
-        shmdt(shared_state);
-        return EXIT_FAILURE;
+
+    SharedState snapshot;
+    unsigned long frame_no = 0;
+    long long period_ns = 1000000000LL / fps;
+    long long next_ns = monotonic_ns();
+
+    if (use_replay) {
+        run_replay(&frame, fps);
     }
-    
-    sleep(1);
-    
-    while (running) {
-        visualize();
-        sleep(1);
+    while (running && !use_replay) {
+        if (resized) {
+            resized = 0;
+            terminal_size(&rows, &cols);
+            frame_resize(&frame, rows, cols);
+        }
+        if (take_snapshot(&snapshot) == -1) {
+            break;
+        }
+        render(&frame, &snapshot, fps, ++frame_no);
+        if (frame_flush(&frame, STDOUT_FILENO) == -1) {
+            break;
+        }
+
+        // Stałe tempo klatek: sen do bezwzględnego terminu następnej klatki
+        next_ns += period_ns;
+        long long now_ns = monotonic_ns();
+        if (next_ns < now_ns) {
+            next_ns = now_ns;  // Opóźnienie - bez nadrabiania zaległych klatek
+        }
+        struct timespec wake;
+        wake.tv_sec = next_ns / 1000000000LL;
+        wake.tv_nsec = next_ns % 1000000000LL;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
     }
-    
-    shmdt(shared_state);
+
+    frame_restore_terminal(&frame, STDOUT_FILENO);
+    frame_free(&frame);
+    detach_source();
     return EXIT_SUCCESS;
 }